@@ -3,3 +3,5 @@
 # Order matters, find kwiver, then the fletch kwiver used
 include( kwant-depends-kwiver )
 include( kwant-depends-fletch )
+
+find_package( Threads REQUIRED )
@@ -0,0 +1,263 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "box_overlap_batch.h"
+
+#include <cmath>
+
+#if defined( __GNUC__ ) && ( defined( __x86_64__ ) || defined( __i386__ ))
+#define BOX_OVERLAP_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define BOX_OVERLAP_X86_KERNELS 0
+#endif
+
+using std::sqrt;
+
+namespace // anon
+{
+
+struct kernel_args
+{
+  const double *ax0, *ay0, *ax1, *ay1;
+  const double *bx0, *by0, *bx1, *by1;
+  unsigned char* hit;
+  double *a_area, *b_area, *o_area, *cd, *cbd;
+};
+
+typedef void (*kernel_type)( const kernel_args&, size_t, size_t );
+
+//
+// The reference kernel, for pairs [begin, end).  vgl_intersection takes
+// the max of the mins and the min of the maxes; the result is empty if
+// either min exceeds its max.  The vector kernels below must evaluate
+// exactly these expressions.
+//
+
+void
+scalar_kernel( const kernel_args& a, size_t begin, size_t end )
+{
+  for (size_t i=begin; i<end; ++i)
+  {
+    double ix0 = (a.ax0[i] > a.bx0[i]) ? a.ax0[i] : a.bx0[i];
+    double iy0 = (a.ay0[i] > a.by0[i]) ? a.ay0[i] : a.by0[i];
+    double ix1 = (a.ax1[i] < a.bx1[i]) ? a.ax1[i] : a.bx1[i];
+    double iy1 = (a.ay1[i] < a.by1[i]) ? a.ay1[i] : a.by1[i];
+    a.hit[i] = ( (ix0 > ix1) || (iy0 > iy1) ) ? 0 : 1;
+
+    a.o_area[i] = (ix1 - ix0) * (iy1 - iy0);
+    a.a_area[i] = (a.ax1[i] - a.ax0[i]) * (a.ay1[i] - a.ay0[i]);
+    a.b_area[i] = (a.bx1[i] - a.bx0[i]) * (a.by1[i] - a.by0[i]);
+
+    double dx = 0.5 * (a.ax0[i] + a.ax1[i]) - 0.5 * (a.bx0[i] + a.bx1[i]);
+    double d_center_y = 0.5 * (a.ay0[i] + a.ay1[i]) - 0.5 * (a.by0[i] + a.by1[i]);
+    double d_bottom_y = a.ay1[i] - a.by1[i];
+    double dx2 = dx * dx;
+    a.cd[i] = sqrt( dx2 + d_center_y * d_center_y );
+    a.cbd[i] = sqrt( dx2 + d_bottom_y * d_bottom_y );
+  }
+}
+
+#if BOX_OVERLAP_X86_KERNELS
+
+__attribute__(( target( "sse2" )))
+void
+sse2_kernel( const kernel_args& a, size_t begin, size_t end )
+{
+  const __m128d half = _mm_set1_pd( 0.5 );
+  size_t i = begin;
+  for ( ; i+2 <= end; i += 2)
+  {
+    __m128d ax0 = _mm_loadu_pd( a.ax0+i ), ay0 = _mm_loadu_pd( a.ay0+i );
+    __m128d ax1 = _mm_loadu_pd( a.ax1+i ), ay1 = _mm_loadu_pd( a.ay1+i );
+    __m128d bx0 = _mm_loadu_pd( a.bx0+i ), by0 = _mm_loadu_pd( a.by0+i );
+    __m128d bx1 = _mm_loadu_pd( a.bx1+i ), by1 = _mm_loadu_pd( a.by1+i );
+
+    __m128d ix0 = _mm_max_pd( ax0, bx0 ), iy0 = _mm_max_pd( ay0, by0 );
+    __m128d ix1 = _mm_min_pd( ax1, bx1 ), iy1 = _mm_min_pd( ay1, by1 );
+    int empty = _mm_movemask_pd( _mm_or_pd( _mm_cmpgt_pd( ix0, ix1 ), _mm_cmpgt_pd( iy0, iy1 )));
+    a.hit[i] = (empty & 0x1) ? 0 : 1;
+    a.hit[i+1] = (empty & 0x2) ? 0 : 1;
+
+    _mm_storeu_pd( a.o_area+i, _mm_mul_pd( _mm_sub_pd( ix1, ix0 ), _mm_sub_pd( iy1, iy0 )));
+    _mm_storeu_pd( a.a_area+i, _mm_mul_pd( _mm_sub_pd( ax1, ax0 ), _mm_sub_pd( ay1, ay0 )));
+    _mm_storeu_pd( a.b_area+i, _mm_mul_pd( _mm_sub_pd( bx1, bx0 ), _mm_sub_pd( by1, by0 )));
+
+    __m128d dx = _mm_sub_pd( _mm_mul_pd( half, _mm_add_pd( ax0, ax1 )),
+                             _mm_mul_pd( half, _mm_add_pd( bx0, bx1 )));
+    __m128d d_center_y = _mm_sub_pd( _mm_mul_pd( half, _mm_add_pd( ay0, ay1 )),
+                                     _mm_mul_pd( half, _mm_add_pd( by0, by1 )));
+    __m128d d_bottom_y = _mm_sub_pd( ay1, by1 );
+    __m128d dx2 = _mm_mul_pd( dx, dx );
+    _mm_storeu_pd( a.cd+i, _mm_sqrt_pd( _mm_add_pd( dx2, _mm_mul_pd( d_center_y, d_center_y ))));
+    _mm_storeu_pd( a.cbd+i, _mm_sqrt_pd( _mm_add_pd( dx2, _mm_mul_pd( d_bottom_y, d_bottom_y ))));
+  }
+  scalar_kernel( a, i, end );
+}
+
+__attribute__(( target( "avx" )))
+void
+avx_kernel( const kernel_args& a, size_t begin, size_t end )
+{
+  const __m256d half = _mm256_set1_pd( 0.5 );
+  size_t i = begin;
+  for ( ; i+4 <= end; i += 4)
+  {
+    __m256d ax0 = _mm256_loadu_pd( a.ax0+i ), ay0 = _mm256_loadu_pd( a.ay0+i );
+    __m256d ax1 = _mm256_loadu_pd( a.ax1+i ), ay1 = _mm256_loadu_pd( a.ay1+i );
+    __m256d bx0 = _mm256_loadu_pd( a.bx0+i ), by0 = _mm256_loadu_pd( a.by0+i );
+    __m256d bx1 = _mm256_loadu_pd( a.bx1+i ), by1 = _mm256_loadu_pd( a.by1+i );
+
+    __m256d ix0 = _mm256_max_pd( ax0, bx0 ), iy0 = _mm256_max_pd( ay0, by0 );
+    __m256d ix1 = _mm256_min_pd( ax1, bx1 ), iy1 = _mm256_min_pd( ay1, by1 );
+    int empty = _mm256_movemask_pd( _mm256_or_pd( _mm256_cmp_pd( ix0, ix1, _CMP_GT_OQ ),
+                                                  _mm256_cmp_pd( iy0, iy1, _CMP_GT_OQ )));
+    for (size_t k=0; k<4; ++k)
+    {
+      a.hit[i+k] = (empty & (1 << k)) ? 0 : 1;
+    }
+
+    _mm256_storeu_pd( a.o_area+i, _mm256_mul_pd( _mm256_sub_pd( ix1, ix0 ), _mm256_sub_pd( iy1, iy0 )));
+    _mm256_storeu_pd( a.a_area+i, _mm256_mul_pd( _mm256_sub_pd( ax1, ax0 ), _mm256_sub_pd( ay1, ay0 )));
+    _mm256_storeu_pd( a.b_area+i, _mm256_mul_pd( _mm256_sub_pd( bx1, bx0 ), _mm256_sub_pd( by1, by0 )));
+
+    __m256d dx = _mm256_sub_pd( _mm256_mul_pd( half, _mm256_add_pd( ax0, ax1 )),
+                                _mm256_mul_pd( half, _mm256_add_pd( bx0, bx1 )));
+    __m256d d_center_y = _mm256_sub_pd( _mm256_mul_pd( half, _mm256_add_pd( ay0, ay1 )),
+                                        _mm256_mul_pd( half, _mm256_add_pd( by0, by1 )));
+    __m256d d_bottom_y = _mm256_sub_pd( ay1, by1 );
+    __m256d dx2 = _mm256_mul_pd( dx, dx );
+    _mm256_storeu_pd( a.cd+i, _mm256_sqrt_pd( _mm256_add_pd( dx2, _mm256_mul_pd( d_center_y, d_center_y ))));
+    _mm256_storeu_pd( a.cbd+i, _mm256_sqrt_pd( _mm256_add_pd( dx2, _mm256_mul_pd( d_bottom_y, d_bottom_y ))));
+  }
+  scalar_kernel( a, i, end );
+}
+
+#endif
+
+struct kernel_choice
+{
+  kernel_type kernel;
+  const char* name;
+};
+
+kernel_choice
+select_kernel()
+{
+  kernel_choice ret = { scalar_kernel, "scalar" };
+#if BOX_OVERLAP_X86_KERNELS
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports( "avx" ))
+  {
+    ret.kernel = avx_kernel;
+    ret.name = "avx";
+  }
+  else if ( __builtin_cpu_supports( "sse2" ))
+  {
+    ret.kernel = sse2_kernel;
+    ret.name = "sse2";
+  }
+#endif
+  return ret;
+}
+
+const kernel_choice&
+active_kernel()
+{
+  static const kernel_choice k = select_kernel();
+  return k;
+}
+
+} // ...anon namespace
+
+namespace kwiver {
+namespace kwant {
+
+void
+box_overlap_batch
+::clear()
+{
+  a_min_x.clear(); a_min_y.clear(); a_max_x.clear(); a_max_y.clear();
+  b_min_x.clear(); b_min_y.clear(); b_max_x.clear(); b_max_y.clear();
+}
+
+void
+box_overlap_batch
+::reserve( size_t n )
+{
+  a_min_x.reserve( n ); a_min_y.reserve( n ); a_max_x.reserve( n ); a_max_y.reserve( n );
+  b_min_x.reserve( n ); b_min_y.reserve( n ); b_max_x.reserve( n ); b_max_y.reserve( n );
+}
+
+void
+box_overlap_batch
+::add( const vgl_box_2d<double>& a, const vgl_box_2d<double>& b )
+{
+  a_min_x.push_back( a.min_x() ); a_min_y.push_back( a.min_y() );
+  a_max_x.push_back( a.max_x() ); a_max_y.push_back( a.max_y() );
+  b_min_x.push_back( b.min_x() ); b_min_y.push_back( b.min_y() );
+  b_max_x.push_back( b.max_x() ); b_max_y.push_back( b.max_y() );
+}
+
+void
+box_overlap_batch
+::compute()
+{
+  size_t n = this->size();
+  intersects.resize( n );
+  a_area.resize( n );
+  b_area.resize( n );
+  overlap_area.resize( n );
+  centroid_distance.resize( n );
+  center_bottom_distance.resize( n );
+  if (n == 0) return;
+
+  kernel_args args;
+  args.ax0 = &a_min_x[0]; args.ay0 = &a_min_y[0]; args.ax1 = &a_max_x[0]; args.ay1 = &a_max_y[0];
+  args.bx0 = &b_min_x[0]; args.by0 = &b_min_y[0]; args.bx1 = &b_max_x[0]; args.by1 = &b_max_y[0];
+  args.hit = &intersects[0];
+  args.a_area = &a_area[0];
+  args.b_area = &b_area[0];
+  args.o_area = &overlap_area[0];
+  args.cd = &centroid_distance[0];
+  args.cbd = &center_bottom_distance[0];
+
+  active_kernel().kernel( args, 0, n );
+}
+
+box_overlap_batch::pair_result
+box_overlap_batch
+::compute_pair( const vgl_box_2d<double>& a, const vgl_box_2d<double>& b )
+{
+  double ax0 = a.min_x(), ay0 = a.min_y(), ax1 = a.max_x(), ay1 = a.max_y();
+  double bx0 = b.min_x(), by0 = b.min_y(), bx1 = b.max_x(), by1 = b.max_y();
+  unsigned char hit;
+  pair_result ret;
+
+  kernel_args args;
+  args.ax0 = &ax0; args.ay0 = &ay0; args.ax1 = &ax1; args.ay1 = &ay1;
+  args.bx0 = &bx0; args.by0 = &by0; args.bx1 = &bx1; args.by1 = &by1;
+  args.hit = &hit;
+  args.a_area = &ret.a_area;
+  args.b_area = &ret.b_area;
+  args.o_area = &ret.overlap_area;
+  args.cd = &ret.centroid_distance;
+  args.cbd = &ret.center_bottom_distance;
+
+  scalar_kernel( args, 0, 1 );
+  ret.intersects = ( hit != 0 );
+  return ret;
+}
+
+const char*
+box_overlap_batch
+::kernel_name()
+{
+  return active_kernel().name;
+}
+
+} // ...kwant
+} // ...kwiver
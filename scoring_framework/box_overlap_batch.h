@@ -0,0 +1,71 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_BOX_OVERLAP_BATCH_H
+#define INCL_BOX_OVERLAP_BATCH_H
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <vector>
+#include <vgl/vgl_box_2d.h>
+
+namespace kwiver {
+namespace kwant {
+
+//
+// A batch of (a, b) box pairs, stored column-wise, and the per-pair
+// quantities phase 1 computes when comparing two aligned frames:
+// the areas of a, b, and their intersection, and the distances between
+// their centroids and between their bottom-center points.
+//
+// compute() fills in the output columns for the whole batch using the
+// widest kernel the CPU supports (AVX or SSE2 on x86 builds with gcc or
+// clang; plain C++ otherwise), chosen once at runtime.  All the kernels
+// evaluate the same expressions in the same order and give the same
+// results as vgl_intersection / vgl_area.
+//
+// The areas and distances are only meaningful where intersects[i] is
+// non-zero.  Boxes are passed in as-is; any expansion is up to the caller.
+//
+
+struct SCORE_CORE_EXPORT box_overlap_batch
+{
+public:
+  // inputs
+  std::vector< double > a_min_x, a_min_y, a_max_x, a_max_y;
+  std::vector< double > b_min_x, b_min_y, b_max_x, b_max_y;
+
+  // outputs
+  std::vector< unsigned char > intersects;
+  std::vector< double > a_area, b_area, overlap_area;
+  std::vector< double > centroid_distance, center_bottom_distance;
+
+  size_t size() const { return a_min_x.size(); }
+  void clear();
+  void reserve( size_t n );
+  void add( const vgl_box_2d<double>& a, const vgl_box_2d<double>& b );
+
+  void compute();
+
+  // the same quantities for the single pair (a, b), without touching
+  // the batch; all the kernels agree, so this uses the plain C++ one.
+  struct pair_result
+  {
+    bool intersects;
+    double a_area, b_area, overlap_area;
+    double centroid_distance, center_bottom_distance;
+  };
+  static pair_result compute_pair( const vgl_box_2d<double>& a, const vgl_box_2d<double>& b );
+
+  // name of the kernel compute() uses ("avx", "sse2", or "scalar")
+  static const char* kernel_name();
+};
+
+} // ...kwant
+} // ...kwiver
+
+#endif
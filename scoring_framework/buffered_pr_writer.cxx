@@ -0,0 +1,60 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "buffered_pr_writer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using std::min;
+using std::ostream;
+using std::snprintf;
+
+namespace kwiver {
+namespace kwant {
+
+const size_t buffered_pr_writer::flush_size;
+const size_t buffered_pr_writer::max_row_size;
+
+buffered_pr_writer
+::buffered_pr_writer( ostream& output )
+  : os( output )
+{
+  this->buf.reserve( flush_size + max_row_size );
+}
+
+buffered_pr_writer
+::~buffered_pr_writer()
+{
+  this->flush();
+}
+
+void
+buffered_pr_writer
+::write_row( unsigned i, double r, unsigned tp, unsigned fp, double prec,
+             unsigned td, unsigned nTrue, double recall )
+{
+  char row[ max_row_size ];
+  int n = snprintf( row, sizeof( row ),
+                    "PR-curve: %u relevancy= %g tp= %u fp= %u prec= %g td= %u nTrue= %u  recall= %g\n",
+                    i, r, tp, fp, prec, td, nTrue, recall );
+  this->buf.append( row, min( static_cast< size_t >( n ), sizeof( row ) - 1 ));
+  if ( this->buf.size() >= flush_size )
+  {
+    this->flush();
+  }
+}
+
+void
+buffered_pr_writer
+::flush()
+{
+  this->os.write( this->buf.data(), this->buf.size() );
+  this->buf.clear();
+}
+
+} // ...kwant
+} // ...kwiver
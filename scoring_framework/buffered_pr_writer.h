@@ -0,0 +1,49 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_BUFFERED_PR_WRITER_H
+#define INCL_BUFFERED_PR_WRITER_H
+
+//
+// Formats score_events' PR-curve rows into a buffer which is written
+// out in large blocks.  The numbers come out as ostream's defaults
+// would write them (%g, i.e. precision 6, for the doubles), so the
+// output is the same as streaming each row.
+//
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+namespace kwiver {
+namespace kwant {
+
+class SCORE_CORE_EXPORT buffered_pr_writer
+{
+public:
+  explicit buffered_pr_writer( std::ostream& output );
+  ~buffered_pr_writer();
+
+  void write_row( unsigned i, double r, unsigned tp, unsigned fp, double prec,
+                  unsigned td, unsigned nTrue, double recall );
+
+  void flush();
+
+private:
+  static const size_t flush_size = 1 << 20;
+  static const size_t max_row_size = 256;
+
+  std::ostream& os;
+  std::string buf;
+};
+
+} // ...kwant
+} // ...kwiver
+
+#endif
@@ -0,0 +1,386 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "hadwav_partial_result.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+#include <vital/logger/logger.h>
+static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __FILE__ ) );
+
+using std::endl;
+using std::ifstream;
+using std::istream;
+using std::map;
+using std::ofstream;
+using std::ostream;
+using std::pair;
+using std::string;
+using std::vector;
+
+using kwiver::track_oracle::track_handle_type;
+
+namespace // anon
+{
+
+using namespace ::kwiver::kwant;
+
+const char* partial_magic = "kwant-hadwav-partial";
+const unsigned partial_version = 2;
+
+vector< hadwav_partial_result::per_track_counts >
+track_counts( const map< track_handle_type, per_track_phase3_hadwav >& stats )
+{
+  vector< hadwav_partial_result::per_track_counts > ret;
+  ret.reserve( stats.size() );
+  for (map< track_handle_type, per_track_phase3_hadwav >::const_iterator i = stats.begin();
+       i != stats.end();
+       ++i)
+  {
+    hadwav_partial_result::per_track_counts c;
+    c.continuity = static_cast< unsigned >( i->second.continuity );
+    c.dominant_size = i->second.dominant_track_size;
+    c.lifetime = i->second.dominated_track_lifetime;
+    ret.push_back( c );
+  }
+  return ret;
+}
+
+// As in overall_phase3_hadwav::compute_per_track().
+
+vector< per_track_phase3_hadwav >
+track_stats( const vector< hadwav_partial_result::per_track_counts >& counts )
+{
+  vector< per_track_phase3_hadwav > ret( counts.size() );
+  for (size_t k=0; k<counts.size(); ++k)
+  {
+    const hadwav_partial_result::per_track_counts& c = counts[k];
+    per_track_phase3_hadwav& stats = ret[k];
+    stats.continuity = c.continuity;
+    stats.purity = (c.lifetime == 0) ? 0.0 : 1.0*c.dominant_size / c.lifetime;
+    stats.dominant_track_size = c.dominant_size;
+    stats.dominated_track_lifetime = c.lifetime;
+    if (stats.purity > 1.0) stats.purity = 1.0;
+  }
+  return ret;
+}
+
+void
+write_track_counts( ostream& os,
+                    const char* tag,
+                    const vector< hadwav_partial_result::per_track_counts >& counts )
+{
+  os << tag << " " << counts.size() << "\n";
+  for (size_t k=0; k<counts.size(); ++k)
+  {
+    os << counts[k].continuity << " " << counts[k].dominant_size << " " << counts[k].lifetime << "\n";
+  }
+}
+
+void
+write_timestamps( ostream& os, const char* tag, const vector< ts_type >& ts )
+{
+  os << tag << " " << ts.size() << "\n";
+  for (size_t k=0; k<ts.size(); ++k)
+  {
+    os << ts[k] << ( ( ( k+1 == ts.size() ) || ( (k+1) % 8 == 0 )) ? "\n" : " " );
+  }
+}
+
+vector< ts_type >
+timestamp_union( const vector< ts_type >& a, const vector< ts_type >& b )
+{
+  vector< ts_type > ret;
+  ret.reserve( a.size() + b.size() );
+  std::set_union( a.begin(), a.end(), b.begin(), b.end(), std::back_inserter( ret ));
+  return ret;
+}
+
+template< typename T >
+bool
+read_value( istream& is, const string& fn, const char* tag, T& value )
+{
+  string s;
+  if ( ( ! ( is >> s >> value )) || ( s != tag ))
+  {
+    LOG_ERROR( main_logger, "Partial result '" << fn << "': expected '" << tag << "'" );
+    return false;
+  }
+  return true;
+}
+
+bool
+read_track_counts( istream& is,
+                   const string& fn,
+                   const char* tag,
+                   vector< hadwav_partial_result::per_track_counts >& counts )
+{
+  size_t n = 0;
+  if ( ! read_value( is, fn, tag, n )) return false;
+  counts.resize( n );
+  for (size_t k=0; k<n; ++k)
+  {
+    if ( ! ( is >> counts[k].continuity >> counts[k].dominant_size >> counts[k].lifetime ))
+    {
+      LOG_ERROR( main_logger, "Partial result '" << fn << "': short " << tag << " list" );
+      return false;
+    }
+  }
+  return true;
+}
+
+bool
+read_timestamps( istream& is,
+                 const string& fn,
+                 const char* tag,
+                 vector< ts_type >& ts )
+{
+  size_t n = 0;
+  if ( ! read_value( is, fn, tag, n )) return false;
+  ts.resize( n );
+  for (size_t k=0; k<n; ++k)
+  {
+    if ( ! ( is >> ts[k] ))
+    {
+      LOG_ERROR( main_logger, "Partial result '" << fn << "': short " << tag << " list" );
+      return false;
+    }
+    if ( ( k > 0 ) && ( ! ( ts[k-1] < ts[k] )))
+    {
+      LOG_ERROR( main_logger, "Partial result '" << fn << "': " << tag << " are not sorted" );
+      return false;
+    }
+  }
+  return true;
+}
+
+} // ...anon
+
+namespace kwiver {
+namespace kwant {
+
+hadwav_partial_result
+::hadwav_partial_result()
+  : one_to_one( false ),
+    n_true_tracks( 0 ),
+    n_computed_tracks( 0 ),
+    total_gt_boxes( 0 ),
+    total_computed_boxes( 0 ),
+    detected_gt_boxes( 0 ),
+    detection_false_alarms( 0 ),
+    n_assigned_pairs( 0 ),
+    assigned_frames( 0 )
+{
+}
+
+hadwav_partial_result
+::hadwav_partial_result( const track2track_phase2_hadwav& p2,
+                         const overall_phase3_hadwav& p3 )
+  : one_to_one( p2.one_to_one ),
+    n_true_tracks( p2.n_true_tracks ),
+    n_computed_tracks( p2.n_computed_tracks ),
+    total_gt_boxes( p2.total_gt_boxes ),
+    total_computed_boxes( p2.total_computed_boxes ),
+    detected_gt_boxes( p2.detected_gt_boxes ),
+    detection_false_alarms( p2.detectionFalseAlarms ),
+    n_assigned_pairs( p2.n_assigned_pairs ),
+    assigned_frames( p2.assignedFrames ),
+    gt_frame_timestamps( p2.gt_frame_timestamps ),
+    computed_frame_matched_timestamps( p2.computed_frame_matched_timestamps ),
+    computed_frame_unmatched_timestamps( p2.computed_frame_unmatched_timestamps ),
+    tracks( track_counts( p3.get_mitre_track_stats() )),
+    targets( track_counts( p3.get_mitre_target_stats() ))
+{
+}
+
+bool
+hadwav_partial_result
+::merge( const hadwav_partial_result& other )
+{
+  if ( this->one_to_one != other.one_to_one )
+  {
+    return false;
+  }
+  this->n_true_tracks += other.n_true_tracks;
+  this->n_computed_tracks += other.n_computed_tracks;
+  this->total_gt_boxes += other.total_gt_boxes;
+  this->total_computed_boxes += other.total_computed_boxes;
+  this->detected_gt_boxes += other.detected_gt_boxes;
+  this->detection_false_alarms += other.detection_false_alarms;
+  this->n_assigned_pairs += other.n_assigned_pairs;
+  this->assigned_frames += other.assigned_frames;
+  this->gt_frame_timestamps =
+    timestamp_union( this->gt_frame_timestamps, other.gt_frame_timestamps );
+  this->computed_frame_matched_timestamps =
+    timestamp_union( this->computed_frame_matched_timestamps, other.computed_frame_matched_timestamps );
+  this->computed_frame_unmatched_timestamps =
+    timestamp_union( this->computed_frame_unmatched_timestamps, other.computed_frame_unmatched_timestamps );
+  this->tracks.insert( this->tracks.end(), other.tracks.begin(), other.tracks.end() );
+  this->targets.insert( this->targets.end(), other.targets.begin(), other.targets.end() );
+  return true;
+}
+
+void
+hadwav_partial_result
+::compute_metrics( track2track_phase2_hadwav& p2,
+                   overall_phase3_hadwav& p3 ) const
+{
+  p2.one_to_one = this->one_to_one;
+  p2.n_true_tracks = this->n_true_tracks;
+  p2.n_computed_tracks = this->n_computed_tracks;
+  p2.total_gt_boxes = this->total_gt_boxes;
+  p2.total_computed_boxes = this->total_computed_boxes;
+  p2.detected_gt_boxes = this->detected_gt_boxes;
+  p2.detectionFalseAlarms = this->detection_false_alarms;
+  p2.gt_frame_timestamps = this->gt_frame_timestamps;
+  p2.computed_frame_matched_timestamps = this->computed_frame_matched_timestamps;
+  p2.computed_frame_unmatched_timestamps = this->computed_frame_unmatched_timestamps;
+  p2.n_gt_frames = this->gt_frame_timestamps.size();
+  p2.n_computed_frames_matched = this->computed_frame_matched_timestamps.size();
+  p2.n_computed_frames_unmatched = this->computed_frame_unmatched_timestamps.size();
+  p2.n_assigned_pairs = this->n_assigned_pairs;
+  p2.assignedFrames = this->assigned_frames;
+  p2.compute_metrics();
+
+  p3.compute_overall( track_stats( this->tracks ), track_stats( this->targets ),
+                      this->n_true_tracks, this->n_computed_tracks );
+}
+
+bool
+hadwav_partial_result
+::write( const string& fn ) const
+{
+  ofstream os( fn.c_str() );
+  if ( ! os )
+  {
+    LOG_ERROR( main_logger, "Couldn't open '" << fn << "' for writing" );
+    return false;
+  }
+  os << partial_magic << " " << partial_version << "\n"
+     << "one-to-one " << ( this->one_to_one ? 1 : 0 ) << "\n"
+     << "n-true-tracks " << this->n_true_tracks << "\n"
+     << "n-computed-tracks " << this->n_computed_tracks << "\n"
+     << "total-gt-boxes " << this->total_gt_boxes << "\n"
+     << "total-computed-boxes " << this->total_computed_boxes << "\n"
+     << "detected-gt-boxes " << this->detected_gt_boxes << "\n"
+     << "detection-false-alarms " << this->detection_false_alarms << "\n"
+     << "n-assigned-pairs " << this->n_assigned_pairs << "\n"
+     << "assigned-frames " << this->assigned_frames << "\n";
+  write_timestamps( os, "gt-frame-timestamps", this->gt_frame_timestamps );
+  write_timestamps( os, "computed-frame-matched-timestamps", this->computed_frame_matched_timestamps );
+  write_timestamps( os, "computed-frame-unmatched-timestamps", this->computed_frame_unmatched_timestamps );
+  write_track_counts( os, "tracks", this->tracks );
+  write_track_counts( os, "targets", this->targets );
+  if ( ! os )
+  {
+    LOG_ERROR( main_logger, "Error writing partial result '" << fn << "'" );
+    return false;
+  }
+  return true;
+}
+
+bool
+hadwav_partial_result
+::read( const string& fn )
+{
+  ifstream is( fn.c_str() );
+  if ( ! is )
+  {
+    LOG_ERROR( main_logger, "Couldn't open partial result '" << fn << "'" );
+    return false;
+  }
+
+  unsigned version = 0;
+  if ( ! read_value( is, fn, partial_magic, version )) return false;
+  if ( version != partial_version )
+  {
+    LOG_ERROR( main_logger, "Partial result '" << fn << "' is version " << version
+               << "; expected " << partial_version );
+    return false;
+  }
+
+  hadwav_partial_result r;
+  int one_to_one_flag = 0;
+  bool okay =
+    read_value( is, fn, "one-to-one", one_to_one_flag ) &&
+    read_value( is, fn, "n-true-tracks", r.n_true_tracks ) &&
+    read_value( is, fn, "n-computed-tracks", r.n_computed_tracks ) &&
+    read_value( is, fn, "total-gt-boxes", r.total_gt_boxes ) &&
+    read_value( is, fn, "total-computed-boxes", r.total_computed_boxes ) &&
+    read_value( is, fn, "detected-gt-boxes", r.detected_gt_boxes ) &&
+    read_value( is, fn, "detection-false-alarms", r.detection_false_alarms ) &&
+    read_value( is, fn, "n-assigned-pairs", r.n_assigned_pairs ) &&
+    read_value( is, fn, "assigned-frames", r.assigned_frames ) &&
+    read_timestamps( is, fn, "gt-frame-timestamps", r.gt_frame_timestamps ) &&
+    read_timestamps( is, fn, "computed-frame-matched-timestamps", r.computed_frame_matched_timestamps ) &&
+    read_timestamps( is, fn, "computed-frame-unmatched-timestamps", r.computed_frame_unmatched_timestamps ) &&
+    read_track_counts( is, fn, "tracks", r.tracks ) &&
+    read_track_counts( is, fn, "targets", r.targets );
+  if ( ! okay ) return false;
+
+  r.one_to_one = ( one_to_one_flag != 0 );
+  *this = r;
+  return true;
+}
+
+void
+write_hadwav_results( ostream& os,
+                      const track2track_phase2_hadwav& p2,
+                      const overall_phase3_hadwav& p3,
+                      const pair< bool, double >& norm,
+                      size_t n_computed_tracks )
+{
+  os << "HADWAV Scoring Results:" << endl;
+
+  os << "  Detection-Pd: " << p2.detectionPD << endl
+     << "  Detection-FA: " << p2.detectionFalseAlarms << endl
+     << "  Detection-PFA: " << p2.detectionPFalseAlarm << endl;
+
+  if (norm.first)
+  {
+    os << "  Frame-NFAR: " << p2.frameFA/norm.second << endl;
+  }
+  else
+  {
+    os << "  Frame-NFAR: not computed" << endl;
+  }
+
+  os << "  Track-Pd: " << p3.trackPd << endl;
+  os << "  Track-FA: " << p3.trackFA << "" << endl;
+
+  double computed_track_pfa =
+    (n_computed_tracks == 0)
+    ? 0.0
+    : p3.trackFA / n_computed_tracks;
+  os << "  Computed-track-PFA: " << computed_track_pfa << endl;
+
+  if (norm.first)
+  {
+    os << "  Track-NFAR: " << p3.trackFA/norm.second << "" << endl;
+  }
+  else
+  {
+    os << "  Track-NFAR: not computed" << endl;
+  }
+  os << "  Avg track (continuity, purity ): " << p3.avg_track_continuity
+     << ", " << p3.avg_track_purity << endl;
+  os << "  Avg target (continuity, purity ): " << p3.avg_target_continuity << ", "
+     << p3.avg_target_purity << endl;
+  os <<  "  Track-frame-precision: " << p2.trackFramePrecision << endl;
+  if ( p2.one_to_one )
+  {
+    os << "  One-to-one pairs: " << p2.n_assigned_pairs << endl
+       << "  Identity (precision, recall, F1): " << p2.identityPrecision << ", "
+       << p2.identityRecall << ", " << p2.identityF1 << endl;
+  }
+}
+
+} // ...kwant
+} // ...kwiver
@@ -0,0 +1,106 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_HADWAV_PARTIAL_RESULT_H
+#define INCL_HADWAV_PARTIAL_RESULT_H
+
+//
+// The raw counts behind the HADWAV metrics of one run, which can be
+// merged with those of other runs over disjoint data (e.g. one run per
+// clip, camera, or time window) to give the metrics of a single run
+// over all the data.
+//
+// Phase 2's counts (boxes, detections, the one-to-one assignment) are
+// summed.  The frame census counts distinct timestamps, and the runs'
+// frames may share timestamps (e.g. one run per camera), so we keep the
+// timestamps of each census category and merge them as sets.  Phase 3's
+// averages can't be summed either, so we keep each
+// track's continuity, dominant track size and lifetime (the purity
+// numerator and denominator), in track order; the merged run's tracks
+// are those of the first run, then the second, and so on.  Merging the
+// runs in the order their tracks would have been loaded in one run
+// gives identical metrics.
+//
+// The file format is plain text, so partial results can be moved
+// between machines.
+//
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_tracks_hadwav_export.h>
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <scoring_framework/score_phase2_hadwav.h>
+#include <scoring_framework/score_phase3_hadwav.h>
+
+namespace kwiver {
+namespace kwant {
+
+struct SCORE_TRACKS_HADWAV_EXPORT hadwav_partial_result
+{
+public:
+  struct per_track_counts
+  {
+    unsigned continuity;        // number of associated tracks
+    unsigned dominant_size;     // purity numerator
+    unsigned lifetime;          // purity denominator
+    per_track_counts(): continuity(0), dominant_size(0), lifetime(0) {}
+  };
+
+  bool one_to_one;
+  size_t n_true_tracks;
+  size_t n_computed_tracks;
+  size_t total_gt_boxes;
+  size_t total_computed_boxes;
+  size_t detected_gt_boxes;
+  size_t detection_false_alarms;
+  size_t n_assigned_pairs;
+  size_t assigned_frames;
+
+  // the frame census, as sorted timestamps (see track2track_phase2_hadwav)
+  std::vector< ts_type > gt_frame_timestamps;
+  std::vector< ts_type > computed_frame_matched_timestamps;
+  std::vector< ts_type > computed_frame_unmatched_timestamps;
+
+  // computed tracks ("tracks") and truth tracks ("targets"), in track order
+  std::vector< per_track_counts > tracks;
+  std::vector< per_track_counts > targets;
+
+  hadwav_partial_result();
+  hadwav_partial_result( const track2track_phase2_hadwav& p2,
+                         const overall_phase3_hadwav& p3 );
+
+  // add the counts of another run, whose tracks follow ours; returns
+  // false (leaving us unchanged) if one ran the one-to-one assignment
+  // and the other didn't
+  bool merge( const hadwav_partial_result& other );
+
+  // set the metrics of p2 and p3 from the counts
+  void compute_metrics( track2track_phase2_hadwav& p2,
+                        overall_phase3_hadwav& p3 ) const;
+
+  bool write( const std::string& fn ) const;
+  bool read( const std::string& fn );
+};
+
+// The HADWAV results table, as written by score_tracks.  norm is the
+// (valid, value) normalization factor for the NFAR lines.
+
+SCORE_TRACKS_HADWAV_EXPORT void
+write_hadwav_results( std::ostream& os,
+                      const track2track_phase2_hadwav& p2,
+                      const overall_phase3_hadwav& p3,
+                      const std::pair< bool, double >& norm,
+                      size_t n_computed_tracks );
+
+} // ...kwant
+} // ...kwiver
+
+#endif
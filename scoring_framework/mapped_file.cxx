@@ -0,0 +1,76 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <fstream>
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using std::string;
+
+namespace kwiver {
+namespace kwant {
+
+#ifdef _WIN32
+
+mapped_file
+::mapped_file( const string& fn )
+  : addr( 0 ), len( 0 )
+{
+  std::ifstream is( fn.c_str(), std::ios::binary );
+  if ( ! is ) return;
+  this->buf.assign( std::istreambuf_iterator< char >( is ), std::istreambuf_iterator< char >() );
+  if ( this->buf.empty() ) return;
+  this->addr = &this->buf[0];
+  this->len = this->buf.size();
+}
+
+mapped_file
+::~mapped_file()
+{
+}
+
+#else
+
+mapped_file
+::mapped_file( const string& fn )
+  : addr( 0 ), len( 0 )
+{
+  int fd = ::open( fn.c_str(), O_RDONLY );
+  if ( fd < 0 ) return;
+  struct stat st;
+  if ( (::fstat( fd, &st ) == 0) && (st.st_size > 0) )
+  {
+    void* p = ::mmap( 0, static_cast< size_t >( st.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( p != MAP_FAILED )
+    {
+      this->addr = static_cast< const char* >( p );
+      this->len = static_cast< size_t >( st.st_size );
+    }
+  }
+  ::close( fd );
+}
+
+mapped_file
+::~mapped_file()
+{
+  if ( this->addr )
+  {
+    ::munmap( const_cast< char* >( this->addr ), this->len );
+  }
+}
+
+#endif
+
+} // ...kwant
+} // ...kwiver
@@ -0,0 +1,48 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_MAPPED_FILE_H
+#define INCL_MAPPED_FILE_H
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace kwiver {
+namespace kwant {
+
+//
+// A read-only view of a whole file: memory-mapped where we can, read
+// into a buffer on Windows.  data() is null if the file couldn't be read.
+//
+
+class SCORE_CORE_EXPORT mapped_file
+{
+public:
+  explicit mapped_file( const std::string& fn );
+  ~mapped_file();
+
+  const char* data() const { return this->addr; }
+  size_t size() const { return this->len; }
+
+private:
+  const char* addr;
+  size_t len;
+#ifdef _WIN32
+  std::vector< char > buf;
+#endif
+
+  mapped_file( const mapped_file& );
+  mapped_file& operator=( const mapped_file& );
+};
+
+} // ...kwant
+} // ...kwiver
+
+#endif
@@ -63,26 +63,10 @@ matching_args_type
   }
 
   string pcent_opt = mutable_me->min_pcent_gt_ct.option();
-  string min_bounding_area_opt = mutable_me->min_bound_area.option();
   string min_filter_frames_opt = mutable_me->min_frames_arg.option();
   if (this->min_pcent_gt_ct() == "help")
   {
-    LOG_ERROR( main_logger, string( "\n" ) <<
-               "The " << pcent_opt << " option sets the minimum area, as a percentage of the box, which\n"
-               "must be overlapped in either the ground-truth box, computed box, or both, for the\n"
-               "overlap to count as a hit.\n\n"
-               "If set, this option overrides the " << min_bounding_area_opt << " option.\n\n"
-               "This option is specified as two numbers separated by a colon, e.g. '20.5:5'.\n"
-               "The first is the percentage of the ground-truth box; the second is the percentage\n"
-               "of the computed box.  To set one value as don't care, set it to 0; for example,\n"
-               "'54.9:0' means as long as 54.9 percent of the ground-truth box is overlapped, any amount\n"
-               "of overlap in the computed box is allowed; similarly, '0:10' means as long as 10 percent\n"
-               "of the computed box is overlapped, any overlap in the ground-truth box is accepted.\n\n"
-               "If the separating character is 'd' instead of ':', overlap area computations are dumped to cerr.\n"
-               "\n"
-               "If " << pcent_opt << " is specified, " << min_filter_frames_opt << " must be explicitly set\n"
-               "to state how many frames must pass the " << pcent_opt << " criteria before the track-to-track\n"
-               "overlap is accepted.\n" );
+    this->log_min_pcent_gt_ct_help();
     ret = false;
   }
 
@@ -118,11 +102,46 @@ matching_args_type
   return ret;
 }
 
+void
+matching_args_type
+::log_min_pcent_gt_ct_help() const
+{
+  // non-const because vul_arg_base.option() is not const
+  matching_args_type* mutable_me = const_cast< matching_args_type * >( this );
+
+  string pcent_opt = mutable_me->min_pcent_gt_ct.option();
+  string min_bounding_area_opt = mutable_me->min_bound_area.option();
+  string min_filter_frames_opt = mutable_me->min_frames_arg.option();
+    LOG_ERROR( main_logger, string( "\n" ) <<
+               "The " << pcent_opt << " option sets the minimum area, as a percentage of the box, which\n"
+               "must be overlapped in either the ground-truth box, computed box, or both, for the\n"
+               "overlap to count as a hit.\n\n"
+               "If set, this option overrides the " << min_bounding_area_opt << " option.\n\n"
+               "This option is specified as two numbers separated by a colon, e.g. '20.5:5'.\n"
+               "The first is the percentage of the ground-truth box; the second is the percentage\n"
+               "of the computed box.  To set one value as don't care, set it to 0; for example,\n"
+               "'54.9:0' means as long as 54.9 percent of the ground-truth box is overlapped, any amount\n"
+               "of overlap in the computed box is allowed; similarly, '0:10' means as long as 10 percent\n"
+               "of the computed box is overlapped, any overlap in the ground-truth box is accepted.\n\n"
+               "If the separating character is 'd' instead of ':', overlap area computations are dumped to cerr.\n"
+               "\n"
+               "If " << pcent_opt << " is specified, " << min_filter_frames_opt << " must be explicitly set\n"
+               "to state how many frames must pass the " << pcent_opt << " criteria before the track-to-track\n"
+               "overlap is accepted.\n" );
+}
+
 bool
 matching_args_type
 ::parse_min_pcent_gt_ct( pair<double, double>& p, bool& debug_flag ) const
 {
-  istringstream iss( this->min_pcent_gt_ct() );
+  return matching_args_type::parse_min_pcent_gt_ct( this->min_pcent_gt_ct(), p, debug_flag );
+}
+
+bool
+matching_args_type
+::parse_min_pcent_gt_ct( const string& s, pair<double, double>& p, bool& debug_flag )
+{
+  istringstream iss( s );
   double d1, d2;
   char c;
   if ( (iss >> d1 >> c >> d2))
@@ -136,7 +155,7 @@ matching_args_type
   }
   else
   {
-    LOG_ERROR( main_logger, "Couldn't parse '" << this->min_pcent_gt_ct()
+    LOG_ERROR( main_logger, "Couldn't parse '" << s
                << "' as a minimum gt/ct overlap argument; try 'help' for help" );
     return false;
   }
@@ -146,12 +165,18 @@ bool
 matching_args_type
 ::parse_min_frames_arg()
 {
-  const string& s = this->min_frames_arg();
+  return matching_args_type::parse_min_frames_arg( this->min_frames_arg(), this->min_frames_policy );
+}
+
+bool
+matching_args_type
+::parse_min_frames_arg( const string& s, pair< bool, double >& policy )
+{
   size_t p = s.find_first_of( "p" );
   // the policy is absolute if no 'p' is in the string
-  this->min_frames_policy.first = (p == string::npos);
+  policy.first = (p == string::npos);
   istringstream iss( s.substr( 0, p ));
-  if ( ! ( iss >> this->min_frames_policy.second ))
+  if ( ! ( iss >> policy.second ))
   {
     LOG_ERROR( main_logger, "Couldn't parse min-frames value from '" << s.substr(0,p) << "'?" );
     return false;
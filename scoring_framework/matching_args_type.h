@@ -50,6 +50,12 @@ struct SCORE_CORE_EXPORT matching_args_type
   bool sanity_check() const;
   bool parse_min_pcent_gt_ct( std::pair<double, double>& p, bool& debug_flag ) const;
   bool parse_min_frames_arg();
+  void log_min_pcent_gt_ct_help() const;
+
+  // the parsers behind the above, for values which didn't come from the
+  // command line (e.g. matching-parameter sweeps)
+  static bool parse_min_pcent_gt_ct( const std::string& s, std::pair<double, double>& p, bool& debug_flag );
+  static bool parse_min_frames_arg( const std::string& s, std::pair< bool, double >& policy );
 };
 
 } // ...kwant
@@ -0,0 +1,88 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "parallel_for.h"
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using std::atomic;
+using std::exception_ptr;
+using std::function;
+using std::lock_guard;
+using std::mutex;
+using std::thread;
+using std::vector;
+
+namespace kwiver {
+namespace kwant {
+
+void
+parallel_for( unsigned n_threads,
+              size_t n,
+              const function< void( size_t ) >& f )
+{
+  if ( (n_threads <= 1) || (n <= 1) )
+  {
+    for (size_t i=0; i<n; ++i)
+    {
+      f( i );
+    }
+    return;
+  }
+
+  if (n_threads > n)
+  {
+    n_threads = static_cast< unsigned >( n );
+  }
+
+  atomic< size_t > next_index( 0 );
+  atomic< bool > abandoned( false );
+  mutex error_mutex;
+  exception_ptr first_error;
+
+  auto worker = [&]()
+  {
+    for (size_t i = next_index++; (i < n) && ( ! abandoned ); i = next_index++)
+    {
+      try
+      {
+        f( i );
+      }
+      catch (...)
+      {
+        lock_guard< mutex > lock( error_mutex );
+        if ( ! first_error )
+        {
+          first_error = std::current_exception();
+        }
+        abandoned = true;
+      }
+    }
+  };
+
+  vector< thread > workers;
+  workers.reserve( n_threads );
+  for (unsigned w=0; w<n_threads; ++w)
+  {
+    workers.push_back( thread( worker ));
+  }
+  for (unsigned w=0; w<n_threads; ++w)
+  {
+    workers[w].join();
+  }
+
+  if ( first_error )
+  {
+    std::rethrow_exception( first_error );
+  }
+}
+
+} // ...kwant
+} // ...kwiver
@@ -0,0 +1,40 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_PARALLEL_FOR_H
+#define INCL_PARALLEL_FOR_H
+
+///
+/// A minimal worker pool for the scoring loops: call f(i) for every i
+/// in [0, n), with the indices handed out to n_threads threads in
+/// increasing order as each thread becomes free.  f must not touch
+/// anything another call of f writes to; in particular, it must not
+/// write to track_oracle.
+///
+/// If n_threads is 0 or 1, f is called in order on the calling thread.
+/// If any call of f throws, the remaining indices are abandoned and the
+/// first exception is rethrown on the calling thread after all the
+/// threads have finished.
+///
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <cstddef>
+#include <functional>
+
+namespace kwiver {
+namespace kwant {
+
+SCORE_CORE_EXPORT
+void parallel_for( unsigned n_threads,
+                   size_t n,
+                   const std::function< void( size_t ) >& f );
+
+} // ...kwant
+} // ...kwiver
+
+#endif
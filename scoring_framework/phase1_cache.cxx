@@ -0,0 +1,582 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "phase1_cache.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#include <track_oracle/core/track_oracle_core.h>
+
+#include <scoring_framework/mapped_file.h>
+#include <scoring_framework/quickfilter_box.h>
+
+#include <vital/logger/logger.h>
+static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __FILE__ ) );
+
+using std::make_pair;
+using std::memcmp;
+using std::ofstream;
+using std::pair;
+using std::string;
+using std::unordered_map;
+using std::vector;
+
+using kwiver::track_oracle::frame_handle_type;
+using kwiver::track_oracle::oracle_entry_handle_type;
+using kwiver::track_oracle::track_handle_list_type;
+
+namespace // anon
+{
+
+using namespace ::kwiver::kwant;
+
+//
+// The file layout: a cache_header, then n_entries cache_entries, then
+// n_records cache_records, then one byte per truth frame and one byte
+// per computed frame (in snapshot order), set if the frame was matched.
+// Frames and tracks are referred to by their index in the snapshots,
+// since handles don't survive between runs.  All the structures are
+// multiples of eight bytes so that the sections stay aligned.
+//
+
+const char cache_magic[8] = { 'K', 'W', 'P', '1', 'C', 'A', 'C', 'H' };
+const uint32_t cache_version = 1;
+
+struct cache_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size; // sizeof( cache_record ), as a check on the layout
+  uint64_t key;
+  uint64_t n_truth_frames;
+  uint64_t n_computed_frames;
+  uint64_t n_entries;
+  uint64_t n_records;
+};
+
+struct cache_entry
+{
+  uint32_t truth_index;
+  uint32_t computed_index;
+  uint32_t spatial_overlap_total_frames;
+  uint32_t pad;
+  uint64_t range_first;
+  uint64_t range_second;
+  uint64_t record_offset;
+  uint64_t record_count;
+};
+
+struct cache_record
+{
+  uint64_t truth_frame;
+  uint64_t computed_frame;
+  uint32_t fL_frame_num;
+  uint32_t fR_frame_num;
+  float truth_area;
+  float computed_area;
+  float overlap_area;
+  float centroid_distance;
+  float center_bottom_distance;
+  uint32_t flags;
+};
+
+//
+// 64-bit FNV-1a.  Not cryptographic; it only has to tell one set of
+// inputs from another.
+//
+
+class fnv1a_hash
+{
+public:
+  fnv1a_hash(): h( 14695981039346656037ULL ) {}
+
+  void add( const void* p, size_t n )
+  {
+    const unsigned char* b = static_cast< const unsigned char* >( p );
+    for (size_t i=0; i<n; ++i)
+    {
+      h ^= b[i];
+      h *= 1099511628211ULL;
+    }
+  }
+
+  template< typename T >
+  void add( const T& v ) { this->add( &v, sizeof( v )); }
+
+  uint64_t value() const { return h; }
+
+private:
+  uint64_t h;
+};
+
+void
+hash_box( fnv1a_hash& h, const vgl_box_2d<double>& b )
+{
+  h.add( b.min_x() );
+  h.add( b.min_y() );
+  h.add( b.max_x() );
+  h.add( b.max_y() );
+}
+
+void
+hash_snapshot( fnv1a_hash& h, const track2track_frame_snapshot& s )
+{
+  h.add( static_cast< uint64_t >( s.size() ));
+  for (size_t i=0; i<s.size(); ++i)
+  {
+    h.add( static_cast< uint64_t >( s.n_frames( i )));
+  }
+  for (size_t k=0; k<s.frames.size(); ++k)
+  {
+    h.add( s.timestamps[k] );
+    h.add( s.frame_numbers[k] );
+    h.add( s.has_box[k] );
+    if ( s.has_box[k] )
+    {
+      hash_box( h, s.boxes[k] );
+    }
+  }
+}
+
+void
+hash_partition( fnv1a_hash& h, const vector< unsigned >* p )
+{
+  h.add( p != 0 );
+  if ( ! p ) return;
+  h.add( static_cast< uint64_t >( p->size() ));
+  for (size_t i=0; i<p->size(); ++i)
+  {
+    h.add( (*p)[i] );
+  }
+}
+
+uint64_t
+cache_key( const track2track_frame_snapshot& t,
+           const track2track_frame_snapshot& c,
+           const phase1_parameters& p,
+           bool detection_mode,
+           const vector< unsigned >* t_partition,
+           const vector< unsigned >* c_partition )
+{
+  fnv1a_hash h;
+  h.add( cache_version );
+  h.add( detection_mode );
+  h.add( p.keep_frame_overlaps );
+  h.add( p.expand_bbox );
+  h.add( p.bbox_expansion );
+  h.add( p.frame_alignment_time_window_usecs );
+  h.add( p.aoiInclusive );
+  h.add( p.b_aoi.is_empty() );
+  if ( ! p.b_aoi.is_empty() )
+  {
+    hash_box( h, p.b_aoi );
+  }
+  h.add( p.min_bound_matching_area );
+  h.add( p.min_frames_policy.first );
+  h.add( p.min_frames_policy.second );
+  h.add( p.min_pcent_overlap_gt_ct.first );
+  h.add( p.min_pcent_overlap_gt_ct.second );
+  h.add( p.iou );
+  h.add( p.pass_all_nonzero_overlaps );
+  hash_snapshot( h, t );
+  hash_snapshot( h, c );
+  hash_partition( h, t_partition );
+  hash_partition( h, c_partition );
+  return h.value();
+}
+
+// Map each frame handle in the snapshot to its index.
+
+unordered_map< oracle_entry_handle_type, size_t >
+frame_index( const track2track_frame_snapshot& s )
+{
+  unordered_map< oracle_entry_handle_type, size_t > ret;
+  ret.reserve( s.frames.size() );
+  for (size_t k=0; k<s.frames.size(); ++k)
+  {
+    ret.insert( make_pair( s.frames[k].row, k ));
+  }
+  return ret;
+}
+
+// Map each track handle in the snapshot to its (first) index.
+
+unordered_map< oracle_entry_handle_type, size_t >
+track_index( const track2track_frame_snapshot& s )
+{
+  unordered_map< oracle_entry_handle_type, size_t > ret;
+  ret.reserve( s.size() );
+  for (size_t i=0; i<s.size(); ++i)
+  {
+    ret.insert( make_pair( s.tracks[i].row, i ));
+  }
+  return ret;
+}
+
+// One byte per frame of the snapshot, set if phase 1 marked it as matched.
+
+void
+append_matched_frames( const track2track_frame_snapshot& s,
+                       vector< unsigned char >& matched )
+{
+  scorable_track_type local_track_view;
+  for (size_t k=0; k<s.frames.size(); ++k)
+  {
+    pair< bool, int > probe = local_track_view.frame_has_been_matched.get( s.frames[k].row );
+    matched.push_back( ( probe.first && ( probe.second == IN_AOI_MATCHED )) ? 1 : 0 );
+  }
+}
+
+// The inverse of append_matched_frames; same as mark_matched_frames().
+
+void
+mark_matched_frames( const track2track_frame_snapshot& s,
+                     const unsigned char* matched )
+{
+  scorable_track_type local_track_view;
+  for (size_t k=0; k<s.frames.size(); ++k)
+  {
+    if ( ! matched[k] ) continue;
+    local_track_view[ s.frames[k] ].frame_has_been_matched() = IN_AOI_MATCHED;
+  }
+}
+
+void
+run_phase1( track2track_phase1& p1,
+            const track_handle_list_type& t,
+            const track_handle_list_type& c,
+            bool detection_mode,
+            const vector< unsigned >* t_partition,
+            const vector< unsigned >* c_partition )
+{
+  if ( t_partition && c_partition )
+  {
+    p1.compute_all_partitioned( t, c, *t_partition, *c_partition );
+  }
+  else if ( detection_mode )
+  {
+    p1.compute_all_detection_mode( t, c );
+  }
+  else
+  {
+    p1.compute_all( t, c );
+  }
+}
+
+} // ...anon namespace
+
+namespace kwiver {
+namespace kwant {
+
+phase1_cache
+::phase1_cache( const string& cache_fn )
+  : fn( cache_fn )
+{
+}
+
+bool
+phase1_cache
+::compute_all( track2track_phase1& p1,
+               const track_handle_list_type& t,
+               const track_handle_list_type& c,
+               bool detection_mode )
+{
+  return this->compute( p1, t, c, detection_mode, 0, 0 );
+}
+
+bool
+phase1_cache
+::compute_all_partitioned( track2track_phase1& p1,
+                           const track_handle_list_type& t,
+                           const track_handle_list_type& c,
+                           const vector< unsigned >& t_partition,
+                           const vector< unsigned >& c_partition )
+{
+  return this->compute( p1, t, c, false, &t_partition, &c_partition );
+}
+
+bool
+phase1_cache
+::compute( track2track_phase1& p1,
+           const track_handle_list_type& t,
+           const track_handle_list_type& c,
+           bool detection_mode,
+           const vector< unsigned >* t_partition,
+           const vector< unsigned >* c_partition )
+{
+  if ( p1.params.radial_overlap >= 0.0 )
+  {
+    LOG_INFO( main_logger, "p1: radial overlap results are not cached; ignoring '" << this->fn << "'" );
+    run_phase1( p1, t, c, detection_mode, t_partition, c_partition );
+    return false;
+  }
+  if ( ! p1.t2t.empty() )
+  {
+    LOG_INFO( main_logger, "p1: association matrix already populated; ignoring cache '" << this->fn << "'" );
+    run_phase1( p1, t, c, detection_mode, t_partition, c_partition );
+    return false;
+  }
+
+  // The snapshots are what phase 1 reads, so they're what we hash.
+  // On a miss compute_all() takes its own; that's cheap next to the
+  // track comparisons.
+
+  track2track_frame_snapshot t_snap( t ), c_snap( c );
+  uint64_t key = cache_key( t_snap, c_snap, p1.params, detection_mode, t_partition, c_partition );
+
+  if ( this->load( key, t_snap, c_snap, p1 ))
+  {
+    LOG_INFO( main_logger, "p1: loaded " << p1.t2t.size() << " track pairs from cache '" << this->fn << "'" );
+    return true;
+  }
+
+  LOG_INFO( main_logger, "p1: no matching results in cache '" << this->fn << "'; computing" );
+  run_phase1( p1, t, c, detection_mode, t_partition, c_partition );
+  if ( this->save( key, t_snap, c_snap, p1 ))
+  {
+    LOG_INFO( main_logger, "p1: wrote " << p1.t2t.size() << " track pairs to cache '" << this->fn << "'" );
+  }
+  else
+  {
+    LOG_WARN( main_logger, "p1: couldn't write cache '" << this->fn << "'" );
+  }
+  return false;
+}
+
+bool
+phase1_cache
+::load( unsigned long long key,
+        const track2track_frame_snapshot& t_snap,
+        const track2track_frame_snapshot& c_snap,
+        track2track_phase1& p1 ) const
+{
+  mapped_file m( this->fn );
+  if ( ( ! m.data() ) || ( m.size() < sizeof( cache_header ))) return false;
+
+  const cache_header* hdr = reinterpret_cast< const cache_header* >( m.data() );
+  if ( ( memcmp( hdr->magic, cache_magic, sizeof( cache_magic )) != 0 ) ||
+       ( hdr->version != cache_version ) ||
+       ( hdr->record_size != sizeof( cache_record )) ||
+       ( hdr->key != key ) ||
+       ( hdr->n_truth_frames != t_snap.frames.size() ) ||
+       ( hdr->n_computed_frames != c_snap.frames.size() ))
+  {
+    return false;
+  }
+
+  size_t n_entries = static_cast< size_t >( hdr->n_entries );
+  size_t n_records = static_cast< size_t >( hdr->n_records );
+  size_t expected_size =
+    sizeof( cache_header ) +
+    n_entries * sizeof( cache_entry ) +
+    n_records * sizeof( cache_record ) +
+    t_snap.frames.size() + c_snap.frames.size();
+  if ( m.size() != expected_size ) return false;
+
+  const char* p = m.data() + sizeof( cache_header );
+  const cache_entry* entries = reinterpret_cast< const cache_entry* >( p );
+  p += n_entries * sizeof( cache_entry );
+  const cache_record* records = reinterpret_cast< const cache_record* >( p );
+  p += n_records * sizeof( cache_record );
+  const unsigned char* t_matched = reinterpret_cast< const unsigned char* >( p );
+  const unsigned char* c_matched = t_matched + t_snap.frames.size();
+
+  // check every index before changing anything
+
+  for (size_t k=0; k<n_entries; ++k)
+  {
+    const cache_entry& e = entries[k];
+    if ( ( e.truth_index >= t_snap.size() ) ||
+         ( e.computed_index >= c_snap.size() ) ||
+         ( e.record_offset > n_records ) ||
+         ( e.record_count > n_records - e.record_offset ))
+    {
+      return false;
+    }
+  }
+  for (size_t k=0; k<n_records; ++k)
+  {
+    if ( ( records[k].truth_frame >= t_snap.frames.size() ) ||
+         ( records[k].computed_frame >= c_snap.frames.size() ))
+    {
+      return false;
+    }
+  }
+
+  // compute_all() leaves quickfilter boxes on the tracks; so do we
+  quickfilter_box_type::add_quickfilter_boxes( t_snap.tracks, p1.params );
+  quickfilter_box_type::add_quickfilter_boxes( c_snap.tracks, p1.params );
+
+  track2track_overlap_arena& arena = *p1.overlap_arena;
+  size_t base = arena.records.size();
+  arena.records.reserve( base + n_records );
+  for (size_t k=0; k<n_records; ++k)
+  {
+    const cache_record& r = records[k];
+    track2track_compact_overlap_record o;
+    o.truth_frame = t_snap.frames[ r.truth_frame ];
+    o.computed_frame = c_snap.frames[ r.computed_frame ];
+    o.fL_frame_num = r.fL_frame_num;
+    o.fR_frame_num = r.fR_frame_num;
+    o.truth_area = r.truth_area;
+    o.computed_area = r.computed_area;
+    o.overlap_area = r.overlap_area;
+    o.centroid_distance = r.centroid_distance;
+    o.center_bottom_distance = r.center_bottom_distance;
+    o.flags = static_cast< unsigned char >( r.flags );
+    arena.records.push_back( o );
+  }
+
+  vector< track2track_phase1::t2t_type::value_type > matches;
+  matches.reserve( n_entries );
+  for (size_t k=0; k<n_entries; ++k)
+  {
+    const cache_entry& e = entries[k];
+    track2track_score s;
+    s.cached_truth_track = t_snap.tracks[ e.truth_index ];
+    s.cached_comp_track = c_snap.tracks[ e.computed_index ];
+    s.spatial_overlap_total_frames = e.spatial_overlap_total_frames;
+    s.overlap_frame_range = make_pair( static_cast< ts_type >( e.range_first ),
+                                       static_cast< ts_type >( e.range_second ));
+    if ( e.record_count > 0 )
+    {
+      s.overlap_arena = p1.overlap_arena;
+      s.overlap_offset = base + static_cast< size_t >( e.record_offset );
+      s.overlap_count = static_cast< size_t >( e.record_count );
+    }
+    matches.push_back( make_pair( make_pair( s.cached_truth_track, s.cached_comp_track ), s ));
+  }
+
+  mark_matched_frames( t_snap, t_matched );
+  mark_matched_frames( c_snap, c_matched );
+  p1.t2t.insert( matches );
+  return true;
+}
+
+bool
+phase1_cache
+::save( unsigned long long key,
+        const track2track_frame_snapshot& t_snap,
+        const track2track_frame_snapshot& c_snap,
+        const track2track_phase1& p1 ) const
+{
+  unordered_map< oracle_entry_handle_type, size_t >
+    t_tracks = track_index( t_snap ),
+    c_tracks = track_index( c_snap ),
+    t_frames = frame_index( t_snap ),
+    c_frames = frame_index( c_snap );
+
+  vector< cache_entry > entries;
+  vector< cache_record > records;
+  entries.reserve( p1.t2t.size() );
+  for (track2track_phase1::t2t_type::const_iterator i = p1.t2t.begin(); i != p1.t2t.end(); ++i)
+  {
+    unordered_map< oracle_entry_handle_type, size_t >::const_iterator t_probe = t_tracks.find( i->first.first.row );
+    unordered_map< oracle_entry_handle_type, size_t >::const_iterator c_probe = c_tracks.find( i->first.second.row );
+    if ( ( t_probe == t_tracks.end() ) || ( c_probe == c_tracks.end() ))
+    {
+      LOG_WARN( main_logger, "p1 cache: association matrix refers to tracks outside the input lists" );
+      return false;
+    }
+
+    const track2track_score& s = i->second;
+    cache_entry e;
+    e.truth_index = static_cast< uint32_t >( t_probe->second );
+    e.computed_index = static_cast< uint32_t >( c_probe->second );
+    e.spatial_overlap_total_frames = s.spatial_overlap_total_frames;
+    e.pad = 0;
+    e.range_first = s.overlap_frame_range.first;
+    e.range_second = s.overlap_frame_range.second;
+    e.record_offset = records.size();
+    e.record_count = s.n_frame_overlaps();
+    entries.push_back( e );
+
+    for (size_t k=0; k<s.n_frame_overlaps(); ++k)
+    {
+      const track2track_compact_overlap_record& o = s.compact_overlap( k );
+      unordered_map< oracle_entry_handle_type, size_t >::const_iterator tf = t_frames.find( o.truth_frame.row );
+      unordered_map< oracle_entry_handle_type, size_t >::const_iterator cf = c_frames.find( o.computed_frame.row );
+      if ( ( tf == t_frames.end() ) || ( cf == c_frames.end() ))
+      {
+        LOG_WARN( main_logger, "p1 cache: frame overlap refers to frames outside the input tracks" );
+        return false;
+      }
+      cache_record r;
+      r.truth_frame = tf->second;
+      r.computed_frame = cf->second;
+      r.fL_frame_num = o.fL_frame_num;
+      r.fR_frame_num = o.fR_frame_num;
+      r.truth_area = o.truth_area;
+      r.computed_area = o.computed_area;
+      r.overlap_area = o.overlap_area;
+      r.centroid_distance = o.centroid_distance;
+      r.center_bottom_distance = o.center_bottom_distance;
+      r.flags = o.flags;
+      records.push_back( r );
+    }
+  }
+
+  vector< unsigned char > matched;
+  matched.reserve( t_snap.frames.size() + c_snap.frames.size() );
+  append_matched_frames( t_snap, matched );
+  append_matched_frames( c_snap, matched );
+
+  cache_header hdr;
+  std::memcpy( hdr.magic, cache_magic, sizeof( cache_magic ));
+  hdr.version = cache_version;
+  hdr.record_size = sizeof( cache_record );
+  hdr.key = key;
+  hdr.n_truth_frames = t_snap.frames.size();
+  hdr.n_computed_frames = c_snap.frames.size();
+  hdr.n_entries = entries.size();
+  hdr.n_records = records.size();
+
+  // write to a temporary and rename, so a failed write never leaves
+  // a truncated cache behind
+
+  string tmp_fn = this->fn + ".tmp";
+  {
+    ofstream os( tmp_fn.c_str(), std::ios::binary | std::ios::trunc );
+    if ( ! os ) return false;
+    os.write( reinterpret_cast< const char* >( &hdr ), sizeof( hdr ));
+    if ( ! entries.empty() )
+    {
+      os.write( reinterpret_cast< const char* >( &entries[0] ), entries.size() * sizeof( cache_entry ));
+    }
+    if ( ! records.empty() )
+    {
+      os.write( reinterpret_cast< const char* >( &records[0] ), records.size() * sizeof( cache_record ));
+    }
+    if ( ! matched.empty() )
+    {
+      os.write( reinterpret_cast< const char* >( &matched[0] ), matched.size() );
+    }
+    if ( ! os )
+    {
+      os.close();
+      std::remove( tmp_fn.c_str() );
+      return false;
+    }
+  }
+
+#ifdef _WIN32
+  std::remove( this->fn.c_str() );
+#endif
+  if ( std::rename( tmp_fn.c_str(), this->fn.c_str() ) != 0 )
+  {
+    std::remove( tmp_fn.c_str() );
+    return false;
+  }
+  return true;
+}
+
+} // ...kwant
+} // ...kwiver
@@ -0,0 +1,86 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_PHASE1_CACHE_H
+#define INCL_PHASE1_CACHE_H
+
+//
+// An on-disk cache of phase 1 results.
+//
+// The cache file holds the t2t entries, their frame overlaps and the
+// frames phase 1 flagged as matched, keyed by a hash of everything
+// phase 1 reads: the timestamps, frame numbers and boxes of every
+// frame of the truth and computed tracks (as loaded, i.e. after any
+// timestamp rebasing and filtering), the phase1_parameters which
+// affect matching, and the track partitions, if any.  If the key in the file matches, the results are
+// loaded instead of computed; otherwise phase 1 runs as usual and the
+// file is (re)written.
+//
+// The file is a flat, native-endian image of fixed-size records and
+// is memory-mapped when read.  It's not meant to be portable between
+// machines, and any mismatch (version, key, size) just means a miss.
+//
+// Radial overlap isn't cached, since the MGRS data it reads isn't
+// part of the key.
+//
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <string>
+#include <vector>
+
+#include <scoring_framework/score_phase1.h>
+
+namespace kwiver {
+namespace kwant {
+
+class SCORE_CORE_EXPORT phase1_cache
+{
+public:
+  explicit phase1_cache( const std::string& fn );
+
+  // Fill in p1.t2t for truth tracks t and computed tracks c, via
+  // compute_all() (or compute_all_detection_mode() if detection_mode
+  // is set) or from the cache.  Returns true if the cache was used.
+  // p1.t2t must be empty.
+  bool compute_all( track2track_phase1& p1,
+                    const kwto::track_handle_list_type& t,
+                    const kwto::track_handle_list_type& c,
+                    bool detection_mode = false );
+
+  // As compute_all, via p1.compute_all_partitioned().
+  bool compute_all_partitioned( track2track_phase1& p1,
+                                const kwto::track_handle_list_type& t,
+                                const kwto::track_handle_list_type& c,
+                                const std::vector< unsigned >& t_partition,
+                                const std::vector< unsigned >& c_partition );
+
+private:
+  std::string fn;
+
+  bool compute( track2track_phase1& p1,
+                const kwto::track_handle_list_type& t,
+                const kwto::track_handle_list_type& c,
+                bool detection_mode,
+                const std::vector< unsigned >* t_partition,
+                const std::vector< unsigned >* c_partition );
+
+  bool load( unsigned long long key,
+             const track2track_frame_snapshot& t_snap,
+             const track2track_frame_snapshot& c_snap,
+             track2track_phase1& p1 ) const;
+
+  bool save( unsigned long long key,
+             const track2track_frame_snapshot& t_snap,
+             const track2track_frame_snapshot& c_snap,
+             const track2track_phase1& p1 ) const;
+};
+
+} // ...kwant
+} // ...kwiver
+
+#endif
@@ -103,6 +103,16 @@ struct SCORE_CORE_EXPORT phase1_parameters
   // downstream.  Invalid if radial overlap requested.
   bool pass_all_nonzero_overlaps;
 
+  // number of worker threads used to compare track pairs; 0 or 1
+  // means compare them on the calling thread.
+  unsigned n_threads;
+
+  // if false, phase 1 keeps only the per-pair aggregates
+  // (spatial_overlap_total_frames, overlap_frame_range) and the frames'
+  // matched flags, dropping the per-frame overlap records.  Only clear
+  // this if nothing downstream reads the records.
+  bool keep_frame_overlaps;
+
 
   phase1_parameters()
     : expand_bbox(false),
@@ -116,7 +126,9 @@ struct SCORE_CORE_EXPORT phase1_parameters
       iou ( -1.0 ),
       debug_min_pcent_overlap_gt_ct( false ),
       radial_overlap( -1.0 ),
-      pass_all_nonzero_overlaps( false )
+      pass_all_nonzero_overlaps( false ),
+      n_threads( 1 ),
+      keep_frame_overlaps( true )
   {}
 
   explicit phase1_parameters(double expansion)
@@ -131,7 +143,9 @@ struct SCORE_CORE_EXPORT phase1_parameters
       iou( -1.0 ),
       debug_min_pcent_overlap_gt_ct( false ),
       radial_overlap( -1.0 ),
-      pass_all_nonzero_overlaps( false )
+      pass_all_nonzero_overlaps( false ),
+      n_threads( 1 ),
+      keep_frame_overlaps( true )
   {}
 
   bool processMatchingArgs( const matching_args_type& m );
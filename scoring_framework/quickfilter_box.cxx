@@ -422,11 +422,23 @@ quickfilter_box_type
   // get the boxes
   vgl_box_2d<double> box_1 = this->img_box();
   vgl_box_2d<double> box_2 = other.img_box();
-  if (box_1.is_empty() || box_2.is_empty())
-  {
 #ifdef QF_DEBUG
-    if (dbg) LOG_DEBUG( main_logger, "img_box_intersect: box1/box2 empty:\n" << box_1 << "\n" << box_2 );
+  if (dbg && (box_1.is_empty() || box_2.is_empty()))
+  {
+    LOG_DEBUG( main_logger, "img_box_intersect: box1/box2 empty:\n" << box_1 << "\n" << box_2 );
+  }
 #endif
+
+  return quickfilter_box_type::img_box_intersect( box_1, box_2 );
+}
+
+double
+quickfilter_box_type
+::img_box_intersect( const vgl_box_2d<double>& box_1,
+                     const vgl_box_2d<double>& box_2 )
+{
+  if (box_1.is_empty() || box_2.is_empty())
+  {
     return -1.0;
   }
 
@@ -116,6 +116,12 @@ struct SCORE_CORE_EXPORT quickfilter_box_type: public kwto::track_base< quickfil
   double img_box_intersect( const kwto::track_handle_type& t1,
                             const kwto::track_handle_type& t2 );
 
+  // as above, on two image-coordinate quickfilter boxes already
+  // fetched from their tracks: -1 if either is empty, else the area
+  // of their intersection.  Does not touch track_oracle.
+  static double img_box_intersect( const vgl_box_2d<double>& box_1,
+                                   const vgl_box_2d<double>& box_2 );
+
   // return >=0 if valid boxes could be compared; return -1 if no
   // quickfilter decision could be made.
   double quickfilter_check( const kwto::track_handle_type& t1,
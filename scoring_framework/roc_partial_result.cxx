@@ -0,0 +1,342 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "roc_partial_result.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <sstream>
+
+#include <vital/logger/logger.h>
+static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __FILE__ ) );
+
+using std::ifstream;
+using std::istream;
+using std::istringstream;
+using std::ofstream;
+using std::ostream;
+using std::string;
+using std::vector;
+
+namespace // anon
+{
+
+using namespace ::kwiver::kwant;
+
+const char* partial_magic = "kwant-roc-partial";
+const unsigned partial_version = 1;
+
+template< typename T >
+void
+write_list( ostream& os, const char* tag, const vector< T >& v )
+{
+  os << tag << " " << v.size() << "\n";
+  for (size_t k=0; k<v.size(); ++k)
+  {
+    os << v[k] << ( ( ( k+1 == v.size() ) || ( (k+1) % 8 == 0 )) ? "\n" : " " );
+  }
+}
+
+template< typename T >
+bool
+read_value( istream& is, const string& fn, const char* tag, T& value )
+{
+  string s;
+  if ( ( ! ( is >> s >> value )) || ( s != tag ))
+  {
+    LOG_ERROR( main_logger, "ROC partial result '" << fn << "': expected '" << tag << "'" );
+    return false;
+  }
+  return true;
+}
+
+template< typename T >
+bool
+read_list( istream& is, const string& fn, const char* tag, vector< T >& v )
+{
+  size_t n = 0;
+  if ( ! read_value( is, fn, tag, n )) return false;
+  v.resize( n );
+  for (size_t k=0; k<n; ++k)
+  {
+    if ( ! ( is >> v[k] ))
+    {
+      LOG_ERROR( main_logger, "ROC partial result '" << fn << "': short " << tag << " list" );
+      return false;
+    }
+  }
+  return true;
+}
+
+void
+add_hist( vector< size_t >& dst, const vector< size_t >& src )
+{
+  for (size_t b=0; b<dst.size(); ++b)
+  {
+    dst[b] += src[b];
+  }
+}
+
+} // ...anon
+
+namespace kwiver {
+namespace kwant {
+
+roc_partial_result
+::roc_partial_result()
+  : min_relevancy( 0.0 ),
+    max_relevancy( 1.0 ),
+    n_bins( 0 ),
+    detection_mode( false ),
+    n_truth_tracks( 0 ),
+    n_matched( 0 ),
+    n_unmatched( 0 )
+{
+}
+
+roc_partial_result
+::roc_partial_result( double min_r, double max_r, unsigned n, bool detection )
+  : min_relevancy( min_r ),
+    max_relevancy( max_r ),
+    n_bins( n ),
+    detection_mode( detection ),
+    n_truth_tracks( 0 ),
+    n_matched( 0 ),
+    n_unmatched( 0 ),
+    tp_hist( n+1, 0 ),
+    fp_hist( n+1, 0 ),
+    hit_hist( n+1, 0 )
+{
+}
+
+bool
+roc_partial_result
+::parse_grid( const string& s, double& min_r, double& max_r, unsigned& n )
+{
+  string tmp( s );
+  std::replace( tmp.begin(), tmp.end(), ':', ' ' );
+  istringstream iss( tmp );
+  if ( ( ! ( iss >> min_r >> max_r >> n )) || ( n == 0 ) || ( ! ( min_r < max_r )))
+  {
+    LOG_ERROR( main_logger, "Couldn't parse '" << s << "' as a relevancy grid (min:max:n, min < max, n > 0)" );
+    return false;
+  }
+  return true;
+}
+
+double
+roc_partial_result
+::threshold( size_t b ) const
+{
+  return ( b >= this->n_bins )
+    ? this->max_relevancy
+    : this->min_relevancy + ( this->max_relevancy - this->min_relevancy ) * b / this->n_bins;
+}
+
+int
+roc_partial_result
+::bin( double relevancy ) const
+{
+  // NaNs fail this too
+  if ( ! ( relevancy >= this->min_relevancy )) return -1;
+  if ( relevancy >= this->max_relevancy ) return static_cast< int >( this->n_bins );
+
+  // the division is only a guess; settle it against the thresholds
+  // themselves, so that a relevancy is counted at threshold(k) exactly
+  // when it's >= threshold(k)
+  double f = ( relevancy - this->min_relevancy ) / ( this->max_relevancy - this->min_relevancy );
+  size_t b = std::min( static_cast< size_t >( f * this->n_bins ), static_cast< size_t >( this->n_bins - 1 ));
+  while ( ( b > 0 ) && ( relevancy < this->threshold( b ))) --b;
+  while ( ( b < this->n_bins ) && ( relevancy >= this->threshold( b+1 ))) ++b;
+  return static_cast< int >( b );
+}
+
+void
+roc_partial_result
+::add_computed( double relevancy, bool matched )
+{
+  int b = this->bin( relevancy );
+  if ( matched )
+  {
+    ++this->n_matched;
+    if ( b >= 0 ) ++this->tp_hist[ b ];
+  }
+  else
+  {
+    ++this->n_unmatched;
+    if ( b >= 0 ) ++this->fp_hist[ b ];
+  }
+}
+
+void
+roc_partial_result
+::add_truth_hit( double best_relevancy )
+{
+  int b = this->bin( best_relevancy );
+  if ( b < 0 ) return;
+  this->hit_hist[ b ]++;
+}
+
+bool
+roc_partial_result
+::merge( const roc_partial_result& other )
+{
+  if ( ( this->min_relevancy != other.min_relevancy ) ||
+       ( this->max_relevancy != other.max_relevancy ) ||
+       ( this->n_bins != other.n_bins ) ||
+       ( this->detection_mode != other.detection_mode ))
+  {
+    return false;
+  }
+  this->n_truth_tracks += other.n_truth_tracks;
+  this->n_matched += other.n_matched;
+  this->n_unmatched += other.n_unmatched;
+  add_hist( this->tp_hist, other.tp_hist );
+  add_hist( this->fp_hist, other.fp_hist );
+  add_hist( this->hit_hist, other.hit_hist );
+
+  vector< ts_type > ts;
+  ts.reserve( this->fa_norm_timestamps.size() + other.fa_norm_timestamps.size() );
+  std::set_union( this->fa_norm_timestamps.begin(), this->fa_norm_timestamps.end(),
+                  other.fa_norm_timestamps.begin(), other.fa_norm_timestamps.end(),
+                  std::back_inserter( ts ));
+  this->fa_norm_timestamps.swap( ts );
+  return true;
+}
+
+double
+roc_partial_result
+::fa_norm() const
+{
+  return
+    this->detection_mode
+    ? static_cast< double >( this->fa_norm_timestamps.size() )
+    : 1.0;
+}
+
+void
+roc_partial_result
+::write_roc_csv( ostream& os ) const
+{
+  os << "threshold, PD, FA, nMatches, TP, FP, TN, FN, matched, relevant, nTrueTracks, faNorm\n";
+
+  // sum each histogram from the top down, then write in ascending order
+  size_t n = this->tp_hist.size();
+  vector< size_t > tp( n+1, 0 ), fp( n+1, 0 ), hits( n+1, 0 );
+  for (size_t b = n; b-- > 0; )
+  {
+    tp[b] = tp[b+1] + this->tp_hist[b];
+    fp[b] = fp[b+1] + this->fp_hist[b];
+    hits[b] = hits[b+1] + this->hit_hist[b];
+  }
+
+  double fa_norm = this->fa_norm();
+  for (size_t b = 0; b < n; ++b)
+  {
+    unsigned nMatches = static_cast< unsigned >( hits[b] );
+    unsigned t_p = static_cast< unsigned >( tp[b] ), f_p = static_cast< unsigned >( fp[b] );
+    unsigned f_n = static_cast< unsigned >( this->n_matched - tp[b] );
+    unsigned t_n = static_cast< unsigned >( this->n_unmatched - fp[b] );
+    double pd =
+      ( this->n_truth_tracks == 0 )
+      ? 0.0
+      : 1.0 * nMatches / this->n_truth_tracks;
+    os << this->threshold( b ) << ", " << pd << ", " << f_p << ", " << nMatches << ", " << t_p << ", " << f_p << ", "
+       << t_n << ", " << f_n << ", " << (t_p+f_n) << ",  " << (t_p+f_p) << ", " << this->n_truth_tracks << ", "
+       << (f_p / fa_norm) << "\n";
+  }
+}
+
+bool
+roc_partial_result
+::write( const string& fn ) const
+{
+  ofstream os( fn.c_str() );
+  if ( ! os )
+  {
+    LOG_ERROR( main_logger, "Couldn't open '" << fn << "' for writing" );
+    return false;
+  }
+  os << std::setprecision( std::numeric_limits< double >::digits10 + 2 );
+  os << partial_magic << " " << partial_version << "\n"
+     << "min-relevancy " << this->min_relevancy << "\n"
+     << "max-relevancy " << this->max_relevancy << "\n"
+     << "n-bins " << this->n_bins << "\n"
+     << "detection-mode " << ( this->detection_mode ? 1 : 0 ) << "\n"
+     << "n-truth-tracks " << this->n_truth_tracks << "\n"
+     << "n-matched " << this->n_matched << "\n"
+     << "n-unmatched " << this->n_unmatched << "\n";
+  write_list( os, "tp-hist", this->tp_hist );
+  write_list( os, "fp-hist", this->fp_hist );
+  write_list( os, "hit-hist", this->hit_hist );
+  write_list( os, "fa-norm-timestamps", this->fa_norm_timestamps );
+  if ( ! os )
+  {
+    LOG_ERROR( main_logger, "Error writing ROC partial result '" << fn << "'" );
+    return false;
+  }
+  return true;
+}
+
+bool
+roc_partial_result
+::read( const string& fn )
+{
+  ifstream is( fn.c_str() );
+  if ( ! is )
+  {
+    LOG_ERROR( main_logger, "Couldn't open ROC partial result '" << fn << "'" );
+    return false;
+  }
+
+  unsigned version = 0;
+  if ( ! read_value( is, fn, partial_magic, version )) return false;
+  if ( version != partial_version )
+  {
+    LOG_ERROR( main_logger, "ROC partial result '" << fn << "' is version " << version
+               << "; expected " << partial_version );
+    return false;
+  }
+
+  roc_partial_result r;
+  int detection_flag = 0;
+  bool okay =
+    read_value( is, fn, "min-relevancy", r.min_relevancy ) &&
+    read_value( is, fn, "max-relevancy", r.max_relevancy ) &&
+    read_value( is, fn, "n-bins", r.n_bins ) &&
+    read_value( is, fn, "detection-mode", detection_flag ) &&
+    read_value( is, fn, "n-truth-tracks", r.n_truth_tracks ) &&
+    read_value( is, fn, "n-matched", r.n_matched ) &&
+    read_value( is, fn, "n-unmatched", r.n_unmatched ) &&
+    read_list( is, fn, "tp-hist", r.tp_hist ) &&
+    read_list( is, fn, "fp-hist", r.fp_hist ) &&
+    read_list( is, fn, "hit-hist", r.hit_hist ) &&
+    read_list( is, fn, "fa-norm-timestamps", r.fa_norm_timestamps );
+  if ( ! okay ) return false;
+
+  size_t n = static_cast< size_t >( r.n_bins ) + 1;
+  if ( ( r.tp_hist.size() != n ) || ( r.fp_hist.size() != n ) || ( r.hit_hist.size() != n ))
+  {
+    LOG_ERROR( main_logger, "ROC partial result '" << fn << "': histograms don't have " << n << " bins" );
+    return false;
+  }
+  if ( ! std::is_sorted( r.fa_norm_timestamps.begin(), r.fa_norm_timestamps.end() ))
+  {
+    LOG_ERROR( main_logger, "ROC partial result '" << fn << "': timestamps are not sorted" );
+    return false;
+  }
+
+  r.detection_mode = ( detection_flag != 0 );
+  *this = r;
+  return true;
+}
+
+} // ...kwant
+} // ...kwiver
@@ -0,0 +1,96 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_ROC_PARTIAL_RESULT_H
+#define INCL_ROC_PARTIAL_RESULT_H
+
+//
+// The raw counts behind a score_events ROC, binned over a fixed grid of
+// relevancy thresholds, which can be merged with those of other runs
+// over disjoint tracks (e.g. one run per clip or camera) to give the
+// ROC of a single run over all the data at the grid's thresholds.
+//
+// The grid is n_bins+1 thresholds evenly spaced from min_relevancy to
+// max_relevancy inclusive; bin b holds the relevancies in
+// [ threshold(b), threshold(b+1) ), and the last bin everything at or
+// above max_relevancy.  Relevancies below the grid (and NaNs) are never
+// relevant at any of its thresholds.  Per bin, we keep the matched and
+// unmatched computed tracks (the TP and FP histograms) and the truth
+// tracks whose most relevant matching computed track falls in that bin
+// (the nMatches histogram); the counts at threshold(b) are the sums
+// from bin b up.
+//
+// In detection mode, false alarms are normalized by the number of
+// distinct timestamps, which may be shared between runs; those are
+// kept as a sorted list and merged as sets.
+//
+// The file format is plain text, so partial results can be moved
+// between machines.
+//
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <scoring_framework/score_core.h>
+
+namespace kwiver {
+namespace kwant {
+
+struct SCORE_CORE_EXPORT roc_partial_result
+{
+public:
+  double min_relevancy;
+  double max_relevancy;
+  unsigned n_bins;
+  bool detection_mode;
+
+  size_t n_truth_tracks;
+  size_t n_matched;                    // computed tracks matching any truth track
+  size_t n_unmatched;                  // ... and those matching none
+  std::vector< size_t > tp_hist;       // n_bins+1 bins: matched computed tracks,
+  std::vector< size_t > fp_hist;       // ... unmatched computed tracks,
+  std::vector< size_t > hit_hist;      // ... truth tracks, by their best match
+  std::vector< ts_type > fa_norm_timestamps;  // detection mode only; sorted
+
+  roc_partial_result();
+  roc_partial_result( double min_r, double max_r, unsigned n, bool detection );
+
+  // parse "min:max:n", e.g. "0:1:100"
+  static bool parse_grid( const std::string& s, double& min_r, double& max_r, unsigned& n );
+
+  double threshold( size_t b ) const;
+
+  // the bin of a relevancy, or -1 if it's below the grid (or a NaN)
+  int bin( double relevancy ) const;
+
+  // count a computed track, and a truth track whose best matching
+  // computed track has the given relevancy
+  void add_computed( double relevancy, bool matched );
+  void add_truth_hit( double best_relevancy );
+
+  // add the counts of another run over the same grid; returns false
+  // (leaving us unchanged) if the grids or modes differ
+  bool merge( const roc_partial_result& other );
+
+  double fa_norm() const;
+
+  // the ROC at each of the grid's thresholds, in the columns of
+  // score_events' --roc-csv-dump
+  void write_roc_csv( std::ostream& os ) const;
+
+  bool write( const std::string& fn ) const;
+  bool read( const std::string& fn );
+};
+
+} // ...kwant
+} // ...kwiver
+
+#endif
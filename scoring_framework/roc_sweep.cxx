@@ -0,0 +1,69 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "roc_sweep.h"
+
+#include <algorithm>
+
+using std::stable_sort;
+using std::vector;
+
+namespace kwiver {
+namespace kwant {
+
+vector< roc_point_type >
+sweep_roc( const vector< double >& thresholds,
+           const vector< double >& relevancy,
+           const vector< vector< size_t > >& matches,
+           size_t n_truth )
+{
+  // most relevant first; NaNs are never relevant, so leave them off the end
+  vector< size_t > order;
+  unsigned n_matched = 0;
+  for (size_t i=0; i<relevancy.size(); ++i)
+  {
+    if ( ! matches[i].empty() ) ++n_matched;
+    if ( relevancy[i] == relevancy[i] ) order.push_back( i );
+  }
+  stable_sort( order.begin(), order.end(),
+               [&]( size_t a, size_t b ) { return relevancy[a] > relevancy[b]; } );
+
+  unsigned n_unmatched = static_cast< unsigned >( relevancy.size() ) - n_matched;
+  vector< bool > truth_hit( n_truth, false );
+  unsigned nMatches = 0, n_relevant = 0, n_relevant_matched = 0;
+
+  vector< roc_point_type > points( thresholds.size() );
+  size_t next = 0;
+  for (size_t k = thresholds.size(); k-- > 0; )
+  {
+    while ( ( next < order.size() ) && ( relevancy[ order[next] ] >= thresholds[k] ))
+    {
+      const vector< size_t >& m = matches[ order[next] ];
+      ++n_relevant;
+      if ( ! m.empty() ) ++n_relevant_matched;
+      for (size_t j=0; j<m.size(); ++j)
+      {
+        if ( ! truth_hit[ m[j] ] )
+        {
+          truth_hit[ m[j] ] = true;
+          ++nMatches;
+        }
+      }
+      ++next;
+    }
+
+    roc_point_type& p = points[k];
+    p.nMatches = nMatches;
+    p.tp = n_relevant_matched;
+    p.fp = n_relevant - n_relevant_matched;
+    p.fn = n_matched - n_relevant_matched;
+    p.tn = n_unmatched - p.fp;
+  }
+  return points;
+}
+
+} // ...kwant
+} // ...kwiver
@@ -0,0 +1,59 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_ROC_SWEEP_H
+#define INCL_ROC_SWEEP_H
+
+//
+// The ROC counts score_events reports at each threshold.  A computed
+// track is relevant (R) if its relevancy is >= the threshold, and
+// matched (M) if it matches any true track:
+//
+// R  &  M  : true positive (but unique against truth tracks)
+// R  & !M  : false positive
+// !R &  M  : false negative
+// !R & !M  : true negative
+//
+// nMatches is the number of distinct true tracks matched by the
+// relevant computed tracks, to factor out the possibility of multiple
+// computed tracks matching a single truth track.
+//
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace kwiver {
+namespace kwant {
+
+struct SCORE_CORE_EXPORT roc_point_type
+{
+  unsigned nMatches, tp, fp, tn, fn;
+  roc_point_type(): nMatches(0), tp(0), fp(0), tn(0), fn(0) {}
+};
+
+//
+// Compute the ROC points for each of the thresholds (ascending), given
+// the relevancy of each computed track and the truth ordinals (in
+// [0, n_truth)) it matches.  The computed tracks are sorted by
+// relevancy once; the thresholds are then swept from the top down,
+// each step adding the newly relevant tracks to the running counts
+// and to the bitset of hit truth tracks.  NaN relevancies are never
+// relevant.
+//
+
+SCORE_CORE_EXPORT std::vector< roc_point_type >
+sweep_roc( const std::vector< double >& thresholds,
+           const std::vector< double >& relevancy,
+           const std::vector< std::vector< size_t > >& matches,
+           size_t n_truth );
+
+} // ...kwant
+} // ...kwiver
+
+#endif
@@ -20,6 +20,11 @@ sweeping an ROC.  For KSTs, this is "relevancy" on the assumption that all track
 C were selected to be the ground-truth activity by e.g. IQR; for kwxmls, the probability of
 the activity index is used.
 
+Several activities may be scored in one run by listing them, comma-separated, in
+--a or --kpf-target.  The tracks are loaded once and phase 1 is computed once, over
+the track pairs which some activity scores; each activity's ROC / PR output files have
+the activity name inserted before their extension (e.g. roc.csv -> roc.walking.csv.)
+
  */
 
 #include <algorithm>
@@ -28,8 +33,11 @@ the activity index is used.
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <cstdio>
 #include <cstdlib>
 #include <limits>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <vul/vul_arg.h>
 #include <vul/vul_file.h>
@@ -66,10 +74,15 @@ the activity index is used.
 #include <track_oracle/file_formats/track_filter_kpf_activity/track_filter_kpf_activity.h>
 
 #include <scoring_framework/score_phase1.h>
+#include <scoring_framework/phase1_cache.h>
 #include <scoring_framework/score_tracks_hadwav.h>
 #include <scoring_framework/score_tracks_loader.h>
 #include <scoring_framework/matching_args_type.h>
 #include <scoring_framework/timestamp_utilities.h>
+#include <scoring_framework/parallel_for.h>
+#include <scoring_framework/roc_partial_result.h>
+#include <scoring_framework/roc_sweep.h>
+#include <scoring_framework/buffered_pr_writer.h>
 
 #include <boost/algorithm/string/classification.hpp>
 #include <boost/algorithm/string/split.hpp>
@@ -88,6 +101,7 @@ using std::ifstream;
 using std::istringstream;
 using std::map;
 using std::max;
+using std::min;
 using std::numeric_limits;
 using std::ofstream;
 using std::ostream;
@@ -96,9 +110,14 @@ using std::pair;
 using std::make_pair;
 using std::replace;
 using std::runtime_error;
+using std::sort;
 using std::string;
 using std::stringstream;
 using std::transform;
+using std::unique;
+using std::unique_copy;
+using std::unordered_map;
+using std::unordered_set;
 using std::vector;
 
 using kwiver::track_oracle::aries_interface;
@@ -528,6 +547,9 @@ struct output_args_type
   vul_arg< string > pr_dump_fn;
   vul_arg< string > thresholds_arg;
   vul_arg< bool > console_dump_arg;
+  vul_arg< bool > roc_quantile_thresholds_arg;
+  vul_arg< string > roc_partial_fn;
+  vul_arg< string > roc_partial_grid_arg;
 
 
   output_args_type()
@@ -539,7 +561,10 @@ struct output_args_type
       roc_csv_dump_fn( "--roc-csv-dump", "write the roc chart information to file (CSV format)" ),
       pr_dump_fn( "--pr-dump", "write the P/R curve information to file (if not set, dump to cout" ),
       thresholds_arg( "--thresholds", "Manually specified thresholds to score on (min[:max[:step]])" ),
-      console_dump_arg( "--console", "Write ROC lines to the console" )
+      console_dump_arg( "--console", "Write ROC lines to the console" ),
+      roc_quantile_thresholds_arg( "--roc-quantile-thresholds", "With --n-roc-points, pick the thresholds at evenly spaced quantiles of the relevancies instead of by minimum gap", false ),
+      roc_partial_fn( "--roc-partial-out", "write the ROC counts, binned over --roc-partial-grid, to this file for score_merge" ),
+      roc_partial_grid_arg( "--roc-partial-grid", "relevancy thresholds for --roc-partial-out as min:max:n (n+1 evenly spaced thresholds)", "0:1:100" )
   {}
 };
 
@@ -551,12 +576,44 @@ compute_roc( const track2track_phase1& p1,
              int max_n_roc_points,
              output_args_type& output_args );
 
+vector< double >
+track_relevancies( const track_handle_list_type& tracks );
+
+bool
+write_roc_partial( const track2track_phase1& p1,
+                   size_t n_truth_tracks,
+                   const track_handle_list_type& computed_tracks,
+                   const vector< double >& computed_relevancy,
+                   bool detection_mode,
+                   const vector< ts_type >& fa_norm_timestamps,
+                   output_args_type& output_args,
+                   const string& activity_tag );
+
+void
+compute_roc( const track2track_phase1& p1,
+             size_t n_truth_tracks,
+             const track_handle_list_type& computed_tracks,
+             const vector< double >& computed_relevancy,
+             double fa_norm,
+             int max_n_roc_points,
+             output_args_type& output_args,
+             const string& activity_tag );
+
 void
 compute_pr( const track2track_phase1& p1,
             track_handle_list_type truth_tracks,
             track_handle_list_type computed_tracks,
             output_args_type& output_args );
 
+void
+compute_pr( const track2track_phase1& p1,
+            size_t n_truth_tracks,
+            const track_handle_list_type& computed_tracks,
+            const vector< double >& computed_relevancy,
+            output_args_type& output_args,
+            const string& activity_tag,
+            ostream& default_os );
+
 //
 // There are two types of filtering we need to support.
 //
@@ -1235,6 +1292,38 @@ compute_normalization_factors(  const track_handle_list_type& truth_tracks,
 }
 #endif
 
+//
+// In detection mode, false alarms are normalized by the number of
+// distinct timestamps across the tracks.
+//
+
+vector< ts_type >
+detection_mode_timestamps( const track_handle_list_type& truth_tracks,
+                           const track_handle_list_type& computed_tracks )
+{
+  track_field<kwiver::track_oracle::dt::tracking::timestamp_usecs> ts;
+  std::set< kwiver::track_oracle::dt::tracking::timestamp_usecs::Type > ts_set;
+  track_handle_list_type all_tracks( truth_tracks );
+  all_tracks.insert( all_tracks.end(), computed_tracks.begin(), computed_tracks.end() );
+  for (size_t i=0; i<all_tracks.size(); ++i)
+  {
+    frame_handle_list_type f = track_oracle_core::get_frames( all_tracks[i] );
+    for (size_t j=0; j<f.size(); ++j)
+    {
+      ts_set.insert( ts( f[j].row ));
+    }
+  }
+  return vector< ts_type >( ts_set.begin(), ts_set.end() );
+}
+
+double
+detection_mode_normalization_factor( const vector< ts_type >& timestamps )
+{
+  double fa_norm = static_cast<double>( timestamps.size() );
+  LOG_INFO( main_logger, "FA normalization: detection mode; factor: " << fa_norm << " frames" );
+  return fa_norm;
+}
+
 track_handle_list_type
 process_top_n_tracks( track_handle_list_type computed_tracks,
                       unsigned top_n,
@@ -1322,7 +1411,7 @@ process_single_match_stat( ostream& os,
                            const track2track_phase1& activity_p1,
                            const track2track_phase1& a2t_p1 )
 {
-  typedef map< track2track_type, track2track_score >::const_iterator p1_probe_type;
+  typedef track2track_phase1::t2t_type::const_iterator p1_probe_type;
 
   const string axis_tag = (is_gt) ? "GA" : "CA";
   const string act_tag = (is_gt) ? "ca" : "ga";
@@ -1353,7 +1442,7 @@ process_single_match_stat( ostream& os,
   {
     const track2track_type& key = a2a_keys[i];
     p1_probe_type p = activity_p1.t2t.find( key );
-    if ( (p != activity_p1.t2t.end()) && ( ! p->second.frame_overlaps.empty() ))
+    if ( (p != activity_p1.t2t.end()) && ( p->second.n_frame_overlaps() > 0 ))
     {
       track_handle_type other = (is_gt) ? key.second : key.first;
       matching_activities.push_back( other );
@@ -1403,7 +1492,7 @@ process_single_match_stat( ostream& os,
   {
     const track2track_type& key = a2t_keys[i];
     p1_probe_type p = a2t_p1.t2t.find( key );
-    if ( (p != a2t_p1.t2t.end()) && ( ! p->second.frame_overlaps.empty() ))
+    if ( (p != a2t_p1.t2t.end()) && ( p->second.n_frame_overlaps() > 0 ))
     {
       track_handle_type other = (is_gt) ? key.second : key.first;
       // skip tracks associated with already output activities
@@ -1631,6 +1720,8 @@ struct score_events_args_type
   vul_arg< string > kwe_track_style_arg;
   vul_arg< string > activity_match_arg;
   vul_arg< string > track_dump_fn_arg;
+  vul_arg< unsigned > n_threads_arg;
+  vul_arg< string > p1_cache_fn_arg;
 
   vul_arg< string > kpf_target_arg;
   vul_arg< string > kpf_conf_src_arg;
@@ -1638,13 +1729,14 @@ struct score_events_args_type
   vul_arg< string > kpf_types_ct_arg;
   vul_arg< string > kpf_activity_gt_arg;
   vul_arg< string > kpf_activity_ct_arg;
-  kpf_context_t kpf_context;
+  kpf_context_t kpf_context;               // the first (or only) of kpf_contexts
+  vector< kpf_context_t > kpf_contexts;
 
 
   score_events_args_type():
     verbose_flag( "-v", "dump more debugging information", false ),
     disable_sanity_checks_arg( "--disable-sanity-checks", "Check for basic track overlaps before scoring", false ),
-    activity_names_arg( "--a", "comma-separated activities described by computed results (leave blank for list)" ),
+    activity_names_arg( "--a", "comma-separated activities described by computed results, each scored separately (leave blank for list)" ),
     top_n_arg( "--top-n", "The top n events to use from the computed file. (unsigned) ('0' refers to using all events)", 0),
     ct_in_rank_arg( "--ct-in-rank", "Flag notifying that the computed tracks were already sorted by rank when written, so they will be in rank order when read in", false ),
     t2t_dump_fn_arg( "--t2t-dump-file", "dump track-to-track details here" ),
@@ -1665,7 +1757,9 @@ struct score_events_args_type
     kwe_track_style_arg( "--kwe-track-style", "Set track style of events from KWE to this", "" ),
     activity_match_arg( "--activity-matches", "write activity match status here (increases run time) "),
     track_dump_fn_arg( "--write-tracks", "Write annotated input tracks to this file (either .kwcsv or .kwiver)" ),
-    kpf_target_arg( "--kpf-target", "[object|activity]:$type:$domain, e.g 'object:person:2' or 'activity:walking:3'" ),
+    n_threads_arg( "--threads", "Number of threads to use when matching tracks", 1 ),
+    p1_cache_fn_arg( "--p1-cache", "Reuse phase 1 results from this file if the tracks and matching parameters are unchanged; otherwise compute and write them" ),
+    kpf_target_arg( "--kpf-target", "[object|activity]:$type:$domain, e.g 'object:person:2' or 'activity:walking:3'; comma-separate several to score each" ),
     kpf_conf_src_arg( "--kpf-conf-src", "KPF packet type / domain containing the confidence we're scoring, e.g. cset2" ),
     kpf_types_gt_arg( "--kpf-types-gt", "KPF types file for ground-truth" ),
     kpf_types_ct_arg( "--kpf-types-ct", "KPF types file for computed" ),
@@ -1677,11 +1771,22 @@ struct score_events_args_type
 
   bool set_kpf_context();
 
+  bool parse_kpf_target( const string& target, kpf_context_t& c );
+
   bool sanity_check( input_args_type& input_args,
                      matching_args_type& matching_args );
 
+  bool multi_activity_sanity_check( output_args_type& output_args,
+                                    matching_args_type& matching_args );
+
   activity_selector_type deduce_activity();
 
+  vector< activity_selector_type > deduce_activities();
+
+  void select_activity_tracks( const activity_selector_type& what_act,
+                               track_handle_list_type& truth_tracks,
+                               track_handle_list_type& computed_tracks );
+
   void process_track_dumps( const track_handle_list_type& truth_tracks,
                             const track_handle_list_type& computed_tracks ) const;
 
@@ -1707,15 +1812,51 @@ score_events_args_type
   // only do anything if kpf target is set
   if (! this->kpf_target_arg.set()) return true;
 
+  // several targets may be given, comma-separated; they must all be of
+  // the same style and (for objects and activities) domain
+  vector< string > targets;
+  boost::split( targets, this->kpf_target_arg(), boost::is_any_of(","), boost::token_compress_on );
+  this->kpf_contexts.clear();
+  for (const auto& target: targets)
+  {
+    kpf_context_t c;
+    bool ok = this->parse_kpf_target( target, c );
+    if ( ok && ( ! this->kpf_contexts.empty() ))
+    {
+      const kpf_context_t& first = this->kpf_contexts.front();
+      if ( ( c.style != first.style ) ||
+           ( ( c.style != kpf_context_t::style_t::ADHOC ) && ( c.domain != first.domain )))
+      {
+        LOG_ERROR( main_logger, "KPF target '" << target << "' does not match the style and domain of '"
+                   << targets.front() << "'" );
+        ok = false;
+      }
+    }
+    if ( ! ok )
+    {
+      this->kpf_contexts.clear();
+      this->kpf_context = kpf_context_t();
+      return false;
+    }
+    this->kpf_contexts.push_back( c );
+  }
+
+  this->kpf_context = this->kpf_contexts.front();
+  return true;
+}
+
+bool
+score_events_args_type
+::parse_kpf_target( const string& target, kpf_context_t& c )
+{
   // expecting three colon-separated fields: string, string, integer
   kwiversys::RegularExpression re( "^([^:]+):([^:]+):([0-9]+)$" );
   // ...or two fields: fieldname, artifact
   kwiversys::RegularExpression re_adhoc( "^([^:]+):([^:]+)$" );
 
-  if ( re.find( this->kpf_target_arg() ))
+  if ( re.find( target ))
   {
 
-    kpf_context_t& c = this->kpf_context;
     // first field must be either 'object' or 'activity'
     if ( re.match(1) == "object" )
     {
@@ -1746,9 +1887,8 @@ score_events_args_type
       return false;
     }
   }
-  else if (re_adhoc.find( this->kpf_target_arg() ))
+  else if (re_adhoc.find( target ))
   {
-    kpf_context_t& c = this->kpf_context;
     c.style = kpf_context_t::style_t::ADHOC;
     c.adhoc_field = re_adhoc.match(1);
     c.artifact = re_adhoc.match(2);
@@ -1779,6 +1919,15 @@ score_events_args_type
     return false;
   }
 
+  // relinking groups the kwxml tracks by source file, which the track
+  // snapshot doesn't keep
+  if ( this->link_tracks_arg() && input_args.snapshot_in_fn.set() )
+  {
+    LOG_ERROR( main_logger, "Can't use " << this->link_tracks_arg.option() << " with "
+               << input_args.snapshot_in_fn.option() << "; the snapshot doesn't keep the source files" );
+    return false;
+  }
+
   // scoring KPF object detections requires detection mode
   if ( (this->kpf_context.style == kpf_context_t::style_t::OBJECT)
        && ( ! input_args.detection_mode() ))
@@ -1870,6 +2019,37 @@ score_events_args_type
 
 }
 
+bool
+score_events_args_type
+::multi_activity_sanity_check( output_args_type& output_args,
+                               matching_args_type& matching_args )
+{
+  //
+  // When scoring several activities, only the ROC / PR outputs are
+  // written (per activity); refuse the options which write per-track
+  // state or which only make sense for a single activity.
+  //
+
+  vector< string > refused;
+  if ( this->t2t_dump_fn_arg.set() ) refused.push_back( this->t2t_dump_fn_arg.option() );
+  if ( output_args.matches_dump_fn.set() ) refused.push_back( output_args.matches_dump_fn.option() );
+  if ( this->activity_match_arg.set() ) refused.push_back( this->activity_match_arg.option() );
+  if ( this->track_dump_fn_arg.set() ) refused.push_back( this->track_dump_fn_arg.option() );
+  if ( this->dump_filtered_gt_arg.set() ) refused.push_back( this->dump_filtered_gt_arg.option() );
+  if ( this->dump_filtered_ct_arg.set() ) refused.push_back( this->dump_filtered_ct_arg.option() );
+  if ( this->link_tracks_arg() ) refused.push_back( this->link_tracks_arg.option() );
+  if ( this->p1_cache_fn_arg.set() ) refused.push_back( this->p1_cache_fn_arg.option() );
+  if ( this->kwe_gt_arg.set() ) refused.push_back( this->kwe_gt_arg.option() );
+  if ( this->kwe_ct_arg.set() ) refused.push_back( this->kwe_ct_arg.option() );
+  if ( matching_args.radial_overlap() >= 0.0 ) refused.push_back( matching_args.radial_overlap.option() );
+
+  for (size_t i=0; i<refused.size(); ++i)
+  {
+    LOG_ERROR( main_logger, "'" << refused[i] << "' is not supported when scoring more than one activity" );
+  }
+  return refused.empty();
+}
+
 activity_selector_type
 score_events_args_type
 ::deduce_activity()
@@ -1989,6 +2169,50 @@ score_events_args_type
   return ret;
 }
 
+vector< activity_selector_type >
+score_events_args_type
+::deduce_activities()
+{
+  //
+  // deduce_activity() selects the first (or only) activity; the rest
+  // of a comma-separated '--a' or '--kpf-target' list differ from it
+  // only in the activity itself.
+  //
+
+  vector< activity_selector_type > ret( 1, this->deduce_activity() );
+  const activity_selector_type first = ret.front();
+
+  if ( ( first.style == activity_style::KPF_ACTIVITY ) ||
+       ( first.style == activity_style::KPF_OBJECT ) ||
+       ( first.style == activity_style::KPF_ADHOC ))
+  {
+    for (size_t i=1; i<this->kpf_contexts.size(); ++i)
+    {
+      activity_selector_type a( first );
+      a.activity_name = this->kpf_contexts[i].artifact;
+      a.activity_domain = this->kpf_contexts[i].domain;
+      a.kpf_adhoc_field = this->kpf_contexts[i].adhoc_field;
+      ret.push_back( a );
+    }
+  }
+  else if ( first.style == activity_style::VIRAT )
+  {
+    // deduce_activity() has already checked the names
+    vector<string> activity_names;
+    boost::split(activity_names, activity_names_arg(), boost::is_any_of(","), boost::token_compress_on);
+    ret.front().activity_name = activity_names.front();
+    for (size_t i=1; i<activity_names.size(); ++i)
+    {
+      activity_selector_type a( first );
+      a.activity_index = aries_interface::activity_to_index( activity_names[i] );
+      a.activity_name = activity_names[i];
+      ret.push_back( a );
+    }
+  }
+
+  return ret;
+}
+
 void
 score_events_args_type
 ::process_track_dumps( const track_handle_list_type& truth_tracks,
@@ -2025,6 +2249,63 @@ score_events_args_type
   }
 }
 
+void
+score_events_args_type
+::select_activity_tracks( const activity_selector_type& what_act,
+                          track_handle_list_type& truth_tracks,
+                          track_handle_list_type& computed_tracks )
+{
+  // First: throw out all ground-truth tracks not matching activity_name_arg()
+  // (since they'd be misses anyway.)
+
+  if ( this->gt_prefiltered_arg() )
+  {
+    LOG_INFO( main_logger, truth_tracks.size() << " truth tracks prefiltered for activity");
+  }
+  else
+  {
+    track_handle_list_type filtered_tracks = filter_on_track_style( truth_tracks, this->track_style_arg );
+    LOG_INFO( main_logger, "Truth track style filtering: " << truth_tracks.size() << " before; "
+              << filtered_tracks.size() << " after" );
+    truth_tracks = filtered_tracks;
+  }
+
+  // all truth tracks must be able to support normalization
+  track_handle_list_type norm_gt = normalize_activity_tracks( truth_tracks,
+                                                              /* input_is_gt = */ true,
+                                                              this->gt_prefiltered_arg(),
+                                                              this->convert_prob_to_relevancy_arg(),
+                                                              what_act );
+  LOG_INFO( main_logger, "Truth track activity normalization: " << truth_tracks.size() << " before; "
+            << norm_gt.size() << " after" );
+
+
+  // Second: filter the computed tracks
+  if ( this->ct_prefiltered_arg() )
+  {
+    LOG_INFO( main_logger, computed_tracks.size() << " computed tracks prefiltered for activity" );
+  }
+  else
+  {
+    track_handle_list_type filtered_tracks = filter_on_track_style( computed_tracks, this->track_style_arg );
+    LOG_INFO( main_logger, "Computed track style filtering: " << computed_tracks.size() << " before; "
+              << filtered_tracks.size() << " after" );
+    computed_tracks = filtered_tracks;
+  }
+
+  // all computed tracks must be able to support normalization
+  track_handle_list_type norm_comp = normalize_activity_tracks( computed_tracks,
+                                                                /* input_is_gt = */ false,
+                                                                this->ct_prefiltered_arg(),
+                                                                this->convert_prob_to_relevancy_arg(),
+                                                                what_act );
+  LOG_INFO( main_logger, "computed track activity normalization: " << computed_tracks.size() << " before; "
+            << norm_comp.size() << " after" );
+
+  truth_tracks = norm_gt;
+  computed_tracks = norm_comp;
+}
+
 bool
 score_events_args_type
 ::copy_kpf_activities( const track_handle_list_type& kpf_activities,
@@ -2272,6 +2553,311 @@ score_events_args_type
 }
 
 
+//
+// Several activities scored against one load of the tracks.
+//
+// Each activity is selected and normalized in turn; normalization
+// writes the shared relevancy field, so each activity's relevancies
+// are copied out (and its top-n / PR orderings taken) before the next
+// one.  Phase 1 is then computed once over the union of the
+// activities' tracks, with each track masked by the activities which
+// score it, so a pair shared by several activities is compared once
+// and a pair no activity scores isn't compared at all.  Each
+// activity's ROC and PR are then computed from its own slice of the
+// result, with the activities spread over --threads.
+//
+
+struct activity_run_type
+{
+  activity_selector_type what_act;
+  track_handle_list_type truth_tracks;
+  track_handle_list_type computed_tracks;          // the ROC / PR is over these...
+  track_handle_list_type scored_computed_tracks;   // ...and phase 1 over these (i.e. top-n)
+  vector< double > computed_relevancy;             // parallel to computed_tracks
+  track_handle_list_type pr_tracks;                // computed_tracks in rank order
+  vector< double > pr_relevancy;                   // parallel to pr_tracks
+  double fa_norm;
+  vector< ts_type > fa_norm_timestamps;            // detection mode: the timestamps behind fa_norm
+  string pr_output;                                // the PR rows, if not to --pr-dump
+  bool roc_partial_failed;
+
+  activity_run_type(): fa_norm( 1.0 ), roc_partial_failed( false ) {}
+};
+
+//
+// Copy the entries of src between the given truth and computed tracks
+// into dst.
+//
+
+void
+restrict_phase1( const track2track_phase1& src,
+                 const track_handle_list_type& truth_tracks,
+                 const track_handle_list_type& computed_tracks,
+                 track2track_phase1& dst )
+{
+  const size_t npos = track2track_phase1::t2t_type::npos;
+  vector< bool > keep_computed( src.t2t.n_computed(), false );
+  for (size_t i=0; i<computed_tracks.size(); ++i)
+  {
+    size_t j = src.t2t.computed_index( computed_tracks[i] );
+    if ( j != npos ) keep_computed[j] = true;
+  }
+
+  vector< track2track_phase1::t2t_type::value_type > entries;
+  for (size_t i=0; i<truth_tracks.size(); ++i)
+  {
+    size_t t = src.t2t.truth_index( truth_tracks[i] );
+    if ( t == npos ) continue;
+    for (track2track_phase1::t2t_type::const_iterator e = src.t2t.row_begin( t );
+         e != src.t2t.row_end( t );
+         ++e)
+    {
+      if ( keep_computed[ src.t2t.computed_index( e->first.second ) ] )
+      {
+        entries.push_back( *e );
+      }
+    }
+  }
+
+  dst.overlap_arena = src.overlap_arena;
+  dst.t2t.insert( entries );
+}
+
+bool
+score_activities( const vector< activity_selector_type >& activities,
+                  score_events_args_type& scoring_args,
+                  input_args_type& input_args,
+                  output_args_type& output_args,
+                  matching_args_type& matching_args,
+                  const track_handle_list_type& loaded_truth_tracks,
+                  const track_handle_list_type& loaded_computed_tracks )
+{
+  track_handle_list_type all_truth( loaded_truth_tracks ), all_computed( loaded_computed_tracks );
+
+  //
+  // KPF activity files are read once; each activity copies its actors
+  // out of them
+  //
+
+  track_handle_list_type kpf_gt_activities, kpf_ct_activities;
+  if ( scoring_args.kpf_activity_gt_arg.set() &&
+       ( ! track_filter_kpf_activity::read( scoring_args.kpf_activity_gt_arg(),
+                                            all_truth,
+                                            scoring_args.kpf_context.domain,
+                                            kpf_gt_activities )))
+  {
+    return false;
+  }
+  if ( scoring_args.kpf_activity_ct_arg.set() &&
+       ( ! track_filter_kpf_activity::read( scoring_args.kpf_activity_ct_arg(),
+                                            all_computed,
+                                            scoring_args.kpf_context.domain,
+                                            kpf_ct_activities )))
+  {
+    return false;
+  }
+
+  //
+  // KPF object types are loaded per domain, which all the targets share
+  //
+
+  if ( (scoring_args.kpf_context.style == score_events_args_type::kpf_context_t::style_t::OBJECT)
+       && scoring_args.kpf_types_gt_arg.set())
+  {
+    LOG_INFO( main_logger, "Setting ground-truth KPF objects from " << scoring_args.kpf_types_gt_arg() );
+    if (! scoring_args.set_kpf_object_types( scoring_args.kpf_types_gt_arg(), activities.front(), all_truth ))
+    {
+      return false;
+    }
+  }
+  if ( (scoring_args.kpf_context.style == score_events_args_type::kpf_context_t::style_t::OBJECT)
+       && scoring_args.kpf_types_ct_arg.set())
+  {
+    LOG_INFO( main_logger, "Setting computed objects from " << scoring_args.kpf_types_ct_arg() );
+    if (! scoring_args.set_kpf_object_types( scoring_args.kpf_types_ct_arg(), activities.front(), all_computed ))
+    {
+      return false;
+    }
+  }
+
+  //
+  // select and normalize each activity's tracks
+  //
+
+  const bool do_roc = ( scoring_args.task_arg().find( "roc" ) != string::npos );
+  const bool do_pr = ( scoring_args.task_arg().find( "pr" ) != string::npos );
+
+  vector< activity_run_type > runs( activities.size() );
+  for (size_t k=0; k<activities.size(); ++k)
+  {
+    activity_run_type& run = runs[k];
+    run.what_act = activities[k];
+    LOG_INFO( main_logger, "Activity " << k+1 << " of " << activities.size() << ": " << run.what_act );
+
+    track_handle_list_type truth_tracks( all_truth ), computed_tracks( all_computed );
+    if ( scoring_args.kpf_activity_gt_arg.set() &&
+         ( ! scoring_args.copy_kpf_activities( kpf_gt_activities, truth_tracks, run.what_act, /* truth = */ true )))
+    {
+      return false;
+    }
+    if ( scoring_args.kpf_activity_ct_arg.set() &&
+         ( ! scoring_args.copy_kpf_activities( kpf_ct_activities, computed_tracks, run.what_act, /* truth = */ false )))
+    {
+      return false;
+    }
+
+    scoring_args.select_activity_tracks( run.what_act, truth_tracks, computed_tracks );
+
+    if ( input_args.detection_mode() )
+    {
+      run.fa_norm_timestamps = detection_mode_timestamps( truth_tracks, computed_tracks );
+      run.fa_norm = detection_mode_normalization_factor( run.fa_norm_timestamps );
+    }
+
+    run.truth_tracks = truth_tracks;
+    run.computed_tracks = computed_tracks;
+    run.scored_computed_tracks =
+      scoring_args.top_n_arg.set()
+      ? process_top_n_tracks( computed_tracks, scoring_args.top_n_arg(), scoring_args.ct_in_rank_arg() )
+      : computed_tracks;
+    run.computed_relevancy = track_relevancies( computed_tracks );
+    if ( do_pr )
+    {
+      run.pr_tracks = computed_tracks;
+      sort( run.pr_tracks.begin(), run.pr_tracks.end(), compare_kst_track_handle );
+      run.pr_relevancy = track_relevancies( run.pr_tracks );
+    }
+  }
+
+  //
+  // phase 1 once, over the pairs which some activity scores
+  //
+
+  phase1_parameters p1_params;
+  p1_params.perform_sanity_checks = ( ! scoring_args.disable_sanity_checks_arg() );
+  if ( ! p1_params.processMatchingArgs( matching_args ))
+  {
+    return false;
+  }
+  p1_params.n_threads = scoring_args.n_threads_arg();
+
+  // the union of the tracks, each masked by the activities scoring it
+  typedef track2track_phase1::track_mask_type mask_type;
+  track_handle_list_type union_truth, union_computed;
+  vector< mask_type > truth_mask, computed_mask;
+  {
+    unordered_map< oracle_entry_handle_type, size_t > truth_slot, computed_slot;
+    auto add_tracks = [&]( const track_handle_list_type& tracks, size_t k,
+                           unordered_map< oracle_entry_handle_type, size_t >& slot,
+                           track_handle_list_type& u, vector< mask_type >& masks )
+    {
+      for (const auto& h: tracks )
+      {
+        auto probe = slot.insert( make_pair( h.row, u.size() ));
+        if ( probe.second )
+        {
+          u.push_back( h );
+          masks.push_back( mask_type( runs.size(), false ));
+        }
+        masks[ probe.first->second ][k] = true;
+      }
+    };
+    for (size_t k=0; k<runs.size(); ++k)
+    {
+      add_tracks( runs[k].truth_tracks, k, truth_slot, union_truth, truth_mask );
+      add_tracks( runs[k].scored_computed_tracks, k, computed_slot, union_computed, computed_mask );
+    }
+  }
+
+  // the AOI keeps or drops a track whichever activities score it
+  {
+    track_handle_list_type filtered_truth, filtered_computed;
+    p1_params.filter_track_list_on_aoi( union_truth, filtered_truth );
+    p1_params.filter_track_list_on_aoi( union_computed, filtered_computed );
+    LOG_INFO( main_logger, "p1: AOI kept "
+              << filtered_truth.size() << " of " << union_truth.size() << " truth tracks; "
+              << filtered_computed.size() << " of " << union_computed.size() << " computed tracks "
+              << "across " << runs.size() << " activities" );
+
+    unordered_set< oracle_entry_handle_type > in_aoi;
+    for (const auto& t: filtered_truth ) in_aoi.insert( t.row );
+    for (const auto& c: filtered_computed ) in_aoi.insert( c.row );
+    auto keep_in_aoi = [&]( track_handle_list_type& tracks, vector< mask_type >* masks )
+    {
+      track_handle_list_type kept;
+      vector< mask_type > kept_masks;
+      for (size_t i=0; i<tracks.size(); ++i)
+      {
+        if ( ! in_aoi.count( tracks[i].row )) continue;
+        kept.push_back( tracks[i] );
+        if ( masks ) kept_masks.push_back( (*masks)[i] );
+      }
+      tracks.swap( kept );
+      if ( masks ) masks->swap( kept_masks );
+    };
+    keep_in_aoi( union_truth, &truth_mask );
+    keep_in_aoi( union_computed, &computed_mask );
+    for (size_t k=0; k<runs.size(); ++k)
+    {
+      keep_in_aoi( runs[k].truth_tracks, 0 );
+      keep_in_aoi( runs[k].scored_computed_tracks, 0 );
+    }
+  }
+
+  track2track_phase1 all_p1( p1_params );
+  if (input_args.detection_mode())
+  {
+    all_p1.compute_all_detection_mode_masked( union_truth, union_computed, truth_mask, computed_mask );
+  }
+  else
+  {
+    all_p1.compute_all_masked( union_truth, union_computed, truth_mask, computed_mask );
+  }
+
+  //
+  // per-activity ROC / PR
+  //
+
+  parallel_for( scoring_args.n_threads_arg(), runs.size(), [&]( size_t k )
+  {
+    activity_run_type& run = runs[k];
+    track2track_phase1 p1( p1_params );
+    restrict_phase1( all_p1, run.truth_tracks, run.scored_computed_tracks, p1 );
+
+    if ( do_roc )
+    {
+      compute_roc( p1, run.truth_tracks.size(), run.computed_tracks, run.computed_relevancy,
+                   run.fa_norm, scoring_args.max_n_roc_points_arg(), output_args,
+                   run.what_act.activity_name );
+      if ( output_args.roc_partial_fn.set() )
+      {
+        run.roc_partial_failed =
+          ! write_roc_partial( p1, run.truth_tracks.size(), run.computed_tracks, run.computed_relevancy,
+                               input_args.detection_mode(), run.fa_norm_timestamps, output_args,
+                               run.what_act.activity_name );
+      }
+    }
+    if ( do_pr )
+    {
+      ostringstream oss;
+      compute_pr( p1, run.truth_tracks.size(), run.pr_tracks, run.pr_relevancy,
+                  output_args, run.what_act.activity_name, oss );
+      run.pr_output = oss.str();
+    }
+  });
+
+  // PR rows not sent to --pr-dump go to cout, in activity order
+  bool roc_partials_ok = true;
+  for (size_t k=0; k<runs.size(); ++k)
+  {
+    cout << runs[k].pr_output;
+    if ( runs[k].roc_partial_failed ) roc_partials_ok = false;
+  }
+  if ( ! roc_partials_ok ) return false;
+
+  return true;
+}
+
 int main( int argc, char *argv[] )
 {
 
@@ -2292,8 +2878,12 @@ int main( int argc, char *argv[] )
     return EXIT_SUCCESS;
   }
 
-  activity_selector_type what_act = scoring_args.deduce_activity();
-  LOG_INFO( main_logger, "Activity deduction: " << what_act );
+  vector< activity_selector_type > activities = scoring_args.deduce_activities();
+  activity_selector_type what_act = activities.front();
+  for (size_t i=0; i<activities.size(); ++i)
+  {
+    LOG_INFO( main_logger, "Activity deduction: " << activities[i] );
+  }
 
   if ( ! scoring_args.sanity_check( input_args, matching_args ) )
   {
@@ -2309,6 +2899,11 @@ int main( int argc, char *argv[] )
   {
     return EXIT_SUCCESS;
   }
+  if ( ( activities.size() > 1 ) &&
+       ( ! scoring_args.multi_activity_sanity_check( output_args, matching_args )))
+  {
+    return EXIT_FAILURE;
+  }
 
   // This is a good point to emit the command line for logging
   LOG_INFO( main_logger, "Command line:\n" << arg_oss.str() );
@@ -2332,6 +2927,15 @@ int main( int argc, char *argv[] )
   track_handle_list_type computed_tracks, truth_tracks;
   if ( ! input_args.process( computed_tracks, truth_tracks )) return EXIT_FAILURE;
 
+  if ( activities.size() > 1 )
+  {
+    return
+      score_activities( activities, scoring_args, input_args, output_args, matching_args,
+                        truth_tracks, computed_tracks )
+      ? EXIT_SUCCESS
+      : EXIT_FAILURE;
+  }
+
   // remember the unfiltered tracks in case we need them for a full stats run
   track_handle_list_type unfiltered_truth_tracks = truth_tracks;
   track_handle_list_type unfiltered_computed_tracks = computed_tracks;
@@ -2375,55 +2979,7 @@ int main( int argc, char *argv[] )
     LOG_INFO( main_logger, "Computed objects complete" );
   }
 
-  // First: throw out all ground-truth tracks not matching activity_name_arg()
-  // (since they'd be misses anyway.)
-
-  if ( scoring_args.gt_prefiltered_arg() )
-  {
-    LOG_INFO( main_logger, truth_tracks.size() << " truth tracks prefiltered for activity");
-  }
-  else
-  {
-    track_handle_list_type filtered_tracks = filter_on_track_style( truth_tracks, scoring_args.track_style_arg );
-    LOG_INFO( main_logger, "Truth track style filtering: " << truth_tracks.size() << " before; "
-              << filtered_tracks.size() << " after" );
-    truth_tracks = filtered_tracks;
-  }
-
-  // all truth tracks must be able to support normalization
-  track_handle_list_type norm_gt = normalize_activity_tracks( truth_tracks,
-                                                              /* input_is_gt = */ true,
-                                                              scoring_args.gt_prefiltered_arg(),
-                                                              scoring_args.convert_prob_to_relevancy_arg(),
-                                                              what_act );
-  LOG_INFO( main_logger, "Truth track activity normalization: " << truth_tracks.size() << " before; "
-            << norm_gt.size() << " after" );
-
-
-  // Second: filter the computed tracks
-  if ( scoring_args.ct_prefiltered_arg() )
-  {
-    LOG_INFO( main_logger, computed_tracks.size() << " computed tracks prefiltered for activity" );
-  }
-  else
-  {
-    track_handle_list_type filtered_tracks = filter_on_track_style( computed_tracks, scoring_args.track_style_arg );
-    LOG_INFO( main_logger, "Computed track style filtering: " << computed_tracks.size() << " before; "
-              << filtered_tracks.size() << " after" );
-    computed_tracks = filtered_tracks;
-  }
-
-  // all computed tracks must be able to support normalization
-  track_handle_list_type norm_comp = normalize_activity_tracks( computed_tracks,
-                                                                /* input_is_gt = */ false,
-                                                                scoring_args.ct_prefiltered_arg(),
-                                                                scoring_args.convert_prob_to_relevancy_arg(),
-                                                                what_act );
-  LOG_INFO( main_logger, "computed track activity normalization: " << computed_tracks.size() << " before; "
-            << norm_comp.size() << " after" );
-
-  truth_tracks = norm_gt;
-  computed_tracks = norm_comp;
+  scoring_args.select_activity_tracks( what_act, truth_tracks, computed_tracks );
 
   scoring_args.process_track_dumps( truth_tracks, computed_tracks );
 
@@ -2432,8 +2988,15 @@ int main( int argc, char *argv[] )
   //
 
   double fa_norm = 1.0;
+  vector< ts_type > fa_norm_timestamps;
   if ( matching_args.radial_overlap() >= 0.0 )
   {
+    if ( output_args.roc_partial_fn.set() )
+    {
+      LOG_ERROR( main_logger, "Can't use " << output_args.roc_partial_fn.option() << " with "
+                 << matching_args.radial_overlap.option() << "; its FA normalization can't be merged" );
+      return EXIT_FAILURE;
+    }
 #ifdef KWANT_ENABLE_MGRS
     fa_norm = compute_normalization_factors( truth_tracks, computed_tracks );
 #else
@@ -2443,20 +3006,8 @@ int main( int argc, char *argv[] )
   }
   else if (input_args.detection_mode() )
   {
-    track_field<kwiver::track_oracle::dt::tracking::timestamp_usecs> ts;
-    std::set< kwiver::track_oracle::dt::tracking::timestamp_usecs::Type > ts_set;
-    track_handle_list_type all_tracks( truth_tracks );
-    all_tracks.insert( all_tracks.end(), computed_tracks.begin(), computed_tracks.end() );
-    for (size_t i=0; i<all_tracks.size(); ++i)
-    {
-      frame_handle_list_type f = track_oracle_core::get_frames( all_tracks[i] );
-      for (size_t j=0; j<f.size(); ++j)
-      {
-        ts_set.insert( ts( f[j].row ));
-      }
-    }
-    fa_norm = static_cast<double>( ts_set.size() );
-    LOG_INFO( main_logger, "FA normalization: detection mode; factor: " << fa_norm << " frames" );
+    fa_norm_timestamps = detection_mode_timestamps( truth_tracks, computed_tracks );
+    fa_norm = detection_mode_normalization_factor( fa_norm_timestamps );
   }
   else
   {
@@ -2470,6 +3021,7 @@ int main( int argc, char *argv[] )
   {
     return EXIT_FAILURE;
   }
+  p1_params.n_threads = scoring_args.n_threads_arg();
 
   if ( scoring_args.link_tracks_arg() )
   {
@@ -2511,7 +3063,11 @@ int main( int argc, char *argv[] )
     scored_computed_tracks = filtered_computed;
   }
 
-  if (input_args.detection_mode())
+  if ( scoring_args.p1_cache_fn_arg.set() )
+  {
+    phase1_cache( scoring_args.p1_cache_fn_arg() ).compute_all( p1, truth_tracks, scored_computed_tracks, input_args.detection_mode() );
+  }
+  else if (input_args.detection_mode())
   {
     p1.compute_all_detection_mode( truth_tracks, scored_computed_tracks );
   }
@@ -2533,7 +3089,12 @@ int main( int argc, char *argv[] )
     if (output_args.matches_dump_fn.set())
     {
       track2track_phase2_hadwav p2( /* verbose flag = */ false );
+      p2.n_threads = scoring_args.n_threads_arg();
       p2.compute( truth_tracks, scored_computed_tracks, p1 );
+      if ( scoring_args.track_dump_fn_arg.set() )
+      {
+        p2.materialize_state_flags();
+      }
       ofstream os (output_args.matches_dump_fn().c_str() );
       if ( os )
       {
@@ -2548,6 +3109,12 @@ int main( int argc, char *argv[] )
     // compute the actual ROC, on only the activity tracks
 
     compute_roc( p1, truth_tracks, computed_tracks, fa_norm, scoring_args.max_n_roc_points_arg(), output_args );
+    if ( output_args.roc_partial_fn.set() &&
+         ( ! write_roc_partial( p1, truth_tracks.size(), computed_tracks, track_relevancies( computed_tracks ),
+                                input_args.detection_mode(), fa_norm_timestamps, output_args, "" )))
+    {
+      return EXIT_FAILURE;
+    }
 
 
     // if requested, process full match stats
@@ -2575,6 +3142,7 @@ int main( int argc, char *argv[] )
     track_handle_list_type all_tracks;
     all_tracks.insert( all_tracks.end(), truth_tracks.begin(), truth_tracks.end() );
     all_tracks.insert( all_tracks.end(), computed_tracks.begin(), computed_tracks.end() );
+    track2track_phase1::materialize_state_flags( all_tracks );
     bool rc = file_format_manager::write( scoring_args.track_dump_fn_arg(), all_tracks, kwiver::track_oracle::TF_INVALID_TYPE );
     LOG_INFO( main_logger, "Write returned " << rc );
   }
@@ -2587,34 +3155,37 @@ int main( int argc, char *argv[] )
 }
 
 
-map< double, bool >
-generate_roc_thresholds( const track_handle_list_type& computed_tracks,
+vector< double >
+generate_roc_thresholds( const vector< double >& relevancy,
                          int max_n_roc_points,
                          output_args_type& output_args )
 {
-  track_field< double > relevancy( "relevancy" );
-  map< double, bool > roc_threshold;
+  vector< double > roc_threshold;
 
   if ( !output_args.thresholds_arg.set() )
   {
     double max_r = -1.0;
     double min_r = 1.0e6;
-    for (unsigned i=0; i<computed_tracks.size(); ++i)
+    vector< double > all_r;
+    all_r.reserve( relevancy.size() );
+    for (unsigned i=0; i<relevancy.size(); ++i)
     {
-      double r = relevancy( computed_tracks[i].row );
-      roc_threshold[ r ] = true;
+      double r = relevancy[i];
+      if ( r != r ) continue;  // NaN can't be a threshold
+      all_r.push_back( r );
       if ( r > max_r ) max_r = r;
       if ( r < min_r ) min_r = r;
     }
+    sort( all_r.begin(), all_r.end() );
+    unique_copy( all_r.begin(), all_r.end(), back_inserter( roc_threshold ));
 
-    LOG_INFO( main_logger, computed_tracks.size() << " computed events have "
+    LOG_INFO( main_logger, relevancy.size() << " computed events have "
               << roc_threshold.size() << " unique thresholds");
 
     // Not that this has ever happened to me...
     if (roc_threshold.size() == 1)
     {
-      map<double, bool>::const_iterator probe = roc_threshold.begin();
-      if (probe->first == 0.0) {
+      if (roc_threshold.front() == 0.0) {
         LOG_WARN( main_logger,"*");
         LOG_WARN( main_logger,"* The set of computed events all have probability 0.");
         LOG_WARN( main_logger,"* This can happen when the kwxml_ts specifies a descriptor" );
@@ -2631,37 +3202,43 @@ generate_roc_thresholds( const track_handle_list_type& computed_tracks,
     else if (roc_threshold.size()  > static_cast<size_t>( max_n_roc_points ))
     {
       LOG_INFO( main_logger, "min / max relevancy " << min_r << " / " << max_r );
-      const double r_range = max_r - min_r;
-      const double max_threshold_gap = r_range / max_n_roc_points;
-      map< double, bool > reduced_roc_threshold;
-      for (map<double, bool>::const_iterator i = roc_threshold.begin(); i != roc_threshold.end(); ++i)
+      vector< double > reduced_roc_threshold;
+      if ( output_args.roc_quantile_thresholds_arg() )
       {
-        bool keep_this = false;
-        if (reduced_roc_threshold.empty() )
+        // the relevancy below which fall q/N of the events, for q in
+        // [0, N); ties may make some of them coincide
+        const size_t n = all_r.size();
+        const size_t n_points = static_cast< size_t >( max_n_roc_points );
+        for (size_t q=0; q<n_points; ++q)
         {
-          keep_this = true;
-        }
-        else
-        {
-          double last_val = reduced_roc_threshold.rbegin()->first;
-          if ( (i->first - last_val) > max_threshold_gap )
+          double r = all_r[ q * n / n_points ];
+          if ( reduced_roc_threshold.empty() || ( r != reduced_roc_threshold.back() ))
           {
-            keep_this = true;
+            reduced_roc_threshold.push_back( r );
           }
         }
-        if (keep_this)
+      }
+      else
+      {
+        const double r_range = max_r - min_r;
+        const double max_threshold_gap = r_range / max_n_roc_points;
+        for (size_t i=0; i<roc_threshold.size(); ++i)
         {
-          reduced_roc_threshold[ i->first ] = true;
+          if ( reduced_roc_threshold.empty() ||
+               ( (roc_threshold[i] - reduced_roc_threshold.back()) > max_threshold_gap ))
+          {
+            reduced_roc_threshold.push_back( roc_threshold[i] );
+          }
         }
       }
 
-      roc_threshold = reduced_roc_threshold;
+      roc_threshold.swap( reduced_roc_threshold );
 
       LOG_INFO( main_logger, "Info: ...reduced to " << roc_threshold.size() << " unique thresholds");
     }
 
     // add an epsilon at the end
-    roc_threshold[ max_r + 0.001 ] = true;
+    roc_threshold.push_back( max_r + 0.001 );
   }
   else
   {
@@ -2682,12 +3259,74 @@ generate_roc_thresholds( const track_handle_list_type& computed_tracks,
 
     for ( double thresh = min; thresh <= max; thresh += step )
     {
-      roc_threshold[ thresh ] = true;
+      roc_threshold.push_back( thresh );
     }
   }
 
+  // ascending and unique, as the ROC is reported
+  sort( roc_threshold.begin(), roc_threshold.end() );
+  roc_threshold.erase( unique( roc_threshold.begin(), roc_threshold.end() ), roc_threshold.end() );
   return roc_threshold;
 }
+
+//
+// The relevancy of each of the tracks, as normalize_activity_tracks
+// left it.
+//
+
+vector< double >
+track_relevancies( const track_handle_list_type& tracks )
+{
+  track_field< double > relevancy( "relevancy" );
+  vector< double > ret;
+  ret.reserve( tracks.size() );
+  for (size_t i=0; i<tracks.size(); ++i)
+  {
+    ret.push_back( relevancy( tracks[i].row ));
+  }
+  return ret;
+}
+
+//
+// Record which truth tracks each computed track matches, as dense
+// truth ordinals (so that the ROC sweep can mark them in a bitset);
+// returns the number of truth tracks matched.
+//
+
+size_t
+computed_truth_matches( const track2track_phase1& p1,
+                        const track_handle_list_type& computed_tracks,
+                        vector< vector< size_t > >& computed_matches )
+{
+  unordered_map< oracle_entry_handle_type, size_t > truth_ordinals;
+  computed_matches.assign( computed_tracks.size(), vector< size_t >() );
+  for (size_t i=0; i<computed_tracks.size(); ++i)
+  {
+    size_t col = p1.t2t.computed_index( computed_tracks[i] );
+    if ( col == track2track_phase1::t2t_type::npos ) continue;
+    for (size_t k=0; k<p1.t2t.column_size( col ); ++k)
+    {
+      const track_handle_type& t = p1.t2t.column_entry( col, k ).first.first;
+      size_t ord = truth_ordinals.insert( make_pair( t.row, truth_ordinals.size() )).first->second;
+      computed_matches[i].push_back( ord );
+    }
+  }
+  return truth_ordinals.size();
+}
+
+//
+// Returns fn with the activity tag inserted before its extension
+// ("roc.csv" -> "roc.walking.csv"), or fn itself if the tag is empty.
+//
+
+string
+activity_output_fn( const string& fn, const string& activity_tag )
+{
+  if ( activity_tag.empty() ) return fn;
+  string ext = vul_file::extension( fn );
+  return vul_file::strip_extension( fn ) + "." + activity_tag + ext;
+}
+
 void
 compute_roc( const track2track_phase1& p1,
              const track_handle_list_type& truth_tracks,
@@ -2695,6 +3334,26 @@ compute_roc( const track2track_phase1& p1,
              double fa_norm,
              int max_n_roc_points,
              output_args_type& output_args )
+{
+  compute_roc( p1, truth_tracks.size(), computed_tracks, track_relevancies( computed_tracks ),
+               fa_norm, max_n_roc_points, output_args, "" );
+}
+
+//
+// The ROC proper, given the relevancy of each computed track.  If
+// activity_tag is set, it's added to the output filenames and log
+// messages, so that several activities may be scored at once.
+//
+
+void
+compute_roc( const track2track_phase1& p1,
+             size_t n_truth_tracks,
+             const track_handle_list_type& computed_tracks,
+             const vector< double >& computed_relevancy,
+             double fa_norm,
+             int max_n_roc_points,
+             output_args_type& output_args,
+             const string& activity_tag )
 {
   //
   // Here's our first plan for scoring viqui:
@@ -2705,121 +3364,45 @@ compute_roc( const track2track_phase1& p1,
   //
 
 
-  // build the map of ROC thresholds
-  map< double, bool > roc_threshold =
-    generate_roc_thresholds( computed_tracks,
+  // build the list of ROC thresholds
+  vector< double > thresholds =
+    generate_roc_thresholds( computed_relevancy,
                              max_n_roc_points,
                              output_args );
 
-  // iterate over thresholds, printing out ROC stats
-  // Record which truth tracks each computed track matches
-  map< track_handle_type, track_handle_list_type > computed_to_truth_match_list;
-  for (size_t i=0; i<computed_tracks.size(); ++i)
-  {
-    track_handle_list_type matches;
-    computed_to_truth_match_list[ computed_tracks[i] ] = matches;
-  }
+  vector< vector< size_t > > computed_matches;
+  size_t n_matched_truth = computed_truth_matches( p1, computed_tracks, computed_matches );
 
-  map< track2track_type, track2track_score >::const_iterator c2t_probe;
-  for (c2t_probe = p1.t2t.begin(); c2t_probe != p1.t2t.end(); ++c2t_probe )
-  {
-    const track_handle_type& t = c2t_probe->first.first;
-    const track_handle_type& c = c2t_probe->first.second;
-    map< track_handle_type, track_handle_list_type >::iterator match_probe = computed_to_truth_match_list.find( c );
-    if (match_probe == computed_to_truth_match_list.end() )
-    {
-      LOG_DEBUG( main_logger, "ROC fallthrough" );
-    }
-    else
-    {
-      match_probe->second.push_back( t );
-    }
-  }
+  vector< roc_point_type > roc_points =
+    sweep_roc( thresholds, computed_relevancy, computed_matches, n_matched_truth );
+
+  const string log_tag = activity_tag.empty() ? "" : "[" + activity_tag + "] ";
 
   ostringstream roc_dump_str;
   ostringstream roc_csv_dump_str;
   roc_csv_dump_str << "threshold, PD, FA, nMatches, TP, FP, TN, FN, matched, relevant, nTrueTracks, faNorm\n";
 
-  track_field< double > relevancy( "relevancy" );
-  vector< map<track_handle_type, track_handle_list_type>::const_iterator > matches_cache;
-  vector< double > relevancy_cache;
-  for (size_t i=0; i<computed_tracks.size(); ++i)
-  {
-    map< track_handle_type, track_handle_list_type >::const_iterator probe
-      = computed_to_truth_match_list.find( computed_tracks[i] );
-    if ( probe == computed_to_truth_match_list.end() )
-    {
-      throw runtime_error( "Lost computed track handle in computed_to_truth_match_list map?" );
-    }
-    matches_cache.push_back( probe );
-    relevancy_cache.push_back( relevancy( computed_tracks[i].row ));
-  }
-
-  for ( map<double, bool>::const_iterator roc_it = roc_threshold.begin();
-        roc_it != roc_threshold.end();
-        ++roc_it )
+  for (size_t k=0; k<roc_points.size(); ++k)
   {
-    double threshold = roc_it->first;
-
-    map< oracle_entry_handle_type, bool> true_matches;
-
-    unsigned tp=0, fp=0, fn=0, tn=0;
-    for (unsigned i=0; i < computed_tracks.size(); ++i)
-    {
-
-      // Computed track[i] has two attributes:
-      // - R (relevance): true if its relevancy >= threshold
-      // - M (match): true if it matches a true track
-      //
-      // R  &  M  : true positive (but unique against truth tracks)
-      // R  & !M  : false positive
-      // !R &  M  : false negative
-      // !R & !M  : true negative
-      //
-      // True positives are recorded by setting flags in the true_matches map,
-      // to factor out the possibility of multiple computed tracks matching a single
-      // truth track.
-
-      // establish R: does this track have a relevancy over the threshold?
-      bool r_flag = ( relevancy_cache[i] >= threshold );
-
-      // establish M: did we match a true track?
-      map< track_handle_type, track_handle_list_type >::const_iterator probe
-        = matches_cache[ i ];
-
-      const track_handle_list_type& matches = probe->second;
-      bool m_flag = ( ! matches.empty());
-      if (r_flag)
-      {
-        for (size_t j=0; j<matches.size(); ++j)
-        {
-          true_matches[ matches[j].row ] = true;
-        }
-      }
-
-      // increment counters
-      if      ( r_flag && m_flag )      ++tp;
-      else if ( r_flag && (!m_flag))    ++fp;
-      else if ( (!r_flag) && m_flag)    ++fn;
-      else if ( (!r_flag) && (!m_flag)) ++tn;
-    } // ...for all computed tracks
+    double threshold = thresholds[k];
+    unsigned nMatches = roc_points[k].nMatches;
+    unsigned tp = roc_points[k].tp, fp = roc_points[k].fp, tn = roc_points[k].tn, fn = roc_points[k].fn;
 
     // output
-    unsigned nMatches = true_matches.size();
     double pd =
-      truth_tracks.empty()
+      ( n_truth_tracks == 0 )
       ? 0.0
-      : 1.0 * nMatches / truth_tracks.size();
+      : 1.0 * nMatches / n_truth_tracks;
 
     roc_dump_str << vul_sprintf("roc threshold = %e ; pd = %e ; fa = %-5u ; nMatches = %-5u ; tp = %-5u ; fp = %-5u ; tn = %-5u ; fn = %-5u ; matched = %-5u ; relevant = %-5u ; nTrueTracks = %-5u ; fa-norm = %e\n",
-                                threshold, pd, fp, nMatches, tp, fp, tn, fn, (tp+fn), (tp+fp), truth_tracks.size(), fp/fa_norm );
+                                threshold, pd, fp, nMatches, tp, fp, tn, fn, (tp+fn), (tp+fp), n_truth_tracks, fp/fa_norm );
     roc_csv_dump_str << threshold << ", " << pd << ", " << fp << ", " << nMatches << ", " << tp << ", " << fp << ", "
-                     << tn << ", " << fn << ", " << (tp+fn) << ",  " << (tp+fp) << ", " << truth_tracks.size() << ", "
+                     << tn << ", " << fn << ", " << (tp+fn) << ",  " << (tp+fp) << ", " << n_truth_tracks << ", "
                      << (fp / fa_norm) << "\n";
 
-    if (roc_it == roc_threshold.begin())
+    if (k == 0)
     {
-      LOG_INFO( main_logger, "ROC: first line: " << roc_dump_str.str() );
+      LOG_INFO( main_logger, log_tag << "ROC: first line: " << roc_dump_str.str() );
     }
   } // ... for each roc threshold
 
@@ -2829,13 +3412,14 @@ compute_roc( const track2track_phase1& p1,
   }
   else
   {
-    LOG_INFO( main_logger, "ROC:\n" << roc_dump_str.str() );
+    LOG_INFO( main_logger, log_tag << "ROC:\n" << roc_dump_str.str() );
   }
   if (output_args.roc_dump_fn.set())
   {
-    LOG_INFO( main_logger, "[score_events] Dumping roc data to '" << output_args.roc_dump_fn().c_str() << "'" );
+    string fn = activity_output_fn( output_args.roc_dump_fn(), activity_tag );
+    LOG_INFO( main_logger, "[score_events] Dumping roc data to '" << fn << "'" );
 
-    fstream dump_stream(output_args.roc_dump_fn().c_str(),
+    fstream dump_stream(fn.c_str(),
                             fstream::out);
     dump_stream << roc_dump_str.str();
     dump_stream.flush();
@@ -2843,20 +3427,78 @@ compute_roc( const track2track_phase1& p1,
   }
   if (output_args.roc_csv_dump_fn.set())
   {
-    ofstream ofs( output_args.roc_csv_dump_fn().c_str() );
+    string fn = activity_output_fn( output_args.roc_csv_dump_fn(), activity_tag );
+    ofstream ofs( fn.c_str() );
     if ( ! ofs )
     {
-      LOG_ERROR( main_logger, "Couldn't write to '" << output_args.roc_csv_dump_fn() << "'" );
+      LOG_ERROR( main_logger, "Couldn't write to '" << fn << "'" );
     }
     else
     {
-      LOG_INFO( main_logger, "[score_events] Writing ROC CSV to '" << output_args.roc_csv_dump_fn() << "'" );
+      LOG_INFO( main_logger, "[score_events] Writing ROC CSV to '" << fn << "'" );
       ofs << roc_csv_dump_str.str();
     }
   }
 }
 
 
+//
+// Write the counts behind the ROC, binned over --roc-partial-grid, for
+// score_merge (see roc_partial_result.h.)  A truth track is hit at a
+// threshold if any of its matching computed tracks is relevant there,
+// i.e. from the bin of its most relevant match up.
+//
+
+bool
+write_roc_partial( const track2track_phase1& p1,
+                   size_t n_truth_tracks,
+                   const track_handle_list_type& computed_tracks,
+                   const vector< double >& computed_relevancy,
+                   bool detection_mode,
+                   const vector< ts_type >& fa_norm_timestamps,
+                   output_args_type& output_args,
+                   const string& activity_tag )
+{
+  double min_r, max_r;
+  unsigned n_bins;
+  if ( ! roc_partial_result::parse_grid( output_args.roc_partial_grid_arg(), min_r, max_r, n_bins ))
+  {
+    return false;
+  }
+
+  vector< vector< size_t > > computed_matches;
+  size_t n_matched_truth = computed_truth_matches( p1, computed_tracks, computed_matches );
+
+  roc_partial_result r( min_r, max_r, n_bins, detection_mode );
+  r.n_truth_tracks = n_truth_tracks;
+  if ( detection_mode )
+  {
+    r.fa_norm_timestamps = fa_norm_timestamps;
+  }
+
+  const double no_match = -std::numeric_limits< double >::infinity();
+  vector< double > best_relevancy( n_matched_truth, no_match );
+  for (size_t i=0; i<computed_tracks.size(); ++i)
+  {
+    double rel = computed_relevancy[i];
+    r.add_computed( rel, ! computed_matches[i].empty() );
+    if ( rel != rel ) continue;
+    for (size_t k=0; k<computed_matches[i].size(); ++k)
+    {
+      double& best = best_relevancy[ computed_matches[i][k] ];
+      best = max( best, rel );
+    }
+  }
+  for (size_t t=0; t<best_relevancy.size(); ++t)
+  {
+    if ( best_relevancy[t] != no_match ) r.add_truth_hit( best_relevancy[t] );
+  }
+
+  string fn = activity_output_fn( output_args.roc_partial_fn(), activity_tag );
+  LOG_INFO( main_logger, "[score_events] Writing ROC partial result to '" << fn << "'" );
+  return r.write( fn );
+}
+
 void
 compute_pr( const track2track_phase1& p1,
             track_handle_list_type truth_tracks,
@@ -2866,6 +3508,25 @@ compute_pr( const track2track_phase1& p1,
   // always sort computed tracks
   sort( computed_tracks.begin(), computed_tracks.end(), compare_kst_track_handle);
 
+  compute_pr( p1, truth_tracks.size(), computed_tracks, track_relevancies( computed_tracks ),
+              output_args, "", cout );
+}
+
+//
+// The PR curve proper, over computed tracks already in rank order and
+// their relevancies.  The rows go to the --pr-dump file (with the
+// activity tag, if any, added to its name) or else to default_os.
+//
+
+void
+compute_pr( const track2track_phase1& p1,
+            size_t n_truth_tracks,
+            const track_handle_list_type& computed_tracks,
+            const vector< double >& computed_relevancy,
+            output_args_type& output_args,
+            const string& activity_tag,
+            ostream& default_os )
+{
   // recall is computed against truth tracks; precision against computed tracks.
   //
   // A set of computed tracks (however big) will partition the set of truth tracks
@@ -2881,88 +3542,98 @@ compute_pr( const track2track_phase1& p1,
   // At each step in the PR curve, either tp or fp goes up by 1.
   // However, each step in the PR curve is not guaranteed to increment either td or fd.
 
-  track_kst_type kst_schema;
   unsigned tp=0, fp=0;
   double last_r = numeric_limits<double>::max();
 
-  // compute true detections: as we loop over the computed tracks,
-  // entries in this map will flip from false to true; at each
-  // computed track, td = # of entries set to true.
-
-  map< track_handle_type, bool > truth_track_hit_map;
-
-  // increment td count only when we flip an entry from false to true
-  // (we never flip them back from true to false)
+  // compute true detections: at each computed track, td = # of
+  // truth tracks hit so far.
   unsigned td=0;
-  unsigned nTrue = truth_tracks.size();
+  unsigned nTrue = n_truth_tracks;
+  const string log_tag = activity_tag.empty() ? "" : "[" + activity_tag + "] ";
 
-  ostream* pr_os = &cout;
+  ostream* pr_os = &default_os;
   if ( output_args.pr_dump_fn.set() )
   {
-    pr_os = new ofstream( output_args.pr_dump_fn().c_str() );
+    string fn = activity_output_fn( output_args.pr_dump_fn(), activity_tag );
+    pr_os = new ofstream( fn.c_str() );
     if ( ! (*pr_os))
     {
-      LOG_ERROR( main_logger, "WARNING: Couldn't open '" << output_args.pr_dump_fn() << "' for writing; defaulting back to cout");
+      LOG_ERROR( main_logger, "WARNING: Couldn't open '" << fn << "' for writing; defaulting back to cout");
       delete pr_os;
-      pr_os = &cout;
+      pr_os = &default_os;
     }
   }
 
-  typedef vector< track2track_type > matches_t;
-  map< oracle_entry_handle_type, matches_t* > matches_map;
+  // computed -> truth index, in CSR form over p1's dense numbering:
+  // the truth tracks matching p1's computed track j are
+  // match_truth[ match_begin[j] .. match_begin[j+1] )
+  vector< size_t > match_begin( p1.t2t.n_computed() + 1, 0 );
+  vector< size_t > match_truth( p1.t2t.size() );
   vul_timer timer;
 
-  LOG_INFO( main_logger, "PR: matches map setup...") ;
-  for (map< track2track_type, track2track_score >::const_iterator i = p1.t2t.begin();
-       i != p1.t2t.end();
-       ++i)
+  LOG_INFO( main_logger, log_tag << "PR: matches index setup...") ;
+  vector< size_t > entry_col( p1.t2t.size() );
+  for (size_t t = 0, e = 0; t < p1.t2t.n_truth(); ++t)
   {
-    if (timer.real() > 5 * 1000)
+    for (track2track_phase1::t2t_type::const_iterator i = p1.t2t.row_begin( t );
+         i != p1.t2t.row_end( t );
+         ++i, ++e)
     {
-      LOG_INFO( main_logger, "PR: matches map " << matches_map.size() << " of " << computed_tracks.size() );
-      timer.mark();
+      entry_col[e] = p1.t2t.computed_index( i->first.second );
+      ++match_begin[ entry_col[e] + 1 ];
     }
-    oracle_entry_handle_type key = i->first.second.row;
-    if (matches_map.find( key ) == matches_map.end() )
+  }
+  for (size_t j = 0; j < p1.t2t.n_computed(); ++j)
+  {
+    match_begin[j+1] += match_begin[j];
+  }
+  {
+    vector< size_t > fill( match_begin.begin(), match_begin.end() - 1 );
+    for (size_t t = 0, e = 0; t < p1.t2t.n_truth(); ++t)
     {
-      matches_map[ key ] = new matches_t;
+      for (track2track_phase1::t2t_type::const_iterator i = p1.t2t.row_begin( t );
+           i != p1.t2t.row_end( t );
+           ++i, ++e)
+      {
+        match_truth[ fill[ entry_col[e] ]++ ] = t;
+      }
     }
-    matches_map[key]->push_back( i->first );
   }
-  LOG_INFO( main_logger, "PR: Matches map complete; contains " << matches_map.size() << " entries");
+  LOG_INFO( main_logger, log_tag << "PR: Matches index complete; " << p1.t2t.n_computed() << " computed tracks, "
+            << p1.t2t.size() << " matches");
   timer.mark();
 
+  // true detections: as we loop over the computed tracks, bits flip
+  // from false to true; increment td count only when we flip one
+  // (we never flip them back from true to false)
+  vector< bool > truth_track_hit( p1.t2t.n_truth(), false );
 
-  matches_t empty_matches;
+  buffered_pr_writer pr_writer( *pr_os );
   for (unsigned i=0; i<computed_tracks.size(); ++i)
   {
     if (timer.real() > 5 * 1000)
     {
-      LOG_INFO( main_logger, "pr curve: " << i << " of " << computed_tracks.size() << "..." );
+      LOG_INFO( main_logger, log_tag << "pr curve: " << i << " of " << computed_tracks.size() << "..." );
       timer.mark();
     }
 
     track_handle_type c = computed_tracks[i];
-    double r = kst_schema( c ).relevancy();
-
-    map< oracle_entry_handle_type, matches_t* >::const_iterator probe = matches_map.find( c.row );
-    const matches_t& matches =
-      probe == matches_map.end()
-      ? empty_matches
-      : *probe->second;
+    double r = computed_relevancy[i];
 
+    size_t col = p1.t2t.computed_index( c );
     bool matched_truth_track = false;
-    for (unsigned j=0; j < matches.size(); ++j)
+    if ( col != track2track_phase1::t2t_type::npos )
     {
-      track_handle_type t = matches[j].first;
-
-      matched_truth_track = true;
-      if ( ! truth_track_hit_map[ t ] )
+      for (size_t j = match_begin[ col ]; j < match_begin[ col+1 ]; ++j)
       {
-        truth_track_hit_map[ t ] = true;
-        ++td;
-      }
-    } // ...for all truth tracks
+        matched_truth_track = true;
+        if ( ! truth_track_hit[ match_truth[j] ] )
+        {
+          truth_track_hit[ match_truth[j] ] = true;
+          ++td;
+        }
+      } // ...for all truth tracks
+    }
 
     if ( matched_truth_track ) ++tp; else ++fp;
     double prec =
@@ -2973,26 +3644,20 @@ compute_pr( const track2track_phase1& p1,
       nTrue == 0
       ? 0
       : 1.0 * td / nTrue;
-    (*pr_os) << "PR-curve: " << i << " relevancy= " << r << " tp= " << tp << " fp= " << fp << " prec= " << prec << " td= " << td << " nTrue= " << nTrue << "  recall= " << recall << "\n";
+    pr_writer.write_row( i, r, tp, fp, prec, td, nTrue, recall );
 
     if (r > last_r)
     {
-      LOG_INFO( main_logger, "Inverted relevancy!  last was " << last_r << " ; this was " << r << "");
+      LOG_INFO( main_logger, log_tag << "Inverted relevancy!  last was " << last_r << " ; this was " << r << "");
     }
     last_r = r;
 
   }
-
-  for (map< oracle_entry_handle_type, matches_t* >::const_iterator probe = matches_map.begin();
-       probe != matches_map.end();
-       ++probe)
-  {
-    delete probe->second;
-  }
+  pr_writer.flush();
 
   LOG_INFO( main_logger, "Sample plot command:\nplot \"running-pr.dat\" using 16:10 w lp, \"\" using 16:10 every 10::10 with points ls 3 ps 3  t \"every 10th\"");
 
-  if (output_args.pr_dump_fn.set())    // i.e. not set to cout
+  if ( pr_os != &default_os )
   {
     delete pr_os;
   }
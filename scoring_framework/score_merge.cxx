@@ -0,0 +1,216 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+//
+// Combine the partial HADWAV results written by several score_tracks
+// runs (via --partial-out) over disjoint data -- e.g. one run per clip,
+// camera, or time window -- into the metrics of a single run over all
+// of it.  See hadwav_partial_result.h.  Likewise, combine the partial
+// ROCs written by score_events --roc-partial-out; see
+// roc_partial_result.h.
+//
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+
+#include <vul/vul_arg.h>
+
+#include <scoring_framework/hadwav_partial_result.h>
+#include <scoring_framework/roc_partial_result.h>
+
+#include <vital/logger/logger.h>
+static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __FILE__ ) );
+
+using std::cout;
+using std::getline;
+using std::ifstream;
+using std::make_pair;
+using std::ofstream;
+using std::pair;
+using std::string;
+using std::vector;
+
+using namespace kwiver::kwant;
+
+namespace // anon
+{
+
+// "a,b,c" is three files; "@fn" reads the files from fn, one per line,
+// skipping blank lines and '#' comments.
+
+bool
+partial_filenames( const string& arg, vector< string >& fns )
+{
+  if ( ( ! arg.empty() ) && ( arg[0] == '@' ))
+  {
+    string fn = arg.substr( 1 );
+    ifstream is( fn.c_str() );
+    if ( ! is )
+    {
+      LOG_ERROR( main_logger, "Couldn't open filename list '" << fn << "'" );
+      return false;
+    }
+    string line;
+    while ( getline( is, line ))
+    {
+      if ( line.empty() || ( line[0] == '#' )) continue;
+      fns.push_back( line );
+    }
+  }
+  else
+  {
+    size_t start = 0;
+    while ( start <= arg.size() )
+    {
+      size_t end = arg.find( ',', start );
+      if ( end == string::npos ) end = arg.size();
+      if ( end > start ) fns.push_back( arg.substr( start, end - start ));
+      start = end + 1;
+    }
+  }
+  return true;
+}
+
+bool
+merge_hadwav_partials( const string& arg, const pair< bool, double >& norm )
+{
+  vector< string > fns;
+  if ( ! partial_filenames( arg, fns ))
+  {
+    return false;
+  }
+  if ( fns.empty() )
+  {
+    LOG_ERROR( main_logger, "No partial results in '" << arg << "'" );
+    return false;
+  }
+
+  //
+  // Merge in the order given; the tracks of each file follow those of the
+  // files before it.
+  //
+
+  hadwav_partial_result merged;
+  for (size_t i=0; i<fns.size(); ++i)
+  {
+    hadwav_partial_result r;
+    if ( ! r.read( fns[i] ))
+    {
+      return false;
+    }
+    if ( i == 0 )
+    {
+      merged = r;
+    }
+    else if ( ! merged.merge( r ))
+    {
+      LOG_ERROR( main_logger, "'" << fns[i] << "' and '" << fns[0] << "' disagree on --one-to-one" );
+      return false;
+    }
+    LOG_INFO( main_logger, "Read '" << fns[i] << "': " << r.n_true_tracks << " truth and "
+              << r.n_computed_tracks << " computed tracks" );
+  }
+
+  track2track_phase2_hadwav p2;
+  overall_phase3_hadwav p3;
+  merged.compute_metrics( p2, p3 );
+
+  write_hadwav_results( cout, p2, p3, norm, merged.n_computed_tracks );
+  return true;
+}
+
+//
+// The ROC partials must all use the same relevancy grid; their truth
+// and computed tracks are disjoint, so the order doesn't matter.
+//
+
+bool
+merge_roc_partials( const string& arg, const string& csv_fn )
+{
+  vector< string > fns;
+  if ( ! partial_filenames( arg, fns ))
+  {
+    return false;
+  }
+  if ( fns.empty() )
+  {
+    LOG_ERROR( main_logger, "No ROC partial results in '" << arg << "'" );
+    return false;
+  }
+
+  roc_partial_result merged;
+  for (size_t i=0; i<fns.size(); ++i)
+  {
+    roc_partial_result r;
+    if ( ! r.read( fns[i] ))
+    {
+      return false;
+    }
+    if ( i == 0 )
+    {
+      merged = r;
+    }
+    else if ( ! merged.merge( r ))
+    {
+      LOG_ERROR( main_logger, "'" << fns[i] << "' and '" << fns[0] << "' have different relevancy grids "
+                 << "or detection modes" );
+      return false;
+    }
+    LOG_INFO( main_logger, "Read '" << fns[i] << "': " << r.n_truth_tracks << " truth and "
+              << r.n_matched + r.n_unmatched << " computed tracks" );
+  }
+
+  if ( csv_fn.empty() )
+  {
+    merged.write_roc_csv( cout );
+    return true;
+  }
+  ofstream os( csv_fn.c_str() );
+  if ( ! os )
+  {
+    LOG_ERROR( main_logger, "Couldn't write to '" << csv_fn << "'" );
+    return false;
+  }
+  merged.write_roc_csv( os );
+  return true;
+}
+
+} // ...anon
+
+int main( int argc, char *argv[] )
+{
+  vul_arg< string > partials_arg( "--partials", "Comma-separated list of score_tracks --partial-out files, or @filelist" );
+  vul_arg< double > norm_arg( "--nfar-norm", "Normalization factor for the frame and track NFAR (as computed by score_tracks); unset to skip NFAR" );
+  vul_arg< string > roc_partials_arg( "--roc-partials", "Comma-separated list of score_events --roc-partial-out files, or @filelist" );
+  vul_arg< string > roc_csv_arg( "--roc-csv", "Write the merged ROC CSV here (default: stdout)" );
+  vul_arg_parse( argc, argv );
+
+  if ( ( ! partials_arg.set() ) && ( ! roc_partials_arg.set() ))
+  {
+    LOG_ERROR( main_logger, "Must set " << partials_arg.option() << " and / or " << roc_partials_arg.option() );
+    return EXIT_FAILURE;
+  }
+
+  pair< bool, double > norm = make_pair( norm_arg.set(), norm_arg.set() ? norm_arg() : 1.0 );
+  if ( norm.first && ( norm.second <= 0.0 ))
+  {
+    LOG_ERROR( main_logger, norm_arg.option() << " must be > 0" );
+    return EXIT_FAILURE;
+  }
+
+  if ( partials_arg.set() && ( ! merge_hadwav_partials( partials_arg(), norm )))
+  {
+    return EXIT_FAILURE;
+  }
+  if ( roc_partials_arg.set() &&
+       ( ! merge_roc_partials( roc_partials_arg(), roc_csv_arg.set() ? roc_csv_arg() : string() )))
+  {
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -12,8 +12,10 @@
 #include <fstream>
 #include <stdexcept>
 #include <typeinfo>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
 
-#include <vgl/vgl_area.h>
 #include <vgl/vgl_box_2d.h>
 #include <vgl/vgl_intersection.h>
 
@@ -28,15 +30,20 @@
 #include <track_oracle/aries_interface/aries_interface.h>
 
 #include <scoring_framework/quickfilter_box.h>
+#include <scoring_framework/parallel_for.h>
+#include <scoring_framework/box_overlap_batch.h>
 
 #include <vital/logger/logger.h>
 static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __FILE__ ) );
 
+using std::atomic;
 using std::endl;
+using std::lock_guard;
 using std::make_pair;
 using std::map;
 using std::max;
 using std::min;
+using std::mutex;
 using std::numeric_limits;
 using std::ofstream;
 using std::ostream;
@@ -44,8 +51,9 @@ using std::ostringstream;
 using std::pair;
 using std::runtime_error;
 using std::sort;
-using std::sqrt;
 using std::string;
+using std::unique;
+using std::unordered_map;
 using std::vector;
 
 using kwiver::track_oracle::field_handle_type;
@@ -147,6 +155,229 @@ sanity_check_track_list_timestamps( const track_handle_list_type& a,
   return true;
 }
 
+// Throw if sanity checks are on and t and c don't overlap in time.
+
+void
+check_track_list_alignment( const track_handle_list_type& t,
+                            const track_handle_list_type& c,
+                            const phase1_parameters& params )
+{
+  if ( ! params.perform_sanity_checks ) return;
+
+  // c may be empty if the tracker missed everything; in that case, don't throw an error
+  // t may also be empty if we're e.g. scoring events (say, PersonWalking), and the truth
+  // set has no Walking events, but the computed set does
+  if ( (! t.empty() ) && (! c.empty() ) && (! sanity_check_track_list_timestamps( t, c )))
+  {
+    LOG_ERROR( main_logger, "*\n*\n*\n"
+               << "* The set of aligned frames between ground-truth and computed tracks is empty.\n"
+               << "* There are three possibilities:\n"
+               << "* 1) your ground-truth and and computed data are truly misaligned\n"
+               << "* 2) the frame alignment parameter is set incorrectly,\n"
+               << "* 3) there is an error in the timestamp_usecs filed of one or both data sets.\n"
+               << "* To disable this test, use the --disable-sanity-checks flag.\n"
+               << "* About to exit signaling failure\n"
+               << "*\n*\n*" );
+    throw runtime_error( "Misaligned datasets" );
+  }
+}
+
+// Line up two lists of timestamps, each sorted, with a tolerance of
+// match_window; return the (f1, f2) index pairs of the aligned frames.
+
+vector< pair< size_t, size_t > >
+align_timestamps( const ts_type* f1, size_t n1,
+                  const ts_type* f2, size_t n2,
+                  double match_window )
+{
+  vector< pair< size_t, size_t > > ret;
+  if ( (n1 == 0) || (n2 == 0) ) return ret;
+
+  // quick tests for endpoints
+  // ...last frame of f1 before first frame of f2?
+  if ( f1[n1-1]+match_window < f2[0] ) return ret;
+  // ...last frame of f2 before first frame of f1?
+  if ( f2[n2-1]+match_window < f1[0] ) return ret;
+
+  // "A" and "B" each map to f1 and f2; which maps to which
+  // can change at the start of each round.  The constraint
+  // is that the timestamp of A is always less than B at
+  // the start of each round.
+  //
+  // values are always stored in ret in (f1, f2) order, helped
+  // by the a_is_f1 state variable below.
+  //
+  // At the start of each round:
+  // -- if A or B has run off the end, return.
+  // -- if ts(B) < ts(A), swap how A and B are mapped to f1 / f2.
+  // Thus, start off each round such that ts(A) < ts(B).
+  //
+  // If ts(B) - ts(A) is outside the match window:
+  // --- A has no match; increment A.
+  // If ts(B) - ts(A) is within match window:
+  // --- A and B match; increment both.
+
+  bool a_is_f1;  // true if (A==f1, B==f2); false if (A==f2, A==f1)
+  size_t f1_index = 0, f2_index = 0;
+  while (true)
+  {
+    // Did we run out of frames?
+    if ((f1_index == n1) || (f2_index == n2)) return ret;
+
+    // decide which is A and which is B
+    a_is_f1 = (f1[f1_index] < f2[f2_index]);
+    const ts_type* fA = (a_is_f1) ? f1 : f2;
+    const ts_type* fB = (a_is_f1) ? f2 : f1;
+    size_t& fA_index = (a_is_f1) ? f1_index : f2_index;
+    size_t& fB_index = (a_is_f1) ? f2_index : f1_index;
+
+    // compute timestamp diff
+    ts_type diff = fB[fB_index] - fA[fA_index];
+#ifdef P1_DEBUG
+    LOG_DEBUG( main_logger, "a-is-f1: " << a_is_f1 << " ; diff " << diff << " vs match_window " << match_window );
+#endif
+    if (diff < match_window)
+    {
+      // the frames are aligned!  Record the result and increment
+      ret.push_back( make_pair( f1_index, f2_index ));
+      ++fA_index;
+      ++fB_index;
+    }
+    else
+    {
+      // A has no match, increment past it
+      ++fA_index;
+    }
+  }
+
+  // shouldn't get here
+  LOG_ERROR( main_logger, "Logic error in " << __FILE__ << "::" << __LINE__ << "");
+  // hush some compilers
+  return ret;
+}
+
+// Append frame f to the snapshot's frame columns, reading its fields
+// via view.  Uses get() rather than operator() so that missing fields
+// aren't created as a side effect.
+
+void
+snapshot_frame( track2track_frame_snapshot& s,
+                frame_handle_type f,
+                scorable_track_type& view )
+{
+  s.frames.push_back( f );
+  pair< bool, ts_type > ts_probe = view.timestamp_usecs.get( f.row );
+  s.timestamps.push_back( ts_probe.first ? ts_probe.second : 0 );
+  pair< bool, unsigned > fn_probe = view.timestamp_frame.get( f.row );
+  s.frame_numbers.push_back( fn_probe.first ? fn_probe.second : 0 );
+  pair< bool, vgl_box_2d<double> > box_probe = view.bounding_box.get( f.row );
+  s.has_box.push_back( box_probe.first ? 1 : 0 );
+  s.boxes.push_back( box_probe.second );
+}
+
+// Reorder v[ begin, begin+order.size() ) so that its k'th element is
+// the old v[ begin+order[k] ].
+
+template< typename T >
+void
+permute_column( vector< T >& v, size_t begin, const vector< size_t >& order )
+{
+  vector< T > tmp( order.size() );
+  for (size_t k=0; k<order.size(); ++k) tmp[k] = v[ begin+order[k] ];
+  std::copy( tmp.begin(), tmp.end(), v.begin()+begin );
+}
+
+//
+// The frame-handle interfaces read a frame's fields into one of these,
+// on the caller's stack, and view it as a one-frame track, rather than
+// building a snapshot.
+//
+
+struct single_frame_data
+{
+  ts_type timestamp;
+  unsigned frame_number;
+  unsigned char has_box;
+  vgl_box_2d<double> box;
+  frame_handle_type frame;
+};
+
+track2track_frame_view
+single_frame_view( frame_handle_type f, single_frame_data& d )
+{
+  static scorable_track_type local_track_view;
+  pair< bool, ts_type > ts_probe = local_track_view.timestamp_usecs.get( f.row );
+  d.timestamp = ts_probe.first ? ts_probe.second : 0;
+  pair< bool, unsigned > fn_probe = local_track_view.timestamp_frame.get( f.row );
+  d.frame_number = fn_probe.first ? fn_probe.second : 0;
+  pair< bool, vgl_box_2d<double> > box_probe = local_track_view.bounding_box.get( f.row );
+  d.has_box = box_probe.first ? 1 : 0;
+  d.box = box_probe.second;
+  d.frame = f;
+
+  track2track_frame_view ret;
+  ret.n_frames = 1;
+  ret.timestamps = &d.timestamp;
+  ret.frame_numbers = &d.frame_number;
+  ret.has_box = &d.has_box;
+  ret.boxes = &d.box;
+  ret.frames = &d.frame;
+  return ret;
+}
+
+//
+// The per-box part of comparing frame f1_index of t with frame
+// f2_index of c: set the frame numbers and the AOI flag in ret, and
+// return the (possibly expanded) boxes to intersect.  Returns false if
+// either frame has no box.
+//
+
+bool
+prepare_frame_pair( const track2track_frame_view& t,
+                    size_t f1_index,
+                    const track2track_frame_view& c,
+                    size_t f2_index,
+                    const phase1_parameters& params,
+                    track2track_frame_overlap_record& ret,
+                    vgl_box_2d<double>& b1,
+                    vgl_box_2d<double>& b2 )
+{
+  typedef vgl_box_2d<double> bbox_type;
+  ret.fL_frame_num = t.frame_numbers[ f1_index ];
+  ret.fR_frame_num = c.frame_numbers[ f2_index ];
+
+  if ( ( ! t.has_box[ f1_index ] ) || ( ! c.has_box[ f2_index ] ))
+  {
+#ifdef P1_DEBUG
+    LOG_INFO( main_logger, "cso: no box for " << t.frames[ f1_index ] << " , " << c.frames[ f2_index ] );
+#endif
+    return false;
+  }
+
+  b1 = t.boxes[ f1_index ];
+  b2 = c.boxes[ f2_index ];
+
+  if( params.expand_bbox )
+  {
+    b1.expand_about_centroid( params.bbox_expansion );
+    b2.expand_about_centroid( params.bbox_expansion );
+  }
+
+  if( params.b_aoi.is_empty() )
+  {
+    ret.in_aoi = true;
+  }
+  else
+  {
+    // Only set to true if BOTH bounding boxes intersect the AOI.
+
+    bbox_type t1i = vgl_intersection( b1, params.b_aoi );
+    bbox_type t2i = vgl_intersection( b2, params.b_aoi );
+    ret.in_aoi = ( ! t1i.is_empty()) && ( ! t2i.is_empty());
+  }
+  return true;
+}
+
 bool
 test_if_overlap_passes_filters( const track2track_frame_overlap_record& overlap,
                                 const phase1_parameters& params )
@@ -161,7 +392,6 @@ test_if_overlap_passes_filters( const track2track_frame_overlap_record& overlap,
   // min-bound-matching-area parameter.
   //
 
-  static scorable_track_type local_track_view;
   bool spatial_overlap_exists = false;
 
   bool use_min_pcent_gt = (params.min_pcent_overlap_gt_ct.first >= 0.0);
@@ -183,6 +413,8 @@ test_if_overlap_passes_filters( const track2track_frame_overlap_record& overlap,
 
     if (params.debug_min_pcent_overlap_gt_ct)
     {
+      // only reached on the serial path; see compute_all
+      scorable_track_type local_track_view;
       static bool first_time = true;
       if (first_time)
       {
@@ -227,6 +459,329 @@ test_if_overlap_passes_filters( const track2track_frame_overlap_record& overlap,
   return spatial_overlap_exists;
 }
 
+//
+// Return, for each truth track t[i], the (sorted) indices of the computed
+// tracks whose timestamps come within match_window of t[i]'s.  Any pair
+// not listed would be rejected by the endpoint tests in align_timestamps,
+// so this is exact.
+//
+// Each track is an interval [first ts, last ts + match_window]; two tracks
+// can align iff their intervals overlap.  Sweep the intervals in order of
+// start time, pairing each one with the active intervals of the other set
+// that haven't ended yet.  If masks are given, a pair is only listed if
+// its two tracks' masks share a set bit.
+//
+
+struct track_interval_type
+{
+  double start, end;
+  size_t index;
+  bool is_truth;
+  track_interval_type( double s, double e, size_t i, bool t )
+    : start(s), end(e), index(i), is_truth(t)
+  {}
+  bool operator<( const track_interval_type& rhs ) const
+  {
+    return (this->start != rhs.start) ? (this->start < rhs.start) : (this->is_truth && ! rhs.is_truth);
+  }
+};
+
+typedef track2track_phase1::track_mask_type track_mask_type;
+
+bool
+masks_intersect( const track_mask_type& a, const track_mask_type& b )
+{
+  for (size_t k=0; (k<a.size()) && (k<b.size()); ++k)
+  {
+    if ( a[k] && b[k] ) return true;
+  }
+  return false;
+}
+
+void
+temporal_candidates( const track2track_frame_snapshot& t,
+                     const track2track_frame_snapshot& c,
+                     double match_window,
+                     const vector< size_t >& t_indices,
+                     const vector< size_t >& c_indices,
+                     const vector< track_mask_type >* t_mask,
+                     const vector< track_mask_type >* c_mask,
+                     vector< vector< size_t > >& ret )
+{
+  vector< track_interval_type > intervals;
+  intervals.reserve( t_indices.size() + c_indices.size() );
+  for (size_t k=0; k<t_indices.size(); ++k)
+  {
+    size_t i = t_indices[k];
+    if ( t.n_frames( i ) == 0 ) continue;
+    intervals.push_back( track_interval_type( t.timestamps[ t.track_begin[i] ],
+                                              t.timestamps[ t.track_begin[i+1]-1 ]+match_window,
+                                              i, true ));
+  }
+  for (size_t k=0; k<c_indices.size(); ++k)
+  {
+    size_t i = c_indices[k];
+    if ( c.n_frames( i ) == 0 ) continue;
+    intervals.push_back( track_interval_type( c.timestamps[ c.track_begin[i] ],
+                                              c.timestamps[ c.track_begin[i+1]-1 ]+match_window,
+                                              i, false ));
+  }
+  sort( intervals.begin(), intervals.end() );
+
+  vector< const track_interval_type* > active_t, active_c;
+  for (size_t i=0; i<intervals.size(); ++i)
+  {
+    const track_interval_type& x = intervals[i];
+    vector< const track_interval_type* >& others = (x.is_truth) ? active_c : active_t;
+
+    // drop the other set's intervals which ended before x started;
+    // pair x with the survivors
+    size_t n_kept = 0;
+    for (size_t j=0; j<others.size(); ++j)
+    {
+      if ( others[j]->end < x.start ) continue;
+      others[ n_kept++ ] = others[j];
+      size_t ti = ( x.is_truth ) ? x.index : others[j]->index;
+      size_t ci = ( x.is_truth ) ? others[j]->index : x.index;
+      if ( t_mask && ( ! masks_intersect( (*t_mask)[ti], (*c_mask)[ci] ))) continue;
+      ret[ ti ].push_back( ci );
+    }
+    others.resize( n_kept );
+
+    ((x.is_truth) ? active_t : active_c).push_back( &x );
+  }
+
+  for (size_t k=0; k<t_indices.size(); ++k)
+  {
+    vector< size_t >& r = ret[ t_indices[k] ];
+    sort( r.begin(), r.end() );
+  }
+}
+
+vector< vector< size_t > >
+temporal_candidates( const track2track_frame_snapshot& t,
+                     const track2track_frame_snapshot& c,
+                     double match_window )
+{
+  vector< size_t > t_indices( t.size() ), c_indices( c.size() );
+  for (size_t i=0; i<t_indices.size(); ++i) t_indices[i] = i;
+  for (size_t i=0; i<c_indices.size(); ++i) c_indices[i] = i;
+
+  vector< vector< size_t > > ret( t.size() );
+  temporal_candidates( t, c, match_window, t_indices, c_indices, 0, 0, ret );
+  return ret;
+}
+
+//
+// As above, but only pairing tracks in the same partition (and, if
+// given, with intersecting masks): the sweep runs separately (and in
+// parallel) over each partition's tracks.  Each partition fills in
+// only its own truth tracks' rows of the result.
+//
+
+vector< vector< size_t > >
+partitioned_temporal_candidates( const track2track_frame_snapshot& t,
+                                 const track2track_frame_snapshot& c,
+                                 double match_window,
+                                 const vector< unsigned >& t_partition,
+                                 const vector< unsigned >& c_partition,
+                                 const vector< track_mask_type >* t_mask,
+                                 const vector< track_mask_type >* c_mask,
+                                 unsigned n_threads )
+{
+  map< unsigned, size_t > partition_index;
+  vector< vector< size_t > > t_indices, c_indices;
+  for (size_t i=0; i<t_partition.size(); ++i)
+  {
+    map< unsigned, size_t >::const_iterator probe = partition_index.find( t_partition[i] );
+    if ( probe == partition_index.end() )
+    {
+      probe = partition_index.insert( make_pair( t_partition[i], t_indices.size() )).first;
+      t_indices.push_back( vector< size_t >() );
+      c_indices.push_back( vector< size_t >() );
+    }
+    t_indices[ probe->second ].push_back( i );
+  }
+  for (size_t i=0; i<c_partition.size(); ++i)
+  {
+    // computed tracks in a partition without truth tracks can't match anything
+    map< unsigned, size_t >::const_iterator probe = partition_index.find( c_partition[i] );
+    if ( probe == partition_index.end() ) continue;
+    c_indices[ probe->second ].push_back( i );
+  }
+
+  vector< vector< size_t > > ret( t.size() );
+  parallel_for( n_threads, t_indices.size(), [&]( size_t p )
+  {
+    temporal_candidates( t, c, match_window, t_indices[p], c_indices[p], t_mask, c_mask, ret );
+  });
+  return ret;
+}
+
+// Radial overlaps, and the min-pcent-gt-ct debugging output, still
+// read from track_oracle while comparing frames; keep those serial.
+
+unsigned
+phase1_thread_count( const phase1_parameters& params )
+{
+  bool use_radial_overlap = (params.radial_overlap >= 0.0);
+  if ( (params.n_threads > 1) && ( use_radial_overlap || params.debug_min_pcent_overlap_gt_ct ))
+  {
+    LOG_INFO( main_logger, "phase 1: radial overlap / overlap debugging requested; running on one thread" );
+    return 1;
+  }
+  return params.n_threads;
+}
+
+// True if a and b agree on everything collect_nonzero_overlaps() depends on.
+
+bool
+same_overlap_geometry( const phase1_parameters& a, const phase1_parameters& b )
+{
+  return
+    ( a.expand_bbox == b.expand_bbox ) &&
+    ( a.bbox_expansion == b.bbox_expansion ) &&
+    ( a.frame_alignment_time_window_usecs == b.frame_alignment_time_window_usecs ) &&
+    ( a.aoiInclusive == b.aoiInclusive ) &&
+    ( a.b_aoi == b.b_aoi ) &&
+    ( a.radial_overlap == b.radial_overlap );
+}
+
+// Return the box of a single-frame track as used for spatial overlap,
+// or false if it has no box (or expands to nothing.)
+
+bool
+detection_box( const track2track_frame_snapshot& s,
+               size_t i,
+               const phase1_parameters& params,
+               vgl_box_2d<double>& box )
+{
+  if ( ( s.n_frames( i ) == 0 ) || ( ! s.has_box[ s.track_begin[i] ] )) return false;
+  box = s.boxes[ s.track_begin[i] ];
+  if ( params.expand_bbox )
+  {
+    box.expand_about_centroid( params.bbox_expansion );
+  }
+  return ! box.is_empty();
+}
+
+//
+// Return the (truth, computed) index pairs from t_frame x c_frame whose
+// boxes might overlap, in the same (truth, computed) order as the full
+// cross product.  The computed boxes are dropped into a uniform grid
+// whose cells are about the size of a computed box; each truth box is
+// paired with the computed boxes sharing a cell with it.  Two boxes
+// with a non-zero overlap always share a cell.
+//
+
+vector< pair< size_t, size_t > >
+detection_grid_candidates( const vector< size_t >& t_frame,
+                           const vector< size_t >& c_frame,
+                           const track2track_frame_snapshot& t_snap,
+                           const track2track_frame_snapshot& c_snap,
+                           const phase1_parameters& params )
+{
+  vector< pair< size_t, size_t > > ret;
+  if ( t_frame.empty() || c_frame.empty() ) return ret;
+
+  vector< vgl_box_2d<double> > c_boxes( c_frame.size() );
+  vector< bool > c_has_box( c_frame.size() );
+  double sum_size = 0.0;
+  size_t n_boxes = 0;
+  for (size_t k=0; k<c_frame.size(); ++k)
+  {
+    c_has_box[k] = detection_box( c_snap, c_frame[k], params, c_boxes[k] );
+    if ( ! c_has_box[k] ) continue;
+    sum_size += max( c_boxes[k].width(), c_boxes[k].height() );
+    ++n_boxes;
+  }
+  if ( n_boxes == 0 ) return ret;
+
+  double cell_size = sum_size / n_boxes;
+  if ( ! ( cell_size > 0.0 )) cell_size = 1.0;
+
+  // if a box covers more cells than this, just test it against everything
+  const double max_cells = 4.0 * c_frame.size() + 16.0;
+
+  typedef long long cell_type;
+  auto cell_range = [&]( const vgl_box_2d<double>& b, cell_type& x0, cell_type& x1, cell_type& y0, cell_type& y1 ) -> bool
+  {
+    double fx0 = std::floor( b.min_x() / cell_size ), fx1 = std::floor( b.max_x() / cell_size );
+    double fy0 = std::floor( b.min_y() / cell_size ), fy1 = std::floor( b.max_y() / cell_size );
+    if ( (fx1 - fx0 + 1.0) * (fy1 - fy0 + 1.0) > max_cells ) return false;
+    x0 = static_cast< cell_type >( fx0 );
+    x1 = static_cast< cell_type >( fx1 );
+    y0 = static_cast< cell_type >( fy0 );
+    y1 = static_cast< cell_type >( fy1 );
+    return true;
+  };
+  auto cell_key = []( cell_type x, cell_type y ) -> cell_type
+  {
+    return (x << 32) ^ (y & 0xffffffffLL);
+  };
+
+  unordered_map< cell_type, vector< size_t > > grid;
+  vector< size_t > unplaced;  // computed boxes too big for the grid
+  for (size_t k=0; k<c_frame.size(); ++k)
+  {
+    if ( ! c_has_box[k] ) continue;
+    cell_type x0, x1, y0, y1;
+    if ( ! cell_range( c_boxes[k], x0, x1, y0, y1 ))
+    {
+      unplaced.push_back( k );
+      continue;
+    }
+    for (cell_type x=x0; x<=x1; ++x)
+    {
+      for (cell_type y=y0; y<=y1; ++y)
+      {
+        grid[ cell_key( x, y ) ].push_back( k );
+      }
+    }
+  }
+
+  vector< size_t > hits;
+  for (size_t ii=0; ii<t_frame.size(); ++ii)
+  {
+    vgl_box_2d<double> t_box;
+    if ( ! detection_box( t_snap, t_frame[ii], params, t_box )) continue;
+
+    hits.clear();
+    cell_type x0, x1, y0, y1;
+    if ( cell_range( t_box, x0, x1, y0, y1 ))
+    {
+      for (cell_type x=x0; x<=x1; ++x)
+      {
+        for (cell_type y=y0; y<=y1; ++y)
+        {
+          unordered_map< cell_type, vector< size_t > >::const_iterator probe = grid.find( cell_key( x, y ));
+          if ( probe != grid.end() )
+          {
+            hits.insert( hits.end(), probe->second.begin(), probe->second.end() );
+          }
+        }
+      }
+      hits.insert( hits.end(), unplaced.begin(), unplaced.end() );
+    }
+    else
+    {
+      for (size_t k=0; k<c_frame.size(); ++k)
+      {
+        if ( c_has_box[k] ) hits.push_back( k );
+      }
+    }
+
+    sort( hits.begin(), hits.end() );
+    hits.erase( unique( hits.begin(), hits.end() ), hits.end() );
+    for (size_t k=0; k<hits.size(); ++k)
+    {
+      ret.push_back( make_pair( t_frame[ii], c_frame[ hits[k] ] ));
+    }
+  }
+
+  return ret;
+}
+
 } // ...anon namespace
 
 namespace kwiver {
@@ -392,143 +947,41 @@ track2track_score
                 double match_window )
 {
 #ifdef P1_DEBUG
-  track_field<unsigned> fn("frame_number");
   debug_dump_first_n_frames( "align frames: f1", f1 );
   debug_dump_first_n_frames( "align frames: f2", f2 );
 #endif
 
-  vector< pair< frame_handle_type, frame_handle_type > > ret;
-  if ( f1.empty() || f2.empty() ) return ret;
-
   // assume f1, f2 are sorted by timestamp
+  vector< ts_type > ts1, ts2;
+  ts1.reserve( f1.size() );
+  ts2.reserve( f2.size() );
+  for (size_t i=0; i<f1.size(); ++i) ts1.push_back( ts( f1[i] ));
+  for (size_t i=0; i<f2.size(); ++i) ts2.push_back( ts( f2[i] ));
 
-  // quick tests for endpoints
-  // ...last frame of f1 before first frame of f2?
-  if ( ts( f1.back() )+match_window < ts( f2.front() ) )
+  vector< pair< size_t, size_t > > aligned =
+    align_timestamps( ts1.data(), ts1.size(), ts2.data(), ts2.size(), match_window );
+
+  vector< pair< frame_handle_type, frame_handle_type > > ret;
+  ret.reserve( aligned.size() );
+  for (size_t i=0; i<aligned.size(); ++i)
   {
-#ifdef P1_DEBUG
-    LOG_INFO( main_logger, "Quick-exit f1 vs f2: ");
-    unsigned long long diff = ts( f2.front() ) - (ts(f1.back()) + match_window);
-    LOG_INFO( main_logger, ts( f1.back() ) << " mw " << match_window << " " << ts( f2.front() ) << " diff " << diff << "");
-#endif
-    return ret;
+    ret.push_back( make_pair( f1[ aligned[i].first ], f2[ aligned[i].second ] ));
   }
-  // ...last frame of f2 before first frame of f1?
-  if ( ts( f2.back() )+match_window < ts( f1.front() ) )
+  return ret;
+}
+
+#ifdef KWANT_ENABLE_MGRS
+track2track_frame_overlap_record
+track2track_score
+::compute_radial_overlap( frame_handle_type f1, frame_handle_type f2, const phase1_parameters& params )
+{
+  static track_scorable_mgrs_type local_track_view;
+
+  field_handle_type mgrs_field = local_track_view.mgrs.get_field_handle();
+  if ( (! track_oracle_core::field_has_row( f1.row, mgrs_field )) ||
+       (! track_oracle_core::field_has_row( f2.row, mgrs_field )) )
   {
-#ifdef P1_DEBUG
-    LOG_INFO( main_logger, "Quick-exit f2 vs f1: ");
-    unsigned long long diff = ts( f1.front()) - (ts(f2.back()) + match_window);
-    LOG_INFO( main_logger, ts( f2.back() ) << " mw " << match_window << " " << ts( f1.front() ) << " diff " << diff << "");
-#endif
-    return ret;
-  }
-
-  // "A" and "B" each map to f1 and f2; which maps to which
-  // can change at the start of each round.  The constraint
-  // is that the timestamp of A is always less than B at
-  // the start of each round.
-  //
-  // values are always stored in ret in (f1, f2) order, helped
-  // by the a_is_f1 state variable below.
-  //
-  // At the start of each round:
-  // -- if A or B has run off the end, return.
-  // -- if ts(B) < ts(A), swap how A and B are mapped to f1 / f2.
-  // Thus, start off each round such that ts(A) < ts(B).
-  //
-  // If ts(B) - ts(A) is outside the match window:
-  // --- A has no match; increment A.
-  // If ts(B) - ts(A) is within match window:
-  // --- A and B match; increment both.
-
-  bool a_is_f1;  // true if (A==f1, B==f2); false if (A==f2, A==f1)
-  size_t f1_index = 0, f2_index = 0;
-  size_t n1 = f1.size(), n2 = f2.size();
-  while (true)
-  {
-    // Did we run out of frames?
-    if ((f1_index == n1) || (f2_index == n2)) return ret;
-
-#ifdef P1_DEBUG
-    {
-      unsigned f1_fn = fn( f1[f1_index].row );
-      unsigned f2_fn = fn( f2[f2_index].row );
-      LOG_DEBUG( main_logger, "Loop top " << f1_index <<  " vs " << f2_index << " (fn " << f1_fn << " / " << f2_fn << " )" );
-    }
-#endif
-    // decide which is A and which is B
-    a_is_f1 = (ts(f1[f1_index]) < ts(f2[f2_index]));
-    const frame_handle_list_type& fA = (a_is_f1) ? f1 : f2;
-    const frame_handle_list_type& fB = (a_is_f1) ? f2 : f1;
-    size_t& fA_index = (a_is_f1) ? f1_index : f2_index;
-    size_t& fB_index = (a_is_f1) ? f2_index : f1_index;
-
-    // compute timestamp diff
-    ts_type diff = ts( fB[fB_index] ) - ts( fA[fA_index] );
-#ifdef P1_DEBUG
-    LOG_DEBUG( main_logger, "a-is-f1: " << a_is_f1 << " ; diff " << diff << " vs match_window " << match_window );
-#endif
-    if (diff < match_window)
-    {
-      // the frames are aligned!  Record the result and increment
-      ret.push_back( make_pair( f1[f1_index], f2[f2_index] ));
-#ifdef P1_DEBUG
-      {
-        unsigned fn_1 = fn( f1[f1_index].row );
-        unsigned fn_2 = fn( f2[f2_index].row );
-        LOG_DEBUG( main_logger, "Match: size now " << ret.size() << " ; was: f1 / f2 " << fn_1 << " / " << fn_2 << "(index " << f1_index << " / " << f2_index << ")" );
-      }
-#endif
-      ++fA_index;
-      ++fB_index;
-#ifdef P1_DEBUG
-      {
-        unsigned fn_1 = fn( f1[f1_index].row );
-        unsigned fn_2 = fn( f2[f2_index].row );
-        LOG_DEBUG( main_logger, "...now  f1 / f2 " << fn_1 << " / " << fn_2  << "(index " << f1_index << " / " << f2_index << ")");
-      }
-#endif
-    }
-    else
-    {
-      // A has no match, increment past it
-#ifdef P1_DEBUG
-      {
-        unsigned fn_1 = fn( f1[f1_index].row );
-        unsigned fn_2 = fn( f2[f2_index].row );
-        LOG_DEBUG( main_logger, "NO MATCH: was f1 / f2 " << fn_1 << " / " << fn_2  << "(index " << f1_index << " / " << f2_index << ")");
-      }
-#endif
-      ++fA_index;
-#ifdef P1_DEBUG
-      {
-        unsigned fn_1 = fn( f1[f1_index].row );
-        unsigned fn_2 = fn( f2[f2_index].row );
-        LOG_DEBUG( main_logger, "...now  f1 / f2 " << fn_1 << " / " << fn_2 << "(index " << f1_index << " / " << f2_index << ")" );
-      }
-#endif
-    }
-  }
-
-  // shouldn't get here
-  LOG_ERROR( main_logger, "Logic error in " << __FILE__ << "::" << __LINE__ << "");
-  // hush some compilers
-  return ret;
-}
-
-#ifdef KWANT_ENABLE_MGRS
-track2track_frame_overlap_record
-track2track_score
-::compute_radial_overlap( frame_handle_type f1, frame_handle_type f2, const phase1_parameters& params )
-{
-  static track_scorable_mgrs_type local_track_view;
-
-  field_handle_type mgrs_field = local_track_view.mgrs.get_field_handle();
-  if ( (! track_oracle_core::field_has_row( f1.row, mgrs_field )) ||
-       (! track_oracle_core::field_has_row( f2.row, mgrs_field )) )
-  {
-    throw runtime_error( "radial overlap requested on frame with no mgrs" );
+    throw runtime_error( "radial overlap requested on frame with no mgrs" );
   }
 
   scorable_mgrs m1 = local_track_view[ f1 ].mgrs();
@@ -604,71 +1057,83 @@ track2track_frame_overlap_record
 track2track_score
 ::compute_spatial_overlap( frame_handle_type t1, frame_handle_type t2, phase1_parameters const& params )
 {
-  static scorable_track_type local_track_view;
-
-  typedef vgl_box_2d<double> bbox_type;
-  track2track_frame_overlap_record ret;
+  single_frame_data d1, d2;
+  track2track_frame_overlap_record ret =
+    this->compute_spatial_overlap( single_frame_view( t1, d1 ), 0, single_frame_view( t2, d2 ), 0, params );
   ret.truth_frame = t1;
   ret.computed_frame = t2;
-  ret.fL_frame_num = local_track_view[ t1 ].timestamp_frame();
-  ret.fR_frame_num = local_track_view[ t2 ].timestamp_frame();
-
-  field_handle_type bbox_field = local_track_view.bounding_box.get_field_handle();
-
+  return ret;
+}
 
-  if ( ( ! track_oracle_core::field_has_row( t1.row, bbox_field ) ) ||
-       ( ! track_oracle_core::field_has_row( t2.row, bbox_field )))
-  {
-#ifdef P1_DEBUG
-    LOG_INFO( main_logger, "cso: no field/row " << t1 << " , " << bbox_field );
-#endif
-    return ret;
+track2track_frame_overlap_record
+track2track_score
+::compute_spatial_overlap( const track2track_frame_view& t,
+                           size_t f1_index,
+                           const track2track_frame_view& c,
+                           size_t f2_index,
+                           phase1_parameters const& params ) const
+{
+  track2track_frame_overlap_record ret;
+  vgl_box_2d<double> b1, b2;
+  if ( ! prepare_frame_pair( t, f1_index, c, f2_index, params, ret, b1, b2 )) return ret;
+
+  // as in compute_spatial_overlaps(), only set if there is overlap
+  box_overlap_batch::pair_result r = box_overlap_batch::compute_pair( b1, b2 );
+  if ( r.intersects )
+  {
+    ret.truth_area = r.a_area;
+    ret.computed_area = r.b_area;
+    ret.overlap_area = r.overlap_area;
+    ret.centroid_distance = r.centroid_distance;
+    ret.center_bottom_distance = r.center_bottom_distance;
   }
+  return ret;
+}
 
-  bbox_type b1 = local_track_view[ t1 ].bounding_box();
-  bbox_type b2 = local_track_view[ t2 ].bounding_box();
+void
+track2track_score
+::compute_spatial_overlaps( const track2track_frame_view& t,
+                            const track2track_frame_view& c,
+                            const vector< pair< size_t, size_t > >& aligned,
+                            phase1_parameters const& params,
+                            vector< track2track_frame_overlap_record >& overlaps ) const
+{
+  typedef vgl_box_2d<double> bbox_type;
+  overlaps.assign( aligned.size(), track2track_frame_overlap_record() );
 
-  if( params.expand_bbox )
-  {
-	  b1.expand_about_centroid( params.bbox_expansion );
-	  b2.expand_about_centroid( params.bbox_expansion );
-  }
+  // First pass: frame numbers, box expansion and the AOI test, which
+  // are per-box; gather the box pairs for the batch.
 
-  if( params.b_aoi.is_empty() )
-  {
-    ret.in_aoi = true;
-  }
-  else
+  box_overlap_batch batch;
+  batch.reserve( aligned.size() );
+  vector< size_t > batch_index;  // index into aligned of each pair in the batch
+  batch_index.reserve( aligned.size() );
+  for (size_t i=0; i<aligned.size(); ++i)
   {
-    // Only set to true if BOTH bounding boxes intersect the AOI.
-
-    bbox_type t1i = vgl_intersection( b1, params.b_aoi );
-    bbox_type t2i = vgl_intersection( b2, params.b_aoi );
-    ret.in_aoi = ( ! t1i.is_empty()) && ( ! t2i.is_empty());
+    bbox_type b1, b2;
+    if ( prepare_frame_pair( t, aligned[i].first, c, aligned[i].second, params, overlaps[i], b1, b2 ))
+    {
+      batch.add( b1, b2 );
+      batch_index.push_back( i );
+    }
   }
 
-  bbox_type bi = vgl_intersection( b1, b2 );
+  // Second pass: areas and distances for the whole batch.
 
-#ifdef P1_DEBUG
-  LOG_INFO( main_logger, "spatial " << t1 << "," << t2 << ": " << b1 << ", " << b2 << ", " << bi );
-#endif
-  if ( ! bi.is_empty() )
+  batch.compute();
+  for (size_t k=0; k<batch.size(); ++k)
   {
     // it's pretty annoying but some of the code (e.g. score_phase2_aipr.cxx:60)
     // seems to rely on these being set ONLY if there is overlap
-    ret.truth_area = vgl_area( b1 );
-    ret.computed_area = vgl_area( b2 );
-    ret.overlap_area = vgl_area( bi );
-
-    double dx = b1.centroid_x() - b2.centroid_x();
-    double d_center_y = b1.centroid_y() - b2.centroid_y();
-    double d_bottom_y = b1.max_y() - b2.max_y();
-
-    ret.centroid_distance = sqrt( (dx*dx) + (d_center_y*d_center_y) );
-    ret.center_bottom_distance = sqrt( (dx*dx) + (d_bottom_y*d_bottom_y) );
-
+    if ( ! batch.intersects[k] ) continue;
+
+    track2track_frame_overlap_record& ret = overlaps[ batch_index[k] ];
+    ret.truth_area = batch.a_area[k];
+    ret.computed_area = batch.b_area[k];
+    ret.overlap_area = batch.overlap_area[k];
+    ret.centroid_distance = batch.centroid_distance[k];
+    ret.center_bottom_distance = batch.center_bottom_distance[k];
   }
-  return ret;
 }
 
 void
@@ -703,53 +1168,262 @@ debug_dump_alignments( const frame_handle_list_type& t,
   }
 }
 
+track2track_frame_snapshot
+::track2track_frame_snapshot( const track_handle_list_type& t )
+  : tracks( t )
+{
+  scorable_track_type local_track_view;
+  quickfilter_box_type qf;
+
+  this->track_begin.reserve( t.size()+1 );
+  this->track_begin.push_back( 0 );
+  this->qf_box_valid.reserve( t.size() );
+  this->qf_boxes.reserve( t.size() );
+
+  vector< size_t > order;
+  for (size_t i=0; i<t.size(); ++i)
+  {
+    size_t begin = this->frames.size();
+    frame_handle_list_type f = track_oracle_core::get_frames( t[i] );
+    for (size_t j=0; j<f.size(); ++j)
+    {
+      snapshot_frame( *this, f[j], local_track_view );
+    }
+
+    // sort this track's frames by timestamp (usually they already are)
+    if ( ! std::is_sorted( this->timestamps.begin()+begin, this->timestamps.end() ))
+    {
+      order.resize( f.size() );
+      for (size_t j=0; j<order.size(); ++j) order[j] = j;
+      const ts_type* ts = &this->timestamps[ begin ];
+      std::stable_sort( order.begin(), order.end(),
+                        [ts]( size_t lhs, size_t rhs ) { return ts[lhs] < ts[rhs]; } );
+      permute_column( this->frames, begin, order );
+      permute_column( this->timestamps, begin, order );
+      permute_column( this->frame_numbers, begin, order );
+      permute_column( this->has_box, begin, order );
+      permute_column( this->boxes, begin, order );
+    }
+    this->track_begin.push_back( this->frames.size() );
+
+    // only image-coordinate quickfilter boxes are snapshotted; see compute()
+    bool valid = false;
+    vgl_box_2d<double> qf_box;
+    pair< bool, int > coord_probe = qf.coord_system.get( t[i].row );
+    if ( coord_probe.first && ( coord_probe.second == quickfilter_box_type::COORD_IMG ))
+    {
+      pair< bool, vgl_box_2d<double> > box_probe = qf.img_box.get( t[i].row );
+      valid = box_probe.first;
+      qf_box = box_probe.second;
+    }
+    this->qf_box_valid.push_back( valid ? 1 : 0 );
+    this->qf_boxes.push_back( qf_box );
+  }
+}
+
+track2track_frame_view
+track2track_frame_snapshot
+::view( size_t i ) const
+{
+  track2track_frame_view ret;
+  size_t begin = this->track_begin[i];
+  ret.track = this->tracks[i];
+  ret.n_frames = this->n_frames( i );
+  if ( ret.n_frames > 0 )
+  {
+    ret.timestamps = &this->timestamps[ begin ];
+    ret.frame_numbers = &this->frame_numbers[ begin ];
+    ret.has_box = &this->has_box[ begin ];
+    ret.boxes = &this->boxes[ begin ];
+    ret.frames = &this->frames[ begin ];
+  }
+  ret.qf_box_valid = ( this->qf_box_valid[i] != 0 );
+  ret.qf_box = this->qf_boxes[i];
+  return ret;
+}
+
 bool
 track2track_score
 ::compute( track_handle_type t, track_handle_type c, phase1_parameters const& params )
 {
-  this->cached_truth_track = t;
-  this->cached_comp_track = c;
+  // one snapshot of both tracks, rather than one each
+  track_handle_list_type tc( 1, t );
+  tc.push_back( c );
+  track2track_frame_snapshot snap( tc );
+  bool b = this->compute( snap.view( 0 ), snap.view( 1 ), params );
+  if ( b )
+  {
+    this->mark_matched_frames();
+  }
+  return b;
+}
+
+track2track_compact_overlap_record
+::track2track_compact_overlap_record( const track2track_frame_overlap_record& r )
+  : truth_frame( r.truth_frame ),
+    computed_frame( r.computed_frame ),
+    fL_frame_num( r.fL_frame_num ),
+    fR_frame_num( r.fR_frame_num ),
+    truth_area( static_cast< float >( r.truth_area )),
+    computed_area( static_cast< float >( r.computed_area )),
+    overlap_area( static_cast< float >( r.overlap_area )),
+    centroid_distance( static_cast< float >( r.centroid_distance )),
+    center_bottom_distance( static_cast< float >( r.center_bottom_distance )),
+    flags( r.in_aoi ? IN_AOI : 0 )
+{
+}
+
+track2track_frame_overlap_record
+track2track_compact_overlap_record
+::materialize() const
+{
+  track2track_frame_overlap_record r;
+  r.truth_frame = this->truth_frame;
+  r.computed_frame = this->computed_frame;
+  r.fL_frame_num = this->fL_frame_num;
+  r.fR_frame_num = this->fR_frame_num;
+  r.truth_area = this->truth_area;
+  r.computed_area = this->computed_area;
+  r.overlap_area = this->overlap_area;
+  r.centroid_distance = this->centroid_distance;
+  r.center_bottom_distance = this->center_bottom_distance;
+  r.in_aoi = this->in_aoi();
+  return r;
+}
+
+size_t
+track2track_score
+::n_frame_overlaps() const
+{
+  return ( this->overlap_arena ) ? this->overlap_count : this->local_overlaps.size();
+}
+
+const track2track_compact_overlap_record&
+track2track_score
+::compact_overlap( size_t i ) const
+{
+  return ( this->overlap_arena )
+    ? this->overlap_arena->records[ this->overlap_offset + i ]
+    : this->local_overlaps[ i ];
+}
+
+track2track_frame_overlap_record
+track2track_score
+::frame_overlap( size_t i ) const
+{
+  return this->compact_overlap( i ).materialize();
+}
+
+vector< track2track_frame_overlap_record >
+track2track_score
+::frame_overlaps() const
+{
+  vector< track2track_frame_overlap_record > ret;
+  size_t n = this->n_frame_overlaps();
+  ret.reserve( n );
+  for (size_t i=0; i<n; ++i)
+  {
+    ret.push_back( this->frame_overlap( i ));
+  }
+  return ret;
+}
+
+void
+track2track_score
+::move_overlaps_to( const std::shared_ptr< track2track_overlap_arena >& arena )
+{
+  if ( this->overlap_arena ) return;
+
+  this->overlap_offset = arena->records.size();
+  this->overlap_count = this->local_overlaps.size();
+  arena->records.insert( arena->records.end(), this->local_overlaps.begin(), this->local_overlaps.end() );
+  vector< track2track_compact_overlap_record >().swap( this->local_overlaps );
+  this->overlap_arena = arena;
+}
+
+void
+track2track_score
+::drop_overlaps()
+{
+  this->overlap_arena.reset();
+  this->overlap_offset = 0;
+  this->overlap_count = 0;
+  vector< track2track_compact_overlap_record >().swap( this->local_overlaps );
+}
+
+void
+track2track_score
+::mark_matched_frames() const
+{
+  scorable_track_type local_track_view;
+  for (size_t i=0; i<this->n_frame_overlaps(); ++i)
+  {
+    const track2track_compact_overlap_record& overlap = this->compact_overlap( i );
+    local_track_view[ overlap.truth_frame ].frame_has_been_matched() = IN_AOI_MATCHED;
+    local_track_view[ overlap.computed_frame ].frame_has_been_matched() = IN_AOI_MATCHED;
+  }
+}
+
+bool
+track2track_score
+::compute( const track2track_frame_view& t,
+           const track2track_frame_view& c,
+           phase1_parameters const& params )
+{
+  vector< track2track_frame_overlap_record > overlaps;
+  vector< pair< size_t, size_t > > alignments;
+  this->collect_nonzero_overlaps( t, c, params, overlaps, alignments );
+  return this->select_overlaps( t, c, overlaps, alignments, params );
+}
+
+void
+track2track_score
+::collect_nonzero_overlaps( const track2track_frame_view& t,
+                            const track2track_frame_view& c,
+                            const phase1_parameters& params,
+                            vector< track2track_frame_overlap_record >& overlaps,
+                            vector< pair< size_t, size_t > >& alignments )
+{
+  overlaps.clear();
+  alignments.clear();
 
   bool use_radial_overlap = (params.radial_overlap >= 0.0);
 
   //
-  // Use the quickfilter boxes if possible
+  // Use the quickfilter boxes if possible.  MGRS quickfilter boxes
+  // aren't cached, so radial overlap goes back to track_oracle; this
+  // keeps radial overlap off the worker threads (see compute_all.)
   //
-  static quickfilter_box_type qf;
-  double qf_check = qf.quickfilter_check( t, c, use_radial_overlap );
+  double qf_check = -1.0;
+  if ( use_radial_overlap )
+  {
+    quickfilter_box_type qf;
+    qf_check = qf.quickfilter_check( t.track, c.track, use_radial_overlap );
+  }
+  else if ( t.qf_box_valid && c.qf_box_valid )
+  {
+    qf_check = quickfilter_box_type::img_box_intersect( t.qf_box, c.qf_box );
+  }
   if ( qf_check == 0 )
   {
-    this->frame_overlaps.clear();
-    return false;
+    return;
   }
 
-  static scorable_track_type local_track_view;
-#ifdef P1_DEBUG
-  LOG_INFO( main_logger,"Sorting truth tracks...");
-#endif
-  frame_handle_list_type t_sorted_frames = sort_frames_by_field( t, "timestamp_usecs" );
-#ifdef P1_DEBUG
-  LOG_INFO( main_logger,"Sorting computed tracks...");
-#endif
-  frame_handle_list_type c_sorted_frames = sort_frames_by_field( c, "timestamp_usecs" );
-
 #ifdef P1_DEBUG
-  debug_dump_first_n_frames( "t-unsorted", track_oracle_core::get_frames(t) );
-  debug_dump_first_n_frames( "t-sorted", t_sorted_frames );
-  debug_dump_first_n_frames( "c-unsorted", track_oracle_core::get_frames(c) );
-  debug_dump_first_n_frames( "c-unsorted", c_sorted_frames );
+  debug_dump_first_n_frames( "t-unsorted", track_oracle_core::get_frames( t.track ) );
+  debug_dump_first_n_frames( "t-sorted", frame_handle_list_type( t.frames, t.frames+t.n_frames ));
+  debug_dump_first_n_frames( "c-unsorted", track_oracle_core::get_frames( c.track ) );
+  debug_dump_first_n_frames( "c-sorted", frame_handle_list_type( c.frames, c.frames+c.n_frames ));
 #endif
 
-  vector< pair< frame_handle_type, frame_handle_type > > aligned_frames
-    = this->align_frames( t_sorted_frames, c_sorted_frames, params.frame_alignment_time_window_usecs );
+  vector< pair< size_t, size_t > > aligned_frames
+    = align_timestamps( t.timestamps, t.n_frames, c.timestamps, c.n_frames,
+                        params.frame_alignment_time_window_usecs );
 
 #ifdef P1_DEBUG
-  LOG_INFO( main_logger, "t-sorted / c-sorted / aligned: " << t_sorted_frames.size() << " " << c_sorted_frames.size() << " " << aligned_frames.size() );
-  LOG_INFO( main_logger, "Aligned frames: " << aligned_frames.size() << ":" );
+  LOG_INFO( main_logger, "t-sorted / c-sorted / aligned: " << t.n_frames << " " << c.n_frames << " " << aligned_frames.size() );
 #endif
 
-  this->frame_overlaps.clear();
-
   // revised AOI logic:
   // The overlap statistics are only valid if there is at least
   // one frame_overlap_record with an AOI match:
@@ -761,6 +1435,73 @@ track2track_score
   //
   // ...in other words, if the in_aoi and params.aoiInclusive values are the same.
 
+  // spatial overlaps are computed for all the aligned frames in one batch
+  vector< track2track_frame_overlap_record > spatial_overlaps;
+  if ( ! use_radial_overlap )
+  {
+    this->compute_spatial_overlaps( t, c, aligned_frames, params, spatial_overlaps );
+  }
+
+  for (size_t i=0; i<aligned_frames.size(); ++i)
+  {
+#ifdef KWANT_ENABLE_MGRS
+    track2track_frame_overlap_record overlap =
+      ( use_radial_overlap )
+      ? this->compute_radial_overlap( t.frames[ aligned_frames[i].first ], c.frames[ aligned_frames[i].second ], params )
+      : spatial_overlaps[i];
+#else
+    track2track_frame_overlap_record overlap;
+    if (use_radial_overlap)
+    {
+      throw std::runtime_error( "Radial overlap used without MGRS support" );
+    }
+    else
+    {
+      overlap = spatial_overlaps[i];
+    }
+#endif
+
+    // aoi match must be checked regardless of overlap area
+    // (but only if the AOI is defined.)
+    bool this_aoi_match = (  params.b_aoi.is_empty() || ( overlap.in_aoi == params.aoiInclusive ) );
+
+    // do not process this overlap if the AOIs do not match
+    if ( ! this_aoi_match) continue;
+
+    // never keep empty overlaps (definition of 'empty' depends on overlap method)
+    bool overlap_is_empty =
+      ( use_radial_overlap )
+      ? overlap.centroid_distance == -1.0
+      : overlap.overlap_area == 0;
+    if ( overlap_is_empty ) continue;
+
+    // the per-frame filters' debugging output reads the frames back
+    // from track_oracle, so the handles must be set before filtering
+    overlap.truth_frame = t.frames[ aligned_frames[i].first ];
+    overlap.computed_frame = c.frames[ aligned_frames[i].second ];
+    overlaps.push_back( overlap );
+    alignments.push_back( aligned_frames[i] );
+  }
+}
+
+bool
+track2track_score
+::select_overlaps( const track2track_frame_view& t,
+                   const track2track_frame_view& c,
+                   const vector< track2track_frame_overlap_record >& overlaps,
+                   const vector< pair< size_t, size_t > >& alignments,
+                   const phase1_parameters& params )
+{
+  this->cached_truth_track = t.track;
+  this->cached_comp_track = c.track;
+  this->overlap_arena.reset();
+  this->overlap_offset = 0;
+  this->overlap_count = 0;
+  this->local_overlaps.clear();
+  this->spatial_overlap_total_frames = 0;
+
+  bool use_radial_overlap = (params.radial_overlap >= 0.0);
+
   //
   // There are three optional parameters for accepting or rejecting a
   // frame-to-frame overlap:
@@ -797,156 +1538,385 @@ track2track_score
   // with ANY overlap will be passed downstream.
   //
 
-  // First, compute all the overlaps; along the way, count how many pass
-  // the per-frame overlap filter
+  // First, count how many of the (non-empty, AOI-matched) overlaps
+  // pass the per-frame overlap filter
 
-  vector< pair< bool, track2track_frame_overlap_record > > overlaps;
+  vector< unsigned char > is_strong( overlaps.size() );
   size_t strong_overlap_count = 0;
-  for (size_t i=0; i<aligned_frames.size(); ++i)
+  for (size_t i=0; i<overlaps.size(); ++i)
   {
-#ifdef KWANT_ENABLE_MGRS
-    track2track_frame_overlap_record overlap =
+    //
+    // process overlaps.  "Strong" overlaps are ones which meet any options
+    // the user requested to tighten the overlap criteria, such as --min-pcent-gt-ct
+    // or --match-overlap-lower-bound.  A "weak" overlap is a single-pixel overlap.
+    // Pass-nonzero-overlaps allows you to filter track-to-track overlaps on
+    // strong overlaps, but compute statistics on strong + weak overlaps.  Radial
+    // overlap doesn't (yet) have a strong vs. weak distinction, which is why
+    // we disallow both radial-overlap and pass-nonzero-overlap to be specified.
+
+    bool overlap_is_strong =
       ( use_radial_overlap )
-      ? this->compute_radial_overlap( aligned_frames[i].first, aligned_frames[i].second, params )
-      : this->compute_spatial_overlap(  aligned_frames[i].first, aligned_frames[i].second, params );
-#else
-    track2track_frame_overlap_record overlap;
-    if (use_radial_overlap)
+      ? ( overlaps[i].centroid_distance <= params.radial_overlap )
+      : test_if_overlap_passes_filters( overlaps[i], params );
+
+    is_strong[i] = overlap_is_strong ? 1 : 0;
+    if ( overlap_is_strong )
     {
-      throw std::runtime_error( "Radial overlap used without MGRS support" );
+      ++strong_overlap_count;
     }
-    else
+  }
+
+  if (params.min_frames_policy.first)
+  {
+    if ((params.min_frames_policy.second != 0) &&
+        (strong_overlap_count < params.min_frames_policy.second ))
     {
-      overlap = this->compute_spatial_overlap(  aligned_frames[i].first, aligned_frames[i].second, params );
+      // we're outta here!
+      return false;
     }
-#endif
+  }
+  else
+  {
+    // convert parameter '10%' into 0.10 * length-of-ground-truth
+    double d = params.min_frames_policy.second;
+    if (d > 0)
+    {
+      size_t t_length_filter = static_cast< size_t >( t.n_frames * d / 100.0 );
+      // percentage parameter can never drive the filter length to zero
+      if ((t_length_filter == 0) && ( t.n_frames > 0 ))
+      {
+        t_length_filter = 1;
+      }
+      if ( strong_overlap_count < t_length_filter )
+      {
+        // we're outta here!
+        return false;
+      }
+    } // ...if d > 0
+  } // ...min_length_filter is percentage-based
 
-    // aoi match must be checked regardless of overlap area
-    // (but only if the AOI is defined.)
-    bool this_aoi_match = (  params.b_aoi.is_empty() || ( overlap.in_aoi == params.aoiInclusive ) );
+  // ...otherwise, we're in.  Copy out of the overlaps buffer into
+  // this object's (compact) frame overlaps based on the value of
+  // the pass_all_nonzero_overlaps flag, computing time ranges and
+  // so forth as we go.  (The frames are flagged as matched later,
+  // in mark_matched_frames().)
 
-    // do not process this overlap if the AOIs do not match
-    if ( ! this_aoi_match) continue;
+  this->overlap_frame_range.first = numeric_limits< ts_type >::max();
+  this->overlap_frame_range.second = numeric_limits< ts_type >::min();
 
-    // never keep empty overlaps (definition of 'empty' depends on overlap method)
-    bool overlap_is_empty =
-      ( use_radial_overlap )
-      ? overlap.centroid_distance == -1.0
-      : overlap.overlap_area == 0;
-    if ( overlap_is_empty ) continue;
+  for (size_t i=0; i<overlaps.size(); ++i)
+  {
+    bool keep_this = params.pass_all_nonzero_overlaps || is_strong[i];
+    if ( ! keep_this ) continue;
 
-    //
-    // process overlaps.  "Strong" overlaps are ones which meet any options
-    // the user requested to tighten the overlap criteria, such as --min-pcent-gt-ct
-    // or --match-overlap-lower-bound.  A "weak" overlap is a single-pixel overlap.
-    // Pass-nonzero-overlaps allows you to filter track-to-track overlaps on
-    // strong overlaps, but compute statistics on strong + weak overlaps.  Radial
-    // overlap doesn't (yet) have a strong vs. weak distinction, which is why
-    // we disallow both radial-overlap and pass-nonzero-overlap to be specified.
+    const track2track_frame_overlap_record& overlap = overlaps[i];
+    const pair< size_t, size_t >& alignment = alignments[i];
+    ts_type t_ts = t.timestamps[ alignment.first ];
+    ts_type c_ts = c.timestamps[ alignment.second ];
+
+    // update the frame range
+    ts_type this_min_ts = min( t_ts, c_ts );
+    this->overlap_frame_range.first = min( this_min_ts, this->overlap_frame_range.first );
+
+    ts_type this_max_ts = max( t_ts, c_ts );
+    this->overlap_frame_range.second = max( this_max_ts, this->overlap_frame_range.second );
+
+    this->local_overlaps.push_back( track2track_compact_overlap_record( overlap ));
+  }
+  this->spatial_overlap_total_frames = this->local_overlaps.size();
+
+  return ( ! this->local_overlaps.empty() );
+}
+
+
+const size_t track2track_association_matrix::npos;
+
+track2track_association_matrix::const_iterator
+track2track_association_matrix
+::find( const key_type& key ) const
+{
+  if ( this->index_sync.stale.load( std::memory_order_acquire ))
+  {
+    // a merge on another thread may be moving the entries
+    std::lock_guard< std::mutex > lock( this->index_sync.rebuild_lock );
+    return this->find_unindexed( key );
+  }
+  return this->find_unindexed( key );
+}
+
+track2track_association_matrix::const_iterator
+track2track_association_matrix
+::find_unindexed( const key_type& key ) const
+{
+  const_iterator sorted_begin = this->entries.begin();
+  const_iterator sorted_end = sorted_begin + this->n_sorted;
+  const_iterator probe = std::lower_bound( sorted_begin, sorted_end, key,
+                                           []( const value_type& e, const key_type& k )
+                                           { return e.first < k; } );
+  if ( (probe != sorted_end) && ( ! (key < probe->first )))
+  {
+    return probe;
+  }
+  if ( this->pending.empty() ) return this->end();
+
+  map< key_type, size_t >::const_iterator p = this->pending.find( key );
+  return ( p == this->pending.end() )
+    ? this->end()
+    : sorted_begin + p->second;
+}
+
+pair< track2track_association_matrix::const_iterator, bool >
+track2track_association_matrix
+::insert( const value_type& v )
+{
+  const_iterator probe = this->find( v.first );
+  if ( probe != this->end() )
+  {
+    return make_pair( probe, false );
+  }
+  // appended to the pending tail; merged by the next ordered access
+  this->entries.push_back( v );
+  this->pending.insert( make_pair( v.first, this->entries.size()-1 ));
+  this->index_sync.stale.store( true, std::memory_order_release );
+  return make_pair( const_iterator( this->entries.end()-1 ), true );
+}
+
+vector< bool >
+track2track_association_matrix
+::insert( const vector< value_type >& v )
+{
+  vector< bool > ret( v.size(), false );
+  if ( v.empty() ) return ret;
+
+  this->merge_pending();
+
+  // stable, so that the first of any repeated keys is the one inserted
+  vector< size_t > order( v.size() );
+  for (size_t k=0; k<order.size(); ++k) order[k] = k;
+  std::stable_sort( order.begin(), order.end(),
+                    [&v]( size_t lhs, size_t rhs ) { return v[lhs].first < v[rhs].first; } );
+
+  vector< value_type > merged;
+  merged.reserve( this->entries.size() + v.size() );
+  size_t i = 0, k = 0;
+  while ( (i < this->entries.size()) || (k < order.size()) )
+  {
+    if ( (k == order.size()) ||
+         ( (i < this->entries.size()) && ( this->entries[i].first < v[ order[k] ].first )))
+    {
+      merged.push_back( std::move( this->entries[i++] ));
+      continue;
+    }
+
+    // v[ order[k] ] goes next, unless its key is already present
+    const value_type& x = v[ order[k] ];
+    bool present =
+      ( ( i < this->entries.size() ) && ( ! ( x.first < this->entries[i].first ))) ||
+      ( ( ! merged.empty() ) && ( ! ( merged.back().first < x.first )));
+    if ( ! present )
+    {
+      merged.push_back( x );
+      ret[ order[k] ] = true;
+    }
+    ++k;
+  }
+
+  this->entries.swap( merged );
+  this->n_sorted = this->entries.size();
+  this->index_sync.stale.store( true, std::memory_order_release );
+  this->rebuild_index();
+  return ret;
+}
+
+void
+track2track_association_matrix
+::clear()
+{
+  this->entries.clear();
+  this->n_sorted = 0;
+  this->pending.clear();
+  this->index_sync.stale.store( true, std::memory_order_release );
+  this->rebuild_index();
+}
 
-    bool overlap_is_strong =
-      ( use_radial_overlap )
-      ? ( overlap.centroid_distance <= params.radial_overlap )
-      : test_if_overlap_passes_filters( overlap, params );
+size_t
+track2track_association_matrix
+::truth_index( const track_handle_type& t ) const
+{
+  this->ensure_index();
+  vector< track_handle_type >::const_iterator probe =
+    std::lower_bound( this->truth_tracks.begin(), this->truth_tracks.end(), t );
+  return ( (probe == this->truth_tracks.end()) || (t < *probe) )
+    ? npos
+    : static_cast< size_t >( probe - this->truth_tracks.begin() );
+}
 
-    overlaps.push_back( make_pair( overlap_is_strong, overlap ));
-    if ( overlap_is_strong )
+size_t
+track2track_association_matrix
+::computed_index( const track_handle_type& c ) const
+{
+  this->ensure_index();
+  vector< track_handle_type >::const_iterator probe =
+    std::lower_bound( this->computed_tracks.begin(), this->computed_tracks.end(), c );
+  return ( (probe == this->computed_tracks.end()) || (c < *probe) )
+    ? npos
+    : static_cast< size_t >( probe - this->computed_tracks.begin() );
+}
+
+void
+track2track_association_matrix
+::rebuild_index() const
+{
+  std::lock_guard< std::mutex > lock( this->index_sync.rebuild_lock );
+  if ( ! this->index_sync.stale.load( std::memory_order_relaxed )) return;
+
+  this->merge_pending();
+
+  // rows: the entries are already grouped by truth track
+  this->truth_tracks.clear();
+  this->row_offsets.assign( 1, 0 );
+  for (size_t k=0; k<this->entries.size(); ++k)
+  {
+    const track_handle_type& t = this->entries[k].first.first;
+    if ( this->truth_tracks.empty() || ( this->truth_tracks.back() < t ))
     {
-      ++strong_overlap_count;
+      if ( ! this->truth_tracks.empty() ) this->row_offsets.push_back( k );
+      this->truth_tracks.push_back( t );
     }
   }
+  if ( ! this->truth_tracks.empty() ) this->row_offsets.push_back( this->entries.size() );
 
-  if (params.min_frames_policy.first)
+  // columns: counting sort of the entry indices by computed track;
+  // walking the entries in key order leaves each column in truth order
+  this->computed_tracks.clear();
+  for (size_t k=0; k<this->entries.size(); ++k)
   {
-    if ((params.min_frames_policy.second != 0) &&
-        (strong_overlap_count < params.min_frames_policy.second ))
-    {
-      // we're outta here!
-      return false;
-    }
+    this->computed_tracks.push_back( this->entries[k].first.second );
   }
-  else
+  sort( this->computed_tracks.begin(), this->computed_tracks.end() );
+  this->computed_tracks.erase( unique( this->computed_tracks.begin(), this->computed_tracks.end(),
+                                       []( const track_handle_type& lhs, const track_handle_type& rhs )
+                                       { return ! ( (lhs < rhs) || (rhs < lhs) ); } ),
+                               this->computed_tracks.end() );
+
+  vector< size_t > entry_column( this->entries.size() );
+  this->col_offsets.assign( this->computed_tracks.size()+1, 0 );
+  for (size_t k=0; k<this->entries.size(); ++k)
+  {
+    // not computed_index(), which would wait on the lock we hold
+    entry_column[k] = std::lower_bound( this->computed_tracks.begin(), this->computed_tracks.end(),
+                                        this->entries[k].first.second ) - this->computed_tracks.begin();
+    ++this->col_offsets[ entry_column[k]+1 ];
+  }
+  for (size_t j=0; j<this->computed_tracks.size(); ++j)
   {
-    // convert parameter '10%' into 0.10 * length-of-ground-truth
-    double d = params.min_frames_policy.second;
-    if (d > 0)
-    {
-      size_t t_length_filter = static_cast< size_t >( t_sorted_frames.size() * d / 100.0 );
-      // percentage parameter can never drive the filter length to zero
-      if ((t_length_filter == 0) && ( ! t_sorted_frames.empty() ))
-      {
-        t_length_filter = 1;
-      }
-      if ( strong_overlap_count < t_length_filter )
-      {
-        // we're outta here!
-        return false;
-      }
-    } // ...if d > 0
-  } // ...min_length_filter is percentage-based
-
-  // ...otherwise, we're in.  Copy out of the overlaps buffer into
-  // this object's frame_overlaps vector based on the value of
-  // the pass_all_nonzero_overlaps flag, setting flags and computing
-  // time ranges and so forth as we go.
-
-  this->overlap_frame_range.first = numeric_limits< ts_type >::max();
-  this->overlap_frame_range.second = numeric_limits< ts_type >::min();
-
-  track_field< kwiver::track_oracle::dt::utility::state_flags > track_flags;
-  for (size_t i=0; i<overlaps.size(); ++i)
+    this->col_offsets[j+1] += this->col_offsets[j];
+  }
+  vector< size_t > fill( this->col_offsets.begin(), this->col_offsets.end()-1 );
+  this->col_entries.resize( this->entries.size() );
+  for (size_t k=0; k<this->entries.size(); ++k)
   {
-    bool keep_this = params.pass_all_nonzero_overlaps || overlaps[i].first;
-    if ( ! keep_this ) continue;
-
-    const track2track_frame_overlap_record& overlap = overlaps[i].second;
-
-    // record that the frames were matched
-    local_track_view[ overlap.truth_frame ].frame_has_been_matched() = IN_AOI_MATCHED;
-    local_track_view[ overlap.computed_frame ].frame_has_been_matched() = IN_AOI_MATCHED;
-    track_flags( overlap.truth_frame.row ).set_flag( "ATTR_SCORING_STATE_MATCHED" );
-    track_flags( overlap.computed_frame.row ).set_flag( "ATTR_SCORING_STATE_MATCHED" );
-
+    this->col_entries[ fill[ entry_column[k] ]++ ] = k;
+  }
 
-    // update the frame range
-    ts_type this_min_ts = min( ts( overlap.truth_frame ), ts( overlap.computed_frame ));
-    this->overlap_frame_range.first = min( this_min_ts, this->overlap_frame_range.first );
+  this->index_sync.stale.store( false, std::memory_order_release );
+}
 
-    ts_type this_max_ts = max( ts( overlap.truth_frame ), ts( overlap.computed_frame ));
-    this->overlap_frame_range.second = max( this_max_ts, this->overlap_frame_range.second );
+void
+track2track_association_matrix
+::merge_pending() const
+{
+  // callers hold the rebuild lock, or are inserting (and so are alone)
+  if ( this->n_sorted == this->entries.size() ) return;
+
+  auto by_key = []( const value_type& lhs, const value_type& rhs ) { return lhs.first < rhs.first; };
+  vector< value_type >::iterator sorted_end = this->entries.begin() + this->n_sorted;
+  sort( sorted_end, this->entries.end(), by_key );
+  std::inplace_merge( this->entries.begin(), sorted_end, this->entries.end(), by_key );
+  this->n_sorted = this->entries.size();
+  this->pending.clear();
+}
 
-    this->frame_overlaps.push_back( overlap );
+void
+track2track_phase1
+::store_matches( vector< t2t_type::value_type >& matches )
+{
+  // flag the matched frames and pack each match's overlaps into the arena
+  // (or drop them, if we're only keeping counts), then add the matches to t2t
+  if ( this->params.keep_frame_overlaps )
+  {
+    size_t n_records = 0;
+    for (size_t k=0; k<matches.size(); ++k)
+    {
+      n_records += matches[k].second.n_frame_overlaps();
+    }
+    this->overlap_arena->records.reserve( this->overlap_arena->records.size() + n_records );
   }
-  this->spatial_overlap_total_frames = this->frame_overlaps.size();
 
-  return ( ! this->frame_overlaps.empty() );
+  for (size_t k=0; k<matches.size(); ++k)
+  {
+    matches[k].second.mark_matched_frames();
+    if ( this->params.keep_frame_overlaps )
+    {
+      matches[k].second.move_overlaps_to( this->overlap_arena );
+    }
+    else
+    {
+      matches[k].second.drop_overlaps();
+    }
+  }
+  this->t2t.insert( matches );
 }
 
-
 void
 track2track_phase1
 ::compute_all( const track_handle_list_type& t,
                const track_handle_list_type& c )
 {
-  if ( params.perform_sanity_checks )
+  // everything in one partition
+  this->compute_all_partitioned( t, c, vector< unsigned >( t.size(), 0 ), vector< unsigned >( c.size(), 0 ));
+}
+
+void
+track2track_phase1
+::compute_all_partitioned( const track_handle_list_type& t,
+                           const track_handle_list_type& c,
+                           const vector< unsigned >& t_partition,
+                           const vector< unsigned >& c_partition )
+{
+  if ( ( t_partition.size() != t.size() ) || ( c_partition.size() != c.size() ))
   {
-    // c may be empty if the tracker missed everything; in that case, don't throw an error
-    // t may also be empty if we're e.g. scoring events (say, PersonWalking), and the truth
-    // set has no Walking events, but the computed set does
-    if ( (! t.empty() ) && (! c.empty() ) && (! sanity_check_track_list_timestamps( t, c )))
-    {
-      LOG_ERROR( main_logger, "*\n*\n*\n"
-                 << "* The set of aligned frames between ground-truth and computed tracks is empty.\n"
-                 << "* There are three possibilities:\n"
-                 << "* 1) your ground-truth and and computed data are truly misaligned\n"
-                 << "* 2) the frame alignment parameter is set incorrectly,\n"
-                 << "* 3) there is an error in the timestamp_usecs filed of one or both data sets.\n"
-                 << "* To disable this test, use the --disable-sanity-checks flag.\n"
-                 << "* About to exit signaling failure\n"
-                 << "*\n*\n*" );
-      throw runtime_error( "Misaligned datasets" );
-    }
+    throw runtime_error( "phase 1: partition lists don't match the track lists" );
+  }
+  this->compute_selected( t, c, t_partition, c_partition, 0, 0 );
+}
+
+void
+track2track_phase1
+::compute_all_masked( const track_handle_list_type& t,
+                      const track_handle_list_type& c,
+                      const vector< track_mask_type >& t_mask,
+                      const vector< track_mask_type >& c_mask )
+{
+  if ( ( t_mask.size() != t.size() ) || ( c_mask.size() != c.size() ))
+  {
+    throw runtime_error( "phase 1: mask lists don't match the track lists" );
   }
+  // everything in one partition
+  this->compute_selected( t, c, vector< unsigned >( t.size(), 0 ), vector< unsigned >( c.size(), 0 ),
+                          &t_mask, &c_mask );
+}
+
+void
+track2track_phase1
+::compute_selected( const track_handle_list_type& t,
+                    const track_handle_list_type& c,
+                    const vector< unsigned >& t_partition,
+                    const vector< unsigned >& c_partition,
+                    const vector< track_mask_type >* t_mask,
+                    const vector< track_mask_type >* c_mask )
+{
+  check_track_list_alignment( t, c, params );
 
 #define QF_DBG 0
 #if QF_DBG
@@ -958,17 +1928,83 @@ track2track_phase1
   LOG_INFO( main_logger, "Adding quickfilter boxes to " << c.size() << " computed tracks..." );
   quickfilter_box_type::add_quickfilter_boxes( c, params );
 
-  for ( unsigned i=0; i<t.size(); ++i )
+  //
+  // Copy out the sorted frames, boxes, and quickfilter boxes of every
+  // track into columnar snapshots.  After this, comparing two tracks
+  // doesn't touch track_oracle until we merge the results back into t2t.
+  //
+
+  LOG_INFO( main_logger, "Snapshotting frames of " << t.size() << " truth and " << c.size() << " computed tracks..." );
+  track2track_frame_snapshot t_snap( t ), c_snap( c );
+
+  unsigned n_threads = phase1_thread_count( this->params );
+
+  // Only pairs in the same partition (with intersecting masks) which
+  // overlap in time can match; find those up front rather than letting
+  // compute() discover it pair by pair.
+  vector< vector< size_t > > candidates =
+    partitioned_temporal_candidates( t_snap, c_snap, params.frame_alignment_time_window_usecs,
+                                     t_partition, c_partition, t_mask, c_mask, n_threads );
+  size_t n_candidates = 0;
+  for (size_t i=0; i<candidates.size(); ++i) n_candidates += candidates[i].size();
+  LOG_INFO( main_logger, "phase 1: " << n_candidates << " of " << t.size() * c.size()
+            << " track pairs overlap in time" );
+
+  if (n_threads > 1)
+  {
+    LOG_INFO( main_logger, "phase 1: comparing tracks on " << n_threads << " threads" );
+  }
+  LOG_INFO( main_logger, "phase 1: using the " << box_overlap_batch::kernel_name() << " box overlap kernel" );
+
+  //
+  // Each worker takes the next unclaimed truth track and compares it
+  // against its candidate computed tracks, keeping the matches in results[i].
+  // The t2t map is only read while the workers are running.
+  //
+
+  vector< vector< pair< size_t, track2track_score > > > results( t.size() );
+  atomic< size_t > n_done( 0 );
+  mutex log_mutex;
+
+  parallel_for( n_threads, t.size(), [&]( size_t i )
   {
-    if ((i % 10 == 0) || (i == t.size()-1)) {
-      LOG_INFO( main_logger, "phase 1: " << i << " of " << t.size() << "..." );
+    track2track_frame_view t_view = t_snap.view( i );
+    for (size_t k=0; k<candidates[i].size(); ++k)
+    {
+      size_t j = candidates[i][k];
+
+      // skip pairs we've already computed (e.g. on a previous call)
+      if ( this->t2t.find( make_pair( t[i], c[j] )) != this->t2t.end() ) continue;
+
+      track2track_score t2t_score;
+      if ( t2t_score.compute( t_view, c_snap.view( j ), this->params ))
+      {
+        results[i].push_back( make_pair( j, t2t_score ));
+      }
     }
-    for (unsigned j=0; j<c.size(); ++j)
+
+    size_t n = ++n_done;
+    if ((n % 10 == 0) || (n == t.size()))
     {
-      this->compute_single( t[i], c[j] );
+      lock_guard< mutex > lock( log_mutex );
+      LOG_INFO( main_logger, "phase 1: " << n << " of " << t.size() << "..." );
     }
-  }
+  });
+
+  //
+  // Merge in truth-track order, flagging the matched frames as we go,
+  // so that the results don't depend on the number of threads.
+  //
 
+  vector< t2t_type::value_type > matches;
+  for (size_t i=0; i<results.size(); ++i)
+  {
+    for (size_t k=0; k<results[i].size(); ++k)
+    {
+      matches.push_back( make_pair( make_pair( t[i], c[ results[i][k].first ] ), results[i][k].second ));
+    }
+  }
+  this->store_matches( matches );
 }
 
 void
@@ -976,79 +2012,139 @@ track2track_phase1
 ::compute_all_detection_mode( const track_handle_list_type& t,
                               const track_handle_list_type& c )
 {
-  track_field<track_oracle::dt::tracking::frame_number> fn;
+  this->compute_selected_detection_mode( t, c, 0, 0 );
+}
+
+void
+track2track_phase1
+::compute_all_detection_mode_masked( const track_handle_list_type& t,
+                                     const track_handle_list_type& c,
+                                     const vector< track_mask_type >& t_mask,
+                                     const vector< track_mask_type >& c_mask )
+{
+  if ( ( t_mask.size() != t.size() ) || ( c_mask.size() != c.size() ))
+  {
+    throw runtime_error( "phase 1: mask lists don't match the track lists" );
+  }
+  this->compute_selected_detection_mode( t, c, &t_mask, &c_mask );
+}
+
+void
+track2track_phase1
+::compute_selected_detection_mode( const track_handle_list_type& t,
+                                   const track_handle_list_type& c,
+                                   const vector< track_mask_type >* t_mask,
+                                   const vector< track_mask_type >* c_mask )
+{
   LOG_INFO( main_logger, "Phase 1 detection mode: aligning detections..." );
 
-  typedef map< track_oracle::dt::tracking::frame_number::Type, pair< track_handle_list_type, track_handle_list_type > >::iterator i_t;
-  map< track_oracle::dt::tracking::frame_number::Type, pair< track_handle_list_type, track_handle_list_type > > fn2gtct;
-  for ( unsigned i=0; i<t.size(); ++i )
+  track2track_frame_snapshot t_snap( t ), c_snap( c );
+
+  // key: frame number; value: indices into (t, c) of the detections on that frame
+  typedef unordered_map< unsigned, pair< vector< size_t >, vector< size_t > > > fn2gtct_type;
+  fn2gtct_type fn2gtct;
+  for ( size_t i=0; i<t.size(); ++i )
   {
-    frame_handle_list_type f = track_oracle_core::get_frames( t[i] );
-    if (f.size() != 1)
+    if (t_snap.n_frames( i ) != 1)
     {
-      LOG_ERROR( main_logger, "Logic error: detection mode track had " << f.size() << " frames?" );
+      LOG_ERROR( main_logger, "Logic error: detection mode track had " << t_snap.n_frames( i ) << " frames?" );
       return;
     }
-    track_oracle::dt::tracking::frame_number::Type frame_number = fn( f[0].row );
-    i_t probe = fn2gtct.find( frame_number );
-    if (probe == fn2gtct.end())
-    {
-      pair< track_handle_list_type, track_handle_list_type > e;
-      e.first.push_back( t[i] );
-      fn2gtct[ frame_number ] = e;
-    }
-    else
-    {
-      probe->second.first.push_back( t[i] );
-    }
+    fn2gtct[ t_snap.frame_numbers[ t_snap.track_begin[i] ] ].first.push_back( i );
   }
 
   LOG_INFO( main_logger, "Aligned truth; found " << fn2gtct.size() << " unique frame numbers" );
 
-  for ( unsigned i=0; i<c.size(); ++i )
+  for ( size_t i=0; i<c.size(); ++i )
   {
-    frame_handle_list_type f = track_oracle_core::get_frames( c[i] );
-    if (f.size() != 1)
+    if (c_snap.n_frames( i ) != 1)
     {
-      LOG_ERROR( main_logger, "Logic error: detection mode track had " << f.size() << " frames?" );
+      LOG_ERROR( main_logger, "Logic error: detection mode track had " << c_snap.n_frames( i ) << " frames?" );
       return;
     }
-    track_oracle::dt::tracking::frame_number::Type frame_number = fn( f[0].row );
-    i_t probe = fn2gtct.find( frame_number );
-    if (probe == fn2gtct.end())
+    fn2gtct[ c_snap.frame_numbers[ c_snap.track_begin[i] ] ].second.push_back( i );
+  }
+  LOG_INFO( main_logger, "Aligned truth and computed; found " << fn2gtct.size() << " unique frame numbers" );
+
+  // visit the frames in frame number order
+  vector< const fn2gtct_type::value_type* > frames;
+  frames.reserve( fn2gtct.size() );
+  for (fn2gtct_type::const_iterator i=fn2gtct.begin(); i != fn2gtct.end(); ++i)
+  {
+    frames.push_back( &(*i) );
+  }
+  sort( frames.begin(), frames.end(),
+        []( const fn2gtct_type::value_type* lhs, const fn2gtct_type::value_type* rhs )
+        { return lhs->first < rhs->first; } );
+
+  // Radial overlaps have no boxes to grid; compare all pairs on the frame
+  bool use_grid = (this->params.radial_overlap < 0.0);
+
+  unsigned n_threads = phase1_thread_count( this->params );
+  if (n_threads > 1)
+  {
+    LOG_INFO( main_logger, "phase 1: comparing detections on " << n_threads << " threads" );
+  }
+
+  // results[f] holds ((truth index, computed index), score) for the matches on frames[f]
+  vector< vector< pair< pair< size_t, size_t >, track2track_score > > > results( frames.size() );
+  vul_timer timer;
+  size_t counter = 0;
+  mutex log_mutex;
+
+  parallel_for( n_threads, frames.size(), [&]( size_t f )
+  {
+    const vector< size_t >& t_frame = frames[f]->second.first;
+    const vector< size_t >& c_frame = frames[f]->second.second;
+
+    vector< pair< size_t, size_t > > pairs;
+    if ( use_grid )
     {
-      pair< track_handle_list_type, track_handle_list_type > e;
-      e.second.push_back( c[i] );
-      fn2gtct[ frame_number ] = e;
+      pairs = detection_grid_candidates( t_frame, c_frame, t_snap, c_snap, this->params );
     }
     else
     {
-      probe->second.second.push_back( c[i] );
+      for (size_t ii=0; ii<t_frame.size(); ++ii)
+      {
+        for (size_t jj=0; jj<c_frame.size(); ++jj)
+        {
+          pairs.push_back( make_pair( t_frame[ii], c_frame[jj] ));
+        }
+      }
     }
-  }
-  LOG_INFO( main_logger, "Aligned truth and computed; found " << fn2gtct.size() << " unique frame numbers" );
 
-  vul_timer timer;
-  size_t counter=0;
-  for (i_t i=fn2gtct.begin(); i != fn2gtct.end(); ++i)
-  {
+    for (size_t k=0; k<pairs.size(); ++k)
+    {
+      size_t i = pairs[k].first, j = pairs[k].second;
+      if ( t_mask && ( ! masks_intersect( (*t_mask)[i], (*c_mask)[j] ))) continue;
+      if ( this->t2t.find( make_pair( t[i], c[j] )) != this->t2t.end() ) continue;
+
+      track2track_score t2t_score;
+      if ( t2t_score.compute( t_snap.view( i ), c_snap.view( j ), this->params ))
+      {
+        results[f].push_back( make_pair( pairs[k], t2t_score ));
+      }
+    }
+
+    lock_guard< mutex > lock( log_mutex );
+    ++counter;
     if (timer.real() > 5 * 1000)
     {
-      LOG_INFO( main_logger, "phase 1: " << counter << " of " << fn2gtct.size() << "..." );
+      LOG_INFO( main_logger, "phase 1: " << counter << " of " << frames.size() << "..." );
       timer.mark();
     }
-    ++counter;
-    const track_handle_list_type& t_frame = i->second.first;
-    const track_handle_list_type& c_frame = i->second.second;
+  });
 
-    for (size_t ii=0; ii<t_frame.size(); ++ii)
+  vector< t2t_type::value_type > matches;
+  for (size_t f=0; f<results.size(); ++f)
+  {
+    for (size_t k=0; k<results[f].size(); ++k)
     {
-      for (size_t jj=0; jj<c_frame.size(); ++jj)
-      {
-        this->compute_single( t_frame[ii], c_frame[jj] );
-      }
+      const pair< pair< size_t, size_t >, track2track_score >& r = results[f][k];
+      matches.push_back( make_pair( make_pair( t[ r.first.first ], c[ r.first.second ] ), r.second ));
     }
   }
+  this->store_matches( matches );
 }
 
 bool
@@ -1074,30 +2170,168 @@ track2track_phase1
   bool b = t2t_score.compute( t, c, params );
   if ( b )
   {
-    this->t2t[ key ] = t2t_score;
+    if ( this->params.keep_frame_overlaps )
+    {
+      t2t_score.move_overlaps_to( this->overlap_arena );
+    }
+    else
+    {
+      t2t_score.drop_overlaps();
+    }
+    this->t2t.insert( make_pair( key, t2t_score ));
   }
 
 #if QF_DBG
-  if ((qf_check <= 0) && (! t2t_score.frame_overlaps.empty()))
+  if ((qf_check <= 0) && (t2t_score.n_frame_overlaps() > 0))
   {
     static scorable_track_type local_track_view;
     unsigned t_id = local_track_view(t).external_id();
     unsigned c_id = local_track_view(c).external_id();
     LOG_ERROR( main_logger, "QF mismatch: qf check " << qf_check << " vs full " <<
-               t2t_score.frame_overlaps.size() << " overlap frames : t " << t_id << " c " << c_id);
+               t2t_score.n_frame_overlaps() << " overlap frames : t " << t_id << " c " << c_id);
   }
 #endif
 
   return b;
 }
 
+track2track_phase1_sweep
+::track2track_phase1_sweep( const phase1_parameters& params )
+  : base_params( params )
+{
+  if ( params.radial_overlap >= 0.0 )
+  {
+    throw runtime_error( "Phase 1 sweeps don't support radial overlap" );
+  }
+}
+
+void
+track2track_phase1_sweep
+::compute_all( const track_handle_list_type& t,
+               const track_handle_list_type& c )
+{
+  check_track_list_alignment( t, c, this->base_params );
+
+  LOG_INFO( main_logger, "Adding quickfilter boxes to " << t.size() << " truth tracks..." );
+  quickfilter_box_type::add_quickfilter_boxes( t, this->base_params );
+  LOG_INFO( main_logger, "Adding quickfilter boxes to " << c.size() << " computed tracks..." );
+  quickfilter_box_type::add_quickfilter_boxes( c, this->base_params );
+
+  LOG_INFO( main_logger, "Snapshotting frames of " << t.size() << " truth and " << c.size() << " computed tracks..." );
+  this->t_snap = track2track_frame_snapshot( t );
+  this->c_snap = track2track_frame_snapshot( c );
+
+  // remember the match state the AOI filter left, so that select()
+  // can undo the previous select()'s marks
+  scorable_track_type local_track_view;
+  const track2track_frame_snapshot* snaps[2] = { &this->t_snap, &this->c_snap };
+  vector< unsigned char >* states[2] = { &this->t_initial_match_state, &this->c_initial_match_state };
+  for (size_t s=0; s<2; ++s)
+  {
+    states[s]->resize( snaps[s]->frames.size() );
+    for (size_t k=0; k<snaps[s]->frames.size(); ++k)
+    {
+      pair< bool, int > probe = local_track_view.frame_has_been_matched.get( snaps[s]->frames[k].row );
+      (*states[s])[k] = static_cast< unsigned char >( probe.first ? probe.second : static_cast< int >( IN_AOI_UNMATCHED ));
+    }
+  }
+
+  vector< vector< size_t > > candidates =
+    temporal_candidates( this->t_snap, this->c_snap, this->base_params.frame_alignment_time_window_usecs );
+
+  unsigned n_threads = phase1_thread_count( this->base_params );
+  LOG_INFO( main_logger, "phase 1 sweep: collecting overlaps on " << n_threads << " thread(s)" );
+
+  vector< vector< candidate_pair > > results( t.size() );
+  parallel_for( n_threads, t.size(), [&]( size_t i )
+  {
+    track2track_frame_view t_view = this->t_snap.view( i );
+    for (size_t k=0; k<candidates[i].size(); ++k)
+    {
+      candidate_pair p;
+      p.t_index = i;
+      p.c_index = candidates[i][k];
+      track2track_score scratch;
+      scratch.collect_nonzero_overlaps( t_view, this->c_snap.view( p.c_index ), this->base_params,
+                                        p.overlaps, p.alignments );
+      if ( ! p.overlaps.empty() )
+      {
+        results[i].push_back( p );
+      }
+    }
+  });
+
+  this->pairs.clear();
+  size_t n_overlaps = 0;
+  for (size_t i=0; i<results.size(); ++i)
+  {
+    for (size_t k=0; k<results[i].size(); ++k)
+    {
+      n_overlaps += results[i][k].overlaps.size();
+      this->pairs.push_back( candidate_pair() );
+      this->pairs.back().t_index = results[i][k].t_index;
+      this->pairs.back().c_index = results[i][k].c_index;
+      this->pairs.back().overlaps.swap( results[i][k].overlaps );
+      this->pairs.back().alignments.swap( results[i][k].alignments );
+    }
+    vector< candidate_pair >().swap( results[i] );
+  }
+  LOG_INFO( main_logger, "phase 1 sweep: " << this->pairs.size() << " track pairs with "
+            << n_overlaps << " non-empty frame overlaps" );
+}
+
+void
+track2track_phase1_sweep
+::select( track2track_phase1& p1 ) const
+{
+  if ( ! p1.t2t.empty() )
+  {
+    throw runtime_error( "Phase 1 sweep: select() requires an empty association matrix" );
+  }
+  if ( ! same_overlap_geometry( this->base_params, p1.params ))
+  {
+    throw runtime_error( "Phase 1 sweep: only the frame filters and min-frames policy may vary" );
+  }
+
+  // reset the frames to their pre-phase-1 state
+  scorable_track_type local_track_view;
+  for (size_t k=0; k<this->t_snap.frames.size(); ++k)
+  {
+    local_track_view[ this->t_snap.frames[k] ].frame_has_been_matched() = this->t_initial_match_state[k];
+  }
+  for (size_t k=0; k<this->c_snap.frames.size(); ++k)
+  {
+    local_track_view[ this->c_snap.frames[k] ].frame_has_been_matched() = this->c_initial_match_state[k];
+  }
+
+  vector< track2track_score > scores( this->pairs.size() );
+  vector< unsigned char > matched( this->pairs.size() );
+  parallel_for( phase1_thread_count( p1.params ), this->pairs.size(), [&]( size_t k )
+  {
+    const candidate_pair& p = this->pairs[k];
+    matched[k] = scores[k].select_overlaps( this->t_snap.view( p.t_index ), this->c_snap.view( p.c_index ),
+                                            p.overlaps, p.alignments, p1.params ) ? 1 : 0;
+  });
+
+  // pairs are in truth-track order, so this matches compute_all's merge
+  vector< track2track_phase1::t2t_type::value_type > matches;
+  for (size_t k=0; k<this->pairs.size(); ++k)
+  {
+    if ( ! matched[k] ) continue;
+    const candidate_pair& p = this->pairs[k];
+    matches.push_back( make_pair( make_pair( this->t_snap.tracks[ p.t_index ], this->c_snap.tracks[ p.c_index ] ),
+                                  scores[k] ));
+  }
+  p1.store_matches( matches );
+}
+
 ts_type
 track2track_phase1
 ::min_ts() const
 {
   ts_type min = 0;
 
-  typedef map< track2track_type, track2track_score >::const_iterator t2t_cit;
+  typedef t2t_type::const_iterator t2t_cit;
   for (t2t_cit i=this->t2t.begin(); i != this->t2t.end(); ++i)
   {
     if ( (i == this->t2t.begin()) || (i->second.overlap_frame_range.first < min))
@@ -1108,6 +2342,26 @@ track2track_phase1
   return min;
 }
 
+void
+track2track_phase1
+::materialize_state_flags( const track_handle_list_type& tracks )
+{
+  scorable_track_type local_track_view;
+  track_field< kwiver::track_oracle::dt::utility::state_flags > track_flags;
+  for (size_t i=0; i<tracks.size(); ++i)
+  {
+    frame_handle_list_type frames = track_oracle_core::get_frames( tracks[i] );
+    for (size_t j=0; j<frames.size(); ++j)
+    {
+      pair< bool, int > probe = local_track_view.frame_has_been_matched.get( frames[j].row );
+      if ( probe.first && ( probe.second == IN_AOI_MATCHED ))
+      {
+        track_flags( frames[j].row ).set_flag( "ATTR_SCORING_STATE_MATCHED" );
+      }
+    }
+  }
+}
+
 void
 track2track_phase1
 ::debug_dump( const track_handle_list_type& gt_list,
@@ -1140,13 +2394,13 @@ track2track_phase1
   // track
   map< oracle_entry_handle_type, oracle_entry_handle_type > matched_computed_frame_map;
 
-  typedef map< track2track_type, track2track_score >::const_iterator t2t_cit;
+  typedef t2t_type::const_iterator t2t_cit;
   for (t2t_cit i=this->t2t.begin(); i != this->t2t.end(); ++i)
   {
     const track_handle_type& gt_handle = i->first.first;
-    for (unsigned j=0; j<i->second.frame_overlaps.size(); ++j)
+    for (unsigned j=0; j<i->second.n_frame_overlaps(); ++j)
     {
-      const track2track_frame_overlap_record& r = i->second.frame_overlaps[j];
+      const track2track_compact_overlap_record& r = i->second.compact_overlap( j );
       matched_computed_frame_map[ r.computed_frame.row ] = gt_handle.row;
     }
   }
@@ -1188,19 +2442,25 @@ track2track_phase1
   // set the y-axis accordingly
   // track
   {
-    for (unsigned i=0; i<ct_list.size(); ++i)
+    // key = computed track, val = (key = ground-truth track, val = number
+    // of frames matched to that track); filled from the rows of the
+    // ground-truth tracks, rather than probing every gt x computed pair
+    map< oracle_entry_handle_type, map< oracle_entry_handle_type, unsigned > > census_by_computed;
+    for (unsigned j=0; j<gt_list.size(); ++j)
     {
-      // key = ground-truth track, val = number of frames matched to that track
-      map< oracle_entry_handle_type, unsigned > matched_track_census;
-      for (unsigned j=0; j<gt_list.size(); ++j)
+      size_t row = this->t2t.truth_index( gt_list[j] );
+      if ( row == t2t_type::npos ) continue;
+      for (t2t_cit probe = this->t2t.row_begin( row ); probe != this->t2t.row_end( row ); ++probe)
       {
-        track2track_type key( gt_list[j], ct_list[i] );
-        t2t_cit probe = this->t2t.find( key );
-        if (probe != this->t2t.end())
-        {
-          matched_track_census[ gt_list[j].row ] += probe->second.frame_overlaps.size();
-        }
+        census_by_computed[ probe->first.second.row ][ gt_list[j].row ] += probe->second.n_frame_overlaps();
       }
+    }
+
+    for (unsigned i=0; i<ct_list.size(); ++i)
+    {
+      // key = ground-truth track, val = number of frames matched to that track
+      const map< oracle_entry_handle_type, unsigned >& matched_track_census =
+        census_by_computed[ ct_list[i].row ];
 
       // Naively, one would expect that at most one key to the census
       // will have more than half the total frames.  However, this
@@ -1307,21 +2567,26 @@ track2track_phase1
 ::matching_keys( const track2track_type& probe ) const
 {
   // exactly one of probe must be undefined.  The 'search' key is the other.
-  // Return a list of all t2t keys with the search key in that position.
+  // Return a list of all t2t keys with the search key in that position,
+  // in key order.
   bool first_is_undef = probe.second.is_valid();
-  track_handle_type k = (first_is_undef) ? probe.second : probe.first;
   vector< track2track_type > ret;
-  for (map< track2track_type, track2track_score >::const_iterator i = this->t2t.begin();
-       i != this->t2t.end();
-       ++i)
+  if ( first_is_undef )
+  {
+    size_t j = this->t2t.computed_index( probe.second );
+    if ( j == t2t_type::npos ) return ret;
+    for (size_t k=0; k<this->t2t.column_size( j ); ++k)
+    {
+      ret.push_back( this->t2t.column_entry( j, k ).first );
+    }
+  }
+  else
   {
-    bool hit =
-      first_is_undef
-      ? i->first.second == k
-      : i->first.first == k;
-    if ( hit )
+    size_t i = this->t2t.truth_index( probe.first );
+    if ( i == t2t_type::npos ) return ret;
+    for (t2t_type::const_iterator e = this->t2t.row_begin( i ); e != this->t2t.row_end( i ); ++e)
     {
-      ret.push_back( i->first );
+      ret.push_back( e->first );
     }
   }
   return ret;
@@ -1332,13 +2597,13 @@ track2track_phase1
 ::debug_dump( ostream & os )
 {
   scorable_track_type scorable_track;
-  typedef map< track2track_type, track2track_score >::const_iterator it;
+  typedef t2t_type::const_iterator it;
 
   os << "##Header####GT id : CP id : ([Frame Time GT]; [Frame Time CP]; Area_overlap; Percentage GT Overlap; Percentage CP Overlap),...." << endl;
   for ( it i = this->t2t.begin(); i != this->t2t.end(); ++i )
   {
     os << "GT " << scorable_track( i->first.first ).external_id() << " : CP " << scorable_track( i->first.second ).external_id();
-    vector< track2track_frame_overlap_record > const & frame_overlap = i->second.frame_overlaps;
+    vector< track2track_frame_overlap_record > const frame_overlap = i->second.frame_overlaps();
     for( unsigned int j = 0; j < frame_overlap.size(); ++j )
     {
       track2track_frame_overlap_record const & t2tfo = frame_overlap[j];
@@ -1384,7 +2649,7 @@ track2track_score
 
   ret.n_frames_src = track_oracle_core::get_n_frames( this->cached_truth_track );
   ret.n_frames_dst = track_oracle_core::get_n_frames( this->cached_comp_track );
-  ret.n_frames_overlap = this->frame_overlaps.size();
+  ret.n_frames_overlap = this->n_frame_overlaps();
   if (ret.n_frames_overlap == 0)
   {
     LOG_WARN( main_logger, "Creating overlap descriptor with zero overlap frames?" );
@@ -1394,9 +2659,9 @@ track2track_score
   bool overall_radial_flag = false;
   double sum_centroid_distance = 0.0;
   double sum_percentage_overlap = 0.0;
-  for (size_t i=0; i<this->frame_overlaps.size(); ++i)
+  for (size_t i=0; i<this->n_frame_overlaps(); ++i)
   {
-    const track2track_frame_overlap_record& r = this->frame_overlaps[i];
+    const track2track_frame_overlap_record r = this->frame_overlap( i );
     if (i == 0)
     {
       overall_radial_flag = r.truth_area < 0;
@@ -1457,7 +2722,7 @@ track2track_score
 
 
   unsigned n_frames_dst = track_oracle_core::get_n_frames( this->cached_comp_track );
-  unsigned n_frames_overlap = this->frame_overlaps.size();
+  unsigned n_frames_overlap = this->n_frame_overlaps();
   if (n_frames_overlap == 0)
   {
     LOG_WARN( main_logger, "Creating overlap descriptor with zero overlap frames?" );
@@ -1467,9 +2732,9 @@ track2track_score
   bool overall_radial_flag = false;
   double sum_centroid_distance = 0.0;
   double sum_percentage_overlap = 0.0;
-  for (size_t i=0; i<this->frame_overlaps.size(); ++i)
+  for (size_t i=0; i<this->n_frame_overlaps(); ++i)
   {
-    const track2track_frame_overlap_record& r = this->frame_overlaps[i];
+    const track2track_frame_overlap_record r = this->frame_overlap( i );
     if (i == 0)
     {
       overall_radial_flag = r.truth_area < 0;
@@ -15,6 +15,10 @@
 #include <algorithm>
 #include <utility>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <vgl/vgl_box_2d.h>
 #include <scoring_framework/score_core.h>
 #include <scoring_framework/phase1_parameters.h>
 #include <track_oracle/vibrant_descriptors/descriptor_overlap_type.h>
@@ -70,24 +74,183 @@ public:
   }
 };
 
+//
+// The compact form of a track2track_frame_overlap_record, as kept in a
+// track2track_overlap_arena: the areas and distances are single
+// precision and in_aoi is a bit in flags.  Radial overlaps' -1.0
+// sentinels survive the conversion exactly.
+//
+
+struct SCORE_CORE_EXPORT track2track_compact_overlap_record
+{
+public:
+  enum { IN_AOI = 0x01 };
+
+  kwto::frame_handle_type truth_frame;
+  kwto::frame_handle_type computed_frame;
+  unsigned int fL_frame_num;
+  unsigned int fR_frame_num;
+  float truth_area;
+  float computed_area;
+  float overlap_area;
+  float centroid_distance;
+  float center_bottom_distance;
+  unsigned char flags;
+
+  track2track_compact_overlap_record()
+    : fL_frame_num(0), fR_frame_num(0),
+      truth_area(0.0f), computed_area(0.0f), overlap_area(0.0f),
+      centroid_distance(0.0f), center_bottom_distance(0.0f),
+      flags( IN_AOI )
+  {}
+  explicit track2track_compact_overlap_record( const track2track_frame_overlap_record& r );
+
+  bool in_aoi() const { return (flags & IN_AOI) != 0; }
+  track2track_frame_overlap_record materialize() const;
+};
+
+//
+// The frame overlaps of all the track pairs matched in a phase 1 run,
+// end to end; each track2track_score refers to its run of records.
+//
+
+struct SCORE_CORE_EXPORT track2track_overlap_arena
+{
+public:
+  std::vector< track2track_compact_overlap_record > records;
+};
+
+//
+// One track's slice of a track2track_frame_snapshot (below): its frames
+// sorted by timestamp, with their timestamps, frame numbers and boxes,
+// plus the track's quickfilter box.  The pointers are into the
+// snapshot, which must outlive the view.
+//
+
+struct SCORE_CORE_EXPORT track2track_frame_view
+{
+public:
+  kwto::track_handle_type track;
+  size_t n_frames;
+  const ts_type* timestamps;
+  const unsigned* frame_numbers;
+  const unsigned char* has_box;
+  const vgl_box_2d<double>* boxes;
+  const kwto::frame_handle_type* frames;
+  bool qf_box_valid; // true if the quickfilter box is in image coordinates
+  vgl_box_2d<double> qf_box;
+
+  track2track_frame_view()
+    : n_frames( 0 ), timestamps( 0 ), frame_numbers( 0 ), has_box( 0 ),
+      boxes( 0 ), frames( 0 ), qf_box_valid( false )
+  {}
+};
+
+//
+// A read-only, columnar copy of the per-frame data phase 1 needs for a
+// list of tracks.  The frame columns are contiguous across all the
+// tracks; the frames of track i are [track_begin[i], track_begin[i+1])
+// and are sorted by timestamp.  Building one reads track_oracle; using
+// one does not, so that track pairs can be compared on worker threads
+// without chasing row handles.
+//
+
+struct SCORE_CORE_EXPORT track2track_frame_snapshot
+{
+public:
+  kwto::track_handle_list_type tracks;
+  std::vector< size_t > track_begin;  // tracks.size()+1 offsets into the frame columns
+
+  // per-frame columns
+  std::vector< ts_type > timestamps;
+  std::vector< unsigned > frame_numbers;
+  std::vector< unsigned char > has_box;
+  std::vector< vgl_box_2d<double> > boxes;
+  std::vector< kwto::frame_handle_type > frames;
+
+  // per-track columns
+  std::vector< unsigned char > qf_box_valid;
+  std::vector< vgl_box_2d<double> > qf_boxes;
+
+  track2track_frame_snapshot()
+    : track_begin( 1, 0 )
+  {}
+  explicit track2track_frame_snapshot( const kwto::track_handle_list_type& t );
+
+  size_t size() const { return tracks.size(); }
+  size_t n_frames( size_t i ) const { return track_begin[i+1] - track_begin[i]; }
+  track2track_frame_view view( size_t i ) const;
+};
+
+class phase1_cache;
+
 struct SCORE_CORE_EXPORT track2track_score
 {
 public:
   unsigned spatial_overlap_total_frames;
   ts_frame_range overlap_frame_range;
-  std::vector< track2track_frame_overlap_record > frame_overlaps;
   track2track_score()
     : spatial_overlap_total_frames(0),
-      overlap_frame_range(std::numeric_limits<ts_type>::max(),std::numeric_limits<ts_type>::max())
+      overlap_frame_range(std::numeric_limits<ts_type>::max(),std::numeric_limits<ts_type>::max()),
+      overlap_offset(0),
+      overlap_count(0)
   {
   }
 
+  // the kept frame overlaps, in compact form or materialized as
+  // full records.  Empty if phase 1 ran without keep_frame_overlaps;
+  // spatial_overlap_total_frames still holds their count.
+  size_t n_frame_overlaps() const;
+  const track2track_compact_overlap_record& compact_overlap( size_t i ) const;
+  track2track_frame_overlap_record frame_overlap( size_t i ) const;
+  std::vector< track2track_frame_overlap_record > frame_overlaps() const;
+
+  // append the frame overlaps to the arena and refer to them there
+  // from now on; does nothing if they're already in an arena
+  void move_overlaps_to( const std::shared_ptr< track2track_overlap_arena >& arena );
+
+  // discard the frame overlaps, keeping the aggregates
+  void drop_overlaps();
+
   // fill in the values given truth track t and computed track c
   // returns false if tracks are not in the AOI
   bool compute( kwto::track_handle_type t,
                 kwto::track_handle_type c,
                 const phase1_parameters& params );
 
+  // as above, but working from snapshotted frame data; does not touch
+  // track_oracle (unless radial overlap is requested) and does not
+  // mark any frames as matched; call mark_matched_frames() for that.
+  bool compute( const track2track_frame_view& t,
+                const track2track_frame_view& c,
+                const phase1_parameters& params );
+
+  // The two halves of compute( view, view, params ):
+  //
+  // collect_nonzero_overlaps() finds the aligned frames of t and c
+  // whose overlaps are non-empty and match the AOI, along with their
+  // (t index, c index) alignments.  This depends on the alignment,
+  // bbox expansion, AOI and radial parameters, but not on the
+  // per-frame filters or the min-frames policy.
+  //
+  // select_overlaps() applies those to the collected overlaps and
+  // fills in this score from the ones it keeps; returns false if the
+  // tracks don't match.
+  void collect_nonzero_overlaps( const track2track_frame_view& t,
+                                 const track2track_frame_view& c,
+                                 const phase1_parameters& params,
+                                 std::vector< track2track_frame_overlap_record >& overlaps,
+                                 std::vector< std::pair< size_t, size_t > >& alignments );
+
+  bool select_overlaps( const track2track_frame_view& t,
+                        const track2track_frame_view& c,
+                        const std::vector< track2track_frame_overlap_record >& overlaps,
+                        const std::vector< std::pair< size_t, size_t > >& alignments,
+                        const phase1_parameters& params );
+
+  // set frame_has_been_matched on the frames of the frame overlaps
+  void mark_matched_frames() const;
+
   // line up the two frame lists with a tolerance of match_window
   // and return a list of aligned frame handles
   std::vector< std::pair< kwto::frame_handle_type, kwto::frame_handle_type > >
@@ -100,6 +263,22 @@ public:
                                                             kwto::frame_handle_type f2,
                                                             const phase1_parameters& params );
 
+  // as above, for frame f1_index of t and frame f2_index of c; the
+  // frame handles in the returned record are left unset
+  track2track_frame_overlap_record compute_spatial_overlap( const track2track_frame_view& t,
+                                                            size_t f1_index,
+                                                            const track2track_frame_view& c,
+                                                            size_t f2_index,
+                                                            const phase1_parameters& params ) const;
+
+  // as above, for each of the aligned (t index, c index) frame pairs;
+  // the box arithmetic for all of them is done as one box_overlap_batch
+  void compute_spatial_overlaps( const track2track_frame_view& t,
+                                 const track2track_frame_view& c,
+                                 const std::vector< std::pair< size_t, size_t > >& aligned,
+                                 const phase1_parameters& params,
+                                 std::vector< track2track_frame_overlap_record >& overlaps ) const;
+
 #ifdef KWANT_ENABLE_MGRS
   // given two frames, return their radial overlap (throw if param not set)
   track2track_frame_overlap_record compute_radial_overlap( kwto::frame_handle_type f1,
@@ -118,9 +297,20 @@ public:
   void add_self_to_event_label_descriptor( kwto::descriptor_event_label_type& delt ) const;
 
 private:
+  // restores scores from its file
+  friend class phase1_cache;
+
   // cached for the descriptor
   kwto::track_handle_type cached_truth_track, cached_comp_track;
 
+  // The frame overlaps are in local_overlaps until move_overlaps_to()
+  // is called; after that, they're [overlap_offset, overlap_offset+overlap_count)
+  // of overlap_arena.
+  std::shared_ptr< const track2track_overlap_arena > overlap_arena;
+  size_t overlap_offset;
+  size_t overlap_count;
+  std::vector< track2track_compact_overlap_record > local_overlaps;
+
   bool move_a_up_to_b( unsigned& index,
                        const kwto::frame_handle_list_type& lagging_list,
                        unsigned fixed_index,
@@ -128,24 +318,165 @@ private:
                        double match_window );
 };
 
+//
+// The phase 1 results: a sparse (truth x computed) matrix of
+// track2track_scores.  Entries are stored in (truth, computed) key
+// order, which makes them CSR rows over the distinct truth tracks;
+// a transposed index lists each computed track's entries in truth
+// order.  The truth and computed tracks which appear in the matrix
+// are numbered densely, in handle order.
+//
+// The std::map operations the scoring code uses (find, begin / end,
+// size, insert) are supported with the same semantics and iteration
+// order.  Entries are read-only once inserted.  Lookups may run
+// concurrently; inserts may not, and invalidate iterators.
+//
+// A single insert is appended to a pending tail of the entries and
+// marks the row / column index stale.  find() is a binary search over
+// the sorted entries plus a probe of the pending keys, so it never
+// needs the index; the tail is merged and the index rebuilt (once,
+// under a lock) by the next begin() or row / column access.  A run of
+// find-then-insert calls is thus O(log n) per call.  An iterator
+// found while inserts are pending is also invalidated by that merge.
+// The batch insert and clear() merge and rebuild immediately.
+//
+
+class SCORE_CORE_EXPORT track2track_association_matrix
+{
+public:
+  typedef track2track_type key_type;
+  typedef track2track_score mapped_type;
+  typedef std::pair< track2track_type, track2track_score > value_type;
+  typedef std::vector< value_type >::const_iterator const_iterator;
+  typedef const_iterator iterator;
+
+  static const size_t npos = static_cast< size_t >( -1 );
+
+  track2track_association_matrix()
+    : n_sorted( 0 ), row_offsets( 1, 0 ), col_offsets( 1, 0 )
+  {}
+
+  const_iterator begin() const { ensure_index(); return entries.begin(); }
+  const_iterator end() const { return entries.end(); }
+  size_t size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+  size_t count( const key_type& key ) const { return (this->find( key ) == this->end()) ? 0 : 1; }
+  const_iterator find( const key_type& key ) const;
+
+  // as std::map::insert: does nothing if the key is already present
+  std::pair< const_iterator, bool > insert( const value_type& v );
+
+  // insert all of v as one merge; as above, keys already present (or
+  // repeated earlier in v) are skipped.  Returns whether each element
+  // of v was inserted.
+  std::vector< bool > insert( const std::vector< value_type >& v );
+
+  void clear();
+
+  // dense numbering of the tracks with entries
+  size_t n_truth() const { ensure_index(); return truth_tracks.size(); }
+  size_t n_computed() const { ensure_index(); return computed_tracks.size(); }
+  kwto::track_handle_type truth_track( size_t i ) const { ensure_index(); return truth_tracks[i]; }
+  kwto::track_handle_type computed_track( size_t j ) const { ensure_index(); return computed_tracks[j]; }
+  size_t truth_index( const kwto::track_handle_type& t ) const;     // or npos
+  size_t computed_index( const kwto::track_handle_type& c ) const;  // or npos
+
+  // row i: the entries for truth track i, in computed-handle order
+  const_iterator row_begin( size_t i ) const { ensure_index(); return entries.begin() + row_offsets[i]; }
+  const_iterator row_end( size_t i ) const { ensure_index(); return entries.begin() + row_offsets[i+1]; }
+
+  // column j: the entries for computed track j, in truth-handle order
+  size_t column_size( size_t j ) const { ensure_index(); return col_offsets[j+1] - col_offsets[j]; }
+  const value_type& column_entry( size_t j, size_t k ) const
+  { ensure_index(); return entries[ col_entries[ col_offsets[j]+k ]]; }
+
+private:
+  // The staleness flag and the lock guarding the rebuild; copies get
+  // their own lock.
+  struct index_state
+  {
+    std::mutex rebuild_lock;
+    std::atomic< bool > stale;
+    index_state(): stale( false ) {}
+    index_state( const index_state& other ): stale( other.stale.load() ) {}
+    index_state& operator=( const index_state& other ) { stale.store( other.stale.load() ); return *this; }
+  };
+
+  // [0, n_sorted) are sorted by key; the rest are single inserts,
+  // in insertion order, whose offsets are in pending
+  mutable std::vector< value_type > entries;
+  mutable size_t n_sorted;
+  mutable std::map< key_type, size_t > pending;
+  mutable std::vector< kwto::track_handle_type > truth_tracks, computed_tracks;  // sorted
+  mutable std::vector< size_t > row_offsets;    // n_truth()+1 offsets into entries
+  mutable std::vector< size_t > col_offsets;    // n_computed()+1 offsets into col_entries
+  mutable std::vector< size_t > col_entries;    // indices into entries, grouped by column
+  mutable index_state index_sync;
+
+  void ensure_index() const
+  {
+    if ( index_sync.stale.load( std::memory_order_acquire )) this->rebuild_index();
+  }
+  void rebuild_index() const;
+  void merge_pending() const;
+  const_iterator find_unindexed( const key_type& key ) const;
+};
+
 struct SCORE_CORE_EXPORT track2track_phase1
 {
 public:
+  typedef track2track_association_matrix t2t_type;
+
   // key: (gt_handle, computed_handle)   value: resulting t2t_score
-  std::map< track2track_type, track2track_score > t2t;
+  t2t_type t2t;
+
+  // the frame overlaps of the scores in t2t
+  std::shared_ptr< track2track_overlap_arena > overlap_arena;
 
   track2track_phase1()
+    : overlap_arena( new track2track_overlap_arena() )
   {}
   explicit track2track_phase1( const phase1_parameters& new_params):
+        overlap_arena( new track2track_overlap_arena() ),
         params(new_params)
   {}
 
+  // if params.n_threads > 1, truth tracks are spread across that many
+  // worker threads; the results are identical to the serial run.
   void compute_all( const kwto::track_handle_list_type& t,
                     const kwto::track_handle_list_type& c );
 
+  // as compute_all, but only tracks in the same partition are compared:
+  // t_partition[i] and c_partition[j] are the partitions of t[i] and c[j]
+  // (e.g. the paired gt/ct files they were loaded from.)  Each partition's
+  // candidate pairs are found independently, on the worker threads.
+  void compute_all_partitioned( const kwto::track_handle_list_type& t,
+                                const kwto::track_handle_list_type& c,
+                                const std::vector< unsigned >& t_partition,
+                                const std::vector< unsigned >& c_partition );
+
+  // as compute_all, but t[i] and c[j] are only compared if t_mask[i]
+  // and c_mask[j] share a set bit (e.g. one bit per activity, set for
+  // each activity which scores the track), so that a single run covers
+  // exactly the pairs which some activity scores.  The masks are
+  // checked in the candidate sweep, before any frames are compared.
+  typedef std::vector< bool > track_mask_type;
+  void compute_all_masked( const kwto::track_handle_list_type& t,
+                           const kwto::track_handle_list_type& c,
+                           const std::vector< track_mask_type >& t_mask,
+                           const std::vector< track_mask_type >& c_mask );
+
+  // as compute_all, but for single-frame tracks: frames are spread
+  // across the worker threads instead of truth tracks.
   void compute_all_detection_mode( const kwto::track_handle_list_type& t,
                                    const kwto::track_handle_list_type& c );
 
+  // as compute_all_masked, for single-frame tracks
+  void compute_all_detection_mode_masked( const kwto::track_handle_list_type& t,
+                                          const kwto::track_handle_list_type& c,
+                                          const std::vector< track_mask_type >& t_mask,
+                                          const std::vector< track_mask_type >& c_mask );
+
   bool compute_single( kwto::track_handle_type t, kwto::track_handle_type c);
 
   void debug_dump( const kwto::track_handle_list_type& gt_list,
@@ -159,7 +490,71 @@ public:
 
   ts_type min_ts() const;
 
+  // Phase 1 only records matches in the typed frame_has_been_matched
+  // field; this sets the ATTR_SCORING_STATE_MATCHED state flag on every
+  // frame of the tracks which has been matched.  Only needed when the
+  // tracks are to be written out (--write-tracks.)
+  static void materialize_state_flags( const kwto::track_handle_list_type& tracks );
+
   phase1_parameters params;
+
+private:
+  friend class track2track_phase1_sweep;
+
+  // the masks may be null, in which case every candidate pair is compared
+  void compute_selected( const kwto::track_handle_list_type& t,
+                         const kwto::track_handle_list_type& c,
+                         const std::vector< unsigned >& t_partition,
+                         const std::vector< unsigned >& c_partition,
+                         const std::vector< track_mask_type >* t_mask,
+                         const std::vector< track_mask_type >* c_mask );
+  void compute_selected_detection_mode( const kwto::track_handle_list_type& t,
+                                        const kwto::track_handle_list_type& c,
+                                        const std::vector< track_mask_type >* t_mask,
+                                        const std::vector< track_mask_type >* c_mask );
+
+  void store_matches( std::vector< t2t_type::value_type >& matches );
+};
+
+//
+// Phase 1 for a sweep over the per-frame match filters (iou,
+// min_pcent_overlap_gt_ct, min_bound_matching_area) and the
+// min_frames_policy.  compute_all() compares the tracks once, keeping
+// every non-empty overlap of every track pair; select() then fills in
+// a track2track_phase1 as if its compute_all() had been called with
+// its own params.
+//
+// Everything else (alignment window, bbox expansion, AOI) must be the
+// same in the base parameters and in each select(); select() throws
+// if it isn't.  Radial overlap isn't supported.
+//
+// Each select() resets the frame_has_been_matched flags to what they
+// were before compute_all(), then marks its own matches.
+//
+
+class SCORE_CORE_EXPORT track2track_phase1_sweep
+{
+public:
+  explicit track2track_phase1_sweep( const phase1_parameters& base_params );
+
+  void compute_all( const kwto::track_handle_list_type& t,
+                    const kwto::track_handle_list_type& c );
+
+  // p1.t2t must be empty; p1.params supplies the filters
+  void select( track2track_phase1& p1 ) const;
+
+private:
+  struct candidate_pair
+  {
+    size_t t_index, c_index;
+    std::vector< track2track_frame_overlap_record > overlaps;
+    std::vector< std::pair< size_t, size_t > > alignments;
+  };
+
+  phase1_parameters base_params;
+  track2track_frame_snapshot t_snap, c_snap;
+  std::vector< candidate_pair > pairs;
+  std::vector< unsigned char > t_initial_match_state, c_initial_match_state;
 };
 
 } // ...kwant
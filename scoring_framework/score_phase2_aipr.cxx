@@ -47,7 +47,7 @@ track2track_phase2_aipr
 
   //Add associations but as they come in check old ones to make sure they are not in
   //conflict. If they are in conflict remove the one with the bigger association value
-  for(map<track2track_type, track2track_score>::const_iterator p1_t2t_iter = p1.t2t.begin();
+  for(track2track_phase1::t2t_type::const_iterator p1_t2t_iter = p1.t2t.begin();
     p1_t2t_iter != p1.t2t.end();
     ++p1_t2t_iter)
   {
@@ -56,9 +56,10 @@ track2track_phase2_aipr
 
     //Give each blank association a value and a range
     double sum_of_L2_norms = 0;
+    vector<track2track_frame_overlap_record> const frame_overlaps = p1_t2t_iter->second.frame_overlaps();
     vector<track2track_frame_overlap_record>::const_iterator frame_overlap_iter;
-    for(frame_overlap_iter = p1_t2t_iter->second.frame_overlaps.begin();
-        frame_overlap_iter != p1_t2t_iter->second.frame_overlaps.end();
+    for(frame_overlap_iter = frame_overlaps.begin();
+        frame_overlap_iter != frame_overlaps.end();
         ++frame_overlap_iter)
     {
       sum_of_L2_norms += frame_overlap_iter->centroid_distance;
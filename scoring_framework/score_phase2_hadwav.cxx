@@ -6,10 +6,18 @@
 
 #include "score_tracks_hadwav.h"
 #include <cstdlib>
+#include <cstdint>
+#include <algorithm>
+#include <bitset>
+#include <unordered_map>
+#include <unordered_set>
 
 #include <track_oracle/core/state_flags.h>
 #include <stdexcept>
 
+#include <scoring_framework/parallel_for.h>
+#include <scoring_framework/sparse_assignment.h>
+
 #include <vital/logger/logger.h>
 static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __FILE__ ) );
 
@@ -22,16 +30,27 @@ using std::ostringstream;
 using std::pair;
 using std::runtime_error;
 using std::string;
+using std::unordered_map;
+using std::unordered_set;
+using std::vector;
 
 using kwiver::track_oracle::frame_handle_list_type;
 using kwiver::track_oracle::frame_handle_type;
+using kwiver::track_oracle::oracle_entry_handle_type;
 using kwiver::track_oracle::track_field;
 using kwiver::track_oracle::track_handle_list_type;
 using kwiver::track_oracle::track_handle_type;
 using kwiver::track_oracle::track_oracle_core;
 using kwiver::kwant::track2track_type;
+using kwiver::kwant::track2track_adjacency_hadwav;
 using kwiver::kwant::track2track_scalars_hadwav;
 using kwiver::kwant::scorable_track_type;
+using kwiver::kwant::IN_AOI_MATCHED;
+using kwiver::kwant::IN_AOI_UNMATCHED;
+using kwiver::kwant::OUTSIDE_AOI;
+using kwiver::kwant::parallel_for;
+using kwiver::kwant::sparse_assignment;
+using kwiver::kwant::ts_type;
 
 typedef map< track_handle_type, track_handle_list_type >::const_iterator t2t_it;
 
@@ -91,6 +110,265 @@ find_dominant( const map< track2track_type, track2track_scalars_hadwav >& t2t,
   return match_index;
 }
 
+//
+// Flatten one side's association map (t2c if src_is_truth, else c2t)
+// into adj, numbering the partners by their position in dst_map.
+//
+
+void
+build_adjacency( const map< track_handle_type, track_handle_list_type >& src_map,
+                 const map< track_handle_type, track_handle_list_type >& dst_map,
+                 const map< track2track_type, track2track_scalars_hadwav >& t2t,
+                 bool src_is_truth,
+                 track2track_adjacency_hadwav& adj )
+{
+  scorable_track_type scorable_track;
+
+  unordered_map< oracle_entry_handle_type, size_t > dst_ordinals;
+  for ( t2t_it i = dst_map.begin(); i != dst_map.end(); ++i )
+  {
+    dst_ordinals.insert( make_pair( i->first.row, dst_ordinals.size() ));
+  }
+
+  adj = track2track_adjacency_hadwav();
+  adj.row_begin.push_back( 0 );
+  for ( t2t_it i = src_map.begin(); i != src_map.end(); ++i )
+  {
+    adj.tracks.push_back( i->first );
+    adj.external_ids.push_back( scorable_track( i->first ).external_id() );
+    adj.lifetimes.push_back( scorable_track( i->first ).frames_in_aoi() );
+    for (size_t j = 0; j < i->second.size(); ++j)
+    {
+      const track_handle_type& partner = i->second[j];
+      track2track_type key = src_is_truth ? make_pair( i->first, partner ) : make_pair( partner, i->first );
+      map< track2track_type, track2track_scalars_hadwav >::const_iterator probe = t2t.find( key );
+      unordered_map< oracle_entry_handle_type, size_t >::const_iterator ord = dst_ordinals.find( partner.row );
+      if ( ( probe == t2t.end() ) || ( ord == dst_ordinals.end() ))
+      {
+        throw runtime_error( "Logic error: phase 2 association without a t2t entry" );
+      }
+      adj.partners.push_back( ord->second );
+      adj.frames_on_target.push_back( probe->second.computed_frames_on_target );
+    }
+    adj.row_begin.push_back( adj.partners.size() );
+  }
+}
+
+//
+// For each track of side, the ordinal (in the other side) of the
+// partner which dominates it: the first with the most frames on
+// target; or npos if it has no partners.  The tracks are independent
+// and are searched on n_threads threads.
+//
+
+vector< size_t >
+find_dominators( const track2track_adjacency_hadwav& side,
+                 unsigned n_threads,
+                 const char* side_name )
+{
+  vector< size_t > dominators( side.size(), track2track_adjacency_hadwav::npos );
+  vector< unsigned char > has_zero_frames( side.size(), 0 );
+  parallel_for( n_threads, side.size(), [&]( size_t k )
+  {
+    unsigned max_frames = 0;
+    for (size_t j = side.row_begin[k]; j < side.row_begin[k+1]; ++j)
+    {
+      if ( side.frames_on_target[j] == 0 )
+      {
+        has_zero_frames[k] = 1;
+      }
+      else if ( side.frames_on_target[j] > max_frames )
+      {
+        max_frames = side.frames_on_target[j];
+        dominators[k] = side.partners[j];
+      }
+    }
+  });
+
+  for (size_t k = 0; k < side.size(); ++k)
+  {
+    if ( has_zero_frames[k] )
+    {
+      LOG_ERROR( main_logger, "Logic error: " << side_name << " contains 0 computed frames on target?");
+      exit(1);
+    }
+  }
+  return dominators;
+}
+
+//
+// The frames of a list of tracks, numbered densely in list order, with
+// their match states.  Lets phase 2 mark frames in bitsets rather than
+// maps keyed on handles.  If a track appears twice in the list, its
+// frames are numbered twice but find() returns the first number.
+//
+
+class frame_table
+{
+public:
+  static const size_t npos = static_cast< size_t >( -1 );
+
+  // per-frame columns
+  vector< frame_handle_type > frames;
+  vector< ts_type > timestamps;
+  vector< unsigned char > match_states;
+
+  // the frames of tracks[i] are [track_begin[i], track_begin[i+1])
+  vector< size_t > track_begin;
+
+  explicit frame_table( const track_handle_list_type& tracks )
+    : track_begin( 1, 0 )
+  {
+    scorable_track_type scorable_track;
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+      frame_handle_list_type const f = track_oracle_core::get_frames( tracks[i] );
+      for (size_t j = 0; j < f.size(); ++j)
+      {
+        this->ordinals.insert( make_pair( f[j].row, this->frames.size() ));
+        this->frames.push_back( f[j] );
+        this->timestamps.push_back( scorable_track[ f[j] ].timestamp_usecs() );
+        this->match_states.push_back( static_cast< unsigned char >( scorable_track[ f[j] ].frame_has_been_matched() ));
+      }
+      this->track_begin.push_back( this->frames.size() );
+    }
+  }
+
+  size_t size() const { return this->frames.size(); }
+  size_t n_tracks() const { return this->track_begin.size() - 1; }
+
+  size_t find( const frame_handle_type& frame ) const
+  {
+    unordered_map< oracle_entry_handle_type, size_t >::const_iterator probe = this->ordinals.find( frame.row );
+    return ( probe == this->ordinals.end() ) ? npos : probe->second;
+  }
+
+  bool in_aoi( size_t i ) const
+  {
+    return ( this->match_states[i] == IN_AOI_UNMATCHED ) || ( this->match_states[i] == IN_AOI_MATCHED );
+  }
+
+  size_t count( int match_state ) const
+  {
+    return std::count( this->match_states.begin(), this->match_states.end(), static_cast< unsigned char >( match_state ));
+  }
+
+private:
+  unordered_map< oracle_entry_handle_type, size_t > ordinals;
+};
+
+const size_t frame_table::npos;
+
+//
+// The frame census at the end of phase 2: the distinct timestamps
+// (sorted) among the in-AOI truth frames and among the computed frames
+// in each match state.  All the frames' timestamps go into a
+// sorted dictionary and each category is a bitset over it.  The tracks
+// are split among n_threads workers, each filling its own bitsets,
+// which are OR-ed together and read back out at the end.  A computed frame
+// in an unknown match state throws (from the worker, rethrown by
+// parallel_for on the calling thread.)
+//
+
+enum census_category { GT_IN_AOI = 0, CT_MATCHED, CT_UNMATCHED, CT_OUTSIDE_AOI, N_CENSUS_CATEGORIES };
+
+struct census_chunk
+{
+  const frame_table* table;
+  bool is_truth;
+  size_t begin, end;  // frame ordinals, on track boundaries
+};
+
+void
+add_census_chunks( const frame_table& table, bool is_truth, unsigned n_chunks, vector< census_chunk >& chunks )
+{
+  size_t n = table.n_tracks();
+  if ( n_chunks > n ) n_chunks = static_cast< unsigned >( n );
+  for (unsigned k = 0; k < n_chunks; ++k)
+  {
+    census_chunk chunk;
+    chunk.table = &table;
+    chunk.is_truth = is_truth;
+    chunk.begin = table.track_begin[ k * n / n_chunks ];
+    chunk.end = table.track_begin[ (k+1) * n / n_chunks ];
+    chunks.push_back( chunk );
+  }
+}
+
+vector< vector< ts_type > >
+frame_census( const frame_table& gt, const frame_table& ct, unsigned n_threads )
+{
+  vector< ts_type > dict;
+  dict.reserve( gt.size() + ct.size() );
+  dict.insert( dict.end(), gt.timestamps.begin(), gt.timestamps.end() );
+  dict.insert( dict.end(), ct.timestamps.begin(), ct.timestamps.end() );
+  std::sort( dict.begin(), dict.end() );
+  dict.erase( std::unique( dict.begin(), dict.end() ), dict.end() );
+  size_t n_words = ( dict.size() + 63 ) / 64;
+
+  unsigned n_chunks = ( n_threads > 1 ) ? n_threads : 1;
+  vector< census_chunk > chunks;
+  add_census_chunks( gt, true, n_chunks, chunks );
+  add_census_chunks( ct, false, n_chunks, chunks );
+
+  vector< vector< uint64_t > > bits( chunks.size() * N_CENSUS_CATEGORIES );
+  parallel_for( n_threads, chunks.size(), [&]( size_t k )
+  {
+    const census_chunk& chunk = chunks[k];
+    vector< uint64_t >* b = &bits[ k * N_CENSUS_CATEGORIES ];
+    for (unsigned cat = 0; cat < N_CENSUS_CATEGORIES; ++cat)
+    {
+      b[cat].assign( n_words, 0 );
+    }
+
+    for (size_t i = chunk.begin; i < chunk.end; ++i)
+    {
+      // truth frames outside the AOI aren't counted; every computed
+      // frame must be in one of the match states
+      census_category cat;
+      if ( chunk.is_truth )
+      {
+        if ( ! chunk.table->in_aoi( i )) continue;
+        cat = GT_IN_AOI;
+      }
+      else
+      {
+        switch ( chunk.table->match_states[i] )
+        {
+        case IN_AOI_MATCHED:   cat = CT_MATCHED; break;
+        case IN_AOI_UNMATCHED: cat = CT_UNMATCHED; break;
+        case OUTSIDE_AOI:      cat = CT_OUTSIDE_AOI; break;
+        default:
+          throw runtime_error( "Unhandled frame match flag" );
+        }
+      }
+
+      size_t d = std::lower_bound( dict.begin(), dict.end(), chunk.table->timestamps[i] ) - dict.begin();
+      b[cat][ d / 64 ] |= ( static_cast< uint64_t >( 1 ) << ( d % 64 ));
+    }
+  });
+
+  // each category's timestamps come out of the dictionary in order
+  vector< vector< ts_type > > census( N_CENSUS_CATEGORIES );
+  for (unsigned cat = 0; cat < N_CENSUS_CATEGORIES; ++cat)
+  {
+    for (size_t w = 0; w < n_words; ++w)
+    {
+      uint64_t word = 0;
+      for (size_t k = 0; k < chunks.size(); ++k)
+      {
+        word |= bits[ k * N_CENSUS_CATEGORIES + cat ][w];
+      }
+      census[cat].reserve( census[cat].size() + std::bitset< 64 >( word ).count() );
+      for (unsigned b = 0; word != 0; ++b, word >>= 1)
+      {
+        if ( word & 1 ) census[cat].push_back( dict[ w*64 + b ] );
+      }
+    }
+  }
+  return census;
+}
+
 void
 debug_dump_output_key( ostream& os,
                        const track_handle_type& t )
@@ -139,6 +417,8 @@ debug_dump_entry( ostream& os,
 namespace kwiver {
 namespace kwant {
 
+const size_t track2track_adjacency_hadwav::npos;
+
 
 void
 track2track_phase2_hadwav
@@ -160,7 +440,7 @@ track2track_phase2_hadwav
     LOG_INFO( main_logger, "phase2: " << this->n_computed_tracks << " computed tracks");
   }
   // insert empty scalars
-  for (map< track2track_type, track2track_score>::const_iterator i = p1.t2t.begin();
+  for (track2track_phase1::t2t_type::const_iterator i = p1.t2t.begin();
        i != p1.t2t.end();
        ++i )
   {
@@ -178,87 +458,93 @@ track2track_phase2_hadwav
   // for each computed track: is it associated with any ground truth track?
   // raw material for MITRE's track continuity
 
-  size_t total_gt_boxes = 0;
-  size_t total_computed_boxes = 0;
-
-  size_t detected_gt_boxes = 0;
-
-  map<pair<track_handle_type, frame_handle_type>, bool> ct_frame_marker;
+  this->total_gt_boxes = 0;
+  this->total_computed_boxes = 0;
+  this->detected_gt_boxes = 0;
 
+  for (size_t g = 0; g < t.size(); ++g)
+  {
+    this->total_gt_boxes += scorable_track( t[g] ).frames_in_aoi();
+  }
   for (size_t i = 0; i < c.size(); ++i)
   {
-    track_handle_type const& ct = c[i];
-    frame_handle_list_type const frames = track_oracle_core::get_frames( ct );
-
-    total_computed_boxes += scorable_track( ct ).frames_in_aoi();
-
-    for (size_t f = 0; f < frames.size(); ++f)
-    {
-      frame_handle_type const& frame = frames[f];
-
-      ct_frame_marker[make_pair(ct, frame)] = false;
-    }
+    this->total_computed_boxes += scorable_track( c[i] ).frames_in_aoi();
   }
 
-  this->detectionFalseAlarms = total_computed_boxes;
+  frame_table gt_frames( t ), ct_frames( c );
 
-  for (size_t g = 0; g < t.size(); ++g)
+  if ( ! p1.params.keep_frame_overlaps )
   {
-    track_handle_type const& gt = t[g];
-    frame_handle_list_type const frames = track_oracle_core::get_frames( gt );
-
-    total_gt_boxes += scorable_track( gt ).frames_in_aoi();
-
-    map<frame_handle_type, bool> gt_frame_marker;
+    // If phase 1 didn't keep its frame overlap records, the matched
+    // frames are exactly the ones it flagged IN_AOI_MATCHED (assuming, as
+    // always, that phase 1 ran on these same truth and computed lists.)
+    this->detected_gt_boxes = gt_frames.count( IN_AOI_MATCHED );
+    this->detectionFalseAlarms = this->total_computed_boxes - ct_frames.count( IN_AOI_MATCHED );
+  }
+  else
+  {
+    //
+    // Walk the phase 1 matches a truth track at a time, marking each
+    // in-AOI truth frame (detected) and computed frame (not a false
+    // alarm) the first time an overlap covers it.  Only pairs whose
+    // tracks are both in (t, c) count; a truth track listed twice
+    // counts twice.
+    //
 
-    for (size_t f = 0; f < frames.size(); ++f)
+    unordered_map< oracle_entry_handle_type, size_t > gt_multiplicity;
+    for (size_t g = 0; g < t.size(); ++g)
     {
-      frame_handle_type const& frame = frames[f];
-      unsigned match_state = scorable_track[ frame ].frame_has_been_matched();
-      if ( ( match_state == IN_AOI_UNMATCHED ) ||
-           ( match_state == IN_AOI_MATCHED ))
-      {
-        gt_frame_marker[frame] = false;
-      }
+      ++gt_multiplicity[ t[g].row ];
     }
-
+    unordered_set< oracle_entry_handle_type > ct_set;
     for (size_t i = 0; i < c.size(); ++i)
     {
-      track_handle_type const& ct = c[i];
-      track2track_type const key = make_pair(gt, ct);
-      map<track2track_type, track2track_score>::const_iterator const probe = p1.t2t.find(key);
+      ct_set.insert( c[i].row );
+    }
 
-      if (probe == p1.t2t.end())
+    vector< bool > gt_detected( gt_frames.size() ), ct_matched( ct_frames.size() );
+    this->detectionFalseAlarms = this->total_computed_boxes;
+
+    for (size_t r = 0; r < p1.t2t.n_truth(); ++r)
+    {
+      unordered_map< oracle_entry_handle_type, size_t >::const_iterator m =
+        gt_multiplicity.find( p1.t2t.truth_track( r ).row );
+      if ( m == gt_multiplicity.end() )
       {
         continue;
       }
 
-      track2track_score const& score = probe->second;
-
-      for (size_t f = 0; f < score.frame_overlaps.size(); ++f)
+      for (track2track_phase1::t2t_type::const_iterator probe = p1.t2t.row_begin( r );
+           probe != p1.t2t.row_end( r );
+           ++probe )
       {
-        track2track_frame_overlap_record const& overlap = score.frame_overlaps[f];
-        unsigned match_state = scorable_track[ overlap.computed_frame ].frame_has_been_matched();
-        bool cp_is_in_aoi =  ( match_state == IN_AOI_UNMATCHED ) || ( match_state == IN_AOI_MATCHED );
-        match_state = scorable_track[ overlap.truth_frame ].frame_has_been_matched();
-        bool gt_is_in_aoi = ( match_state == IN_AOI_UNMATCHED ) || ( match_state == IN_AOI_MATCHED );
-        if(!(cp_is_in_aoi && gt_is_in_aoi))
+        if ( ct_set.find( probe->first.second.row ) == ct_set.end() )
         {
           continue;
         }
 
-        if (!gt_frame_marker[overlap.truth_frame])
-        {
-          ++detected_gt_boxes;
-          gt_frame_marker[overlap.truth_frame] = true;
-        }
-
-        pair<track_handle_type, frame_handle_type> const track_key = make_pair(ct, overlap.computed_frame);
-
-        if (!ct_frame_marker[track_key])
+        track2track_score const& score = probe->second;
+        for (size_t f = 0; f < score.n_frame_overlaps(); ++f)
         {
-          --this->detectionFalseAlarms;
-          ct_frame_marker[track_key] = true;
+          track2track_compact_overlap_record const& overlap = score.compact_overlap(f);
+          size_t gt_ord = gt_frames.find( overlap.truth_frame );
+          size_t ct_ord = ct_frames.find( overlap.computed_frame );
+          if ( ( gt_ord == frame_table::npos ) || ( ct_ord == frame_table::npos ) ||
+               ( ! gt_frames.in_aoi( gt_ord )) || ( ! ct_frames.in_aoi( ct_ord )) )
+          {
+            continue;
+          }
+
+          if ( ! gt_detected[ gt_ord ] )
+          {
+            gt_detected[ gt_ord ] = true;
+            this->detected_gt_boxes += m->second;
+          }
+          if ( ! ct_matched[ ct_ord ] )
+          {
+            ct_matched[ ct_ord ] = true;
+            --this->detectionFalseAlarms;
+          }
         }
       }
     }
@@ -271,7 +557,7 @@ track2track_phase2_hadwav
     track2track_type key = i->first;
     track_handle_type t_id = i->first.first;
     track_handle_type c_id = i->first.second;
-    map< track2track_type, track2track_score >::const_iterator p1_scores = p1.t2t.find( key );
+    track2track_phase1::t2t_type::const_iterator p1_scores = p1.t2t.find( key );
     if ( p1_scores == p1.t2t.end() )
     {
       continue;
@@ -302,179 +588,149 @@ track2track_phase2_hadwav
     }
   } // ...for all true/computed pairs
 
-  // compute dominators for targets
-  for ( map< track_handle_type, track_handle_list_type >::const_iterator i = this->t2c.begin();
-        i != this->t2c.end();
-        ++i )
+  build_adjacency( this->t2c, this->c2t, this->t2t, /* src_is_truth = */ true, this->truth_adjacency );
+  build_adjacency( this->c2t, this->t2c, this->t2t, /* src_is_truth = */ false, this->computed_adjacency );
+
+  // compute dominators for targets and for computed tracks; the
+  // partners are searched in parallel, then the flags are set
+  vector< size_t > target_dominators = find_dominators( this->truth_adjacency, this->n_threads, "c2t" );
+  vector< size_t > computed_dominators = find_dominators( this->computed_adjacency, this->n_threads, "t2c" );
+
+  for (size_t k = 0; k < target_dominators.size(); ++k)
   {
-    track_handle_type max_computed_track;
-    unsigned max_frames = 0;
-    const track_handle_list_type& tracks_on_target = i->second;
-    if ( ! tracks_on_target.empty() )
+    if ( target_dominators[k] == track2track_adjacency_hadwav::npos ) continue;
+    track2track_type key = make_pair( this->truth_adjacency.tracks[k], this->computed_adjacency.tracks[ target_dominators[k] ] );
+    this->t2t[ key ].target_is_dominated_by_computed = true;
+    if (this->verbose)
     {
-      for (unsigned j=0; j<tracks_on_target.size(); ++j)
-      {
-        track2track_type key = make_pair( i->first, tracks_on_target[j] );
-        map< track2track_type, track2track_scalars_hadwav >::const_iterator probe = this->t2t.find( key );
-        if ( probe == this->t2t.end() )
-        {
-          LOG_ERROR( main_logger, "Logic error: lost c2t pair?");
-          exit(1);
-        }
-        const track2track_scalars_hadwav& s = probe->second;
-        if ( s.computed_frames_on_target == 0 )
-        {
-          LOG_ERROR( main_logger, "Logic error: c2t contains 0 computed frames on target?");
-          exit(1);
-        }
-
-        if ( s.computed_frames_on_target > max_frames )
-        {
-          max_frames = s.computed_frames_on_target;
-          max_computed_track = tracks_on_target[j];
-        }
-      }
-      if ( max_computed_track.row == kwiver::track_oracle::INVALID_ROW_HANDLE )
-      {
-        LOG_ERROR( main_logger, "Logic error: c2t entry has no dominator?");
-        exit(1);
-      }
-      track2track_type key = make_pair( i->first, max_computed_track );
-      this->t2t[ key ].target_is_dominated_by_computed = true;
-      if (this->verbose)
-      {
-        LOG_INFO( main_logger, "phase2: target " << scorable_track( i->first ).external_id()
-                 << " is dominated by " << scorable_track( max_computed_track ).external_id()
-                 << "");
-      }
+      LOG_INFO( main_logger, "phase2: target " << this->truth_adjacency.external_ids[k]
+               << " is dominated by " << this->computed_adjacency.external_ids[ target_dominators[k] ]
+               << "");
     }
   } // .. for each target track
 
-  // compute dominators for computed tracks
-  for ( map< track_handle_type, track_handle_list_type >::const_iterator i = this->c2t.begin();
-        i != this->c2t.end();
-        ++i )
+  for (size_t k = 0; k < computed_dominators.size(); ++k)
   {
-    track_handle_type max_target_track;
-    unsigned max_frames = 0;
-    const track_handle_list_type& targets_on_track = i->second;
-    if ( ! targets_on_track.empty() )
+    if ( computed_dominators[k] == track2track_adjacency_hadwav::npos ) continue;
+    track2track_type key = make_pair( this->truth_adjacency.tracks[ computed_dominators[k] ], this->computed_adjacency.tracks[k] );
+    this->t2t[ key ].computed_is_dominated_by_target = true;
+    if (this->verbose)
     {
-      for (unsigned j=0; j<targets_on_track.size(); ++j)
-      {
-        track2track_type key = make_pair( targets_on_track[j], i->first );
-        map< track2track_type, track2track_scalars_hadwav >::const_iterator probe = this->t2t.find( key );
-        if ( probe == this->t2t.end() )
-        {
-          LOG_ERROR( main_logger, "Logic error: lost t2c pair?");
-          exit(1);
-        }
-        const track2track_scalars_hadwav& s = probe->second;
-        if ( s.computed_frames_on_target == 0 )
-        {
-          LOG_ERROR( main_logger, "Logic error: t2c contains 0 computed frames on target?");
-          exit(1);
-        }
-
-        if ( s.computed_frames_on_target > max_frames )
-        {
-          max_frames = s.computed_frames_on_target;
-          max_target_track = targets_on_track[j];
-        }
-      }
-      if ( max_target_track.row == kwiver::track_oracle::INVALID_ROW_HANDLE )
-      {
-        LOG_ERROR( main_logger, "Logic error: t2c entry has no dominator?");
-        exit(1);
-      }
-      track2track_type key = make_pair( max_target_track, i->first );
-      this->t2t[ key ].computed_is_dominated_by_target = true;
-      if (this->verbose)
-      {
-        unsigned id = scorable_track( i->first ).external_id();
-        unsigned max_id = scorable_track( max_target_track ).external_id();
-        LOG_INFO( main_logger, "phase2: (computed) track " << id << " is dominated by " << max_id << "");
-      }
+      unsigned id = this->computed_adjacency.external_ids[k];
+      unsigned max_id = this->truth_adjacency.external_ids[ computed_dominators[k] ];
+      LOG_INFO( main_logger, "phase2: (computed) track " << id << " is dominated by " << max_id << "");
     }
   } // .. for each computed track
 
-  scorable_track_type trk;
-  map< ts_type, bool > gt_frame_map, ct_frame_matched_map, ct_frame_unmatched_map, ct_frame_outside_aoi_map;
-
-  track_field< kwiver::track_oracle::dt::utility::state_flags > state_flags;
-
-  for (unsigned i = 0; i < t.size(); ++i )
+  if ( this->one_to_one )
   {
-    const frame_handle_list_type& frames = track_oracle_core::get_frames( t[i] );
-    for (unsigned j = 0; j < frames.size(); ++j )
+    // rows are p1's truth tracks, columns its computed tracks; the
+    // edges are the associated pairs, weighted by frames on target
+    sparse_assignment lap;
+    lap.n_cols = p1.t2t.n_computed();
+    for (size_t r = 0; r < p1.t2t.n_truth(); ++r)
     {
-      unsigned match_state = trk[ frames[j] ].frame_has_been_matched();
-      if ( ( match_state == IN_AOI_UNMATCHED ) ||
-           ( match_state == IN_AOI_MATCHED ))
+      for (track2track_phase1::t2t_type::const_iterator probe = p1.t2t.row_begin( r );
+           probe != p1.t2t.row_end( r );
+           ++probe )
       {
-        gt_frame_map[ trk[frames[j]].timestamp_usecs() ] = true;
+        if ( probe->second.spatial_overlap_total_frames > 0 )
+        {
+          lap.add_edge( p1.t2t.computed_index( probe->first.second ), probe->second.spatial_overlap_total_frames );
+        }
       }
+      lap.end_row();
     }
-  }
+    this->assignedFrames = lap.solve( this->n_threads );
 
-  unsigned n_comp_tracks_no_match = 0;
-  for (unsigned i = 0; i < c.size(); ++i )
-  {
-    bool this_track_matched = false;
-    const frame_handle_list_type& frames = track_oracle_core::get_frames( c[i] );
-    for (unsigned j = 0; j < frames.size(); ++j )
-    {
-      ts_type this_ts = trk[ frames[j] ].timestamp_usecs();
-      switch (trk[ frames[j] ].frame_has_been_matched() )
-      {
-      case IN_AOI_MATCHED:
-        state_flags( frames[j].row ).set_flag( "in-aoi", "true" );
-        state_flags( frames[j].row ).set_flag( "matched", "true" );
-        ct_frame_matched_map[ this_ts ] = true;
-        this_track_matched = true;
-        break;
-
-      case IN_AOI_UNMATCHED:
-        state_flags( frames[j].row ).set_flag( "in-aoi", "true" );
-        state_flags( frames[j].row ).set_flag( "matched", "false" );
-        ct_frame_unmatched_map[ this_ts ] = true;
-        break;
-
-      case OUTSIDE_AOI:
-        state_flags( frames[j].row ).set_flag( "in-aoi", "false" );
-        state_flags( frames[j].row ).set_flag( "matched", "n/a" );
-        ct_frame_outside_aoi_map[ this_ts ] = true;
-        break;
-
-      default:
-        throw runtime_error( "Unhandled frame match flag" );
-      }
-    }
-    if ( ! this_track_matched )
+    this->n_assigned_pairs = 0;
+    for (size_t r = 0; r < lap.n_rows(); ++r)
     {
-      ++n_comp_tracks_no_match;
+      if ( lap.col_for_row[r] == sparse_assignment::npos ) continue;
+      track2track_type key = make_pair( p1.t2t.truth_track( r ), p1.t2t.computed_track( lap.col_for_row[r] ));
+      this->t2t[ key ].computed_assigned_to_target = true;
+      ++this->n_assigned_pairs;
     }
+    LOG_INFO( main_logger, "phase2: one-to-one assignment: " << this->n_assigned_pairs << " pairs, "
+              << this->assignedFrames << " frames on target" );
   }
 
-  int num_gt_frames = gt_frame_map.size();
-  int num_comp_frames_with_unique_associations = ct_frame_matched_map.size();
-  int num_comp_frames_with_no_associations = ct_frame_unmatched_map.size();
-  int num_comp_frames = num_comp_frames_with_unique_associations + num_comp_frames_with_no_associations;
+  vector< vector< ts_type > > census = frame_census( gt_frames, ct_frames, this->n_threads );
+
+  this->gt_frame_timestamps.swap( census[ GT_IN_AOI ] );
+  this->computed_frame_matched_timestamps.swap( census[ CT_MATCHED ] );
+  this->computed_frame_unmatched_timestamps.swap( census[ CT_UNMATCHED ] );
+  this->n_gt_frames = this->gt_frame_timestamps.size();
+  this->n_computed_frames_matched = this->computed_frame_matched_timestamps.size();
+  this->n_computed_frames_unmatched = this->computed_frame_unmatched_timestamps.size();
+  size_t num_comp_frames = this->n_computed_frames_matched + this->n_computed_frames_unmatched;
 
-  LOG_INFO( main_logger, "n-gt-detections: " << total_gt_boxes );
-  LOG_INFO( main_logger, "n-comp-detections: " << total_computed_boxes );
-  LOG_INFO( main_logger, "n-gt-frames:  " << num_gt_frames );
+  LOG_INFO( main_logger, "n-gt-detections: " << this->total_gt_boxes );
+  LOG_INFO( main_logger, "n-comp-detections: " << this->total_computed_boxes );
+  LOG_INFO( main_logger, "n-gt-frames:  " << this->n_gt_frames );
   LOG_INFO( main_logger, "n-comp-frames: " << num_comp_frames );
-  LOG_INFO( main_logger, "n-comp-frames-unique-match: " << num_comp_frames_with_unique_associations );
-  LOG_INFO( main_logger, "n-comp-frames-no-match: " << num_comp_frames_with_no_associations );
-  LOG_INFO( main_logger, "n-comp-frames-outside-aoi: " << ct_frame_outside_aoi_map.size() );
+  LOG_INFO( main_logger, "n-comp-frames-unique-match: " << this->n_computed_frames_matched );
+  LOG_INFO( main_logger, "n-comp-frames-no-match: " << this->n_computed_frames_unmatched );
+  LOG_INFO( main_logger, "n-comp-frames-outside-aoi: " << census[ CT_OUTSIDE_AOI ].size() );
+
+  this->compute_metrics();
+
+  // keep the computed frames' match states for materialize_state_flags()
+  this->computed_frames.swap( ct_frames.frames );
+  this->computed_frame_states.swap( ct_frames.match_states );
+}
 
-  this->framePD = (num_gt_frames == 0) ? 0.0 : 1.0 * num_comp_frames_with_unique_associations / num_gt_frames;
-  this->frameFA = 1.0 * num_comp_frames_with_no_associations;
-  this->trackFramePrecision = (num_comp_frames == 0) ? 0.0 : 1.0 * num_comp_frames_with_unique_associations / num_comp_frames;
-  this->detectionPD = (total_gt_boxes == 0) ? 0.0 : (1.0 * detected_gt_boxes / total_gt_boxes);
-  this->detectionPFalseAlarm = (total_computed_boxes == 0) ? 0.0 : 1.0 * this->detectionFalseAlarms / total_computed_boxes;
+void
+track2track_phase2_hadwav
+::compute_metrics()
+{
+  size_t num_comp_frames = this->n_computed_frames_matched + this->n_computed_frames_unmatched;
 
+  this->framePD = (this->n_gt_frames == 0) ? 0.0 : 1.0 * this->n_computed_frames_matched / this->n_gt_frames;
+  this->frameFA = 1.0 * this->n_computed_frames_unmatched;
+  this->trackFramePrecision = (num_comp_frames == 0) ? 0.0 : 1.0 * this->n_computed_frames_matched / num_comp_frames;
+  this->detectionPD = (this->total_gt_boxes == 0) ? 0.0 : (1.0 * this->detected_gt_boxes / this->total_gt_boxes);
+  this->detectionPFalseAlarm = (this->total_computed_boxes == 0) ? 0.0 : 1.0 * this->detectionFalseAlarms / this->total_computed_boxes;
+
+  if ( this->one_to_one )
+  {
+    size_t total_boxes = this->total_gt_boxes + this->total_computed_boxes;
+    this->identityPrecision = (this->total_computed_boxes == 0) ? 0.0 : 1.0 * this->assignedFrames / this->total_computed_boxes;
+    this->identityRecall = (this->total_gt_boxes == 0) ? 0.0 : 1.0 * this->assignedFrames / this->total_gt_boxes;
+    this->identityF1 = (total_boxes == 0) ? 0.0 : 2.0 * this->assignedFrames / total_boxes;
+  }
+}
+
+void
+track2track_phase2_hadwav
+::materialize_state_flags() const
+{
+  track_field< kwiver::track_oracle::dt::utility::state_flags > state_flags;
+
+  for (size_t i = 0; i < this->computed_frames.size(); ++i )
+  {
+    const frame_handle_type& frame = this->computed_frames[i];
+    switch ( this->computed_frame_states[i] )
+    {
+    case IN_AOI_MATCHED:
+      state_flags( frame.row ).set_flag( "in-aoi", "true" );
+      state_flags( frame.row ).set_flag( "matched", "true" );
+      break;
+
+    case IN_AOI_UNMATCHED:
+      state_flags( frame.row ).set_flag( "in-aoi", "true" );
+      state_flags( frame.row ).set_flag( "matched", "false" );
+      break;
+
+    case OUTSIDE_AOI:
+      state_flags( frame.row ).set_flag( "in-aoi", "false" );
+      state_flags( frame.row ).set_flag( "matched", "n/a" );
+      break;
+
+    default:
+      throw runtime_error( "Unhandled frame match flag" );
+    }
+  }
 }
 
 
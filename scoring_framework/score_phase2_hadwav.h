@@ -43,14 +43,45 @@ public:
   // ... any computed track can dominate multiple targets
   bool target_is_dominated_by_computed;
 
+  // true if the pair is in the one-to-one assignment (only computed
+  // when track2track_phase2_hadwav::one_to_one is set)
+  bool computed_assigned_to_target;
+
   track2track_scalars_hadwav()
     : computed_associated_with_target( false ),
       computed_frames_on_target( 0 ),
       computed_is_dominated_by_target( false ),
-      target_is_dominated_by_computed( false )
+      target_is_dominated_by_computed( false ),
+      computed_assigned_to_target( false )
   {}
 };
 
+//
+// One side (truth or computed) of the phase 2 associations, flattened
+// for phase 3: the tracks are numbered in the order of their t2c (or
+// c2t) keys, and the associated tracks of track k are
+// partners[ row_begin[k] .. row_begin[k+1] ), in the same order as the
+// t2c / c2t list, given as ordinals into the other side.
+//
+
+struct SCORE_TRACKS_HADWAV_EXPORT track2track_adjacency_hadwav
+{
+public:
+  static const size_t npos = static_cast< size_t >( -1 );
+
+  // per-track columns
+  kwto::track_handle_list_type tracks;
+  std::vector< unsigned > external_ids;
+  std::vector< unsigned > lifetimes;      // frames_in_aoi
+  std::vector< size_t > row_begin;        // tracks.size()+1 offsets into partners
+
+  // per-association columns
+  std::vector< size_t > partners;
+  std::vector< unsigned > frames_on_target;
+
+  size_t size() const { return this->tracks.size(); }
+};
+
 struct SCORE_TRACKS_HADWAV_EXPORT track2track_phase2_hadwav
 {
 public:
@@ -60,6 +91,10 @@ public:
   size_t n_true_tracks;
   size_t n_computed_tracks;
 
+  // t2c and c2t, flattened, with computed_frames_on_target inlined
+  track2track_adjacency_hadwav truth_adjacency;
+  track2track_adjacency_hadwav computed_adjacency;
+
   double framePD;
   double frameFA;
   double trackFramePrecision;
@@ -68,11 +103,54 @@ public:
   double detectionPFalseAlarm;
   bool verbose;
 
+  // if set, also find the one-to-one assignment of truth to computed
+  // tracks maximizing the total frames on target (as for IDF1), in
+  // addition to the greedy dominance
+  bool one_to_one;
+  size_t n_assigned_pairs;
+  size_t assignedFrames;
+  double identityPrecision;
+  double identityRecall;
+  double identityF1;
+
+  // the raw counts behind the metrics above; unlike the metrics, these
+  // can be summed over runs on disjoint data (see hadwav_partial_result.)
+  size_t total_gt_boxes;
+  size_t total_computed_boxes;
+  size_t detected_gt_boxes;
+  size_t n_gt_frames;                    // frame census: truth frames in the AOI,
+  size_t n_computed_frames_matched;      // ... computed frames matched,
+  size_t n_computed_frames_unmatched;    // ... computed frames in the AOI but unmatched
+
+  // The census counts distinct timestamps, which can't be summed over
+  // runs whose frames share timestamps; these are the sorted timestamps
+  // behind each of the three counts, as of compute().
+  std::vector< ts_type > gt_frame_timestamps;
+  std::vector< ts_type > computed_frame_matched_timestamps;
+  std::vector< ts_type > computed_frame_unmatched_timestamps;
+
+  // number of worker threads for the frame census; 0 or 1 means
+  // count on the calling thread.
+  unsigned n_threads;
+
+  // the frames of the computed tracks and their FRAME_MATCH_STATE,
+  // one byte per frame, as of compute(); the "in-aoi" / "matched"
+  // state flags are only derived from these by materialize_state_flags().
+  kwto::frame_handle_list_type computed_frames;
+  std::vector< unsigned char > computed_frame_states;
+
   void compute( const kwto::track_handle_list_type& t,
                 const kwto::track_handle_list_type& c,
                 const track2track_phase1& p1 );
   void debug_dump( std::ostream& os );
 
+  // set the metrics from the raw counts (compute() calls this.)
+  void compute_metrics();
+
+  // set the "in-aoi" / "matched" state flags on the computed frames
+  // (for --write-tracks.)
+  void materialize_state_flags() const;
+
   explicit track2track_phase2_hadwav( bool v = false ) :
     n_true_tracks(0),
     n_computed_tracks(0),
@@ -82,7 +160,20 @@ public:
     detectionPD(0.0),
     detectionFalseAlarms(0),
     detectionPFalseAlarm(0),
-    verbose(v)
+    verbose(v),
+    one_to_one(false),
+    n_assigned_pairs(0),
+    assignedFrames(0),
+    identityPrecision(0.0),
+    identityRecall(0.0),
+    identityF1(0.0),
+    total_gt_boxes(0),
+    total_computed_boxes(0),
+    detected_gt_boxes(0),
+    n_gt_frames(0),
+    n_computed_frames_matched(0),
+    n_computed_frames_unmatched(0),
+    n_threads(1)
   {}
 };
 
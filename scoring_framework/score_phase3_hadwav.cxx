@@ -8,14 +8,18 @@
 
 #include <track_oracle/core/state_flags.h>
 
+#include <scoring_framework/parallel_for.h>
+
 #include <vital/logger/logger.h>
 static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __FILE__ ) );
 
 using std::make_pair;
 using std::map;
 using std::ostringstream;
+using std::vector;
 
 using kwiver::track_oracle::track_field;
+using kwiver::track_oracle::track_handle_list_type;
 using kwiver::track_oracle::track_handle_type;
 
 namespace kwiver {
@@ -23,80 +27,103 @@ namespace kwant {
 
 per_track_phase3_hadwav
 overall_phase3_hadwav
-::compute_per_track( p2it p, const track2track_phase2_hadwav& p2_results, bool seeking_across_truth )
+::compute_per_track( size_t k,
+                     const track2track_adjacency_hadwav& side,
+                     const track2track_adjacency_hadwav& other ) const
 {
-  static scorable_track_type local_track_view;
-
+  // the dominant track is the first partner with the most frames on target
   unsigned dominant_size = 0;
-  track_handle_type dominant_index;
-  for (unsigned i=0; i<p->second.size(); ++i)
+  size_t dominant_index = 0;
+  bool has_dominant = false;
+  for (size_t j = side.row_begin[k]; j < side.row_begin[k+1]; ++j)
   {
-    track_handle_type this_index = p->second[i];
-    track2track_type key;
-    //
-    // TODO: make this semantically consistent
-    //
-    if ( ! seeking_across_truth)
-    {
-      key = make_pair( this_index, p->first );
-    }
-    else
-    {
-      key = make_pair( p->first, this_index );
-    }
-    map< track2track_type, track2track_scalars_hadwav >::const_iterator j = p2_results.t2t.find( key );
-    if ( j == p2_results.t2t.end() )
-    {
-      LOG_ERROR( main_logger, "Logic error: phase 3 deduced key of " << key.first.row << ", " << key.second.row << " not in phase 2 results?");
-      throw("Whoops");
-    }
-    unsigned this_size = j->second.computed_frames_on_target;
-    if (( i == 0 ) || ( this_size > dominant_size ))
+    unsigned this_size = side.frames_on_target[j];
+    if (( ! has_dominant ) || ( this_size > dominant_size ))
     {
       dominant_size = this_size;
-      dominant_index = this_index;
+      dominant_index = side.partners[j];
+      has_dominant = true;
     }
   }
 
   per_track_phase3_hadwav stats;
-  stats.continuity = p->second.size();
-  unsigned lifetime = local_track_view( p->first ).frames_in_aoi();
-  //  LOG_INFO( main_logger, "dominant size, lifetime: " << dominant_size << "," << lifetime << "");
+  stats.continuity = side.row_begin[k+1] - side.row_begin[k];
+  unsigned lifetime = side.lifetimes[k];
   stats.purity = (lifetime == 0) ? 0.0 : 1.0*dominant_size / lifetime;
-  stats.dominant_track_id = local_track_view( dominant_index ).external_id();
+  stats.dominant_track_id = has_dominant ? other.external_ids[ dominant_index ] : 0;
   stats.dominant_track_size = dominant_size;
   stats.dominated_track_lifetime = lifetime;
   // MITRE definition is "over the life of the given {track,target}", implying
   // it's okay to cap this at 1.0
   if (stats.purity > 1.0) stats.purity = 1.0;
-  if ( this->verbose )
-  {
-    LOG_INFO( main_logger, "C/P of ");
-    if (seeking_across_truth) LOG_INFO( main_logger, "target "); else LOG_INFO( main_logger, "track ");
-    unsigned int domid = local_track_view( dominant_index ).external_id();
-    LOG_INFO( main_logger, local_track_view( p->first ).external_id()
-             << " (dominated by " << domid << "; size " << dominant_size << "; lifetime " << lifetime << ")"
-             << " : cont " << stats.continuity
-             << " purity " << stats.purity << "");
-  }
 
   return stats;
 }
 
+void
+overall_phase3_hadwav
+::compute( const track2track_phase2_hadwav& t2t )
+{
+  const track2track_adjacency_hadwav& tracks = t2t.computed_adjacency;
+  const track2track_adjacency_hadwav& targets = t2t.truth_adjacency;
+
+  // compute the per-track stats of both sides in one parallel pass:
+  // MITRE's "track" metrics (i.e. computed tracks) first, then the
+  // "target" metrics (i.e. ground truth)
+  size_t n_tracks = tracks.size();
+  vector< per_track_phase3_hadwav > all_stats( n_tracks + targets.size() );
+  parallel_for( this->n_threads, all_stats.size(), [&]( size_t k )
+  {
+    all_stats[k] =
+      ( k < n_tracks )
+      ? this->compute_per_track( k, tracks, targets )
+      : this->compute_per_track( k - n_tracks, targets, tracks );
+  });
+
+  this->mitre_tracks.clear();
+  this->mitre_targets.clear();
+  for (size_t k = 0; k < n_tracks; ++k)
+  {
+    const per_track_phase3_hadwav& stats = all_stats[k];
+    log_per_track( "track ", tracks.external_ids[k], stats );
+    this->mitre_tracks.insert( this->mitre_tracks.end(), make_pair( tracks.tracks[k], stats ));
+    if ( this->verbose )
+    {
+      LOG_INFO( main_logger, "FAR: computed " << tracks.tracks[k].row  << " has " << stats.continuity << "");
+    }
+  }
+  for (size_t k = 0; k < targets.size(); ++k)
+  {
+    const per_track_phase3_hadwav& stats = all_stats[ n_tracks + k ];
+    log_per_track( "target ", targets.external_ids[k], stats );
+    this->mitre_targets.insert( this->mitre_targets.end(), make_pair( targets.tracks[k], stats ));
+  }
 
+  vector< per_track_phase3_hadwav > track_stats( all_stats.begin(), all_stats.begin() + n_tracks );
+  vector< per_track_phase3_hadwav > target_stats( all_stats.begin() + n_tracks, all_stats.end() );
+  this->compute_overall( track_stats, target_stats, t2t.n_true_tracks, t2t.n_computed_tracks );
+}
 
 void
 overall_phase3_hadwav
-::compute( const track2track_phase2_hadwav& t2t )
+::compute_overall( const vector< per_track_phase3_hadwav >& track_stats,
+                   const vector< per_track_phase3_hadwav >& target_stats,
+                   size_t n_true_tracks,
+                   size_t n_computed_tracks )
 {
-  // compute MITRE's "track" metrics (i.e. computed tracks)
-  map<ts_type, int> numCTOnFrame;
+  // the averages are summed in the same (track handle) order as the
+  // c2t / t2c maps, so they come out the same as a serial pass
+  this->avg_track_continuity = 0.0;
+  this->avg_track_purity = 0.0;
+  this->avg_target_continuity = 0.0;
+  this->avg_target_purity = 0.0;
+
   unsigned purity_counter = 0;
   unsigned continuity_counter = 0;
-  for ( p2it iter = t2t.c2t.begin(); iter != t2t.c2t.end(); ++iter )
+  unsigned n_unassigned_computed_tracks = 0;
+  for (size_t k = 0; k < track_stats.size(); ++k)
   {
-    per_track_phase3_hadwav stats = this->compute_per_track( iter, t2t, /* looping over truth = */ false  );
-    this->mitre_tracks[ iter->first ] = stats;
+    const per_track_phase3_hadwav& stats = track_stats[k];
     if( stats.continuity != 0 )
     {
       this->avg_track_continuity += stats.continuity;
@@ -107,8 +134,9 @@ overall_phase3_hadwav
       this->avg_track_purity += stats.purity;
       purity_counter++;
     }
+    if ( stats.continuity == 0 ) ++n_unassigned_computed_tracks;
   }
-  if ( t2t.n_computed_tracks > 0 )
+  if ( n_computed_tracks > 0 )
   {
     if (continuity_counter > 0)
     {
@@ -119,61 +147,62 @@ overall_phase3_hadwav
       this->avg_track_purity /= static_cast<double>( purity_counter );
     }
   }
-  LOG_INFO( main_logger, "CP (track) avg over " << t2t.n_computed_tracks << "");
+  LOG_INFO( main_logger, "CP (track) avg over " << n_computed_tracks << "");
 
-  // compute MITRE's "target" metrics (i.e. ground truth )
-  map<ts_type, int> numGTOnFrame;
-  for ( p2it iter = t2t.t2c.begin(); iter != t2t.t2c.end(); ++iter )
+  unsigned n_hit_true_tracks = 0;
+  for (size_t k = 0; k < target_stats.size(); ++k)
   {
-    per_track_phase3_hadwav stats = this->compute_per_track( iter, t2t, /* looping over truth = */ true  );
-    this->mitre_targets[ iter->first ] = stats;
+    const per_track_phase3_hadwav& stats = target_stats[k];
     this->avg_target_continuity += stats.continuity;
     this->avg_target_purity += stats.purity;
+    if ( stats.continuity != 0 ) ++n_hit_true_tracks;
   }
-  if ( t2t.n_true_tracks > 0 )
+  if ( n_true_tracks > 0 )
   {
-    this->avg_target_continuity /= (1.0 * t2t.n_true_tracks );
-    this->avg_target_purity /= (1.0 * t2t.n_true_tracks );
+    this->avg_target_continuity /= (1.0 * n_true_tracks );
+    this->avg_target_purity /= (1.0 * n_true_tracks );
   }
-  LOG_INFO( main_logger, "CP (target) avg over " << t2t.n_computed_tracks << "");
-
-  track_field< kwiver::track_oracle::dt::utility::state_flags > state_flags;
+  LOG_INFO( main_logger, "CP (target) avg over " << n_computed_tracks << "");
 
   // compute overall Pd/FA (or FAR)
-  unsigned n_hit_true_tracks = 0;
-  for (p2it iter = t2t.t2c.begin(); iter != t2t.t2c.end(); ++iter )
-  {
-    {
-      ostringstream oss;
-      oss << iter->second.size();
-      state_flags( iter->first.row).set_flag( "n-matched", oss.str() );
-    }
+  LOG_INFO( main_logger, "t2t.c2t is " << track_stats.size() << "");
+  LOG_INFO( main_logger, "trackPD: " << n_hit_true_tracks << " / " << n_true_tracks << "");
+  this->trackPd = (target_stats.size() == 0) ? 0.0 : 1.0 * n_hit_true_tracks / n_true_tracks;
+  LOG_INFO( main_logger, "trackFA: " << n_unassigned_computed_tracks << "");
+  this->trackFA = (track_stats.size() == 0) ? 0.0 : 1.0 * n_unassigned_computed_tracks;
+}
 
-    if ( ! iter->second.empty() )
-    {
-      ++n_hit_true_tracks;
-    }
+void
+overall_phase3_hadwav
+::log_per_track( const char* kind, unsigned id, const per_track_phase3_hadwav& stats ) const
+{
+  if ( ! this->verbose ) return;
+
+  LOG_INFO( main_logger, "C/P of ");
+  LOG_INFO( main_logger, kind );
+  LOG_INFO( main_logger, id
+           << " (dominated by " << stats.dominant_track_id << "; size " << stats.dominant_track_size
+           << "; lifetime " << stats.dominated_track_lifetime << ")"
+           << " : cont " << stats.continuity
+           << " purity " << stats.purity << "");
+}
 
-  }
-  unsigned n_unassigned_computed_tracks = 0;
-  LOG_INFO( main_logger, "t2t.c2t is " << t2t.c2t.size() << "");
-  for (p2it iter = t2t.c2t.begin(); iter != t2t.c2t.end(); ++iter )
+void
+overall_phase3_hadwav
+::materialize_state_flags( const track2track_phase2_hadwav& t2t ) const
+{
+  track_field< kwiver::track_oracle::dt::utility::state_flags > state_flags;
+
+  const map< track_handle_type, track_handle_list_type >* sides[] = { &t2t.t2c, &t2t.c2t };
+  for (size_t s = 0; s < 2; ++s)
   {
+    for (p2it iter = sides[s]->begin(); iter != sides[s]->end(); ++iter )
     {
       ostringstream oss;
       oss << iter->second.size();
       state_flags( iter->first.row).set_flag( "n-matched", oss.str() );
     }
-    if ( this->verbose )
-    {
-      LOG_INFO( main_logger, "FAR: computed " << iter->first.row  << " has " << iter->second.size() << "");
-    }
-    if ( iter->second.empty() ) ++n_unassigned_computed_tracks;
   }
-  LOG_INFO( main_logger, "trackPD: " << n_hit_true_tracks << " / " << t2t.n_true_tracks << "");
-  this->trackPd = (t2t.t2c.empty()) ? 0.0 : 1.0 * n_hit_true_tracks / t2t.n_true_tracks;
-  LOG_INFO( main_logger, "trackFA: " << n_unassigned_computed_tracks << "");
-  this->trackFA = (t2t.c2t.empty()) ? 0.0 : 1.0 * n_unassigned_computed_tracks;
 }
 
 const map< track_handle_type, per_track_phase3_hadwav >&
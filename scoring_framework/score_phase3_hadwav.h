@@ -22,6 +22,7 @@ namespace kwant {
 namespace kwto = ::kwiver::track_oracle;
 
 struct track2track_phase2_hadwav;
+struct track2track_adjacency_hadwav;
 
 struct SCORE_TRACKS_HADWAV_EXPORT per_track_phase3_hadwav
 {
@@ -44,6 +45,8 @@ private:
   std::map< kwto::track_handle_type, per_track_phase3_hadwav > mitre_tracks;
   std::map< kwto::track_handle_type, per_track_phase3_hadwav > mitre_targets;
 
+  void log_per_track( const char* kind, unsigned id, const per_track_phase3_hadwav& stats ) const;
+
 public:
   double avg_track_continuity;
   double avg_track_purity;
@@ -53,6 +56,10 @@ public:
   double trackFA;
   bool verbose;
 
+  // number of worker threads for the per-track pass; 0 or 1 means
+  // compute on the calling thread.
+  unsigned n_threads;
+
   overall_phase3_hadwav():
     avg_track_continuity(0.0),
     avg_track_purity(0.0),
@@ -60,12 +67,27 @@ public:
     avg_target_purity(0.0),
     trackPd(0.0),
     trackFA(0.0),
-    verbose(false)
+    verbose(false),
+    n_threads(1)
     {
     }
 
-  per_track_phase3_hadwav compute_per_track( p2it p, const track2track_phase2_hadwav& t2t, bool seeking_across_truth );
+  // stats of track k of side, whose partners are ordinals into other
+  per_track_phase3_hadwav compute_per_track( size_t k,
+                                             const track2track_adjacency_hadwav& side,
+                                             const track2track_adjacency_hadwav& other ) const;
   void compute( const track2track_phase2_hadwav& t2t );
+
+  // set the averages and track Pd / FA from the per-track stats of the
+  // computed tracks and of the targets (compute() calls this with the
+  // stats in track handle order.)
+  void compute_overall( const std::vector< per_track_phase3_hadwav >& track_stats,
+                        const std::vector< per_track_phase3_hadwav >& target_stats,
+                        size_t n_true_tracks,
+                        size_t n_computed_tracks );
+
+  // set the "n-matched" state flag on each track in t2t (for --write-tracks.)
+  void materialize_state_flags( const track2track_phase2_hadwav& t2t ) const;
   const std::map< kwto::track_handle_type, per_track_phase3_hadwav >& get_mitre_track_stats() const;
   const std::map< kwto::track_handle_type, per_track_phase3_hadwav >& get_mitre_target_stats() const;
 };
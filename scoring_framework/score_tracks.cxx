@@ -25,8 +25,10 @@
 #include <track_oracle/aries_interface/aries_interface.h>
 
 #include <scoring_framework/score_tracks_hadwav.h>
+#include <scoring_framework/hadwav_partial_result.h>
 
 #include <scoring_framework/matching_args_type.h>
+#include <scoring_framework/phase1_cache.h>
 #include <scoring_framework/score_tracks_loader.h>
 #include <scoring_framework/timestamp_utilities.h>
 
@@ -38,6 +40,7 @@ static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __
 
 using std::cout;
 using std::endl;
+using std::istringstream;
 using std::make_pair;
 using std::map;
 using std::ofstream;
@@ -117,6 +120,216 @@ normalization_args_type
   }
 }
 
+//
+// Matching-parameter sweeps: each option is a comma-separated list of
+// values for the corresponding matching option.  Phase 1 compares the
+// tracks once and phase 2 / 3 are run for every combination of the
+// listed values; options not swept keep their usual values.
+//
+
+struct sweep_args_type
+{
+  vul_arg< string > iou_list;
+  vul_arg< string > min_pcent_list;
+  vul_arg< string > min_bound_list;
+  vul_arg< string > min_frames_list;
+
+  sweep_args_type()
+    : iou_list( "--sweep-iou", "comma-separated --iou values to score in a single run" ),
+      min_pcent_list( "--sweep-min-pcent-gt-ct", "comma-separated --min-pcent-gt-ct values (e.g. '50:0,50:50') to score in a single run" ),
+      min_bound_list( "--sweep-match-overlap-lower-bound", "comma-separated --match-overlap-lower-bound values to score in a single run" ),
+      min_frames_list( "--sweep-match-frames-lower-bound", "comma-separated --match-frames-lower-bound values (e.g. '0,5,10p') to score in a single run" )
+  {}
+
+  bool set() const;
+
+  // Expand the lists into (label, parameters) grid points based on p
+  bool make_grid( const phase1_parameters& p,
+                  matching_args_type& matching_args,   // non-const because option() isn't const
+                  vector< pair< string, phase1_parameters > >& grid );
+};
+
+bool
+sweep_args_type
+::set() const
+{
+  return this->iou_list.set() || this->min_pcent_list.set() ||
+    this->min_bound_list.set() || this->min_frames_list.set();
+}
+
+vector< string >
+split_sweep_list( const string& s )
+{
+  vector< string > ret;
+  istringstream iss( s );
+  string tmp;
+  while ( std::getline( iss, tmp, ',' ))
+  {
+    if ( ! tmp.empty() ) ret.push_back( tmp );
+  }
+  return ret;
+}
+
+bool
+sweep_args_type
+::make_grid( const phase1_parameters& p,
+             matching_args_type& matching_args,
+             vector< pair< string, phase1_parameters > >& grid )
+{
+  if ( this->iou_list.set() && this->min_pcent_list.set() )
+  {
+    LOG_ERROR( main_logger, "Can't sweep both " << this->iou_list.option() << " and " << this->min_pcent_list.option() );
+    return false;
+  }
+  bool uses_iou = this->iou_list.set() || ( ( ! this->min_pcent_list.set() ) && ( p.iou != -1.0 ));
+  bool uses_pcent = this->min_pcent_list.set() ||
+    ( ( ! this->iou_list.set() ) && ( (p.min_pcent_overlap_gt_ct.first >= 0.0) || (p.min_pcent_overlap_gt_ct.second >= 0.0) ));
+  if ( this->min_bound_list.set() && ( uses_iou || uses_pcent ))
+  {
+    LOG_ERROR( main_logger, this->min_bound_list.option() << " has no effect when IoU or min-pcent-gt-ct matching is used" );
+    return false;
+  }
+  if ( this->min_pcent_list.set() && ( ! matching_args.min_frames_arg.set() ) && ( ! this->min_frames_list.set() ))
+  {
+    LOG_ERROR( main_logger, "When sweeping " << this->min_pcent_list.option() << ", the minimum frame count "
+               << "must be explicitly set; see " << matching_args.min_pcent_gt_ct.option() << " 'help'" );
+    return false;
+  }
+
+  // each axis of the grid as (label, parameter-setting) pairs, starting
+  // from a single point at p
+
+  grid.clear();
+  grid.push_back( make_pair( string(), p ));
+
+  vector< string > v;
+  vector< pair< string, phase1_parameters > > next;
+
+  v = split_sweep_list( this->iou_list() );
+  if ( this->iou_list.set() )
+  {
+    next.clear();
+    for (size_t g=0; g<grid.size(); ++g)
+    {
+      for (size_t i=0; i<v.size(); ++i)
+      {
+        istringstream iss( v[i] );
+        double d;
+        if ( ! ( iss >> d ))
+        {
+          LOG_ERROR( main_logger, "Couldn't parse IoU value '" << v[i] << "'" );
+          return false;
+        }
+        phase1_parameters q = grid[g].second;
+        q.iou = d;
+        q.min_pcent_overlap_gt_ct = make_pair( -1.0, -1.0 );
+        next.push_back( make_pair( grid[g].first + " iou=" + v[i], q ));
+      }
+    }
+    grid.swap( next );
+  }
+
+  v = split_sweep_list( this->min_pcent_list() );
+  if ( this->min_pcent_list.set() )
+  {
+    next.clear();
+    for (size_t g=0; g<grid.size(); ++g)
+    {
+      for (size_t i=0; i<v.size(); ++i)
+      {
+        // same syntax (and 'help') as --min-pcent-gt-ct
+        if ( v[i] == "help" )
+        {
+          matching_args.log_min_pcent_gt_ct_help();
+          return false;
+        }
+        phase1_parameters q = grid[g].second;
+        if ( ! matching_args_type::parse_min_pcent_gt_ct( v[i], q.min_pcent_overlap_gt_ct,
+                                                          q.debug_min_pcent_overlap_gt_ct ))
+        {
+          return false;
+        }
+        q.iou = -1.0;
+        next.push_back( make_pair( grid[g].first + " min-pcent-gt-ct=" + v[i], q ));
+      }
+    }
+    grid.swap( next );
+  }
+
+  v = split_sweep_list( this->min_bound_list() );
+  if ( this->min_bound_list.set() )
+  {
+    next.clear();
+    for (size_t g=0; g<grid.size(); ++g)
+    {
+      for (size_t i=0; i<v.size(); ++i)
+      {
+        istringstream iss( v[i] );
+        double d;
+        if ( ! ( iss >> d ))
+        {
+          LOG_ERROR( main_logger, "Couldn't parse match-overlap-lower-bound value '" << v[i] << "'" );
+          return false;
+        }
+        phase1_parameters q = grid[g].second;
+        q.min_bound_matching_area = d;
+        next.push_back( make_pair( grid[g].first + " match-overlap-lower-bound=" + v[i], q ));
+      }
+    }
+    grid.swap( next );
+  }
+
+  v = split_sweep_list( this->min_frames_list() );
+  if ( this->min_frames_list.set() )
+  {
+    next.clear();
+    for (size_t g=0; g<grid.size(); ++g)
+    {
+      for (size_t i=0; i<v.size(); ++i)
+      {
+        // same syntax as --match-frames-lower-bound
+        phase1_parameters q = grid[g].second;
+        if ( ! matching_args_type::parse_min_frames_arg( v[i], q.min_frames_policy ))
+        {
+          return false;
+        }
+        next.push_back( make_pair( grid[g].first + " match-frames-lower-bound=" + v[i], q ));
+      }
+    }
+    grid.swap( next );
+  }
+
+  if ( grid.empty() )
+  {
+    LOG_ERROR( main_logger, "Sweep lists are empty" );
+    return false;
+  }
+  return true;
+}
+
+//
+// With --paired-gtct, the loader records which gt/ct file pair each track
+// came from; those are the phase 1 partitions for --partition-pairs.
+//
+
+bool
+gtct_pair_partitions( const track_handle_list_type& tracks,
+                      vector< unsigned >& partitions )
+{
+  track_field< unsigned > gtct_pair_index( "gtct_pair_index" );
+  partitions.resize( tracks.size() );
+  for (size_t i=0; i<tracks.size(); ++i)
+  {
+    if ( ! gtct_pair_index.exists( tracks[i].row ))
+    {
+      LOG_ERROR( main_logger, "Track " << i << " doesn't record its gt/ct pair; was it loaded with --paired-gtct?" );
+      return false;
+    }
+    partitions[i] = gtct_pair_index( tracks[i].row );
+  }
+  return true;
+}
+
 void
 write_stats( const map< track_handle_type, per_track_phase3_hadwav >& stats,
              const string& fn )
@@ -258,10 +471,10 @@ write_activity_overlay( ostream& os,
 
       // first, enter any matching frames into ct_frame_matches
       track2track_type key = make_pair( gt, ct );
-      map< track2track_type, track2track_score >::const_iterator probe = p1.t2t.find( key );
+      track2track_phase1::t2t_type::const_iterator probe = p1.t2t.find( key );
       if ( probe != p1.t2t.end() )
       {
-        const vector< track2track_frame_overlap_record >& m = probe->second.frame_overlaps;
+        const vector< track2track_frame_overlap_record > m = probe->second.frame_overlaps();
         for (unsigned k=0; k<m.size(); ++k)
         {
           // Truth and computed frames match
@@ -482,11 +695,17 @@ int main( int argc, char *argv[] )
   vul_arg< string > activity_overlay_fn_arg( "--act-overlay-file", "write activity overlay data for overlay_score_tracks" );
   vul_arg< bool > display_git_hash( "--git-hash", "Display git hash and exit", false);
   vul_arg< string > track_dump_fn_arg( "--write-tracks", "Write annotated input tracks to this file (either .kwcsv or .kwiver)" );
+  vul_arg< unsigned > n_threads_arg( "--threads", "Number of threads to use when matching tracks", 1 );
+  vul_arg< bool > one_to_one_flag( "--one-to-one", "Also report identity precision / recall / F1 from the one-to-one track assignment maximizing frames on target", false );
+  vul_arg< string > p1_cache_fn_arg( "--p1-cache", "Reuse phase 1 results from this file if the tracks and matching parameters are unchanged; otherwise compute and write them" );
+  vul_arg< string > partial_out_fn_arg( "--partial-out", "Write the raw HADWAV counts to this file, to be combined with those of other runs by score_merge" );
+  vul_arg< bool > partition_pairs_flag( "--partition-pairs", "With --paired-gtct, only compare tracks from the same gt/ct file pair in phase 1", false );
 
   input_args_type input_args;
   output_args_type output_args;
   matching_args_type matching_args;
   normalization_args_type normalization_args;
+  sweep_args_type sweep_args;
 
   ostringstream arg_oss;
   for (int i=0; i<argc; ++i) arg_oss << argv[i] << " ";
@@ -527,6 +746,44 @@ int main( int argc, char *argv[] )
     }
   }
 
+  // partitions come from the gt/ct pairs; the sweep doesn't know
+  // about them
+  if ( partition_pairs_flag() )
+  {
+    if ( ! input_args.paired_gtct() )
+    {
+      LOG_ERROR( main_logger, partition_pairs_flag.option() << " requires " << input_args.paired_gtct.option() );
+      return EXIT_FAILURE;
+    }
+    if ( sweep_args.set() )
+    {
+      LOG_ERROR( main_logger, "Can't use " << partition_pairs_flag.option() << " with a matching-parameter sweep" );
+      return EXIT_FAILURE;
+    }
+  }
+
+  // a sweep writes one metrics table per grid point and nothing else
+  if ( sweep_args.set() )
+  {
+    bool other_output =
+      t2t_dump_fn_arg.set() || activity_pd_dump_fn_arg.set() || activity_overlay_fn_arg.set() ||
+      track_dump_fn_arg.set() || p1_cache_fn_arg.set() || partial_out_fn_arg.set() ||
+      output_args.track_stats_fn.set() || output_args.target_stats_fn.set() ||
+      output_args.json_dump_fn.set() || output_args.matches_dump_fn.set() ||
+      output_args.frame_level_matches_fn.set();
+    if ( other_output )
+    {
+      LOG_ERROR( main_logger, "Matching-parameter sweeps only write the metrics tables; "
+                 "remove the file output and cache options" );
+      return EXIT_FAILURE;
+    }
+    if ( matching_args.radial_overlap() >= 0.0 )
+    {
+      LOG_ERROR( main_logger, "Matching-parameter sweeps don't support radial overlap" );
+      return EXIT_FAILURE;
+    }
+  }
+
   // if the user specified radial_overlap, set input_arg's compute_mgrs_data flag
   if ( matching_args.radial_overlap() >= 0.0 )
   {
@@ -580,6 +837,19 @@ int main( int argc, char *argv[] )
   {
     return EXIT_FAILURE;
   }
+  p1_params.n_threads = n_threads_arg();
+
+  // Only keep phase 1's per-frame overlap records if an output needs them;
+  // plain hadwav scoring gets by on the per-pair counts and frame flags.
+  p1_params.keep_frame_overlaps =
+    t2t_dump_fn_arg.set() ||
+    activity_overlay_fn_arg.set() ||
+    output_args.frame_level_matches_fn.set() ||
+    ( ! score_hadwav_flag() );
+  if ( ! p1_params.keep_frame_overlaps )
+  {
+    LOG_INFO( main_logger, "p1: keeping per-pair overlap counts only" );
+  }
 
   pair< bool, double > norm = compute_normalization_factor( p1_params, matching_args, normalization_args, computed_tracks );
 
@@ -612,8 +882,68 @@ int main( int argc, char *argv[] )
   p1_params.filter_track_list_on_aoi( truth_tracks, aoi_filtered_truth_tracks );
   p1_params.filter_track_list_on_aoi( computed_tracks, aoi_filtered_computed_tracks );
 
+  if ( sweep_args.set() )
+  {
+    vector< pair< string, phase1_parameters > > grid;
+    if ( ! sweep_args.make_grid( p1_params, matching_args, grid ))
+    {
+      return EXIT_FAILURE;
+    }
+
+    track2track_phase1_sweep sweep( p1_params );
+    sweep.compute_all( aoi_filtered_truth_tracks, aoi_filtered_computed_tracks );
+
+    for (size_t g=0; g<grid.size(); ++g)
+    {
+      LOG_INFO( main_logger, "sweep: scoring" << grid[g].first << "..." );
+      track2track_phase1 p1( grid[g].second );
+      sweep.select( p1 );
+
+      track2track_phase2_hadwav p2( verbose_flag() );
+      p2.n_threads = n_threads_arg();
+      p2.one_to_one = one_to_one_flag();
+      p2.compute( aoi_filtered_truth_tracks, aoi_filtered_computed_tracks, p1 );
+      overall_phase3_hadwav p3;
+      p3.verbose = verbose_flag();
+      p3.n_threads = n_threads_arg();
+      p3.compute( p2 );
+
+      cout << "Sweep point " << g+1 << " of " << grid.size() << ":" << grid[g].first << endl;
+      write_hadwav_results( cout, p2, p3, norm, aoi_filtered_computed_tracks.size() );
+    }
+    return EXIT_SUCCESS;
+  }
+
   track2track_phase1 p1(p1_params);
-  p1.compute_all( aoi_filtered_truth_tracks, aoi_filtered_computed_tracks );
+  if ( partition_pairs_flag() )
+  {
+    // each gt/ct pair is its own phase 1 problem; tracks from different
+    // pairs are never compared
+    vector< unsigned > truth_partitions, computed_partitions;
+    if ( ( ! gtct_pair_partitions( aoi_filtered_truth_tracks, truth_partitions )) ||
+         ( ! gtct_pair_partitions( aoi_filtered_computed_tracks, computed_partitions )))
+    {
+      return EXIT_FAILURE;
+    }
+    if ( p1_cache_fn_arg.set() )
+    {
+      phase1_cache( p1_cache_fn_arg() ).compute_all_partitioned( p1, aoi_filtered_truth_tracks, aoi_filtered_computed_tracks,
+                                                                 truth_partitions, computed_partitions );
+    }
+    else
+    {
+      p1.compute_all_partitioned( aoi_filtered_truth_tracks, aoi_filtered_computed_tracks,
+                                  truth_partitions, computed_partitions );
+    }
+  }
+  else if ( p1_cache_fn_arg.set() )
+  {
+    phase1_cache( p1_cache_fn_arg() ).compute_all( p1, aoi_filtered_truth_tracks, aoi_filtered_computed_tracks );
+  }
+  else
+  {
+    p1.compute_all( aoi_filtered_truth_tracks, aoi_filtered_computed_tracks );
+  }
 
   LOG_INFO( main_logger, "p1: AOI kept "
            << aoi_filtered_truth_tracks.size() << " of " << truth_tracks.size() << " truth tracks; "
@@ -673,6 +1003,8 @@ int main( int argc, char *argv[] )
   if(score_hadwav_flag())
   {
     track2track_phase2_hadwav p2( verbose_flag() );
+    p2.n_threads = n_threads_arg();
+    p2.one_to_one = one_to_one_flag();
     p2.compute( aoi_filtered_truth_tracks, aoi_filtered_computed_tracks, p1 );
 
     LOG_INFO( main_logger, "p2...");
@@ -705,8 +1037,15 @@ int main( int argc, char *argv[] )
 
     overall_phase3_hadwav p3;
     p3.verbose = verbose_flag();
+    p3.n_threads = n_threads_arg();
     p3.compute( p2 );
 
+    if ( track_dump_fn_arg.set() )
+    {
+      p2.materialize_state_flags();
+      p3.materialize_state_flags( p2 );
+    }
+
     if ( output_args.track_stats_fn.set() )
     {
       LOG_INFO( main_logger, "Writing " << output_args.track_stats_fn() << "...");
@@ -718,43 +1057,16 @@ int main( int argc, char *argv[] )
       write_stats( p3.get_mitre_target_stats(), output_args.target_stats_fn() );
     }
 
-    cout << "HADWAV Scoring Results:" << endl;
-
-    cout << "  Detection-Pd: " << p2.detectionPD << endl
-             << "  Detection-FA: " << p2.detectionFalseAlarms << endl
-             << "  Detection-PFA: " << p2.detectionPFalseAlarm << endl;
-
-    if (norm.first)
-    {
-      cout << "  Frame-NFAR: " << p2.frameFA/norm.second << endl;
-    }
-    else
-    {
-      cout << "  Frame-NFAR: not computed" << endl;
-    }
-
-    cout << "  Track-Pd: " << p3.trackPd << endl;
-    cout << "  Track-FA: " << p3.trackFA << "" << endl;
+    write_hadwav_results( cout, p2, p3, norm, aoi_filtered_computed_tracks.size() );
 
-    double computed_track_pfa =
-      aoi_filtered_computed_tracks.empty()
-      ? 0.0
-      : p3.trackFA / aoi_filtered_computed_tracks.size();
-    cout << "  Computed-track-PFA: " << computed_track_pfa << endl;
-
-    if (norm.first)
+    if ( partial_out_fn_arg.set() )
     {
-      cout << "  Track-NFAR: " << p3.trackFA/norm.second << "" << endl;
-    }
-    else
-    {
-      cout << "  Track-NFAR: not computed" << endl;
+      if ( ! hadwav_partial_result( p2, p3 ).write( partial_out_fn_arg() ))
+      {
+        return EXIT_FAILURE;
+      }
+      LOG_INFO( main_logger, "Wrote partial result to '" << partial_out_fn_arg() << "'" );
     }
-    cout << "  Avg track (continuity, purity ): " << p3.avg_track_continuity
-             << ", " << p3.avg_track_purity << endl;
-    cout << "  Avg target (continuity, purity ): " << p3.avg_target_continuity << ", "
-             << p3.avg_target_purity << endl;
-    cout <<  "  Track-frame-precision: " << p2.trackFramePrecision << endl;
 
     if ( output_args.json_dump_fn.set() )
     {
@@ -782,6 +1094,13 @@ int main( int argc, char *argv[] )
       hadwav_node.push_back(JSONNode("avg-track-purity", p3.avg_track_purity));
       hadwav_node.push_back(JSONNode("avg-target-continuity", p3.avg_target_continuity));
       hadwav_node.push_back(JSONNode("avg-target-purity", p3.avg_target_purity));
+      if (p2.one_to_one)
+      {
+        hadwav_node.push_back(JSONNode("one-to-one-pairs", p2.n_assigned_pairs));
+        hadwav_node.push_back(JSONNode("identity-precision", p2.identityPrecision));
+        hadwav_node.push_back(JSONNode("identity-recall", p2.identityRecall));
+        hadwav_node.push_back(JSONNode("identity-f1", p2.identityF1));
+      }
 
       json_root.push_back(hadwav_node);
     }
@@ -817,6 +1136,7 @@ int main( int argc, char *argv[] )
     track_handle_list_type all_tracks;
     all_tracks.insert( all_tracks.end(), aoi_filtered_truth_tracks.begin(), aoi_filtered_truth_tracks.end() );
     all_tracks.insert( all_tracks.end(), aoi_filtered_computed_tracks.begin(), aoi_filtered_computed_tracks.end() );
+    track2track_phase1::materialize_state_flags( all_tracks );
     bool rc = file_format_manager::write( track_dump_fn_arg(), all_tracks, kwiver::track_oracle::TF_INVALID_TYPE );
     LOG_INFO( main_logger, "Write returned " << rc );
   }
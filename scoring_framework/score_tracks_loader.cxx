@@ -14,6 +14,10 @@
 #include <cstdlib>
 #include <limits>
 #include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include <vul/vul_file.h>
 #include <vul/vul_reg_exp.h>
@@ -39,6 +43,7 @@
 
 #include <scoring_framework/time_window_filter.h>
 #include <scoring_framework/timestamp_utilities.h>
+#include <scoring_framework/track_set_snapshot.h>
 #include <scoring_framework/virat_scenario_utilities.h>
 #include <track_oracle/core/state_flags.h>
 
@@ -75,6 +80,7 @@ using kwiver::track_oracle::track_handle_type;
 using kwiver::track_oracle::track_oracle_core;
 using kwiver::track_oracle::file_format_schema_type;
 using kwiver::track_oracle::file_format_manager;
+using kwiver::track_oracle::file_format_base;
 using kwiver::track_oracle::track_vpd_track_type;
 using kwiver::track_oracle::track_vpd_event_type;
 using kwiver::track_oracle::track_comms_xml_type;
@@ -137,6 +143,7 @@ struct input_source_type
   timestamp_generator_map_type timestamp_generator_map;
   map< string, vector< size_t > > qid2activity_map;
   size_t min_track_length;
+  time_window_filter load_window;   // if valid, applied to each file's tracks as it's read
 };
 
 ///
@@ -837,42 +844,200 @@ filter_on_timestamp_window( const time_window_filter& twf,
 }
 
 
+//
+// Ask the OS to start reading a track file into the page cache, so
+// that the parser finds it there rather than waiting on the disk.
+// This returns at once; the kernel does the reading.  A file which
+// can't be opened is left for the parser to report.  Without
+// posix_fadvise, this does nothing.
+//
+
+void
+advise_track_file_willneed( const string& fn )
+{
+#ifdef POSIX_FADV_WILLNEED
+  int fd = open( fn.c_str(), O_RDONLY );
+  if ( fd < 0 ) return;
+  posix_fadvise( fd, 0, 0, POSIX_FADV_WILLNEED );
+  close( fd );
+#else
+  (void) fn;
+#endif
+}
+
+//
+// Load a kw18 file, dropping tracks which can't pass the load window
+// or the minimum length before any of their rows reach track_oracle.
+// The file's lines are grouped by track ID (column 1); a track's
+// length is its line count, and its frame numbers (column 3) and
+// timestamps (column 18, in seconds) are checked against the window
+// with time_window_filter::frames_may_pass_filter, which errs on the
+// side of keeping a track.  The kept lines are then handed to the
+// kw18 reader as usual, so its options (e.g. the kw19 hack) still
+// apply.  If the file can't be parsed here, nothing is read and
+// KW18_NOT_PREFILTERED is returned, leaving the file to the generic
+// reader.
+//
+
+enum kw18_prefilter_status { KW18_NOT_PREFILTERED, KW18_PREFILTERED, KW18_READ_FAILED };
+
+kw18_prefilter_status
+read_kw18_prefiltered( const string& fn,
+                       const input_source_type& src,
+                       track_handle_list_type& tracks )
+{
+  ifstream is( fn.c_str() );
+  if ( ! is ) return KW18_NOT_PREFILTERED;
+
+  vector< string > lines;
+  map< long, vector< size_t > > id2lines;
+  map< long, vector< time_window_filter::frame_time_type > > id2frames;
+  string line;
+  while ( getline( is, line ))
+  {
+    size_t p = line.find_first_not_of( " \t\r" );
+    if ( ( p == string::npos ) || ( line[p] == '#' )) continue;
+
+    // columns 1 (id), 3 (frame) and 18 (timestamp); all 18 must parse
+    const char* c = line.c_str();
+    double cols[ 18 ];
+    for (size_t k=0; k<18; ++k)
+    {
+      char* end;
+      cols[k] = std::strtod( c, &end );
+      if ( end == c ) return KW18_NOT_PREFILTERED;
+      c = end;
+    }
+
+    long id = static_cast< long >( cols[0] );
+    time_window_filter::frame_time_type f;
+    if ( cols[2] >= 0 )
+    {
+      f.has_frame_number = true;
+      f.frame_number = static_cast< unsigned >( cols[2] );
+    }
+    if ( cols[17] >= 0 )
+    {
+      f.has_timestamp = true;
+      f.timestamp_usecs = cols[17] * 1.0e6;
+    }
+    id2lines[ id ].push_back( lines.size() );
+    id2frames[ id ].push_back( f );
+    lines.push_back( line );
+  }
+
+  ostringstream kept;
+  size_t n_kept = 0;
+  for (map< long, vector< size_t > >::const_iterator i = id2lines.begin(); i != id2lines.end(); ++i)
+  {
+    if ( i->second.size() < src.min_track_length ) continue;
+    if ( src.load_window.is_valid() &&
+         ( ! src.load_window.frames_may_pass_filter( id2frames[ i->first ] )))
+    {
+      continue;
+    }
+    for (size_t j=0; j<i->second.size(); ++j)
+    {
+      kept << lines[ i->second[j] ] << "\n";
+    }
+    ++n_kept;
+  }
+  LOG_INFO( main_logger, "kw18 pre-filter: " << n_kept << " of " << id2lines.size()
+            << " tracks may pass the load window and length filters" );
+
+  file_format_base* kw18 = file_format_manager::get_format( kwiver::track_oracle::TF_KW18 );
+  istringstream kept_is( kept.str() );
+  if ( ( ! kw18 ) || ( ! kw18->read( kept_is, tracks )))
+  {
+    return KW18_READ_FAILED;
+  }
+  file_format_schema_type::record_track_source( tracks, fn, kwiver::track_oracle::TF_KW18 );
+  return KW18_PREFILTERED;
+}
+
+//
+// Reading a file creates its tracks in track_oracle, which isn't
+// thread-safe, so the files are parsed one at a time in the given
+// order, as are the length filter and (later) the timestamp
+// statistics, which also read through track_oracle.  Nothing here
+// runs in parallel: with readahead > 0, the OS is asked to read that
+// many files ahead of the parser.
+//
+// kw18 files are pre-filtered on the window and length while being
+// read (see read_kw18_prefiltered.)  Other formats, and kw18 files
+// the pre-filter can't parse, are read whole and filtered afterwards
+// by the checks below, which also run on pre-filtered files to settle
+// the tracks the conservative pre-filter kept.
+//
+
 vector< track_record_type >
-load_tracks_from_file( const input_source_type& src )
+load_tracks_from_file( const input_source_type& src, unsigned readahead )
 {
   vector< track_record_type > ret;
+  const size_t n_files = src.fn_list.size();
 
-  for (unsigned i=0; i<src.fn_list.size(); ++i)
+  size_t n_advised = 0;
+  vector< track_handle_list_type > input_tracks( n_files );
+  for (size_t i=0; i<n_files; ++i)
   {
-    track_record_type r;
-    r.set_src_fn( src.fn_list[i] );
-    LOG_INFO( main_logger, "About to load file " << i+1 << " of " << src.fn_list.size() << " : " << r.src_fn() << "...");
-    track_handle_list_type input_tracks;
-    if ( ! file_format_manager::read( r.src_fn(), input_tracks ))
+    // keep files [i, i+readahead] on their way into the page cache
+    while ( ( readahead > 0 ) && ( n_advised < n_files ) && ( n_advised <= i + readahead ))
+    {
+      advise_track_file_willneed( src.fn_list[ n_advised++ ] );
+    }
+
+    LOG_INFO( main_logger, "About to load file " << i+1 << " of " << n_files << " : " << src.fn_list[i] << "...");
+    kw18_prefilter_status prefiltered = KW18_NOT_PREFILTERED;
+    if ( ( src.load_window.is_valid() || ( src.min_track_length > 0 )) &&
+         ( file_format_manager::detect_format( src.fn_list[i] ) == kwiver::track_oracle::TF_KW18 ))
     {
-      LOG_ERROR( main_logger, "Couldn't load tracks from '" << r.src_fn() << "'");
-      ret.clear();
+      prefiltered = read_kw18_prefiltered( src.fn_list[i], src, input_tracks[i] );
+    }
+    if ( ( prefiltered == KW18_READ_FAILED ) ||
+         ( ( prefiltered == KW18_NOT_PREFILTERED ) && ( ! file_format_manager::read( src.fn_list[i], input_tracks[i] ))))
+    {
+      LOG_ERROR( main_logger, "Couldn't load tracks from '" << src.fn_list[i] << "'");
       return ret;
     }
-    LOG_INFO( main_logger, "read " << input_tracks.size() << " tracks");
+    LOG_INFO( main_logger, "read " << input_tracks[i].size() << " tracks");
+
+    if ( src.load_window.is_valid() )
+    {
+      track_handle_list_type in_window;
+      for (size_t j=0; j<input_tracks[i].size(); ++j)
+      {
+        if ( src.load_window.track_may_pass_filter( input_tracks[i][j] ))
+        {
+          in_window.push_back( input_tracks[i][j] );
+        }
+      }
+      LOG_INFO( main_logger, "Time window filtering on load: kept " << in_window.size() << " of "
+                << input_tracks[i].size() << " tracks" );
+      input_tracks[i].swap( in_window );
+    }
+  }
+  ret.resize( n_files );
+  for (size_t i=0; i<n_files; ++i)
+  {
+    track_record_type& r = ret[i];
+    r.set_src_fn( src.fn_list[i] );
     // only keep tracks longer than the requested number of states
     if ( src.min_track_length > 0 )
     {
       track_handle_list_type filtered;
-      for (size_t j=0; j<input_tracks.size(); ++j)
+      for (size_t j=0; j<input_tracks[i].size(); ++j)
       {
-        size_t n = track_oracle_core::get_n_frames( input_tracks[j] );
+        size_t n = track_oracle_core::get_n_frames( input_tracks[i][j] );
         if (n >= src.min_track_length )
         {
-          filtered.push_back( input_tracks[j] );
+          filtered.push_back( input_tracks[i][j] );
         }
       }
-      LOG_INFO( main_logger, "Track length filtering requested; kept " << filtered.size()
+      LOG_INFO( main_logger, "File " << i+1 << ": track length filtering requested; kept " << filtered.size()
                 << " tracks with length >= " << src.min_track_length );
-      input_tracks = filtered;
+      input_tracks[i].swap( filtered );
     }
-    r.set_tracks( input_tracks );
-    ret.push_back( r );
+    r.set_tracks( input_tracks[i] );
   }
   return ret;
 }
@@ -1061,6 +1226,87 @@ decompose_track_into_frames( const track_handle_type& t )
   return ret;
 }
 
+void
+mark_loaded_tracks( const track_handle_list_type& truth_tracks,
+                    const track_handle_list_type& computed_tracks )
+{
+  track_field< kwiver::track_oracle::dt::utility::state_flags > state_flags;
+  for (size_t i=0; i<truth_tracks.size(); ++i)
+  {
+    const frame_handle_list_type& frames = track_oracle_core::get_frames( truth_tracks[i] );
+    for (size_t j=0; j<frames.size(); ++j)
+    {
+      state_flags( frames[j].row ).set_flag( "ATTR_SCORING_SRC_IS_TRUTH" );
+    }
+  }
+
+  for (size_t i=0; i<computed_tracks.size(); ++i)
+  {
+    const frame_handle_list_type& frames = track_oracle_core::get_frames( computed_tracks[i] );
+    for (size_t j=0; j<frames.size(); ++j)
+    {
+      state_flags( frames[j].row ).set_flag( "ATTR_SCORING_SRC_IS_COMPUTED" );
+    }
+  }
+}
+
+bool
+input_args_type
+::load_snapshot( track_handle_list_type& computed_tracks, track_handle_list_type& truth_tracks )
+{
+  // The snapshot holds the tracks as they were at the end of process(), so
+  // none of the loading options apply.  Radial overlap needs the MGRS data,
+  // which isn't in the snapshot; detection mode must match the snapshot's.
+
+  if ( this->compute_mgrs_data )
+  {
+    LOG_ERROR( main_logger, "Can't compute MGRS data from the track snapshot '" << this->snapshot_in_fn() << "'" );
+    return false;
+  }
+  if ( this->computed_tracks_fn.set() || this->truth_tracks_fn.set() )
+  {
+    LOG_WARN( main_logger, "Loading tracks from " << this->snapshot_in_fn.option() << " '" << this->snapshot_in_fn()
+              << "'; ignoring " << this->computed_tracks_fn.option() << " and " << this->truth_tracks_fn.option() );
+  }
+
+  bool snapshot_detection_mode = false;
+  if ( ! track_set_snapshot::read( this->snapshot_in_fn(), truth_tracks, computed_tracks, snapshot_detection_mode ))
+  {
+    return false;
+  }
+  if ( snapshot_detection_mode != this->detection_mode() )
+  {
+    LOG_ERROR( main_logger, "Track snapshot '" << this->snapshot_in_fn() << "' was "
+               << ( snapshot_detection_mode ? "" : "not " ) << "written in detection mode; "
+               << this->detection_mode.option() << " must match" );
+    return false;
+  }
+  LOG_INFO( main_logger, "Loaded " << truth_tracks.size() << " truth and " << computed_tracks.size()
+            << " computed tracks from snapshot '" << this->snapshot_in_fn() << "'" );
+
+  // --paired-gtct's timestamps are already in the snapshot, but its pair
+  // indices must be too, or the tracks weren't paired when written
+  if ( this->paired_gtct() )
+  {
+    track_field< unsigned > gtct_pair_index( "gtct_pair_index" );
+    for (const track_handle_list_type* tracks: { &truth_tracks, &computed_tracks } )
+    {
+      for (size_t i=0; i<tracks->size(); ++i)
+      {
+        if ( ! gtct_pair_index.exists( (*tracks)[i].row ))
+        {
+          LOG_ERROR( main_logger, "Track snapshot '" << this->snapshot_in_fn() << "' was not written with "
+                     << this->paired_gtct.option() );
+          return false;
+        }
+      }
+    }
+  }
+
+  mark_loaded_tracks( truth_tracks, computed_tracks );
+  return true;
+}
+
 
 
 bool
@@ -1076,6 +1322,11 @@ input_args_type
     return false;
   }
 
+  if ( this->snapshot_in_fn.set() )
+  {
+    return this->load_snapshot( computed_tracks, truth_tracks );
+  }
+
   if ( (this->computed_path() != "") && ( ! vul_file::is_directory( this->computed_path() )))
   {
     LOG_ERROR( main_logger, this->computed_path.option() << " is set to '" << this->computed_path()
@@ -1115,6 +1366,38 @@ input_args_type
     return false;
   }
 
+  //
+  // Filtering on load needs the window before the tracks are loaded, and
+  // in detection mode, the window applies to each detection rather than
+  // to the track as a whole.  It also sees the timestamps as read, so it
+  // can't be used with any option which later rewrites them.
+  //
+
+  if ( this->filter_on_load() )
+  {
+    if ( ( ! this->time_window.set() ) || time_window_filter_factory::code_is_special( this->time_window() ))
+    {
+      LOG_ERROR( main_logger, this->filter_on_load.option() << " requires an explicit " << this->time_window.option() );
+      return false;
+    }
+    if ( this->detection_mode() )
+    {
+      LOG_ERROR( main_logger, "Can't use " << this->filter_on_load.option() << " with " << this->detection_mode.option() );
+      return false;
+    }
+    vector< string > rewrites_timestamps;
+    if ( this->paired_gtct() ) rewrites_timestamps.push_back( this->paired_gtct.option() );
+    if ( this->ts_from_fn() ) rewrites_timestamps.push_back( this->ts_from_fn.option() );
+    if ( this->xgtf_timestamps_fn.set() ) rewrites_timestamps.push_back( this->xgtf_timestamps_fn.option() );
+    if ( this->xgtf_base_ts.set() ) rewrites_timestamps.push_back( this->xgtf_base_ts.option() );
+    for (size_t i=0; i<rewrites_timestamps.size(); ++i)
+    {
+      LOG_ERROR( main_logger, "Can't use " << this->filter_on_load.option() << " with " << rewrites_timestamps[i]
+                 << ", which changes the timestamps after the tracks are loaded" );
+    }
+    if ( ! rewrites_timestamps.empty() ) return false;
+  }
+
   if ( ! (this->computed_tracks_fn.set() && this->truth_tracks_fn.set() ))
   {
     LOG_INFO( main_logger, "Must set both " << this->computed_tracks_fn.option() << " and "
@@ -1135,6 +1418,11 @@ input_args_type
 
   input_source_type computed_src( this->computed_tracks_fn(), this->computed_path, this->computed_fps(), min_computed_length );
   input_source_type truth_src( this->truth_tracks_fn(), this->truth_path, this->truth_fps(), min_truth_length );
+  if ( this->filter_on_load() )
+  {
+    computed_src.load_window = twf;
+    truth_src.load_window = twf;
+  }
 
   // verify we have plausible data in the input sources
   if (computed_src.fn_list.empty())
@@ -1170,7 +1458,7 @@ input_args_type
   comms_xml_reader_opts& comms_opts = dynamic_cast<comms_xml_reader_opts&>( file_format_manager::default_options( kwiver::track_oracle::TF_COMMS_XML));
   comms_opts.set_comms_qid( this->qid() );
 
-  vector< track_record_type > truth_track_records = load_tracks_from_file( truth_src );
+  vector< track_record_type > truth_track_records = load_tracks_from_file( truth_src, this->load_readahead() );
   // Truth tracks must be non-empty, else why are you trying to compute scores?
   if ( truth_track_records.empty() )
   {
@@ -1190,7 +1478,7 @@ input_args_type
     kw18_opts.set_kw19_hack( true );
   }
 
-  vector< track_record_type > computed_track_records = load_tracks_from_file( computed_src );
+  vector< track_record_type > computed_track_records = load_tracks_from_file( computed_src, this->load_readahead() );
 
   // if kw19, reset reader
   if (kw19_hack())
@@ -1266,6 +1554,22 @@ input_args_type
       LOG_INFO( main_logger, "paired-gtct failed; score_tracks_loader returning false" );
       return false;
     }
+
+    // remember which pair each track came from, for partitioned scoring
+    track_field< unsigned > gtct_pair_index( "gtct_pair_index" );
+    for (unsigned i=0; i<truth_track_records.size(); ++i)
+    {
+      const track_handle_list_type& t = truth_track_records[i].tracks();
+      for (size_t j=0; j<t.size(); ++j)
+      {
+        gtct_pair_index( t[j].row ) = i;
+      }
+      const track_handle_list_type& c = computed_track_records[i].tracks();
+      for (size_t j=0; j<c.size(); ++j)
+      {
+        gtct_pair_index( c[j].row ) = i;
+      }
+    }
   }
 
   // If truth tracks do not have timestamps, assign them.
@@ -1547,25 +1851,19 @@ input_args_type
                             computed_track_records[i].tracks().end() );
   }
 
-  // mark all the tracks as "loaded"
-  track_field< kwiver::track_oracle::dt::utility::state_flags > state_flags;
-  for (size_t i=0; i<truth_tracks.size(); ++i)
+  if ( this->snapshot_out_fn.set() )
   {
-    const frame_handle_list_type& frames = track_oracle_core::get_frames( truth_tracks[i] );
-    for (size_t j=0; j<frames.size(); ++j)
+    if ( ! track_set_snapshot::write( this->snapshot_out_fn(), truth_tracks, computed_tracks, this->detection_mode() ))
     {
-      state_flags( frames[j].row ).set_flag( "ATTR_SCORING_SRC_IS_TRUTH" );
+      LOG_ERROR( main_logger, "Couldn't write track snapshot '" << this->snapshot_out_fn() << "'" );
+      return false;
     }
+    LOG_INFO( main_logger, "Wrote " << truth_tracks.size() << " truth and " << computed_tracks.size()
+              << " computed tracks to snapshot '" << this->snapshot_out_fn() << "'" );
   }
 
-  for (size_t i=0; i<computed_tracks.size(); ++i)
-  {
-    const frame_handle_list_type& frames = track_oracle_core::get_frames( computed_tracks[i] );
-    for (size_t j=0; j<frames.size(); ++j)
-    {
-      state_flags( frames[j].row ).set_flag( "ATTR_SCORING_SRC_IS_COMPUTED" );
-    }
-  }
+  // mark all the tracks as "loaded"
+  mark_loaded_tracks( truth_tracks, computed_tracks );
 
   // all done
   return true;
@@ -85,6 +85,8 @@ struct SCORE_TRACKS_LOADER_EXPORT input_args_type
   vul_arg< std::string > xgtf_timestamps_fn;
   vul_arg< std::string > xgtf_base_ts;
 
+  // With paired gt/ct, each track's pair (its index in the file lists)
+  // is recorded in the track field "gtct_pair_index".
   vul_arg< bool > paired_gtct;
   vul_arg< bool > promote_pvmoving;
   vul_arg< std::string > qid;
@@ -103,6 +105,15 @@ struct SCORE_TRACKS_LOADER_EXPORT input_args_type
   // wholly within this window.
   vul_arg< std::string > time_window;
 
+  // If set, apply an explicit --time-window to each file's tracks as
+  // soon as the file is read, so that the tracks outside it are dropped
+  // before any of the per-track processing.  The window is applied to
+  // the tracks as read (tracks without the timestamps are kept until
+  // they've been filled in); the usual filter still runs afterwards.
+  // Not allowed with the options which rewrite timestamps after loading
+  // (--paired-gtct, --fn2ts, and the xgtf timestamp options.)
+  vul_arg< bool > filter_on_load;
+
   // Some file formats, e.g. CSV, do not have a fixed source for the latitude
   // and longitude information required for setting MGRS data for radial overlap
   // computation.  Allow the user to specify these fields as a colon-separated
@@ -117,6 +128,21 @@ struct SCORE_TRACKS_LOADER_EXPORT input_args_type
   // data structure; just break them up into single-frame tracks.
   vul_arg< bool > detection_mode;
 
+  // Track files are parsed one at a time, in order; this many files
+  // ahead of the parser are passed to posix_fadvise( WILLNEED ) so the
+  // OS reads them into the page cache in the background.
+  vul_arg< unsigned > load_readahead;
+
+  // --snapshot-out writes the tracks, as process() returns them, to a
+  // binary snapshot (see track_set_snapshot.h); a later run with
+  // --snapshot-in reads them from the snapshot instead of loading them,
+  // and the other loading options are ignored.  Only the fields used
+  // for scoring tracks and relevancy / activity-typed events (including
+  // kwxml classifiers and track styles) and the --paired-gtct pair
+  // indices are kept; source file IDs are not.
+  vul_arg< std::string > snapshot_out_fn;
+  vul_arg< std::string > snapshot_in_fn;
+
   // this flag is not set directly by an input_args command line variable,
   // but instead is set by the main program via other variables (such as
   // e.g. --radial-overlap).  When set, process() tries to compute MGRS geolocation
@@ -143,9 +169,13 @@ struct SCORE_TRACKS_LOADER_EXPORT input_args_type
       apix_debug_fn(      "--apix-log", "For APIX tracks, log tracks as read to this file", "" ),
       track_length_filter("--track-length-filter", "Only keep (truth:computed) tracks with at least this many states (default: all tracks)", "0:0" ),
       time_window(        "--time-window", "Only select tracks within a time window; 'help' for more details" ),
+      filter_on_load(     "--filter-on-load", "Apply an explicit --time-window to each file's tracks as it is loaded" ),
       mgrs_lon_lat_fields("--mgrs-ll-fields", "For e.g. CSV files, pull longitude / latitude from these fields", "world_x:world_y" ),
       kw19_hack(          "--kw19-hack", "If set, read confidence / probability / etc. from 19th column (computed only)" ),
       detection_mode(     "--detection-mode", "Convert truth and computed tracks to single-frame tracks to score as detections" ),
+      load_readahead(     "--load-readahead", "Ask the OS to read this many track files ahead of the (single-threaded) parser", 0 ),
+      snapshot_out_fn(    "--snapshot-out", "Write the loaded truth and computed tracks to this binary snapshot" ),
+      snapshot_in_fn(     "--snapshot-in", "Load the truth and computed tracks from this binary snapshot" ),
       compute_mgrs_data( false )
   {}
 
@@ -153,6 +183,10 @@ struct SCORE_TRACKS_LOADER_EXPORT input_args_type
   bool process( kwiver::track_oracle::track_handle_list_type& computed_tracks,
                 kwiver::track_oracle::track_handle_list_type& truth_tracks );
 
+private:
+  bool load_snapshot( kwiver::track_oracle::track_handle_list_type& computed_tracks,
+                      kwiver::track_oracle::track_handle_list_type& truth_tracks );
+
 };
 
 } // ...kwant
@@ -0,0 +1,322 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "sparse_assignment.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+
+#include <scoring_framework/parallel_for.h>
+
+using std::greater;
+using std::make_pair;
+using std::max;
+using std::numeric_limits;
+using std::pair;
+using std::priority_queue;
+using std::runtime_error;
+using std::stable_sort;
+using std::swap;
+using std::vector;
+
+namespace // anon
+{
+
+using kwiver::kwant::sparse_assignment;
+
+const size_t npos = sparse_assignment::npos;
+
+//
+// union-find over the rows [0, n_rows) and columns [n_rows, n_rows+n_cols)
+//
+
+size_t
+find_root( vector< size_t >& parent, size_t x )
+{
+  while ( parent[x] != x )
+  {
+    parent[x] = parent[ parent[x] ];
+    x = parent[x];
+  }
+  return x;
+}
+
+//
+// One connected component, renumbered locally: rows 0..R-1 (global
+// rows[r]), real columns 0..C-1 (global cols[c]), and a private dummy
+// column C+r for each row r, meaning "row r is unassigned".  Edge costs
+// are (W - weight) for real edges and W for the dummies, where W is the
+// largest weight in the component, so a minimum-cost row-perfect
+// assignment is a maximum-weight assignment of the original graph.
+//
+
+struct component_type
+{
+  vector< size_t > rows, cols;
+  vector< size_t > edge_begin;         // rows.size()+1 offsets
+  vector< size_t > edge_col;           // local column
+  vector< long long > edge_cost;
+  long long dummy_cost;
+};
+
+//
+// Shortest augmenting paths (as in Jonker-Volgenant), one row at a
+// time, with Dijkstra over the sparse edges using the dual variables
+// u, v to keep the reduced costs non-negative.  Every row can always
+// reach its dummy, so every search ends at a free column.  Returns the
+// local column of each local row.
+//
+
+vector< size_t >
+solve_component( const component_type& comp )
+{
+  typedef pair< long long, size_t > heap_entry;
+  const long long inf = numeric_limits< long long >::max();
+
+  size_t n_rows = comp.rows.size();
+  size_t n_real = comp.cols.size();
+  size_t n_cols = n_real + n_rows;
+
+  vector< long long > u( n_rows, 0 ), v( n_cols, 0 );
+  vector< size_t > col4row( n_rows, npos ), row4col( n_cols, npos );
+  vector< long long > dist( n_cols, inf );
+  vector< size_t > path( n_cols, npos );
+  vector< unsigned char > scanned( n_cols, 0 );
+  vector< size_t > touched, scanned_rows;
+
+  for (size_t cur = 0; cur < n_rows; ++cur)
+  {
+    priority_queue< heap_entry, vector< heap_entry >, greater< heap_entry > > heap;
+    touched.clear();
+    scanned_rows.clear();
+
+    long long min_val = 0;
+    size_t i = cur;
+    size_t sink = npos;
+    while ( sink == npos )
+    {
+      scanned_rows.push_back( i );
+
+      // relax the edges of row i, then its dummy
+      for (size_t e = comp.edge_begin[i]; e <= comp.edge_begin[i+1]; ++e)
+      {
+        bool is_dummy = ( e == comp.edge_begin[i+1] );
+        size_t j = is_dummy ? n_real + i : comp.edge_col[e];
+        long long cost = is_dummy ? comp.dummy_cost : comp.edge_cost[e];
+        if ( scanned[j] ) continue;
+        long long r = min_val + cost - u[i] - v[j];
+        if ( r < dist[j] )
+        {
+          if ( dist[j] == inf ) touched.push_back( j );
+          dist[j] = r;
+          path[j] = i;
+          heap.push( make_pair( r, j ));
+        }
+      }
+
+      // closest unscanned column; skip stale heap entries
+      size_t j = npos;
+      while ( j == npos )
+      {
+        if ( heap.empty() )
+        {
+          throw runtime_error( "sparse_assignment: no augmenting path (internal error)" );
+        }
+        heap_entry top = heap.top();
+        heap.pop();
+        if ( ( ! scanned[ top.second ] ) && ( top.first == dist[ top.second ] ))
+        {
+          j = top.second;
+        }
+      }
+
+      min_val = dist[j];
+      scanned[j] = 1;
+      if ( row4col[j] == npos )
+      {
+        sink = j;
+      }
+      else
+      {
+        i = row4col[j];
+      }
+    }
+
+    // update the duals
+    u[cur] += min_val;
+    for (size_t k = 1; k < scanned_rows.size(); ++k)
+    {
+      size_t r = scanned_rows[k];
+      u[r] += min_val - dist[ col4row[r] ];
+    }
+    for (size_t k = 0; k < touched.size(); ++k)
+    {
+      size_t j = touched[k];
+      if ( scanned[j] )
+      {
+        v[j] -= min_val - dist[j];
+      }
+      dist[j] = inf;
+      scanned[j] = 0;
+    }
+
+    // augment along the path back to cur
+    for (size_t j = sink; ; )
+    {
+      size_t r = path[j];
+      row4col[j] = r;
+      swap( col4row[r], j );
+      if ( r == cur ) break;
+    }
+  }
+
+  return col4row;
+}
+
+} // ...anon
+
+namespace kwiver {
+namespace kwant {
+
+const size_t sparse_assignment::npos;
+
+void
+sparse_assignment
+::add_edge( size_t col, unsigned weight )
+{
+  if ( col >= this->n_cols )
+  {
+    throw runtime_error( "sparse_assignment: column out of range" );
+  }
+  if ( weight == 0 )
+  {
+    throw runtime_error( "sparse_assignment: weights must be positive" );
+  }
+  this->cols.push_back( col );
+  this->weights.push_back( weight );
+}
+
+void
+sparse_assignment
+::end_row()
+{
+  this->row_begin.push_back( this->cols.size() );
+}
+
+unsigned long long
+sparse_assignment
+::solve( unsigned n_threads )
+{
+  size_t n_rows = this->n_rows();
+  this->col_for_row.assign( n_rows, npos );
+  this->row_for_col.assign( this->n_cols, npos );
+
+  // connected components
+  vector< size_t > parent( n_rows + this->n_cols );
+  for (size_t k = 0; k < parent.size(); ++k)
+  {
+    parent[k] = k;
+  }
+  for (size_t i = 0; i < n_rows; ++i)
+  {
+    for (size_t e = this->row_begin[i]; e < this->row_begin[i+1]; ++e)
+    {
+      size_t a = find_root( parent, i );
+      size_t b = find_root( parent, n_rows + this->cols[e] );
+      if ( a != b ) parent[ max( a, b ) ] = std::min( a, b );
+    }
+  }
+
+  // gather the rows of each component (in row order), skipping rows
+  // without edges
+  vector< size_t > comp_of_root( parent.size(), npos );
+  vector< component_type > comps;
+  vector< size_t > local_col( this->n_cols, npos );
+  for (size_t i = 0; i < n_rows; ++i)
+  {
+    if ( this->row_begin[i] == this->row_begin[i+1] ) continue;
+    size_t root = find_root( parent, i );
+    if ( comp_of_root[ root ] == npos )
+    {
+      comp_of_root[ root ] = comps.size();
+      comps.push_back( component_type() );
+      comps.back().edge_begin.push_back( 0 );
+    }
+    component_type& comp = comps[ comp_of_root[ root ]];
+    comp.rows.push_back( i );
+    for (size_t e = this->row_begin[i]; e < this->row_begin[i+1]; ++e)
+    {
+      size_t c = this->cols[e];
+      if ( local_col[c] == npos )
+      {
+        local_col[c] = comp.cols.size();
+        comp.cols.push_back( c );
+      }
+      comp.edge_col.push_back( local_col[c] );
+      comp.edge_cost.push_back( this->weights[e] );
+    }
+    comp.edge_begin.push_back( comp.edge_col.size() );
+  }
+
+  // turn the weights into costs
+  for (size_t k = 0; k < comps.size(); ++k)
+  {
+    component_type& comp = comps[k];
+    long long w_max = *std::max_element( comp.edge_cost.begin(), comp.edge_cost.end() );
+    for (size_t e = 0; e < comp.edge_cost.size(); ++e)
+    {
+      comp.edge_cost[e] = w_max - comp.edge_cost[e];
+    }
+    comp.dummy_cost = w_max;
+  }
+
+  // hand out the biggest components first, for balance
+  vector< size_t > order( comps.size() );
+  for (size_t k = 0; k < order.size(); ++k)
+  {
+    order[k] = k;
+  }
+  stable_sort( order.begin(), order.end(), [&]( size_t a, size_t b )
+  {
+    return comps[a].edge_col.size() > comps[b].edge_col.size();
+  });
+
+  parallel_for( n_threads, order.size(), [&]( size_t k )
+  {
+    const component_type& comp = comps[ order[k] ];
+    vector< size_t > col4row = solve_component( comp );
+    for (size_t r = 0; r < col4row.size(); ++r)
+    {
+      if ( col4row[r] >= comp.cols.size() ) continue;  // dummy
+      size_t row = comp.rows[r];
+      size_t col = comp.cols[ col4row[r] ];
+      this->col_for_row[ row ] = col;
+      this->row_for_col[ col ] = row;
+    }
+  });
+
+  unsigned long long total = 0;
+  for (size_t i = 0; i < n_rows; ++i)
+  {
+    if ( this->col_for_row[i] == npos ) continue;
+    for (size_t e = this->row_begin[i]; e < this->row_begin[i+1]; ++e)
+    {
+      if ( this->cols[e] == this->col_for_row[i] )
+      {
+        total += this->weights[e];
+        break;
+      }
+    }
+  }
+  return total;
+}
+
+} // ...kwant
+} // ...kwiver
@@ -0,0 +1,67 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_SPARSE_ASSIGNMENT_H
+#define INCL_SPARSE_ASSIGNMENT_H
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace kwiver {
+namespace kwant {
+
+//
+// A maximum-weight one-to-one assignment between the rows and columns
+// of a sparse bipartite graph.  Rows and columns may be left
+// unassigned; the sum of the weights of the assigned edges is maximal.
+//
+// The graph is given in CSR form: the edges of row i are
+// cols[ row_begin[i] .. row_begin[i+1] ), with the matching weights.
+// Weights must be positive; repeated (row, col) edges are not allowed.
+//
+// The graph is split into connected components, which are solved
+// independently on n_threads worker threads (see parallel_for.)  Each
+// component is solved exactly by shortest augmenting paths
+// (Jonker-Volgenant, with Dijkstra over the sparse edges and integer
+// costs), so the result is the same for any n_threads.
+//
+
+struct SCORE_CORE_EXPORT sparse_assignment
+{
+public:
+  static const size_t npos = static_cast< size_t >( -1 );
+
+  // input graph
+  size_t n_cols;
+  std::vector< size_t > row_begin;    // n_rows()+1 offsets into cols / weights
+  std::vector< size_t > cols;
+  std::vector< unsigned > weights;
+
+  // output: the column assigned to each row, or npos; and vice versa
+  std::vector< size_t > col_for_row;
+  std::vector< size_t > row_for_col;
+
+  sparse_assignment()
+    : n_cols( 0 ), row_begin( 1, 0 )
+  {}
+
+  size_t n_rows() const { return row_begin.size() - 1; }
+
+  // append the next row's edges one at a time, then call end_row()
+  void add_edge( size_t col, unsigned weight );
+  void end_row();
+
+  // returns the total weight of the assignment
+  unsigned long long solve( unsigned n_threads );
+};
+
+} // ...kwant
+} // ...kwiver
+
+#endif
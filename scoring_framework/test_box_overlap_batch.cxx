@@ -0,0 +1,183 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+//
+// Check that box_overlap_batch, with whichever kernel this CPU gets,
+// gives exactly the results of the per-pair vgl arithmetic phase 1
+// used before the batch (vgl_intersection, vgl_area, and the centroid
+// and bottom-center distances.)  Batch sizes cover the vector kernels'
+// scalar tails.  Also check that compute_pair() agrees with the batch.
+//
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <testlib/testlib_test.h>
+
+#include <vgl/vgl_area.h>
+#include <vgl/vgl_box_2d.h>
+#include <vgl/vgl_intersection.h>
+
+#include <scoring_framework/box_overlap_batch.h>
+
+using std::mt19937;
+using std::ostringstream;
+using std::sqrt;
+using std::string;
+using std::vector;
+
+using kwiver::kwant::box_overlap_batch;
+
+namespace // anon
+{
+
+typedef vgl_box_2d<double> bbox_type;
+
+struct reference_overlap
+{
+  bool intersects;
+  double a_area, b_area, overlap_area;
+  double centroid_distance, center_bottom_distance;
+};
+
+reference_overlap
+reference( const bbox_type& a, const bbox_type& b )
+{
+  reference_overlap ret;
+  bbox_type bi = vgl_intersection( a, b );
+  ret.intersects = ! bi.is_empty();
+  ret.a_area = vgl_area( a );
+  ret.b_area = vgl_area( b );
+  ret.overlap_area = ret.intersects ? vgl_area( bi ) : 0.0;
+
+  double dx = a.centroid_x() - b.centroid_x();
+  double d_center_y = a.centroid_y() - b.centroid_y();
+  double d_bottom_y = a.max_y() - b.max_y();
+  ret.centroid_distance = sqrt( (dx*dx) + (d_center_y*d_center_y) );
+  ret.center_bottom_distance = sqrt( (dx*dx) + (d_bottom_y*d_bottom_y) );
+  return ret;
+}
+
+//
+// A box near (cx, cy) of up to max_side a side; coordinates are
+// either integral (as most track formats give them) or arbitrary.
+//
+
+bbox_type
+random_box( mt19937& rng, double cx, double cy, double max_side, bool integral )
+{
+  double v[4];
+  for (unsigned k=0; k<4; ++k)
+  {
+    v[k] = ( rng() % 100000 ) / 100000.0 * max_side;
+    if ( integral ) v[k] = std::floor( v[k] );
+  }
+  return bbox_type( cx - v[0], cx + v[1], cy - v[2], cy + v[3] );
+}
+
+} // ...anon
+
+void
+test_box_overlap_batch()
+{
+  ostringstream kernel_msg;
+  kernel_msg << "Kernel '" << box_overlap_batch::kernel_name() << "' is one of avx, sse2, scalar";
+  string kernel( box_overlap_batch::kernel_name() );
+  bool known_kernel = ( kernel == "avx" ) || ( kernel == "sse2" ) || ( kernel == "scalar" );
+  TEST( kernel_msg.str().c_str(), known_kernel );
+
+  mt19937 rng( 42 );
+  const size_t batch_sizes[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 31, 1000 };
+
+  for (size_t s=0; s<sizeof( batch_sizes ) / sizeof( batch_sizes[0] ); ++s)
+  {
+    size_t n = batch_sizes[s];
+    box_overlap_batch batch;
+    vector< reference_overlap > expected;
+    batch.reserve( n );
+    for (size_t i=0; i<n; ++i)
+    {
+      bool integral = ( i % 3 ) != 0;
+      bbox_type a = random_box( rng, 100.0, 100.0, 40.0, integral );
+
+      // mostly near a, so that about half the pairs intersect; some
+      // share an edge or a corner, or are identical
+      bbox_type b;
+      switch ( i % 8 )
+      {
+      case 0: b = a; break;
+      case 1: b = bbox_type( a.max_x(), a.max_x() + 10.0, a.min_y(), a.max_y() ); break;
+      case 2: b = bbox_type( a.max_x(), a.max_x() + 5.0, a.max_y(), a.max_y() + 5.0 ); break;
+      default: b = random_box( rng, 100.0 + ( rng() % 120 ) - 60.0, 100.0 + ( rng() % 120 ) - 60.0, 40.0, integral );
+      }
+
+      batch.add( a, b );
+      expected.push_back( reference( a, b ));
+    }
+
+    batch.compute();
+
+    unsigned n_hit_mismatch = 0, n_value_mismatch = 0, n_pair_mismatch = 0, n_hits = 0;
+    bool sizes_ok =
+      ( batch.size() == n ) && ( batch.intersects.size() == n ) &&
+      ( batch.a_area.size() == n ) && ( batch.b_area.size() == n ) && ( batch.overlap_area.size() == n ) &&
+      ( batch.centroid_distance.size() == n ) && ( batch.center_bottom_distance.size() == n );
+    for (size_t i=0; sizes_ok && ( i<n ); ++i)
+    {
+      const reference_overlap& e = expected[i];
+      box_overlap_batch::pair_result p = box_overlap_batch::compute_pair(
+        bbox_type( batch.a_min_x[i], batch.a_max_x[i], batch.a_min_y[i], batch.a_max_y[i] ),
+        bbox_type( batch.b_min_x[i], batch.b_max_x[i], batch.b_min_y[i], batch.b_max_y[i] ));
+      if ( ( p.intersects != ( batch.intersects[i] != 0 )) ||
+           ( p.intersects &&
+             ( ( p.a_area != batch.a_area[i] ) || ( p.b_area != batch.b_area[i] ) ||
+               ( p.overlap_area != batch.overlap_area[i] ) ||
+               ( p.centroid_distance != batch.centroid_distance[i] ) ||
+               ( p.center_bottom_distance != batch.center_bottom_distance[i] ))))
+      {
+        ++n_pair_mismatch;
+      }
+
+      if ( ( batch.intersects[i] != 0 ) != e.intersects )
+      {
+        ++n_hit_mismatch;
+        continue;
+      }
+      if ( ! e.intersects ) continue;
+
+      // only meaningful where the boxes intersect
+      ++n_hits;
+      if ( ( batch.a_area[i] != e.a_area ) ||
+           ( batch.b_area[i] != e.b_area ) ||
+           ( batch.overlap_area[i] != e.overlap_area ) ||
+           ( batch.centroid_distance[i] != e.centroid_distance ) ||
+           ( batch.center_bottom_distance[i] != e.center_bottom_distance ))
+      {
+        ++n_value_mismatch;
+      }
+    }
+
+    ostringstream oss;
+    oss << "Batch of " << n << " (" << n_hits << " intersecting): ";
+    TEST( ( oss.str() + "output sizes" ).c_str(), sizes_ok );
+    TEST( ( oss.str() + "intersection flags match vgl" ).c_str(), n_hit_mismatch == 0 );
+    TEST( ( oss.str() + "areas and distances match vgl exactly" ).c_str(), n_value_mismatch == 0 );
+    TEST( ( oss.str() + "compute_pair() matches the batch" ).c_str(), n_pair_mismatch == 0 );
+  }
+
+  // clear() empties the batch for reuse
+  box_overlap_batch batch;
+  batch.add( bbox_type( 0, 1, 0, 1 ), bbox_type( 0, 1, 0, 1 ));
+  batch.compute();
+  batch.clear();
+  batch.compute();
+  TEST( "clear() leaves an empty batch", ( batch.size() == 0 ) && batch.intersects.empty() );
+}
+
+TESTMAIN( test_box_overlap_batch );
@@ -0,0 +1,680 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+//
+// Check phase 1 on random track sets against a reference which
+// compares every truth track with every computed track the way phase 1
+// originally did: frame handles sorted by timestamp, align_frames(),
+// and compute_spatial_overlap() on each aligned pair of frames.  This
+// exercises the temporal candidate sweep, the frame snapshots, the
+// batched box arithmetic, the worker threads and the association
+// matrix together.  Also checked:
+//
+// - compute_all_detection_mode (frame grid, threads) against the
+//   reference over the detections on each frame;
+// - track2track_phase1_sweep::select() against compute_all() with the
+//   same per-frame filters;
+// - phase1_cache: a hit restores what compute_all() produced;
+// - compute_all_masked() (and its detection mode) against the full
+//   run's entries whose tracks' masks intersect;
+// - compute_single() over every pair, in random order, against
+//   compute_all() (the association matrix's pending single inserts.)
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <testlib/testlib_test.h>
+
+#include <vgl/vgl_box_2d.h>
+
+#include <track_oracle/core/track_oracle_core.h>
+
+#include <scoring_framework/phase1_cache.h>
+#include <scoring_framework/phase1_parameters.h>
+#include <scoring_framework/score_core.h>
+#include <scoring_framework/score_phase1.h>
+#include <scoring_framework/track_synthesizer.h>
+
+using std::make_pair;
+using std::map;
+using std::mt19937;
+using std::ostringstream;
+using std::pair;
+using std::string;
+using std::vector;
+
+using kwiver::track_oracle::frame_handle_list_type;
+using kwiver::track_oracle::frame_handle_type;
+using kwiver::track_oracle::oracle_entry_handle_type;
+using kwiver::track_oracle::track_handle_list_type;
+using kwiver::track_oracle::track_handle_type;
+using kwiver::track_oracle::track_oracle_core;
+
+using namespace kwiver::kwant;
+
+namespace // anon
+{
+
+typedef vgl_box_2d<double> bbox_type;
+
+//
+// A random box of 20 to 60 pixels a side with its corner in the given
+// range.
+//
+
+bbox_type
+random_box( mt19937& rng, double x0, double y0, double range )
+{
+  double x = x0 + ( rng() % static_cast< unsigned >( range ));
+  double y = y0 + ( rng() % static_cast< unsigned >( range ));
+  return bbox_type( x, x + 20 + rng() % 40, y, y + 20 + rng() % 40 );
+}
+
+//
+// Random truth tracks over n_frames frames, and computed tracks of
+// which about half follow (with some jitter and different extents and
+// frame rates) one of the truth tracks.
+//
+
+void
+make_track_sets( mt19937& rng, const track_synthesizer& ts, unsigned n_frames,
+                 size_t n_truth, size_t n_computed,
+                 track_handle_list_type& truth, track_handle_list_type& computed )
+{
+  struct path { unsigned first, length, step; bbox_type box; double dx, dy; };
+  vector< path > truth_paths;
+  for (size_t i=0; i<n_truth; ++i)
+  {
+    path p;
+    p.first = rng() % n_frames;
+    p.length = 1 + rng() % 60;
+    p.step = ( rng() % 4 == 0 ) ? 2 : 1;
+    p.box = random_box( rng, 0, 0, 400 );
+    p.dx = ( static_cast< double >( rng() % 13 ) - 6.0 ) / 2.0;
+    p.dy = ( static_cast< double >( rng() % 13 ) - 6.0 ) / 2.0;
+    truth_paths.push_back( p );
+    truth.push_back( ts.make_linear_track( 100 + i, p.first, p.length, p.step, p.box, p.dx, p.dy ));
+  }
+
+  for (size_t i=0; i<n_computed; ++i)
+  {
+    path p;
+    if ( ( ! truth_paths.empty() ) && ( rng() % 2 ))
+    {
+      p = truth_paths[ rng() % truth_paths.size() ];
+      unsigned shift = rng() % 11;
+      p.first = ( p.first > shift ) ? p.first - shift + rng() % ( 2*shift + 1 ) : p.first + rng() % ( shift + 1 );
+      p.length = 1 + rng() % ( p.length + 10 );
+      p.step = 1 + rng() % 2;
+      double jx = static_cast< double >( rng() % 21 ) - 10.0, jy = static_cast< double >( rng() % 21 ) - 10.0;
+      p.box = bbox_type( p.box.min_x() + jx, p.box.max_x() + jx, p.box.min_y() + jy, p.box.max_y() + jy );
+    }
+    else
+    {
+      p.first = rng() % n_frames;
+      p.length = 1 + rng() % 60;
+      p.step = 1;
+      p.box = random_box( rng, 0, 0, 400 );
+      p.dx = ( static_cast< double >( rng() % 13 ) - 6.0 ) / 2.0;
+      p.dy = ( static_cast< double >( rng() % 13 ) - 6.0 ) / 2.0;
+    }
+    computed.push_back( ts.make_linear_track( 1000 + i, p.first, p.length, p.step, p.box, p.dx, p.dy ));
+  }
+}
+
+//
+// Single-frame detections: up to six truth boxes per frame, with
+// computed boxes near some of them plus a few strays.
+//
+
+void
+make_detection_sets( mt19937& rng, const track_synthesizer& ts, unsigned n_frames,
+                     track_handle_list_type& truth, track_handle_list_type& computed )
+{
+  unsigned id = 0;
+  for (unsigned f=0; f<n_frames; ++f)
+  {
+    unsigned n = rng() % 7;
+    for (unsigned k=0; k<n; ++k)
+    {
+      bbox_type box = random_box( rng, 0, 0, 300 );
+      truth.push_back( ts.make_linear_track( id++, f, 1, 1, box, 0, 0 ));
+      if ( rng() % 3 )
+      {
+        double jx = static_cast< double >( rng() % 31 ) - 15.0, jy = static_cast< double >( rng() % 31 ) - 15.0;
+        bbox_type c( box.min_x() + jx, box.max_x() + jx, box.min_y() + jy, box.max_y() + jy );
+        computed.push_back( ts.make_linear_track( id++, f, 1, 1, c, 0, 0 ));
+      }
+    }
+    if ( rng() % 4 == 0 )
+    {
+      computed.push_back( ts.make_linear_track( id++, f, 1, 1, random_box( rng, 0, 0, 300 ), 0, 0 ));
+    }
+  }
+}
+
+frame_handle_list_type
+frames_by_timestamp( const track_handle_type& t )
+{
+  scorable_track_type s;
+  frame_handle_list_type frames = track_oracle_core::get_frames( t );
+  std::stable_sort( frames.begin(), frames.end(),
+                    [&]( const frame_handle_type& a, const frame_handle_type& b )
+                    { return s[ a ].timestamp_usecs() < s[ b ].timestamp_usecs(); } );
+  return frames;
+}
+
+//
+// Phase 1 on one pair as originally computed, for parameters with no
+// per-frame filters and no minimum frame count (so that every non-empty
+// overlap with an AOI match counts.)
+//
+
+struct reference_match
+{
+  ts_frame_range range;
+  vector< pair< oracle_entry_handle_type, oracle_entry_handle_type > > frames;
+};
+
+reference_match
+reference_phase1( const track_handle_type& t, const track_handle_type& c, const phase1_parameters& params )
+{
+  scorable_track_type s;
+  track2track_score score;
+  reference_match ret;
+  ret.range = make_pair( std::numeric_limits< ts_type >::max(), std::numeric_limits< ts_type >::min() );
+
+  vector< pair< frame_handle_type, frame_handle_type > > aligned =
+    score.align_frames( frames_by_timestamp( t ), frames_by_timestamp( c ), params.frame_alignment_time_window_usecs );
+  for (size_t i=0; i<aligned.size(); ++i)
+  {
+    track2track_frame_overlap_record r = score.compute_spatial_overlap( aligned[i].first, aligned[i].second, params );
+    bool aoi_match = params.b_aoi.is_empty() || ( r.in_aoi == params.aoiInclusive );
+    if ( ( ! aoi_match ) || ( r.overlap_area == 0 )) continue;
+
+    ts_type t_ts = s[ aligned[i].first ].timestamp_usecs(), c_ts = s[ aligned[i].second ].timestamp_usecs();
+    ret.range.first = std::min( ret.range.first, std::min( t_ts, c_ts ));
+    ret.range.second = std::max( ret.range.second, std::max( t_ts, c_ts ));
+    ret.frames.push_back( make_pair( aligned[i].first.row, aligned[i].second.row ));
+  }
+  return ret;
+}
+
+//
+// The frame_has_been_matched state of every frame of the tracks.
+//
+
+vector< int >
+match_states( const track_handle_list_type& tracks )
+{
+  scorable_track_type s;
+  vector< int > ret;
+  for (size_t i=0; i<tracks.size(); ++i)
+  {
+    frame_handle_list_type frames = track_oracle_core::get_frames( tracks[i] );
+    for (size_t j=0; j<frames.size(); ++j)
+    {
+      pair< bool, int > probe = s.frame_has_been_matched.get( frames[j].row );
+      ret.push_back( probe.first ? probe.second : static_cast< int >( IN_AOI_UNMATCHED ));
+    }
+  }
+  return ret;
+}
+
+void
+set_match_states( const track_handle_list_type& tracks, const vector< int >& states, size_t& k )
+{
+  scorable_track_type s;
+  for (size_t i=0; i<tracks.size(); ++i)
+  {
+    frame_handle_list_type frames = track_oracle_core::get_frames( tracks[i] );
+    for (size_t j=0; j<frames.size(); ++j)
+    {
+      s[ frames[j] ].frame_has_been_matched() = states[ k++ ];
+    }
+  }
+}
+
+void
+restore_match_states( const track_handle_list_type& t, const track_handle_list_type& c, const vector< int >& states )
+{
+  size_t k = 0;
+  set_match_states( t, states, k );
+  set_match_states( c, states, k );
+}
+
+vector< int >
+all_match_states( const track_handle_list_type& t, const track_handle_list_type& c )
+{
+  vector< int > ret = match_states( t ), c_states = match_states( c );
+  ret.insert( ret.end(), c_states.begin(), c_states.end() );
+  return ret;
+}
+
+//
+// Compare phase 1 results against the reference over all pairs (or,
+// if same_frame_only, the detections on the same frame); returns the
+// number of mismatched pairs.  Also checks that exactly the frames of
+// the reference overlaps were marked as matched.
+//
+
+unsigned
+check_against_reference( const track2track_phase1& p1,
+                         const track_handle_list_type& t,
+                         const track_handle_list_type& c,
+                         const vector< int >& states_before,
+                         bool same_frame_only,
+                         unsigned& n_matched_pairs,
+                         bool& states_ok )
+{
+  scorable_track_type s;
+  unsigned n_bad = 0;
+  size_t n_expected = 0;
+  n_matched_pairs = 0;
+
+  vector< oracle_entry_handle_type > matched_frames;
+  for (size_t i=0; i<t.size(); ++i)
+  {
+    for (size_t j=0; j<c.size(); ++j)
+    {
+      if ( same_frame_only )
+      {
+        frame_handle_list_type ft = track_oracle_core::get_frames( t[i] ), fc = track_oracle_core::get_frames( c[j] );
+        if ( s[ ft[0] ].timestamp_frame() != s[ fc[0] ].timestamp_frame() ) continue;
+      }
+
+      reference_match ref = reference_phase1( t[i], c[j], p1.params );
+      track2track_phase1::t2t_type::const_iterator probe = p1.t2t.find( make_pair( t[i], c[j] ));
+      bool found = ( probe != p1.t2t.end() );
+      if ( ref.frames.empty() )
+      {
+        if ( found ) ++n_bad;
+        continue;
+      }
+
+      ++n_expected;
+      if ( ! found )
+      {
+        ++n_bad;
+        continue;
+      }
+      ++n_matched_pairs;
+
+      const track2track_score& score = probe->second;
+      bool ok =
+        ( score.spatial_overlap_total_frames == ref.frames.size() ) &&
+        ( score.overlap_frame_range == ref.range ) &&
+        ( score.n_frame_overlaps() == ref.frames.size() );
+      for (size_t k=0; ok && ( k<ref.frames.size() ); ++k)
+      {
+        const track2track_compact_overlap_record& r = score.compact_overlap( k );
+        ok = ( r.truth_frame.row == ref.frames[k].first ) && ( r.computed_frame.row == ref.frames[k].second );
+      }
+      if ( ! ok ) ++n_bad;
+
+      for (size_t k=0; k<ref.frames.size(); ++k)
+      {
+        matched_frames.push_back( ref.frames[k].first );
+        matched_frames.push_back( ref.frames[k].second );
+      }
+    }
+  }
+  if ( p1.t2t.size() != n_expected ) ++n_bad;
+
+  // every frame keeps its state unless a reference overlap matched it
+  std::sort( matched_frames.begin(), matched_frames.end() );
+  vector< int > expected_states( states_before );
+  size_t k = 0;
+  const track_handle_list_type* lists[2] = { &t, &c };
+  for (size_t l=0; l<2; ++l)
+  {
+    for (size_t i=0; i<lists[l]->size(); ++i)
+    {
+      frame_handle_list_type frames = track_oracle_core::get_frames( (*lists[l])[i] );
+      for (size_t j=0; j<frames.size(); ++j, ++k)
+      {
+        if ( std::binary_search( matched_frames.begin(), matched_frames.end(), frames[j].row ))
+        {
+          expected_states[k] = IN_AOI_MATCHED;
+        }
+      }
+    }
+  }
+  states_ok = ( all_match_states( t, c ) == expected_states );
+  return n_bad;
+}
+
+bool
+same_records( const track2track_compact_overlap_record& a, const track2track_compact_overlap_record& b )
+{
+  return
+    ( a.truth_frame.row == b.truth_frame.row ) && ( a.computed_frame.row == b.computed_frame.row ) &&
+    ( a.fL_frame_num == b.fL_frame_num ) && ( a.fR_frame_num == b.fR_frame_num ) &&
+    ( a.truth_area == b.truth_area ) && ( a.computed_area == b.computed_area ) &&
+    ( a.overlap_area == b.overlap_area ) && ( a.centroid_distance == b.centroid_distance ) &&
+    ( a.center_bottom_distance == b.center_bottom_distance ) && ( a.flags == b.flags );
+}
+
+//
+// Two phase 1 results hold the same pairs, aggregates and frame
+// overlaps, in the same order.
+//
+
+bool
+same_results( const track2track_phase1& a, const track2track_phase1& b )
+{
+  if ( a.t2t.size() != b.t2t.size() ) return false;
+  for (track2track_phase1::t2t_type::const_iterator i = a.t2t.begin(), j = b.t2t.begin();
+       i != a.t2t.end();
+       ++i, ++j)
+  {
+    if ( ( i->first.first.row != j->first.first.row ) || ( i->first.second.row != j->first.second.row )) return false;
+    const track2track_score& x = i->second;
+    const track2track_score& y = j->second;
+    if ( ( x.spatial_overlap_total_frames != y.spatial_overlap_total_frames ) ||
+         ( x.overlap_frame_range != y.overlap_frame_range ) ||
+         ( x.n_frame_overlaps() != y.n_frame_overlaps() ))
+    {
+      return false;
+    }
+    for (size_t k=0; k<x.n_frame_overlaps(); ++k)
+    {
+      if ( ! same_records( x.compact_overlap( k ), y.compact_overlap( k ))) return false;
+    }
+  }
+  return true;
+}
+
+void
+test_compute_all( mt19937& rng, const track_synthesizer& ts, bool use_aoi )
+{
+  string tag = use_aoi ? "[AOI] " : "";
+  track_handle_list_type all_t, all_c;
+  make_track_sets( rng, ts, 400, 60, 90, all_t, all_c );
+
+  phase1_parameters params;
+  if ( use_aoi )
+  {
+    params.setAOI( bbox_type( 50, 300, 80, 350 ), /* inclusive = */ true );
+  }
+  else
+  {
+    restore_match_states( all_t, all_c, vector< int >( all_match_states( all_t, all_c ).size(), IN_AOI_UNMATCHED ));
+  }
+  track_handle_list_type t, c;
+  params.filter_track_list_on_aoi( all_t, t );
+  params.filter_track_list_on_aoi( all_c, c );
+  vector< int > states_before = all_match_states( t, c );
+
+  const unsigned thread_counts[] = { 1, 4 };
+  vector< track2track_phase1 > results;
+  for (size_t n=0; n<2; ++n)
+  {
+    restore_match_states( t, c, states_before );
+    params.n_threads = thread_counts[n];
+    track2track_phase1 p1( params );
+    p1.compute_all( t, c );
+
+    unsigned n_matched = 0;
+    bool states_ok = false;
+    unsigned n_bad = check_against_reference( p1, t, c, states_before, false, n_matched, states_ok );
+    ostringstream oss;
+    oss << tag << "compute_all on " << thread_counts[n] << " thread(s) matches the all-pairs reference ("
+        << n_matched << " matched pairs of " << t.size() << " x " << c.size() << ")";
+    TEST( oss.str().c_str(), ( n_bad == 0 ) && ( n_matched > 0 ));
+    TEST( ( tag + "compute_all marks exactly the matched frames" ).c_str(), states_ok );
+    results.push_back( p1 );
+  }
+  TEST( ( tag + "Threaded compute_all is identical to serial" ).c_str(), same_results( results[0], results[1] ));
+
+  // the pairs one at a time, in random order: each compute_single()
+  // is a find() and (if matched) an insert() against pending inserts
+  {
+    restore_match_states( t, c, states_before );
+    params.n_threads = 1;
+    track2track_phase1 p1( params );
+    vector< pair< size_t, size_t > > pairs;
+    for (size_t i=0; i<t.size(); ++i)
+    {
+      for (size_t j=0; j<c.size(); ++j)
+      {
+        pairs.push_back( make_pair( i, j ));
+      }
+    }
+    std::shuffle( pairs.begin(), pairs.end(), rng );
+    bool repeat_ok = true;
+    for (size_t k=0; k<pairs.size(); ++k)
+    {
+      bool b = p1.compute_single( t[ pairs[k].first ], c[ pairs[k].second ] );
+      // a second call finds the pending entry rather than recomputing
+      if ( b ) repeat_ok = repeat_ok && p1.compute_single( t[ pairs[k].first ], c[ pairs[k].second ] );
+    }
+    TEST( ( tag + "compute_single finds its own pending inserts" ).c_str(), repeat_ok );
+    TEST( ( tag + "compute_single over all pairs is identical to compute_all" ).c_str(),
+          same_results( p1, results[0] ));
+  }
+}
+
+void
+test_detection_mode( mt19937& rng, const track_synthesizer& ts )
+{
+  track_handle_list_type t, c;
+  make_detection_sets( rng, ts, 150, t, c );
+  restore_match_states( t, c, vector< int >( all_match_states( t, c ).size(), IN_AOI_UNMATCHED ));
+  vector< int > states_before = all_match_states( t, c );
+
+  const unsigned thread_counts[] = { 1, 4 };
+  vector< track2track_phase1 > results;
+  for (size_t n=0; n<2; ++n)
+  {
+    restore_match_states( t, c, states_before );
+    phase1_parameters params;
+    params.n_threads = thread_counts[n];
+    track2track_phase1 p1( params );
+    p1.compute_all_detection_mode( t, c );
+
+    unsigned n_matched = 0;
+    bool states_ok = false;
+    unsigned n_bad = check_against_reference( p1, t, c, states_before, true, n_matched, states_ok );
+    ostringstream oss;
+    oss << "Detection mode on " << thread_counts[n] << " thread(s) matches the per-frame reference ("
+        << n_matched << " matched detections)";
+    TEST( oss.str().c_str(), ( n_bad == 0 ) && ( n_matched > 0 ));
+    TEST( "Detection mode marks exactly the matched frames", states_ok );
+    results.push_back( p1 );
+  }
+  TEST( "Threaded detection mode is identical to serial", same_results( results[0], results[1] ));
+}
+
+void
+test_sweep( mt19937& rng, const track_synthesizer& ts )
+{
+  track_handle_list_type t, c;
+  make_track_sets( rng, ts, 300, 40, 60, t, c );
+  restore_match_states( t, c, vector< int >( all_match_states( t, c ).size(), IN_AOI_UNMATCHED ));
+  vector< int > states_before = all_match_states( t, c );
+
+  phase1_parameters base;
+  track2track_phase1_sweep sweep( base );
+  sweep.compute_all( t, c );
+
+  vector< pair< string, phase1_parameters > > grid;
+  grid.push_back( make_pair( "defaults", base ));
+  for (double iou = 0.1; iou < 0.8; iou += 0.3)
+  {
+    phase1_parameters p( base );
+    p.iou = iou;
+    ostringstream oss;
+    oss << "iou " << iou;
+    grid.push_back( make_pair( oss.str(), p ));
+  }
+  {
+    phase1_parameters p( base );
+    p.min_pcent_overlap_gt_ct = make_pair( 0.3, 0.5 );
+    grid.push_back( make_pair( "min-pcent 0.3:0.5", p ));
+    p.min_frames_policy = make_pair( true, 5.0 );
+    grid.push_back( make_pair( "min-pcent 0.3:0.5, min-frames 5", p ));
+    p.pass_all_nonzero_overlaps = true;
+    grid.push_back( make_pair( "min-pcent 0.3:0.5, min-frames 5, pass-nonzero", p ));
+  }
+  {
+    phase1_parameters p( base );
+    p.min_bound_matching_area = 300.0;
+    p.min_frames_policy = make_pair( false, 40.0 );
+    grid.push_back( make_pair( "area 300, min-frames 40%", p ));
+  }
+
+  for (size_t g=0; g<grid.size(); ++g)
+  {
+    track2track_phase1 selected( grid[g].second );
+    sweep.select( selected );
+    vector< int > selected_states = all_match_states( t, c );
+
+    restore_match_states( t, c, states_before );
+    track2track_phase1 direct( grid[g].second );
+    direct.compute_all( t, c );
+    vector< int > direct_states = all_match_states( t, c );
+
+    ostringstream oss;
+    oss << "Sweep select() equals compute_all() at " << grid[g].first << " (" << direct.t2t.size() << " pairs)";
+    TEST( oss.str().c_str(), same_results( selected, direct ) && ( selected_states == direct_states ));
+  }
+}
+
+void
+test_cache( mt19937& rng, const track_synthesizer& ts )
+{
+  const string fn = "test_phase1_equivalence.p1cache.tmp";
+  std::remove( fn.c_str() );
+
+  track_handle_list_type t, c;
+  make_track_sets( rng, ts, 300, 40, 60, t, c );
+  restore_match_states( t, c, vector< int >( all_match_states( t, c ).size(), IN_AOI_UNMATCHED ));
+  vector< int > states_before = all_match_states( t, c );
+
+  phase1_parameters params;
+  params.min_pcent_overlap_gt_ct = make_pair( 0.2, 0.2 );
+  params.pass_all_nonzero_overlaps = true;
+
+  track2track_phase1 computed( params );
+  TEST( "First cached run computes", ! phase1_cache( fn ).compute_all( computed, t, c ));
+  vector< int > computed_states = all_match_states( t, c );
+
+  restore_match_states( t, c, states_before );
+  track2track_phase1 loaded( params );
+  TEST( "Second cached run loads", phase1_cache( fn ).compute_all( loaded, t, c ));
+  TEST( "Loaded results equal the computed ones", same_results( computed, loaded ) && ( computed.t2t.size() > 0 ));
+  TEST( "Loaded results mark the same frames", all_match_states( t, c ) == computed_states );
+
+  restore_match_states( t, c, states_before );
+  phase1_parameters other( params );
+  other.iou = 0.5;
+  other.min_pcent_overlap_gt_ct = make_pair( -1.0, -1.0 );
+  track2track_phase1 recomputed( other );
+  TEST( "Different parameters miss the cache", ! phase1_cache( fn ).compute_all( recomputed, t, c ));
+
+  restore_match_states( t, c, states_before );
+  track2track_phase1 direct( other );
+  direct.compute_all( t, c );
+  TEST( "A cache miss computes as compute_all() does", same_results( recomputed, direct ));
+
+  std::remove( fn.c_str() );
+}
+
+void
+test_masked( mt19937& rng, const track_synthesizer& ts, bool detection_mode )
+{
+  string tag = detection_mode ? "[detection mode] " : "";
+  track_handle_list_type t, c;
+  if ( detection_mode )
+  {
+    make_detection_sets( rng, ts, 100, t, c );
+  }
+  else
+  {
+    make_track_sets( rng, ts, 300, 40, 60, t, c );
+  }
+  restore_match_states( t, c, vector< int >( all_match_states( t, c ).size(), IN_AOI_UNMATCHED ));
+  vector< int > states_before = all_match_states( t, c );
+
+  // three "activities", each scoring a random subset of the tracks
+  vector< track2track_phase1::track_mask_type > t_mask( t.size() ), c_mask( c.size() );
+  vector< track2track_phase1::track_mask_type >* masks[2] = { &t_mask, &c_mask };
+  for (size_t l=0; l<2; ++l)
+  {
+    for (size_t i=0; i<masks[l]->size(); ++i)
+    {
+      unsigned bits = rng() % 8;
+      for (unsigned b=0; b<3; ++b) (*masks[l])[i].push_back( ( bits >> b ) & 1 );
+    }
+  }
+
+  phase1_parameters params;
+  params.n_threads = 4;
+  track2track_phase1 all( params ), masked( params );
+  if ( detection_mode )
+  {
+    all.compute_all_detection_mode( t, c );
+    restore_match_states( t, c, states_before );
+    masked.compute_all_detection_mode_masked( t, c, t_mask, c_mask );
+  }
+  else
+  {
+    all.compute_all( t, c );
+    restore_match_states( t, c, states_before );
+    masked.compute_all_masked( t, c, t_mask, c_mask );
+  }
+
+  map< oracle_entry_handle_type, size_t > t_slot, c_slot;
+  for (size_t i=0; i<t.size(); ++i) t_slot[ t[i].row ] = i;
+  for (size_t j=0; j<c.size(); ++j) c_slot[ c[j].row ] = j;
+
+  vector< track2track_phase1::t2t_type::value_type > entries;
+  for (track2track_phase1::t2t_type::const_iterator e = all.t2t.begin(); e != all.t2t.end(); ++e)
+  {
+    const track2track_phase1::track_mask_type& a = t_mask[ t_slot[ e->first.first.row ]];
+    const track2track_phase1::track_mask_type& b = c_mask[ c_slot[ e->first.second.row ]];
+    bool shared = false;
+    for (size_t k=0; k<a.size(); ++k) shared = shared || ( a[k] && b[k] );
+    if ( shared ) entries.push_back( *e );
+  }
+  track2track_phase1 expected( params );
+  expected.overlap_arena = all.overlap_arena;
+  expected.t2t.insert( entries );
+
+  ostringstream oss;
+  oss << tag << "compute_all_masked keeps exactly the masked pairs (" << masked.t2t.size()
+      << " of " << all.t2t.size() << ")";
+  TEST( oss.str().c_str(),
+        same_results( masked, expected ) && ( masked.t2t.size() > 0 ) && ( masked.t2t.size() < all.t2t.size() ));
+}
+
+} // ...anon
+
+void
+test_phase1_equivalence()
+{
+  mt19937 rng( 1001 );
+  track_synthesizer ts( track_synthesizer_params( 10, 5, 30 ));
+
+  test_compute_all( rng, ts, false );
+  test_compute_all( rng, ts, true );
+  test_detection_mode( rng, ts );
+  test_sweep( rng, ts );
+  test_cache( rng, ts );
+  test_masked( rng, ts, false );
+  test_masked( rng, ts, true );
+}
+
+TESTMAIN( test_phase1_equivalence );
@@ -0,0 +1,336 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+//
+// Check the phase 2 frame census against the map of distinct
+// timestamps per match state phase 2 originally built, on one and on
+// several threads; then check that scoring two "cameras" separately
+// and merging their hadwav_partial_results (through the file format)
+// gives the counts and metrics of scoring both at once.  The cameras
+// share timestamps, so the census must be merged as sets.
+//
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <testlib/testlib_test.h>
+
+#include <vgl/vgl_box_2d.h>
+
+#include <track_oracle/core/track_oracle_core.h>
+
+#include <scoring_framework/hadwav_partial_result.h>
+#include <scoring_framework/phase1_parameters.h>
+#include <scoring_framework/score_core.h>
+#include <scoring_framework/score_phase1.h>
+#include <scoring_framework/score_phase2_hadwav.h>
+#include <scoring_framework/score_phase3_hadwav.h>
+#include <scoring_framework/track_synthesizer.h>
+
+using std::map;
+using std::mt19937;
+using std::string;
+using std::vector;
+
+using kwiver::track_oracle::frame_handle_list_type;
+using kwiver::track_oracle::track_handle_list_type;
+using kwiver::track_oracle::track_oracle_core;
+
+using namespace kwiver::kwant;
+
+namespace // anon
+{
+
+typedef vgl_box_2d<double> bbox_type;
+
+//
+// One camera's truth and computed tracks over frames [0, n_frames),
+// with x offset by x0 so that no two cameras' tracks overlap; about
+// half the computed tracks follow a truth track.
+//
+
+void
+make_camera( mt19937& rng, const track_synthesizer& ts, double x0, unsigned n_frames, unsigned first_id,
+             track_handle_list_type& truth, track_handle_list_type& computed )
+{
+  struct path { unsigned first, length; bbox_type box; double dx, dy; };
+  vector< path > truth_paths;
+  for (unsigned i=0; i<25; ++i)
+  {
+    path p;
+    p.first = rng() % n_frames;
+    p.length = 1 + rng() % 50;
+    double x = x0 + rng() % 400, y = rng() % 400;
+    p.box = bbox_type( x, x + 20 + rng() % 40, y, y + 20 + rng() % 40 );
+    p.dx = ( static_cast< double >( rng() % 9 ) - 4.0 );
+    p.dy = ( static_cast< double >( rng() % 9 ) - 4.0 );
+    truth_paths.push_back( p );
+    truth.push_back( ts.make_linear_track( first_id + i, p.first, p.length, 1, p.box, p.dx, p.dy ));
+  }
+  for (unsigned i=0; i<35; ++i)
+  {
+    path p = truth_paths[ rng() % truth_paths.size() ];
+    if ( rng() % 2 )
+    {
+      p.first += rng() % 5;
+      p.length = 1 + rng() % ( p.length + 5 );
+      double jx = static_cast< double >( rng() % 15 ) - 7.0, jy = static_cast< double >( rng() % 15 ) - 7.0;
+      p.box = bbox_type( p.box.min_x() + jx, p.box.max_x() + jx, p.box.min_y() + jy, p.box.max_y() + jy );
+    }
+    else
+    {
+      p.first = rng() % n_frames;
+      double x = x0 + rng() % 400, y = rng() % 400;
+      p.box = bbox_type( x, x + 20 + rng() % 40, y, y + 20 + rng() % 40 );
+    }
+    computed.push_back( ts.make_linear_track( first_id + 100 + i, p.first, p.length, 1, p.box, p.dx, p.dy ));
+  }
+}
+
+//
+// Score t against c through phase 3, as score_tracks does.
+//
+
+void
+score( const phase1_parameters& params,
+       const track_handle_list_type& all_t, const track_handle_list_type& all_c,
+       unsigned n_threads, bool one_to_one,
+       track_handle_list_type& t, track_handle_list_type& c,
+       track2track_phase2_hadwav& p2, overall_phase3_hadwav& p3 )
+{
+  phase1_parameters p1_params( params );
+  t.clear();
+  c.clear();
+  p1_params.filter_track_list_on_aoi( all_t, t );
+  p1_params.filter_track_list_on_aoi( all_c, c );
+  p1_params.n_threads = n_threads;
+
+  track2track_phase1 p1( p1_params );
+  p1.compute_all( t, c );
+  p2.n_threads = n_threads;
+  p2.one_to_one = one_to_one;
+  p2.compute( t, c, p1 );
+  p3.n_threads = n_threads;
+  p3.compute( p2 );
+}
+
+vector< ts_type >
+keys_of( const map< ts_type, bool >& m )
+{
+  vector< ts_type > ret;
+  for (map< ts_type, bool >::const_iterator i = m.begin(); i != m.end(); ++i)
+  {
+    ret.push_back( i->first );
+  }
+  return ret;
+}
+
+//
+// The census as phase 2 originally took it.
+//
+
+bool
+census_matches_maps( const track_handle_list_type& t, const track_handle_list_type& c,
+                     const track2track_phase2_hadwav& p2 )
+{
+  scorable_track_type trk;
+  map< ts_type, bool > gt_frame_map, ct_frame_matched_map, ct_frame_unmatched_map;
+  for (size_t i=0; i<t.size(); ++i)
+  {
+    frame_handle_list_type frames = track_oracle_core::get_frames( t[i] );
+    for (size_t j=0; j<frames.size(); ++j)
+    {
+      unsigned match_state = trk[ frames[j] ].frame_has_been_matched();
+      if ( ( match_state == IN_AOI_UNMATCHED ) ||
+           ( match_state == IN_AOI_MATCHED ))
+      {
+        gt_frame_map[ trk[ frames[j] ].timestamp_usecs() ] = true;
+      }
+    }
+  }
+  for (size_t i=0; i<c.size(); ++i)
+  {
+    frame_handle_list_type frames = track_oracle_core::get_frames( c[i] );
+    for (size_t j=0; j<frames.size(); ++j)
+    {
+      switch (trk[ frames[j] ].frame_has_been_matched() )
+      {
+      case IN_AOI_MATCHED:
+        ct_frame_matched_map[ trk[ frames[j] ].timestamp_usecs() ] = true;
+        break;
+      case IN_AOI_UNMATCHED:
+        ct_frame_unmatched_map[ trk[ frames[j] ].timestamp_usecs() ] = true;
+        break;
+      default:
+        break;
+      }
+    }
+  }
+
+  return
+    ( p2.gt_frame_timestamps == keys_of( gt_frame_map )) &&
+    ( p2.computed_frame_matched_timestamps == keys_of( ct_frame_matched_map )) &&
+    ( p2.computed_frame_unmatched_timestamps == keys_of( ct_frame_unmatched_map )) &&
+    ( p2.n_gt_frames == gt_frame_map.size() ) &&
+    ( p2.n_computed_frames_matched == ct_frame_matched_map.size() ) &&
+    ( p2.n_computed_frames_unmatched == ct_frame_unmatched_map.size() );
+}
+
+bool
+same_counts( const hadwav_partial_result& a, const hadwav_partial_result& b )
+{
+  return
+    ( a.one_to_one == b.one_to_one ) &&
+    ( a.n_true_tracks == b.n_true_tracks ) && ( a.n_computed_tracks == b.n_computed_tracks ) &&
+    ( a.total_gt_boxes == b.total_gt_boxes ) && ( a.total_computed_boxes == b.total_computed_boxes ) &&
+    ( a.detected_gt_boxes == b.detected_gt_boxes ) && ( a.detection_false_alarms == b.detection_false_alarms ) &&
+    ( a.n_assigned_pairs == b.n_assigned_pairs ) && ( a.assigned_frames == b.assigned_frames );
+}
+
+bool
+same_census( const hadwav_partial_result& a, const hadwav_partial_result& b )
+{
+  return
+    ( a.gt_frame_timestamps == b.gt_frame_timestamps ) &&
+    ( a.computed_frame_matched_timestamps == b.computed_frame_matched_timestamps ) &&
+    ( a.computed_frame_unmatched_timestamps == b.computed_frame_unmatched_timestamps );
+}
+
+vector< unsigned >
+sorted_track_counts( const vector< hadwav_partial_result::per_track_counts >& v )
+{
+  vector< unsigned > ret;
+  for (size_t i=0; i<v.size(); ++i)
+  {
+    // one key per track, so the multiset compares all three counts
+    ret.push_back( ( v[i].continuity << 20 ) ^ ( v[i].dominant_size << 10 ) ^ v[i].lifetime );
+  }
+  std::sort( ret.begin(), ret.end() );
+  return ret;
+}
+
+void
+test_metrics_near( const string& tag,
+                   const track2track_phase2_hadwav& a2, const overall_phase3_hadwav& a3,
+                   const track2track_phase2_hadwav& b2, const overall_phase3_hadwav& b3 )
+{
+  const double eps = 1.0e-12;
+  TEST_NEAR( ( tag + "framePD" ).c_str(), a2.framePD, b2.framePD, eps );
+  TEST_NEAR( ( tag + "frameFA" ).c_str(), a2.frameFA, b2.frameFA, eps );
+  TEST_NEAR( ( tag + "trackFramePrecision" ).c_str(), a2.trackFramePrecision, b2.trackFramePrecision, eps );
+  TEST_NEAR( ( tag + "detectionPD" ).c_str(), a2.detectionPD, b2.detectionPD, eps );
+  TEST_NEAR( ( tag + "detectionPFalseAlarm" ).c_str(), a2.detectionPFalseAlarm, b2.detectionPFalseAlarm, eps );
+  TEST_NEAR( ( tag + "identityF1" ).c_str(), a2.identityF1, b2.identityF1, eps );
+  TEST_NEAR( ( tag + "avg_track_continuity" ).c_str(), a3.avg_track_continuity, b3.avg_track_continuity, eps );
+  TEST_NEAR( ( tag + "avg_track_purity" ).c_str(), a3.avg_track_purity, b3.avg_track_purity, eps );
+  TEST_NEAR( ( tag + "avg_target_continuity" ).c_str(), a3.avg_target_continuity, b3.avg_target_continuity, eps );
+  TEST_NEAR( ( tag + "avg_target_purity" ).c_str(), a3.avg_target_purity, b3.avg_target_purity, eps );
+  TEST_NEAR( ( tag + "trackPd" ).c_str(), a3.trackPd, b3.trackPd, eps );
+  TEST_NEAR( ( tag + "trackFA" ).c_str(), a3.trackFA, b3.trackFA, eps );
+}
+
+} // ...anon
+
+void
+test_phase2_hadwav()
+{
+  mt19937 rng( 2718 );
+  track_synthesizer ts( track_synthesizer_params( 10, 5, 30 ));
+
+  // camera A's tracks are all created before camera B's, so a single
+  // run orders them as merging A then B does
+  track_handle_list_type a_t, a_c, b_t, b_c;
+  make_camera( rng, ts, 0.0, 200, 0, a_t, a_c );
+  make_camera( rng, ts, 5000.0, 200, 1000, b_t, b_c );
+  track_handle_list_type all_t( a_t ), all_c( a_c );
+  all_t.insert( all_t.end(), b_t.begin(), b_t.end() );
+  all_c.insert( all_c.end(), b_c.begin(), b_c.end() );
+
+  // the AOI covers the right of camera A and the left of camera B
+  phase1_parameters params;
+  params.setAOI( bbox_type( 200, 5250, -1000, 1000 ), /* inclusive = */ true );
+
+  //
+  // census against the original maps, serial and threaded
+  //
+
+  track_handle_list_type t, c;
+  track2track_phase2_hadwav serial_p2, threaded_p2;
+  overall_phase3_hadwav serial_p3, threaded_p3;
+  score( params, all_t, all_c, 1, false, t, c, serial_p2, serial_p3 );
+  TEST( "Serial census equals the distinct-timestamp maps", census_matches_maps( t, c, serial_p2 ));
+  score( params, all_t, all_c, 4, false, t, c, threaded_p2, threaded_p3 );
+  TEST( "Threaded census equals the distinct-timestamp maps", census_matches_maps( t, c, threaded_p2 ));
+  TEST( "The census has matched and unmatched computed frames",
+        ( ! serial_p2.computed_frame_matched_timestamps.empty() ) &&
+        ( ! serial_p2.computed_frame_unmatched_timestamps.empty() ));
+
+  hadwav_partial_result serial_r( serial_p2, serial_p3 ), threaded_r( threaded_p2, threaded_p3 );
+  TEST( "Threaded phase 2 counts equal serial", same_counts( serial_r, threaded_r ) && same_census( serial_r, threaded_r ));
+  TEST( "Threaded phase 3 per-track counts equal serial",
+        ( sorted_track_counts( serial_r.tracks ) == sorted_track_counts( threaded_r.tracks )) &&
+        ( sorted_track_counts( serial_r.targets ) == sorted_track_counts( threaded_r.targets )));
+  test_metrics_near( "Threaded metrics equal serial: ", serial_p2, serial_p3, threaded_p2, threaded_p3 );
+
+  //
+  // per-camera partial results, written, read and merged
+  //
+
+  track2track_phase2_hadwav all_p2;
+  overall_phase3_hadwav all_p3;
+  score( params, all_t, all_c, 1, true, t, c, all_p2, all_p3 );
+  hadwav_partial_result all_r( all_p2, all_p3 );
+
+  const string fns[2] = { "test_phase2_hadwav.camera_a.tmp", "test_phase2_hadwav.camera_b.tmp" };
+  const track_handle_list_type* cam_t[2] = { &a_t, &b_t };
+  const track_handle_list_type* cam_c[2] = { &a_c, &b_c };
+  size_t sum_of_gt_frames = 0;
+  hadwav_partial_result merged;
+  bool io_ok = true, merge_ok = true;
+  for (size_t k=0; k<2; ++k)
+  {
+    track2track_phase2_hadwav p2;
+    overall_phase3_hadwav p3;
+    score( params, *cam_t[k], *cam_c[k], 1, true, t, c, p2, p3 );
+    sum_of_gt_frames += p2.n_gt_frames;
+
+    hadwav_partial_result written( p2, p3 ), read_back;
+    io_ok = io_ok && written.write( fns[k] ) && read_back.read( fns[k] );
+    io_ok = io_ok && same_counts( written, read_back ) && same_census( written, read_back );
+    if ( k == 0 )
+    {
+      merged = read_back;
+    }
+    else
+    {
+      merge_ok = merged.merge( read_back );
+    }
+    std::remove( fns[k].c_str() );
+  }
+
+  TEST( "Partial results survive the file format", io_ok );
+  TEST( "Camera partial results merge", merge_ok );
+  TEST( "The cameras share timestamps", all_p2.n_gt_frames < sum_of_gt_frames );
+  TEST( "Merged counts equal the single run's", same_counts( merged, all_r ));
+  TEST( "Merged census equals the single run's", same_census( merged, all_r ));
+  TEST( "Merged per-track counts equal the single run's",
+        ( sorted_track_counts( merged.tracks ) == sorted_track_counts( all_r.tracks )) &&
+        ( sorted_track_counts( merged.targets ) == sorted_track_counts( all_r.targets )));
+
+  track2track_phase2_hadwav merged_p2;
+  overall_phase3_hadwav merged_p3;
+  merged.compute_metrics( merged_p2, merged_p3 );
+  test_metrics_near( "Merged metrics equal the single run's: ", merged_p2, merged_p3, all_p2, all_p3 );
+
+  hadwav_partial_result greedy;
+  TEST( "Merging greedy and one-to-one results is refused", ! greedy.merge( merged ));
+}
+
+TESTMAIN( test_phase2_hadwav );
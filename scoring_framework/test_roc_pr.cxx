@@ -0,0 +1,412 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+//
+// Check score_events' ROC and PR machinery against the straightforward
+// computations it replaced:
+//
+// - sweep_roc against counting every computed track at every threshold;
+// - buffered_pr_writer against streaming each row to an ostream;
+// - roc_partial_result: binning, merging runs over disjoint truth
+//   tracks, the file round trip, and its CSV against sweep_roc at the
+//   grid's thresholds.
+//
+
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <testlib/testlib_test.h>
+
+#include <scoring_framework/buffered_pr_writer.h>
+#include <scoring_framework/roc_partial_result.h>
+#include <scoring_framework/roc_sweep.h>
+
+using std::mt19937;
+using std::numeric_limits;
+using std::ostringstream;
+using std::set;
+using std::string;
+using std::vector;
+
+using kwiver::kwant::buffered_pr_writer;
+using kwiver::kwant::roc_partial_result;
+using kwiver::kwant::roc_point_type;
+using kwiver::kwant::sweep_roc;
+using kwiver::kwant::ts_type;
+
+namespace // anon
+{
+
+//
+// A random scored run: n_computed tracks with relevancies quantized to
+// n_levels (so there are ties), a few NaNs, and each matching zero to
+// three of n_truth truth tracks.
+//
+
+struct scored_run
+{
+  size_t n_truth;
+  vector< double > relevancy;
+  vector< vector< size_t > > matches;
+};
+
+scored_run
+random_run( mt19937& rng, size_t n_truth, size_t n_computed, unsigned n_levels )
+{
+  scored_run r;
+  r.n_truth = n_truth;
+  for (size_t i=0; i<n_computed; ++i)
+  {
+    double rel =
+      ( rng() % 50 == 0 )
+      ? numeric_limits< double >::quiet_NaN()
+      : 1.0 * ( rng() % ( n_levels+1 )) / n_levels;
+    r.relevancy.push_back( rel );
+
+    set< size_t > m;
+    unsigned n_matches = ( n_truth == 0 ) ? 0 : rng() % 4;
+    for (unsigned k=0; k<n_matches; ++k) m.insert( rng() % n_truth );
+    r.matches.push_back( vector< size_t >( m.begin(), m.end() ));
+  }
+  return r;
+}
+
+//
+// The ROC point at one threshold, counting every computed track.
+//
+
+roc_point_type
+brute_force_roc_point( const scored_run& r, double threshold )
+{
+  roc_point_type p;
+  vector< bool > hit( r.n_truth, false );
+  for (size_t i=0; i<r.relevancy.size(); ++i)
+  {
+    bool relevant = ( r.relevancy[i] >= threshold );
+    bool matched = ! r.matches[i].empty();
+    if ( relevant && matched ) ++p.tp;
+    if ( relevant && ! matched ) ++p.fp;
+    if ( ! relevant && matched ) ++p.fn;
+    if ( ! relevant && ! matched ) ++p.tn;
+    if ( ! relevant ) continue;
+    for (size_t k=0; k<r.matches[i].size(); ++k)
+    {
+      if ( ! hit[ r.matches[i][k] ] )
+      {
+        hit[ r.matches[i][k] ] = true;
+        ++p.nMatches;
+      }
+    }
+  }
+  return p;
+}
+
+bool
+same_point( const roc_point_type& a, const roc_point_type& b )
+{
+  return
+    ( a.nMatches == b.nMatches ) && ( a.tp == b.tp ) && ( a.fp == b.fp ) &&
+    ( a.tn == b.tn ) && ( a.fn == b.fn );
+}
+
+//
+// The partial result of a run, as score_events' write_roc_partial
+// builds it: each computed track binned by its relevancy, and each
+// truth track by the relevancy of its most relevant match.
+//
+
+roc_partial_result
+make_partial( const scored_run& r, double min_r, double max_r, unsigned n_bins )
+{
+  roc_partial_result p( min_r, max_r, n_bins, false );
+  p.n_truth_tracks = r.n_truth;
+  const double no_match = -numeric_limits< double >::infinity();
+  vector< double > best( r.n_truth, no_match );
+  for (size_t i=0; i<r.relevancy.size(); ++i)
+  {
+    double rel = r.relevancy[i];
+    p.add_computed( rel, ! r.matches[i].empty() );
+    if ( rel != rel ) continue;
+    for (size_t k=0; k<r.matches[i].size(); ++k)
+    {
+      best[ r.matches[i][k] ] = std::max( best[ r.matches[i][k] ], rel );
+    }
+  }
+  for (size_t t=0; t<best.size(); ++t)
+  {
+    if ( best[t] != no_match ) p.add_truth_hit( best[t] );
+  }
+  return p;
+}
+
+//
+// The --roc-csv-dump rows score_events' compute_roc writes for these
+// thresholds (with faNorm 1.)
+//
+
+string
+roc_csv( const vector< double >& thresholds, const vector< roc_point_type >& points, size_t n_truth_tracks )
+{
+  ostringstream os;
+  os << "threshold, PD, FA, nMatches, TP, FP, TN, FN, matched, relevant, nTrueTracks, faNorm\n";
+  for (size_t k=0; k<points.size(); ++k)
+  {
+    unsigned nMatches = points[k].nMatches;
+    unsigned tp = points[k].tp, fp = points[k].fp, tn = points[k].tn, fn = points[k].fn;
+    double pd =
+      ( n_truth_tracks == 0 )
+      ? 0.0
+      : 1.0 * nMatches / n_truth_tracks;
+    os << thresholds[k] << ", " << pd << ", " << fp << ", " << nMatches << ", " << tp << ", " << fp << ", "
+       << tn << ", " << fn << ", " << (tp+fn) << ",  " << (tp+fp) << ", " << n_truth_tracks << ", "
+       << (fp / 1.0) << "\n";
+  }
+  return os.str();
+}
+
+string
+csv_of( const roc_partial_result& p )
+{
+  ostringstream os;
+  p.write_roc_csv( os );
+  return os.str();
+}
+
+bool
+same_partial( const roc_partial_result& a, const roc_partial_result& b )
+{
+  return
+    ( a.min_relevancy == b.min_relevancy ) && ( a.max_relevancy == b.max_relevancy ) &&
+    ( a.n_bins == b.n_bins ) && ( a.detection_mode == b.detection_mode ) &&
+    ( a.n_truth_tracks == b.n_truth_tracks ) && ( a.n_matched == b.n_matched ) &&
+    ( a.n_unmatched == b.n_unmatched ) && ( a.tp_hist == b.tp_hist ) &&
+    ( a.fp_hist == b.fp_hist ) && ( a.hit_hist == b.hit_hist ) &&
+    ( a.fa_norm_timestamps == b.fa_norm_timestamps );
+}
+
+void
+test_sweep_roc()
+{
+  mt19937 rng( 17 );
+  unsigned n_mismatches = 0, n_points = 0;
+  for (unsigned trial=0; trial<50; ++trial)
+  {
+    scored_run r = random_run( rng, rng() % 30, rng() % 200, 1 + rng() % 20 );
+
+    // thresholds below, between, on, and above the relevancy levels
+    set< double > ts;
+    for (unsigned k=0; k<10; ++k) ts.insert( ( static_cast< double >( rng() % 2400 ) - 200.0 ) / 2000.0 );
+    for (size_t i=0; i<r.relevancy.size() && i<10; ++i)
+    {
+      if ( r.relevancy[i] == r.relevancy[i] ) ts.insert( r.relevancy[i] );
+    }
+    vector< double > thresholds( ts.begin(), ts.end() );
+
+    vector< roc_point_type > points = sweep_roc( thresholds, r.relevancy, r.matches, r.n_truth );
+    if ( points.size() != thresholds.size() )
+    {
+      ++n_mismatches;
+      continue;
+    }
+    for (size_t k=0; k<thresholds.size(); ++k)
+    {
+      if ( ! same_point( points[k], brute_force_roc_point( r, thresholds[k] ))) ++n_mismatches;
+      ++n_points;
+    }
+  }
+
+  ostringstream oss;
+  oss << "sweep_roc matches per-threshold counts at " << n_points << " points";
+  TEST( oss.str().c_str(), n_mismatches == 0 );
+
+  vector< double > none;
+  TEST( "sweep_roc with no thresholds", sweep_roc( none, vector< double >( 3, 0.5 ),
+                                                   vector< vector< size_t > >( 3 ), 0 ).empty() );
+}
+
+void
+test_pr_writer()
+{
+  mt19937 rng( 99 );
+  const double specials[] = { 0.0, 1.0, -1.0, 0.1, 1.0/3.0, 1e-7, 123456789.0, 1e300, -2.5e-310,
+                              numeric_limits< double >::max(),
+                              numeric_limits< double >::infinity(),
+                              -numeric_limits< double >::infinity() };
+  const size_t n_specials = sizeof( specials ) / sizeof( specials[0] );
+
+  // enough rows to flush several times along the way
+  ostringstream expected, actual;
+  {
+    buffered_pr_writer w( actual );
+    for (unsigned i=0; i<40000; ++i)
+    {
+      double r =
+        ( i < n_specials )
+        ? specials[i]
+        : static_cast< double >( rng() ) / ( 1 + rng() % 1000 );
+      unsigned tp = rng() % 100000, fp = rng() % 100000, td = rng() % 1000, nTrue = 1 + rng() % 1000;
+      double prec = ( tp + fp == 0 ) ? 0.0 : 1.0 * tp / ( tp + fp );
+      double recall = 1.0 * td / nTrue;
+      if ( i == 1 ) tp = numeric_limits< unsigned >::max();
+
+      expected << "PR-curve: " << i << " relevancy= " << r << " tp= " << tp << " fp= " << fp
+               << " prec= " << prec << " td= " << td << " nTrue= " << nTrue << "  recall= " << recall << "\n";
+      w.write_row( i, r, tp, fp, prec, td, nTrue, recall );
+
+      if ( i == 20000 ) TEST( "Rows are flushed once the buffer fills", ! actual.str().empty() );
+    }
+    // the destructor flushes the rest
+  }
+  TEST( "Buffered PR rows are byte-for-byte the streamed rows", actual.str() == expected.str() );
+}
+
+void
+test_roc_partial_bins()
+{
+  roc_partial_result p( 0.0, 1.0, 10, false );
+  TEST( "Grid threshold 0", p.threshold( 0 ) == 0.0 );
+  TEST( "Grid threshold n_bins is max", p.threshold( 10 ) == 1.0 );
+  TEST( "Below the grid", p.bin( -0.01 ) == -1 );
+  TEST( "NaN is in no bin", p.bin( numeric_limits< double >::quiet_NaN() ) == -1 );
+  TEST( "At max: last bin", p.bin( 1.0 ) == 10 );
+  TEST( "Above max: last bin", p.bin( 7.0 ) == 10 );
+
+  // every relevancy lands in the bin whose thresholds bracket it,
+  // including those exactly on a threshold
+  mt19937 rng( 3 );
+  unsigned n_bad = 0;
+  roc_partial_result q( -0.3, 0.7, 37, false );
+  for (unsigned k=0; k<20000; ++k)
+  {
+    double r =
+      ( k % 2 )
+      ? q.threshold( rng() % 38 )
+      : -0.35 + 1.1 * ( rng() % 1000000 ) / 1000000.0;
+    int b = q.bin( r );
+    bool ok =
+      ( r < q.min_relevancy )
+      ? ( b == -1 )
+      : ( ( b >= 0 ) && ( b <= 37 ) && ( r >= q.threshold( b )) && ( ( b == 37 ) || ( r < q.threshold( b+1 ))));
+    if ( ! ok ) ++n_bad;
+  }
+  TEST( "Relevancies are binned between their thresholds", n_bad == 0 );
+
+  double min_r = 0, max_r = 0;
+  unsigned n = 0;
+  TEST( "Parse grid", roc_partial_result::parse_grid( "-1:2.5:30", min_r, max_r, n ) &&
+        ( min_r == -1.0 ) && ( max_r == 2.5 ) && ( n == 30 ));
+  TEST( "Refuse an empty grid", ! roc_partial_result::parse_grid( "0:1:0", min_r, max_r, n ));
+  TEST( "Refuse an inverted grid", ! roc_partial_result::parse_grid( "1:0:10", min_r, max_r, n ));
+}
+
+void
+test_roc_partial_merge()
+{
+  mt19937 rng( 2018 );
+  const double min_r = 0.0, max_r = 1.0;
+  const unsigned n_bins = 20;
+
+  unsigned n_csv_mismatch = 0, n_merge_mismatch = 0;
+  for (unsigned trial=0; trial<20; ++trial)
+  {
+    // three runs over disjoint truth tracks; relevancies fall on and
+    // between the grid's thresholds
+    vector< scored_run > runs;
+    scored_run all;
+    all.n_truth = 0;
+    for (unsigned k=0; k<3; ++k)
+    {
+      scored_run r = random_run( rng, rng() % 20, rng() % 100, ( k == 0 ) ? n_bins : 1 + rng() % 50 );
+      for (size_t i=0; i<r.relevancy.size(); ++i)
+      {
+        all.relevancy.push_back( r.relevancy[i] );
+        vector< size_t > m( r.matches[i] );
+        for (size_t j=0; j<m.size(); ++j) m[j] += all.n_truth;
+        all.matches.push_back( m );
+      }
+      all.n_truth += r.n_truth;
+      runs.push_back( r );
+    }
+
+    roc_partial_result merged = make_partial( runs[0], min_r, max_r, n_bins );
+    for (size_t k=1; k<runs.size(); ++k)
+    {
+      if ( ! merged.merge( make_partial( runs[k], min_r, max_r, n_bins ))) ++n_merge_mismatch;
+    }
+    roc_partial_result single = make_partial( all, min_r, max_r, n_bins );
+    if ( ! same_partial( merged, single )) ++n_merge_mismatch;
+
+    vector< double > thresholds;
+    for (unsigned b=0; b<=n_bins; ++b) thresholds.push_back( single.threshold( b ));
+    string expected = roc_csv( thresholds, sweep_roc( thresholds, all.relevancy, all.matches, all.n_truth ), all.n_truth );
+    if ( csv_of( merged ) != expected ) ++n_csv_mismatch;
+  }
+  TEST( "Merged partials equal the partial of the combined run", n_merge_mismatch == 0 );
+  TEST( "Partial ROC CSV equals sweep_roc's at the grid thresholds", n_csv_mismatch == 0 );
+
+  roc_partial_result a( 0.0, 1.0, 10, false ), b( 0.0, 1.0, 11, false ), c( 0.0, 1.0, 10, true );
+  a.add_computed( 0.5, true );
+  roc_partial_result a_copy( a );
+  TEST( "Refuse to merge different grids", ( ! a.merge( b )) && same_partial( a, a_copy ));
+  TEST( "Refuse to merge different modes", ( ! a.merge( c )) && same_partial( a, a_copy ));
+
+  // detection mode: the false-alarm normalization is over the union
+  // of the runs' timestamps
+  roc_partial_result d1( 0.0, 1.0, 10, true ), d2( 0.0, 1.0, 10, true );
+  ts_type t1[] = { 100, 200, 300 }, t2[] = { 50, 200, 300, 400 };
+  d1.fa_norm_timestamps.assign( t1, t1+3 );
+  d2.fa_norm_timestamps.assign( t2, t2+4 );
+  d1.fp_hist[3] = 4;
+  d2.fp_hist[3] = 2;
+  d1.n_unmatched = 4;
+  d2.n_unmatched = 2;
+  TEST( "Merge detection-mode partials", d1.merge( d2 ));
+  ts_type t12[] = { 50, 100, 200, 300, 400 };
+  TEST( "Timestamps merge as a set", d1.fa_norm_timestamps == vector< ts_type >( t12, t12+5 ));
+  TEST( "faNorm is the number of distinct timestamps", d1.fa_norm() == 5.0 );
+  TEST( "Histograms add", ( d1.fp_hist[3] == 6 ) && ( d1.n_unmatched == 6 ));
+}
+
+void
+test_roc_partial_file()
+{
+  mt19937 rng( 7 );
+  const string fn = "test_roc_pr.partial.tmp";
+
+  roc_partial_result p = make_partial( random_run( rng, 25, 300, 40 ), -0.1, 1.1, 33 );
+  p.detection_mode = true;
+  ts_type ts[] = { 0, 33333, 66666, 18446744073709551615ULL };
+  p.fa_norm_timestamps.assign( ts, ts+4 );
+
+  roc_partial_result q;
+  TEST( "Write partial", p.write( fn ));
+  TEST( "Read partial", q.read( fn ));
+  TEST( "Partial round trip", same_partial( p, q ));
+  TEST( "Round-tripped CSV", csv_of( p ) == csv_of( q ));
+  std::remove( fn.c_str() );
+
+  TEST( "Refuse to read a missing partial", ! q.read( fn ));
+  TEST( "Failed read leaves the partial alone", same_partial( p, q ));
+}
+
+} // ...anon
+
+void
+test_roc_pr()
+{
+  test_sweep_roc();
+  test_pr_writer();
+  test_roc_partial_bins();
+  test_roc_partial_merge();
+  test_roc_partial_file();
+}
+
+TESTMAIN( test_roc_pr );
@@ -0,0 +1,221 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+//
+// Check sparse_assignment against an exhaustive search over every
+// one-to-one assignment of small random graphs, and check that the
+// assignment doesn't depend on the number of threads.
+//
+
+#include <algorithm>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <testlib/testlib_test.h>
+
+#include <scoring_framework/sparse_assignment.h>
+
+using std::mt19937;
+using std::ostringstream;
+using std::vector;
+
+using kwiver::kwant::sparse_assignment;
+
+namespace // anon
+{
+
+// a dense copy of the graph: 0 means no edge
+typedef vector< vector< unsigned > > dense_graph;
+
+//
+// The best total weight assigning rows [row, n_rows) to the columns
+// not yet in used; each row may also be left unassigned.
+//
+
+unsigned long long
+brute_force_best( const dense_graph& g, size_t row, vector< bool >& used )
+{
+  if ( row == g.size() ) return 0;
+
+  unsigned long long best = brute_force_best( g, row+1, used );
+  for (size_t c=0; c<used.size(); ++c)
+  {
+    if ( used[c] || ( g[row][c] == 0 )) continue;
+    used[c] = true;
+    best = std::max( best, g[row][c] + brute_force_best( g, row+1, used ));
+    used[c] = false;
+  }
+  return best;
+}
+
+//
+// A random graph on n_rows x n_cols; about density of the possible
+// edges are present, with weights in [1, max_weight].  Each row's
+// edges are added in random column order.
+//
+
+void
+make_graph( mt19937& rng, size_t n_rows, size_t n_cols, double density, unsigned max_weight,
+            dense_graph& g, sparse_assignment& lap )
+{
+  g.assign( n_rows, vector< unsigned >( n_cols, 0 ));
+  lap = sparse_assignment();
+  lap.n_cols = n_cols;
+  vector< size_t > cols( n_cols );
+  for (size_t c=0; c<n_cols; ++c) cols[c] = c;
+
+  for (size_t r=0; r<n_rows; ++r)
+  {
+    std::shuffle( cols.begin(), cols.end(), rng );
+    for (size_t k=0; k<n_cols; ++k)
+    {
+      if ( ( rng() % 1000 ) >= density * 1000 ) continue;
+      unsigned w = 1 + rng() % max_weight;
+      g[r][ cols[k] ] = w;
+      lap.add_edge( cols[k], w );
+    }
+    lap.end_row();
+  }
+}
+
+//
+// The assignment is one-to-one, uses only edges of the graph, and
+// its weight is what solve() returned.
+//
+
+bool
+is_consistent( const dense_graph& g, const sparse_assignment& lap, unsigned long long total )
+{
+  if ( ( lap.col_for_row.size() != lap.n_rows() ) || ( lap.row_for_col.size() != lap.n_cols )) return false;
+
+  unsigned long long sum = 0;
+  for (size_t r=0; r<lap.n_rows(); ++r)
+  {
+    size_t c = lap.col_for_row[r];
+    if ( c == sparse_assignment::npos ) continue;
+    if ( ( c >= lap.n_cols ) || ( lap.row_for_col[c] != r ) || ( g[r][c] == 0 )) return false;
+    sum += g[r][c];
+  }
+  for (size_t c=0; c<lap.n_cols; ++c)
+  {
+    size_t r = lap.row_for_col[c];
+    if ( ( r != sparse_assignment::npos ) && ( lap.col_for_row[r] != c )) return false;
+  }
+  return sum == total;
+}
+
+void
+test_against_brute_force()
+{
+  mt19937 rng( 1234 );
+  const double densities[] = { 0.15, 0.35, 0.7, 1.0 };
+  const unsigned max_weights[] = { 1, 3, 50 };
+
+  unsigned n_wrong_total = 0, n_inconsistent = 0, n_graphs = 0;
+  for (size_t n_rows=1; n_rows<=6; ++n_rows)
+  {
+    for (size_t n_cols=1; n_cols<=6; ++n_cols)
+    {
+      for (size_t d=0; d<sizeof( densities ) / sizeof( densities[0] ); ++d)
+      {
+        for (size_t w=0; w<sizeof( max_weights ) / sizeof( max_weights[0] ); ++w)
+        {
+          for (unsigned trial=0; trial<8; ++trial)
+          {
+            dense_graph g;
+            sparse_assignment lap;
+            make_graph( rng, n_rows, n_cols, densities[d], max_weights[w], g, lap );
+
+            vector< bool > used( n_cols, false );
+            unsigned long long expected = brute_force_best( g, 0, used );
+            unsigned long long total = lap.solve( 1 );
+            if ( total != expected ) ++n_wrong_total;
+            if ( ! is_consistent( g, lap, total )) ++n_inconsistent;
+            ++n_graphs;
+          }
+        }
+      }
+    }
+  }
+
+  ostringstream oss;
+  oss << "Optimal total weight on " << n_graphs << " random graphs";
+  TEST( oss.str().c_str(), n_wrong_total == 0 );
+  TEST( "Assignments are one-to-one and use the graph's edges", n_inconsistent == 0 );
+}
+
+void
+test_empty_graphs()
+{
+  sparse_assignment no_rows;
+  no_rows.n_cols = 3;
+  TEST( "No rows: zero weight", no_rows.solve( 1 ) == 0 );
+  TEST( "No rows: columns unassigned",
+        no_rows.row_for_col == vector< size_t >( 3, sparse_assignment::npos ));
+
+  sparse_assignment no_edges;
+  no_edges.n_cols = 2;
+  no_edges.end_row();
+  no_edges.end_row();
+  TEST( "No edges: zero weight", no_edges.solve( 1 ) == 0 );
+  TEST( "No edges: rows unassigned",
+        no_edges.col_for_row == vector< size_t >( 2, sparse_assignment::npos ));
+}
+
+//
+// Larger graphs made of many small blocks, so that there are many
+// components to spread across the threads; each block is checked by
+// brute force and the threaded assignment must be identical to the
+// serial one.
+//
+
+void
+test_threads()
+{
+  mt19937 rng( 5678 );
+  const size_t n_blocks = 200, block_rows = 5, block_cols = 4;
+
+  sparse_assignment lap;
+  lap.n_cols = n_blocks * block_cols;
+  unsigned long long expected = 0;
+  for (size_t b=0; b<n_blocks; ++b)
+  {
+    dense_graph g;
+    sparse_assignment block;
+    make_graph( rng, block_rows, block_cols, 0.5, 20, g, block );
+    vector< bool > used( block_cols, false );
+    expected += brute_force_best( g, 0, used );
+    for (size_t r=0; r<block_rows; ++r)
+    {
+      for (size_t k=block.row_begin[r]; k<block.row_begin[r+1]; ++k)
+      {
+        lap.add_edge( b * block_cols + block.cols[k], block.weights[k] );
+      }
+      lap.end_row();
+    }
+  }
+
+  sparse_assignment serial( lap ), threaded( lap );
+  unsigned long long serial_total = serial.solve( 1 );
+  unsigned long long threaded_total = threaded.solve( 4 );
+  TEST( "Block graph: optimal total weight", serial_total == expected );
+  TEST( "Block graph: same total on 4 threads", threaded_total == serial_total );
+  TEST( "Block graph: same assignment on 4 threads",
+        ( threaded.col_for_row == serial.col_for_row ) && ( threaded.row_for_col == serial.row_for_col ));
+}
+
+} // ...anon
+
+void
+test_sparse_assignment()
+{
+  test_against_brute_force();
+  test_empty_graphs();
+  test_threads();
+}
+
+TESTMAIN( test_sparse_assignment );
@@ -0,0 +1,275 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+//
+// Check that a track_set_snapshot round trip recreates the tracks with
+// exactly the fields they had, in order, leaving absent fields absent;
+// and that missing or damaged snapshots are refused without creating
+// any tracks.
+//
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <testlib/testlib_test.h>
+
+#include <vgl/vgl_box_2d.h>
+
+#include <track_oracle/core/track_field.h>
+#include <track_oracle/core/track_oracle_core.h>
+#include <track_oracle/data_terms/data_terms.h>
+
+#include <scoring_framework/score_core.h>
+#include <scoring_framework/track_set_snapshot.h>
+
+using std::ifstream;
+using std::istreambuf_iterator;
+using std::mt19937;
+using std::ofstream;
+using std::ostringstream;
+using std::string;
+using std::vector;
+
+using kwiver::track_oracle::frame_handle_list_type;
+using kwiver::track_oracle::frame_handle_type;
+using kwiver::track_oracle::track_field;
+using kwiver::track_oracle::track_handle_list_type;
+using kwiver::track_oracle::track_handle_type;
+using kwiver::track_oracle::track_oracle_core;
+
+using namespace kwiver::kwant;
+
+namespace dt = ::kwiver::track_oracle::dt;
+
+namespace // anon
+{
+
+//
+// The fields the snapshot keeps beyond scorable_track_type, declared
+// as the loaders declare them.
+//
+
+struct extra_fields
+{
+  track_field< double > relevancy;
+  track_field< int > activity;
+  track_field< double > activity_probability;
+  track_field< dt::events::event_type > event_type;
+  track_field< dt::events::event_probability > event_probability;
+  track_field< vector< double > > descriptor_classifier;
+  track_field< dt::tracking::track_style > track_style;
+  track_field< unsigned > gtct_pair_index;
+
+  extra_fields()
+    : relevancy( "relevancy" ),
+      activity( "activity" ),
+      activity_probability( "activity_probability" ),
+      descriptor_classifier( "descriptor_classifier" ),
+      gtct_pair_index( "gtct_pair_index" )
+  {}
+};
+
+//
+// A track with a random subset of the optional fields, and frames with
+// a random subset of theirs.
+//
+
+track_handle_type
+make_track( mt19937& rng, unsigned id )
+{
+  scorable_track_type s;
+  extra_fields f;
+  track_handle_type t = s.create();
+  if ( rng() % 8 ) s( t ).external_id() = id;
+  if ( rng() % 2 ) f.relevancy( t.row ) = ( rng() % 1000 ) / 7.0;
+  if ( rng() % 2 ) f.activity( t.row ) = static_cast< int >( rng() % 40 ) - 1;
+  if ( rng() % 2 ) f.activity_probability( t.row ) = ( rng() % 1000 ) / 999.0;
+  if ( rng() % 3 == 0 ) f.event_type( t.row ) = static_cast< int >( rng() % 20 );
+  if ( rng() % 3 == 0 ) f.event_probability( t.row ) = ( rng() % 1000 ) / 1001.0;
+  if ( rng() % 3 == 0 )
+  {
+    vector< double > classifier( rng() % 5 );
+    for (size_t k=0; k<classifier.size(); ++k) classifier[k] = ( rng() % 1000 ) / 3.0;
+    f.descriptor_classifier( t.row ) = classifier;
+  }
+  if ( rng() % 3 == 0 )
+  {
+    const char* styles[] = { "", "kwxml", "a longer track style" };
+    f.track_style( t.row ) = styles[ rng() % 3 ];
+  }
+  if ( rng() % 2 ) f.gtct_pair_index( t.row ) = rng() % 10;
+
+  unsigned n_frames = rng() % 12;
+  for (unsigned j=0; j<n_frames; ++j)
+  {
+    frame_handle_type fh = s( t ).create_frame();
+    if ( rng() % 5 )
+    {
+      double x = ( rng() % 10000 ) / 8.0, y = ( rng() % 10000 ) / 8.0;
+      s[ fh ].bounding_box() = vgl_box_2d<double>( x, x + rng() % 50, y, y + rng() % 50 );
+    }
+    if ( rng() % 5 ) s[ fh ].timestamp_frame() = 100 + j;
+    if ( rng() % 5 ) s[ fh ].timestamp_usecs() = 1000000ULL * 1000000ULL + j * 33333ULL;
+  }
+  return t;
+}
+
+//
+// Everything the snapshot keeps about a track, as a string: each field
+// is written if present, with doubles in full precision.
+//
+
+string
+describe( const track_handle_type& t )
+{
+  scorable_track_type s;
+  extra_fields f;
+  ostringstream oss;
+  oss.precision( 17 );
+  if ( s.external_id.exists( t.row )) oss << "id " << s.external_id( t.row ) << "; ";
+  if ( f.relevancy.exists( t.row )) oss << "relevancy " << f.relevancy( t.row ) << "; ";
+  if ( f.activity.exists( t.row )) oss << "activity " << f.activity( t.row ) << "; ";
+  if ( f.activity_probability.exists( t.row )) oss << "activity_probability " << f.activity_probability( t.row ) << "; ";
+  if ( f.event_type.exists( t.row )) oss << "event_type " << f.event_type( t.row ) << "; ";
+  if ( f.event_probability.exists( t.row )) oss << "event_probability " << f.event_probability( t.row ) << "; ";
+  if ( f.descriptor_classifier.exists( t.row ))
+  {
+    const vector< double >& c = f.descriptor_classifier( t.row );
+    oss << "classifier " << c.size() << ":";
+    for (size_t k=0; k<c.size(); ++k) oss << " " << c[k];
+    oss << "; ";
+  }
+  if ( f.track_style.exists( t.row )) oss << "style '" << f.track_style( t.row ) << "'; ";
+  if ( f.gtct_pair_index.exists( t.row )) oss << "gtct " << f.gtct_pair_index( t.row ) << "; ";
+
+  frame_handle_list_type frames = track_oracle_core::get_frames( t );
+  oss << frames.size() << " frames:";
+  for (size_t j=0; j<frames.size(); ++j)
+  {
+    const frame_handle_type& fh = frames[j];
+    oss << " [";
+    if ( s.bounding_box.exists( fh.row ))
+    {
+      const vgl_box_2d<double>& b = s.bounding_box( fh.row );
+      oss << "box " << b.min_x() << " " << b.min_y() << " " << b.max_x() << " " << b.max_y() << " ";
+    }
+    if ( s.timestamp_frame.exists( fh.row )) oss << "frame " << s.timestamp_frame( fh.row ) << " ";
+    if ( s.timestamp_usecs.exists( fh.row )) oss << "ts " << s.timestamp_usecs( fh.row );
+    oss << "]";
+  }
+  return oss.str();
+}
+
+unsigned
+n_differences( const track_handle_list_type& a, const track_handle_list_type& b )
+{
+  if ( a.size() != b.size() ) return 1 + a.size() + b.size();
+  unsigned n = 0;
+  for (size_t i=0; i<a.size(); ++i)
+  {
+    if ( describe( a[i] ) != describe( b[i] )) ++n;
+  }
+  return n;
+}
+
+string
+file_contents( const string& fn )
+{
+  ifstream is( fn.c_str(), std::ios::binary );
+  return string( istreambuf_iterator< char >( is ), istreambuf_iterator< char >() );
+}
+
+void
+write_file( const string& fn, const string& contents )
+{
+  ofstream os( fn.c_str(), std::ios::binary );
+  os.write( contents.data(), contents.size() );
+}
+
+//
+// read() on fn fails and leaves the lists alone.
+//
+
+bool
+is_refused( const string& fn )
+{
+  track_handle_list_type t, c;
+  bool detection_mode = false;
+  return ( ! track_set_snapshot::read( fn, t, c, detection_mode )) && t.empty() && c.empty();
+}
+
+} // ...anon
+
+void
+test_track_set_snapshot()
+{
+  const string fn = "test_track_set_snapshot.snapshot.tmp";
+  const string damaged_fn = "test_track_set_snapshot.damaged.tmp";
+  mt19937 rng( 3141 );
+
+  track_handle_list_type truth, computed;
+  for (unsigned i=0; i<40; ++i) truth.push_back( make_track( rng, i ));
+  for (unsigned i=0; i<60; ++i) computed.push_back( make_track( rng, 1000+i ));
+
+  TEST( "Write the snapshot", track_set_snapshot::write( fn, truth, computed, true ));
+
+  // read() appends to the lists it's given
+  track_handle_list_type truth_back( 1, make_track( rng, 9999 )), computed_back;
+  track_handle_type existing = truth_back[0];
+  bool detection_mode = false;
+  TEST( "Read the snapshot", track_set_snapshot::read( fn, truth_back, computed_back, detection_mode ));
+  TEST( "Detection mode survives", detection_mode );
+  TEST( "Read appends to the truth list",
+        ( ! truth_back.empty() ) && ( truth_back[0].row == existing.row ));
+  if ( ! truth_back.empty() ) truth_back.erase( truth_back.begin() );
+
+  unsigned n_truth_diffs = n_differences( truth, truth_back );
+  unsigned n_computed_diffs = n_differences( computed, computed_back );
+  ostringstream oss;
+  oss << "Truth tracks round-trip field for field (" << n_truth_diffs << " differ)";
+  TEST( oss.str().c_str(), n_truth_diffs == 0 );
+  oss.str( "" );
+  oss << "Computed tracks round-trip field for field (" << n_computed_diffs << " differ)";
+  TEST( oss.str().c_str(), n_computed_diffs == 0 );
+
+  // not in detection mode, with no computed tracks
+  track_handle_list_type empty, t2, c2;
+  detection_mode = true;
+  TEST( "Write a snapshot of truth only", track_set_snapshot::write( fn, truth, empty, false ));
+  TEST( "Read a snapshot of truth only",
+        track_set_snapshot::read( fn, t2, c2, detection_mode ) &&
+        ( ! detection_mode ) && c2.empty() && ( n_differences( truth, t2 ) == 0 ));
+
+  // damaged files
+  string good = file_contents( fn );
+  std::remove( damaged_fn.c_str() );
+  TEST( "A missing snapshot is refused", is_refused( damaged_fn ));
+
+  write_file( damaged_fn, "" );
+  TEST( "An empty file is refused", is_refused( damaged_fn ));
+
+  write_file( damaged_fn, good.substr( 0, good.size() / 2 ));
+  TEST( "A truncated snapshot is refused", is_refused( damaged_fn ));
+
+  string bad_magic( good );
+  bad_magic[0] ^= 0x20;
+  write_file( damaged_fn, bad_magic );
+  TEST( "A file with the wrong magic is refused", is_refused( damaged_fn ));
+
+  string bad_version( good );
+  bad_version[8] = static_cast< char >( bad_version[8] + 1 );
+  write_file( damaged_fn, bad_version );
+  TEST( "A snapshot of another version is refused", is_refused( damaged_fn ));
+
+  std::remove( damaged_fn.c_str() );
+  std::remove( fn.c_str() );
+}
+
+TESTMAIN( test_track_set_snapshot );
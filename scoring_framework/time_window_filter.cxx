@@ -24,6 +24,7 @@ using std::ostringstream;
 using std::runtime_error;
 using std::string;
 using std::swap;
+using std::vector;
 
 using kwiver::track_oracle::track_handle_type;
 using kwiver::track_oracle::frame_handle_list_type;
@@ -145,6 +146,20 @@ time_window_filter
 bool
 time_window_filter
 ::track_passes_filter( const track_handle_type& t ) const
+{
+  return this->check_track( t, /* pass_if_missing = */ false );
+}
+
+bool
+time_window_filter
+::track_may_pass_filter( const track_handle_type& t ) const
+{
+  return this->check_track( t, /* pass_if_missing = */ true );
+}
+
+bool
+time_window_filter
+::check_track( const track_handle_type& t, bool pass_if_missing ) const
 {
   track_field< unsigned long long > ts_usecs( "timestamp_usecs" );
   track_field< unsigned > ts_frame( "frame_number" );
@@ -160,6 +175,7 @@ time_window_filter
     {
       if ( ! ts_frame.exists( row ))
       {
+        if ( pass_if_missing ) return true;
         LOG_WARN( main_logger, "Time window is on frames but track does not have frame numbers?  Rejecting" );
         return false;
       }
@@ -170,22 +186,15 @@ time_window_filter
     {
       if ( ! ts_usecs.exists( row ))
       {
+        if ( pass_if_missing ) return true;
         LOG_WARN( main_logger, "Time window is on timestamps but track does not have timestamps?  Rejecting" );
         return false;
       }
       unsigned long long ts = ts_usecs( row );
       in_window = (this->min <= ts) && (ts <= this->max);
     }
-    if ( ( ! in_window ) && ( ! this->inclusive ))
-    {
-      // we're outside the window, and the window is exclusive; return false
-      return false;
-    }
-    if ( in_window && this->inclusive )
-    {
-      // we're inside the window, and the window is inclusive-- return true
-      return true;
-    }
+    int verdict = this->frame_verdict( in_window );
+    if ( verdict != 0 ) return ( verdict > 0 );
   } // each frame
 
   if (this->inclusive)
@@ -200,6 +209,51 @@ time_window_filter
   }
 }
 
+bool
+time_window_filter
+::frames_may_pass_filter( const vector< frame_time_type >& frames ) const
+{
+  const double lo = static_cast< double >( this->min ) - 1.0;
+  const double hi = static_cast< double >( this->max ) + 1.0;
+  for (size_t i=0; i<frames.size(); ++i)
+  {
+    const frame_time_type& f = frames[i];
+    bool in_window;
+    if (this->units_are_frames)
+    {
+      if ( ! f.has_frame_number ) return true;
+      in_window = (this->min <= f.frame_number) && (f.frame_number <= this->max);
+    }
+    else
+    {
+      if ( ! f.has_timestamp ) return true;
+      in_window = (lo <= f.timestamp_usecs) && (f.timestamp_usecs <= hi);
+    }
+    int verdict = this->frame_verdict( in_window );
+    if ( verdict != 0 ) return ( verdict > 0 );
+  }
+
+  // as in check_track
+  return ( ! this->inclusive );
+}
+
+int
+time_window_filter
+::frame_verdict( bool in_window ) const
+{
+  if ( ( ! in_window ) && ( ! this->inclusive ))
+  {
+    // we're outside the window, and the window is exclusive; the track fails
+    return -1;
+  }
+  if ( in_window && this->inclusive )
+  {
+    // we're inside the window, and the window is inclusive-- the track passes
+    return 1;
+  }
+  return 0;
+}
+
 bool
 time_window_filter
 ::is_valid() const
@@ -11,6 +11,7 @@
 #include <scoring_framework/score_core_export.h>
 
 #include <string>
+#include <vector>
 #include <track_oracle/core/track_oracle_api_types.h>
 #include <scoring_framework/timestamp_utilities.h>
 
@@ -24,10 +25,39 @@ public:
   time_window_filter();
   bool set_from_string( const std::string& s );
   bool track_passes_filter( const kwiver::track_oracle::track_handle_type& t ) const;
+
+  // As track_passes_filter, but frames without the frame number /
+  // timestamp the window is on pass the track rather than rejecting
+  // it, so that tracks may be filtered as they're loaded, before any
+  // missing timestamps are filled in.  Never rejects a track which
+  // track_passes_filter would pass once they are.
+  bool track_may_pass_filter( const kwiver::track_oracle::track_handle_type& t ) const;
+
+  // As track_may_pass_filter, for a track's frames before they're
+  // created in track_oracle (e.g. while streaming a file.)  The reader
+  // may round a timestamp differently, so timestamps within one usec
+  // of the window count as inside it; the check only ever passes more
+  // tracks than track_may_pass_filter would on the stored values.
+  struct frame_time_type
+  {
+    bool has_frame_number;
+    unsigned frame_number;
+    bool has_timestamp;
+    double timestamp_usecs;
+    frame_time_type(): has_frame_number( false ), frame_number( 0 ), has_timestamp( false ), timestamp_usecs( 0 ) {}
+  };
+  bool frames_may_pass_filter( const std::vector< frame_time_type >& frames ) const;
+
   bool is_valid() const;
   static std::string help_text();
 
 private:
+  bool check_track( const kwiver::track_oracle::track_handle_type& t, bool pass_if_missing ) const;
+
+  // 1 if a frame in / out of the window settles that the track passes,
+  // -1 that it fails, or 0 if the next frame must be checked
+  int frame_verdict( bool in_window ) const;
+
   bool units_are_frames; // true if frames, false if timestamp_usecs
   bool inclusive; // true if inclusive, false if exclusive
   bool valid; // true if constructed
@@ -0,0 +1,468 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#include "track_set_snapshot.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include <vgl/vgl_box_2d.h>
+
+#include <track_oracle/core/track_field.h>
+#include <track_oracle/data_terms/data_terms.h>
+
+#include <scoring_framework/mapped_file.h>
+#include <scoring_framework/score_core.h>
+
+#include <vital/logger/logger.h>
+static kwiver::vital::logger_handle_t main_logger( kwiver::vital::get_logger( __FILE__ ) );
+
+using std::memcmp;
+using std::ofstream;
+using std::string;
+using std::vector;
+
+using kwiver::track_oracle::frame_handle_list_type;
+using kwiver::track_oracle::frame_handle_type;
+using kwiver::track_oracle::track_field;
+using kwiver::track_oracle::track_handle_list_type;
+using kwiver::track_oracle::track_handle_type;
+using kwiver::track_oracle::track_oracle_core;
+
+namespace dt = ::kwiver::track_oracle::dt;
+
+namespace // anon
+{
+
+//
+// The file layout: a snapshot_header, then n_truth_tracks +
+// n_computed_tracks snapshot_tracks (truth first), then n_frames
+// snapshot_frames, then n_classifier_values doubles, then
+// n_style_chars characters.  Each track's frames are the frame_count
+// records starting at frame_offset; its descriptor classifier and
+// track style are likewise ranges of the last two sections.  The flags
+// record which optional fields were set, so that absent fields stay
+// absent when read back.  All the structures are multiples of eight
+// bytes so that the sections stay aligned.
+//
+
+const char snapshot_magic[8] = { 'K', 'W', 'T', 'R', 'K', 'S', 'N', 'P' };
+const uint32_t snapshot_version = 2;
+
+enum { SNAPSHOT_DETECTION_MODE = 1 };
+
+enum { TRACK_HAS_EXTERNAL_ID = 1,
+       TRACK_HAS_RELEVANCY = 2,
+       TRACK_HAS_ACTIVITY = 4,
+       TRACK_HAS_ACTIVITY_PROBABILITY = 8,
+       TRACK_HAS_EVENT_TYPE = 16,
+       TRACK_HAS_EVENT_PROBABILITY = 32,
+       TRACK_HAS_CLASSIFIER = 64,
+       TRACK_HAS_TRACK_STYLE = 128,
+       TRACK_HAS_GTCT_PAIR_INDEX = 256 };
+
+enum { FRAME_HAS_BOX = 1,
+       FRAME_HAS_FRAME_NUMBER = 2,
+       FRAME_HAS_TIMESTAMP = 4 };
+
+struct snapshot_header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint32_t track_record_size; // sizeof( snapshot_track ), as a check on the layout
+  uint32_t frame_record_size; // ditto for snapshot_frame
+  uint64_t n_truth_tracks;
+  uint64_t n_computed_tracks;
+  uint64_t n_frames;
+  uint64_t n_classifier_values;
+  uint64_t n_style_chars;
+};
+
+struct snapshot_track
+{
+  uint64_t external_id;
+  uint64_t frame_offset;
+  uint64_t frame_count;
+  uint64_t classifier_offset;
+  uint64_t style_offset;
+  double relevancy;
+  double activity_probability;
+  double event_probability;
+  int32_t activity;
+  int32_t event_type;
+  uint32_t classifier_count;
+  uint32_t style_length;
+  uint32_t gtct_pair_index;
+  uint32_t flags;
+};
+
+struct snapshot_frame
+{
+  double min_x;
+  double min_y;
+  double max_x;
+  double max_y;
+  uint64_t timestamp_usecs;
+  uint32_t frame_number;
+  uint32_t flags;
+};
+
+//
+// The fields we save beyond those in scorable_track_type.  "activity"
+// is the VIRAT activity index set by the loader; the event type and
+// probability come from e.g. xgtf activities.  The descriptor
+// classifier and track style are what score_events reads from kwxml
+// tracks; "gtct_pair_index" is set by the loader under --paired-gtct.
+//
+
+struct snapshot_fields
+{
+  track_field< double > relevancy;
+  track_field< int > activity;
+  track_field< double > activity_probability;
+  track_field< dt::events::event_type > event_type;
+  track_field< dt::events::event_probability > event_probability;
+  track_field< vector< double > > descriptor_classifier;
+  track_field< dt::tracking::track_style > track_style;
+  track_field< unsigned > gtct_pair_index;
+
+  snapshot_fields()
+    : relevancy( "relevancy" ),
+      activity( "activity" ),
+      activity_probability( "activity_probability" ),
+      descriptor_classifier( "descriptor_classifier" ),
+      gtct_pair_index( "gtct_pair_index" )
+  {}
+};
+
+void
+append_tracks( const track_handle_list_type& tracks,
+               vector< snapshot_track >& track_records,
+               vector< snapshot_frame >& frame_records,
+               vector< double >& classifier_values,
+               vector< char >& style_chars )
+{
+  kwiver::kwant::scorable_track_type s;
+  snapshot_fields f;
+
+  for (size_t i=0; i<tracks.size(); ++i)
+  {
+    const track_handle_type& t = tracks[i];
+    snapshot_track tr;
+    std::memset( &tr, 0, sizeof( tr ));
+    if ( s.external_id.exists( t.row ))
+    {
+      tr.external_id = s.external_id( t.row );
+      tr.flags |= TRACK_HAS_EXTERNAL_ID;
+    }
+    if ( f.relevancy.exists( t.row ))
+    {
+      tr.relevancy = f.relevancy( t.row );
+      tr.flags |= TRACK_HAS_RELEVANCY;
+    }
+    if ( f.activity.exists( t.row ))
+    {
+      tr.activity = f.activity( t.row );
+      tr.flags |= TRACK_HAS_ACTIVITY;
+    }
+    if ( f.activity_probability.exists( t.row ))
+    {
+      tr.activity_probability = f.activity_probability( t.row );
+      tr.flags |= TRACK_HAS_ACTIVITY_PROBABILITY;
+    }
+    if ( f.event_type.exists( t.row ))
+    {
+      tr.event_type = f.event_type( t.row );
+      tr.flags |= TRACK_HAS_EVENT_TYPE;
+    }
+    if ( f.event_probability.exists( t.row ))
+    {
+      tr.event_probability = f.event_probability( t.row );
+      tr.flags |= TRACK_HAS_EVENT_PROBABILITY;
+    }
+    if ( f.descriptor_classifier.exists( t.row ))
+    {
+      const vector< double >& c = f.descriptor_classifier( t.row );
+      tr.classifier_offset = classifier_values.size();
+      tr.classifier_count = static_cast< uint32_t >( c.size() );
+      classifier_values.insert( classifier_values.end(), c.begin(), c.end() );
+      tr.flags |= TRACK_HAS_CLASSIFIER;
+    }
+    if ( f.track_style.exists( t.row ))
+    {
+      const string& style = f.track_style( t.row );
+      tr.style_offset = style_chars.size();
+      tr.style_length = static_cast< uint32_t >( style.size() );
+      style_chars.insert( style_chars.end(), style.begin(), style.end() );
+      tr.flags |= TRACK_HAS_TRACK_STYLE;
+    }
+    if ( f.gtct_pair_index.exists( t.row ))
+    {
+      tr.gtct_pair_index = f.gtct_pair_index( t.row );
+      tr.flags |= TRACK_HAS_GTCT_PAIR_INDEX;
+    }
+
+    const frame_handle_list_type& frames = track_oracle_core::get_frames( t );
+    tr.frame_offset = frame_records.size();
+    tr.frame_count = frames.size();
+    for (size_t j=0; j<frames.size(); ++j)
+    {
+      const frame_handle_type& fh = frames[j];
+      snapshot_frame fr;
+      std::memset( &fr, 0, sizeof( fr ));
+      if ( s.bounding_box.exists( fh.row ))
+      {
+        const vgl_box_2d<double>& box = s.bounding_box( fh.row );
+        fr.min_x = box.min_x();
+        fr.min_y = box.min_y();
+        fr.max_x = box.max_x();
+        fr.max_y = box.max_y();
+        fr.flags |= FRAME_HAS_BOX;
+      }
+      if ( s.timestamp_frame.exists( fh.row ))
+      {
+        fr.frame_number = s.timestamp_frame( fh.row );
+        fr.flags |= FRAME_HAS_FRAME_NUMBER;
+      }
+      if ( s.timestamp_usecs.exists( fh.row ))
+      {
+        fr.timestamp_usecs = s.timestamp_usecs( fh.row );
+        fr.flags |= FRAME_HAS_TIMESTAMP;
+      }
+      frame_records.push_back( fr );
+    }
+
+    track_records.push_back( tr );
+  }
+}
+
+track_handle_list_type
+create_tracks( const snapshot_track* track_records,
+               size_t n_tracks,
+               const snapshot_frame* frame_records,
+               const double* classifier_values,
+               const char* style_chars )
+{
+  kwiver::kwant::scorable_track_type s;
+  snapshot_fields f;
+  track_handle_list_type ret;
+  ret.reserve( n_tracks );
+
+  for (size_t i=0; i<n_tracks; ++i)
+  {
+    const snapshot_track& tr = track_records[i];
+    track_handle_type t = s.create();
+    if ( tr.flags & TRACK_HAS_EXTERNAL_ID )
+    {
+      s( t ).external_id() = static_cast< dt::tracking::external_id::Type >( tr.external_id );
+    }
+    if ( tr.flags & TRACK_HAS_RELEVANCY ) f.relevancy( t.row ) = tr.relevancy;
+    if ( tr.flags & TRACK_HAS_ACTIVITY ) f.activity( t.row ) = tr.activity;
+    if ( tr.flags & TRACK_HAS_ACTIVITY_PROBABILITY ) f.activity_probability( t.row ) = tr.activity_probability;
+    if ( tr.flags & TRACK_HAS_EVENT_TYPE ) f.event_type( t.row ) = tr.event_type;
+    if ( tr.flags & TRACK_HAS_EVENT_PROBABILITY ) f.event_probability( t.row ) = tr.event_probability;
+    if ( tr.flags & TRACK_HAS_CLASSIFIER )
+    {
+      const double* c = classifier_values + tr.classifier_offset;
+      f.descriptor_classifier( t.row ) = vector< double >( c, c + tr.classifier_count );
+    }
+    if ( tr.flags & TRACK_HAS_TRACK_STYLE )
+    {
+      f.track_style( t.row ) = string( style_chars + tr.style_offset, tr.style_length );
+    }
+    if ( tr.flags & TRACK_HAS_GTCT_PAIR_INDEX ) f.gtct_pair_index( t.row ) = tr.gtct_pair_index;
+
+    for (size_t j=0; j<tr.frame_count; ++j)
+    {
+      const snapshot_frame& fr = frame_records[ tr.frame_offset + j ];
+      frame_handle_type fh = s( t ).create_frame();
+      if ( fr.flags & FRAME_HAS_BOX )
+      {
+        s[ fh ].bounding_box() = vgl_box_2d<double>( fr.min_x, fr.max_x, fr.min_y, fr.max_y );
+      }
+      if ( fr.flags & FRAME_HAS_FRAME_NUMBER )
+      {
+        s[ fh ].timestamp_frame() = fr.frame_number;
+      }
+      if ( fr.flags & FRAME_HAS_TIMESTAMP )
+      {
+        s[ fh ].timestamp_usecs() = fr.timestamp_usecs;
+      }
+    }
+
+    ret.push_back( t );
+  }
+  return ret;
+}
+
+} // ...anon
+
+namespace kwiver {
+namespace kwant {
+
+namespace track_set_snapshot
+{
+
+bool
+write( const string& fn,
+       const track_handle_list_type& truth_tracks,
+       const track_handle_list_type& computed_tracks,
+       bool detection_mode )
+{
+  vector< snapshot_track > track_records;
+  vector< snapshot_frame > frame_records;
+  vector< double > classifier_values;
+  vector< char > style_chars;
+  track_records.reserve( truth_tracks.size() + computed_tracks.size() );
+  append_tracks( truth_tracks, track_records, frame_records, classifier_values, style_chars );
+  append_tracks( computed_tracks, track_records, frame_records, classifier_values, style_chars );
+
+  snapshot_header hdr;
+  std::memset( &hdr, 0, sizeof( hdr ));
+  std::memcpy( hdr.magic, snapshot_magic, sizeof( snapshot_magic ));
+  hdr.version = snapshot_version;
+  hdr.flags = detection_mode ? SNAPSHOT_DETECTION_MODE : 0;
+  hdr.track_record_size = sizeof( snapshot_track );
+  hdr.frame_record_size = sizeof( snapshot_frame );
+  hdr.n_truth_tracks = truth_tracks.size();
+  hdr.n_computed_tracks = computed_tracks.size();
+  hdr.n_frames = frame_records.size();
+  hdr.n_classifier_values = classifier_values.size();
+  hdr.n_style_chars = style_chars.size();
+
+  // write to a temporary and rename, so a failed write never leaves
+  // a truncated snapshot behind
+
+  string tmp_fn = fn + ".tmp";
+  {
+    ofstream os( tmp_fn.c_str(), std::ios::binary | std::ios::trunc );
+    if ( ! os ) return false;
+    os.write( reinterpret_cast< const char* >( &hdr ), sizeof( hdr ));
+    if ( ! track_records.empty() )
+    {
+      os.write( reinterpret_cast< const char* >( &track_records[0] ), track_records.size() * sizeof( snapshot_track ));
+    }
+    if ( ! frame_records.empty() )
+    {
+      os.write( reinterpret_cast< const char* >( &frame_records[0] ), frame_records.size() * sizeof( snapshot_frame ));
+    }
+    if ( ! classifier_values.empty() )
+    {
+      os.write( reinterpret_cast< const char* >( &classifier_values[0] ), classifier_values.size() * sizeof( double ));
+    }
+    if ( ! style_chars.empty() )
+    {
+      os.write( &style_chars[0], style_chars.size() );
+    }
+    if ( ! os )
+    {
+      os.close();
+      std::remove( tmp_fn.c_str() );
+      return false;
+    }
+  }
+
+#ifdef _WIN32
+  std::remove( fn.c_str() );
+#endif
+  if ( std::rename( tmp_fn.c_str(), fn.c_str() ) != 0 )
+  {
+    std::remove( tmp_fn.c_str() );
+    return false;
+  }
+  return true;
+}
+
+bool
+read( const string& fn,
+      track_handle_list_type& truth_tracks,
+      track_handle_list_type& computed_tracks,
+      bool& detection_mode )
+{
+  mapped_file m( fn );
+  if ( ( ! m.data() ) || ( m.size() < sizeof( snapshot_header )))
+  {
+    LOG_ERROR( main_logger, "Couldn't read track snapshot '" << fn << "'" );
+    return false;
+  }
+
+  const snapshot_header* hdr = reinterpret_cast< const snapshot_header* >( m.data() );
+  if ( ( memcmp( hdr->magic, snapshot_magic, sizeof( snapshot_magic )) != 0 ) ||
+       ( hdr->version != snapshot_version ) ||
+       ( hdr->track_record_size != sizeof( snapshot_track )) ||
+       ( hdr->frame_record_size != sizeof( snapshot_frame )))
+  {
+    LOG_ERROR( main_logger, "'" << fn << "' is not a track snapshot written by this version" );
+    return false;
+  }
+
+  size_t n_truth = static_cast< size_t >( hdr->n_truth_tracks );
+  size_t n_computed = static_cast< size_t >( hdr->n_computed_tracks );
+  size_t n_frames = static_cast< size_t >( hdr->n_frames );
+  size_t n_classifier_values = static_cast< size_t >( hdr->n_classifier_values );
+  size_t n_style_chars = static_cast< size_t >( hdr->n_style_chars );
+  size_t expected_size =
+    sizeof( snapshot_header ) +
+    ( n_truth + n_computed ) * sizeof( snapshot_track ) +
+    n_frames * sizeof( snapshot_frame ) +
+    n_classifier_values * sizeof( double ) +
+    n_style_chars;
+  if ( m.size() != expected_size )
+  {
+    LOG_ERROR( main_logger, "Track snapshot '" << fn << "' is " << m.size() << " bytes; expected "
+               << expected_size );
+    return false;
+  }
+
+  const snapshot_track* track_records =
+    reinterpret_cast< const snapshot_track* >( m.data() + sizeof( snapshot_header ));
+  const snapshot_frame* frame_records =
+    reinterpret_cast< const snapshot_frame* >( track_records + n_truth + n_computed );
+  const double* classifier_values =
+    reinterpret_cast< const double* >( frame_records + n_frames );
+  const char* style_chars =
+    reinterpret_cast< const char* >( classifier_values + n_classifier_values );
+
+  // check the ranges before creating anything
+
+  for (size_t i=0; i<n_truth + n_computed; ++i)
+  {
+    const snapshot_track& tr = track_records[i];
+    if ( ( tr.frame_offset > n_frames ) || ( tr.frame_count > n_frames - tr.frame_offset ))
+    {
+      LOG_ERROR( main_logger, "Track snapshot '" << fn << "': track " << i << " has a bad frame range" );
+      return false;
+    }
+    if ( ( ( tr.flags & TRACK_HAS_CLASSIFIER ) &&
+           ( ( tr.classifier_offset > n_classifier_values ) ||
+             ( tr.classifier_count > n_classifier_values - tr.classifier_offset ))) ||
+         ( ( tr.flags & TRACK_HAS_TRACK_STYLE ) &&
+           ( ( tr.style_offset > n_style_chars ) ||
+             ( tr.style_length > n_style_chars - tr.style_offset ))))
+    {
+      LOG_ERROR( main_logger, "Track snapshot '" << fn << "': track " << i << " has a bad classifier or style range" );
+      return false;
+    }
+  }
+
+  track_handle_list_type t =
+    create_tracks( track_records, n_truth, frame_records, classifier_values, style_chars );
+  track_handle_list_type c =
+    create_tracks( track_records + n_truth, n_computed, frame_records, classifier_values, style_chars );
+  truth_tracks.insert( truth_tracks.end(), t.begin(), t.end() );
+  computed_tracks.insert( computed_tracks.end(), c.begin(), c.end() );
+  detection_mode = ( hdr->flags & SNAPSHOT_DETECTION_MODE ) != 0;
+  return true;
+}
+
+} // ...track_set_snapshot
+
+} // ...kwant
+} // ...kwiver
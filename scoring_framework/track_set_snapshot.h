@@ -0,0 +1,68 @@
+/*ckwg +5
+ * Copyright 2018 by Kitware, Inc. All Rights Reserved. Please refer to
+ * KITWARE_LICENSE.TXT for licensing information, or contact General Counsel,
+ * Kitware, Inc., 28 Corporate Drive, Clifton Park, NY 12065.
+ */
+
+#ifndef INCL_TRACK_SET_SNAPSHOT_H
+#define INCL_TRACK_SET_SNAPSHOT_H
+
+//
+// A binary snapshot of a loaded set of truth and computed tracks.
+//
+// The snapshot holds what the scoring executables read from the
+// tracks once the loader is done with them (i.e. after timestamp
+// generation, rebasing, filtering and detection-mode decomposition):
+// the fields of scorable_track_type, plus the track-level relevancy,
+// activity, event type / probability, kwxml descriptor classifier,
+// track style and --paired-gtct pair index when present.  Reading it
+// back recreates the tracks in track_oracle in the order they were
+// written, which is much faster than re-parsing and re-processing the
+// sources.
+//
+// Anything else the formats carry (e.g. other kwxml descriptors, KPF
+// activity sets, source file IDs) is not kept.
+//
+// Like the phase 1 cache, the file is a flat, native-endian image of
+// fixed-size records, memory-mapped when read, and not meant to be
+// portable between machines.
+//
+
+#include <vital/vital_config.h>
+#include <scoring_framework/score_core_export.h>
+
+#include <string>
+
+#include <track_oracle/core/track_oracle_core.h>
+
+namespace kwiver {
+namespace kwant {
+
+namespace kwto = ::kwiver::track_oracle;
+
+namespace track_set_snapshot
+{
+
+// Write the tracks to fn; detection_mode records whether the tracks
+// were decomposed into detections.  Returns false on failure.
+
+SCORE_CORE_EXPORT bool write( const std::string& fn,
+                              const kwto::track_handle_list_type& truth_tracks,
+                              const kwto::track_handle_list_type& computed_tracks,
+                              bool detection_mode );
+
+// Recreate the tracks in fn, appending them to truth_tracks and
+// computed_tracks.  Returns false (having created no tracks) if the
+// file can't be read or isn't a snapshot of this version.
+
+SCORE_CORE_EXPORT bool read( const std::string& fn,
+                             kwto::track_handle_list_type& truth_tracks,
+                             kwto::track_handle_list_type& computed_tracks,
+                             bool& detection_mode );
+
+} // ...track_set_snapshot
+
+} // ...kwant
+} // ...kwiver
+
+#endif
@@ -217,5 +217,35 @@ track_synthesizer
   return true;
 }
 
+track_handle_type
+track_synthesizer
+::make_linear_track( unsigned id,
+                     unsigned first_frame,
+                     unsigned n_frames,
+                     unsigned frame_step,
+                     const vgl_box_2d<double>& first_box,
+                     double dx,
+                     double dy ) const
+{
+  scorable_track_type t;
+  track_handle_type h = t.create();
+  t( h ).external_id() = id;
+
+  ts_type clock_tick_usecs = static_cast<ts_type>( 1.0 / this->params.fps * 1.0e6 );
+  for (unsigned i = 0; i < n_frames; ++i)
+  {
+    unsigned frame_number = first_frame + i * frame_step;
+    double offset = static_cast<double>( i * frame_step );
+    vgl_box_2d<double> box( first_box.min_x() + offset * dx, first_box.max_x() + offset * dx,
+                            first_box.min_y() + offset * dy, first_box.max_y() + offset * dy );
+
+    frame_handle_type f = t( h ).create_frame();
+    t[ f ].bounding_box() = box;
+    t[ f ].timestamp_frame() = frame_number;
+    t[ f ].timestamp_usecs() = frame_number * clock_tick_usecs;
+  }
+  return h;
+}
+
 } // ...kwant
 } // ...kwiver
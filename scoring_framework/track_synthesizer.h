@@ -112,6 +112,18 @@ public:
   bool make_tracks( const std::string& track_description_string,
                     kwto::track_handle_list_type& output_tracks );
 
+  // a single track of n_frames boxes, one every frame_step frames from
+  // first_frame, starting at first_box and moving (dx, dy) pixels per
+  // frame; for building larger, randomized test sets than
+  // make_tracks() can describe.  Timestamps are as in make_tracks().
+  kwto::track_handle_type make_linear_track( unsigned id,
+                                             unsigned first_frame,
+                                             unsigned n_frames,
+                                             unsigned frame_step,
+                                             const vgl_box_2d<double>& first_box,
+                                             double dx,
+                                             double dy ) const;
+
 private:
   track_synthesizer_params params;
   box_pool bp;